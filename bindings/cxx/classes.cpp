@@ -898,16 +898,48 @@ float TriggerMatch::value() const
 DatafeedCallbackData::DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback) :
 	_callback(move(callback)),
-	_session(session)
+	_session(session),
+	_sdi(nullptr),
+	_devices_generation(0)
 {
 }
 
+shared_ptr<Device> DatafeedCallbackData::get_device(
+	const struct sr_dev_inst *sdi)
+{
+	/* Consecutive packets are mostly from the same device. */
+	if (sdi == _sdi && _devices_generation == _session->_devices_generation)
+		if (auto device = _device.lock())
+			return device;
+
+	auto device = _session->get_device(sdi);
+	_sdi = sdi;
+	_device = device;
+	_devices_generation = _session->_devices_generation;
+	return device;
+}
+
 void DatafeedCallbackData::run(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *pkt)
 {
-	auto device = _session->get_device(sdi);
-	shared_ptr<Packet> packet {new Packet{device, pkt}, default_delete<Packet>{}};
-	_callback(move(device), move(packet));
+	auto device = get_device(sdi);
+
+	/*
+	 * Reuse the packet object of the previous call, unless the callback
+	 * still holds a reference to it, or to its payload.
+	 */
+	if (_packet && _packet.use_count() == 1)
+		_packet->reuse(device, pkt);
+	else
+		_packet.reset(new Packet{device, pkt}, default_delete<Packet>{});
+
+	_callback(move(device), _packet);
+
+	/* Don't keep the device alive through an idle packet object. */
+	if (_packet.use_count() == 1)
+		_packet->_device.reset();
+	else
+		_packet.reset();
 }
 
 SessionDevice::SessionDevice(struct sr_dev_inst *structure) :
@@ -926,7 +958,8 @@ shared_ptr<Device> SessionDevice::get_shared_from_this()
 
 Session::Session(shared_ptr<Context> context) :
 	_structure(nullptr),
-	_context(move(context))
+	_context(move(context)),
+	_devices_generation(0)
 {
 	check(sr_session_new(_context->_structure, &_structure));
 	_context->_session = this;
@@ -935,6 +968,7 @@ Session::Session(shared_ptr<Context> context) :
 Session::Session(shared_ptr<Context> context, string filename) :
 	_structure(nullptr),
 	_context(move(context)),
+	_devices_generation(0),
 	_filename(move(filename))
 {
 	check(sr_session_load(_context->_structure, _filename.c_str(), &_structure));
@@ -970,6 +1004,7 @@ void Session::add_device(shared_ptr<Device> device)
 	const auto dev_struct = device->_structure;
 	check(sr_session_dev_add(_structure, dev_struct));
 	_other_devices[dev_struct] = move(device);
+	_devices_generation++;
 }
 
 vector<shared_ptr<Device>> Session::devices()
@@ -988,6 +1023,7 @@ vector<shared_ptr<Device>> Session::devices()
 void Session::remove_devices()
 {
 	_other_devices.clear();
+	_devices_generation++;
 	check(sr_session_dev_remove_all(_structure));
 }
 
@@ -1078,40 +1114,139 @@ shared_ptr<Context> Session::context()
 	return _context;
 }
 
+void Session::set_statistics_enabled(bool enable)
+{
+	check(sr_session_stats_enable(_structure, enable));
+}
+
+void Session::reset_statistics()
+{
+	check(sr_session_stats_reset(_structure));
+}
+
+static LatencyHistogram convert_histogram(const struct sr_latency_histogram &hist)
+{
+	LatencyHistogram result;
+	result.count = hist.count;
+	result.total_us = hist.total_us;
+	result.max_us = hist.max_us;
+	result.buckets.assign(hist.buckets, hist.buckets + SR_LATENCY_HIST_BUCKETS);
+	return result;
+}
+
+static vector<StageStatistics> convert_stages(GSList *stages)
+{
+	vector<StageStatistics> result;
+	for (GSList *l = stages; l; l = l->next) {
+		auto *const stage = static_cast<struct sr_session_stage_stats *>(l->data);
+		StageStatistics entry;
+		entry.name = valid_string(stage->name);
+		entry.latency = convert_histogram(stage->latency);
+		result.push_back(move(entry));
+	}
+	return result;
+}
+
+SessionStatistics Session::statistics()
+{
+	struct sr_session_stats *stats;
+	check(sr_session_stats_get(_structure, &stats));
+	SessionStatistics result;
+	result.elapsed_us = stats->elapsed_us;
+	for (GSList *l = stats->devices; l; l = l->next) {
+		auto *const dev = static_cast<struct sr_session_dev_stats *>(l->data);
+		DeviceStatistics entry;
+		try {
+			entry.device = get_device(dev->sdi);
+		} catch (const Error &) {
+			// Device was removed from the session meanwhile.
+		}
+		for (int i = 0; i < SR_DF_TYPE_COUNT; i++) {
+			if (!dev->packets[i])
+				continue;
+			const auto type = PacketType::get(SR_DF_HEADER + i);
+			entry.packets[type] = dev->packets[i];
+			entry.bytes[type] = dev->bytes[i];
+		}
+		entry.logic_samples = dev->logic_samples;
+		entry.analog_samples = dev->analog_samples;
+		result.devices.push_back(move(entry));
+	}
+	result.transforms = convert_stages(stats->transforms);
+	result.callbacks = convert_stages(stats->callbacks);
+	result.send = convert_histogram(stats->send);
+	result.fd_lag = convert_histogram(stats->fd_lag);
+	result.usb_lag = convert_histogram(stats->usb_lag);
+	sr_session_stats_free(stats);
+	return result;
+}
+
 Packet::Packet(shared_ptr<Device> device,
 	const struct sr_datafeed_packet *structure) :
-	_structure(structure),
-	_device(move(device))
+	_structure(structure)
 {
+	reuse(move(device), structure);
+}
+
+Packet::~Packet()
+{
+}
+
+void Packet::reuse(shared_ptr<Device> device,
+	const struct sr_datafeed_packet *structure)
+{
+	_device = move(device);
+	_structure = structure;
+
+	/* Keep the payload object if it is of the right type. */
 	switch (structure->type)
 	{
 		case SR_DF_HEADER:
+			if (auto header = dynamic_cast<Header *>(_payload.get())) {
+				header->_structure = static_cast<
+					const struct sr_datafeed_header *>(structure->payload);
+				return;
+			}
 			_payload.reset(new Header{
 				static_cast<const struct sr_datafeed_header *>(
 					structure->payload)});
 			break;
 		case SR_DF_META:
+			if (auto meta = dynamic_cast<Meta *>(_payload.get())) {
+				meta->_structure = static_cast<
+					const struct sr_datafeed_meta *>(structure->payload);
+				return;
+			}
 			_payload.reset(new Meta{
 				static_cast<const struct sr_datafeed_meta *>(
 					structure->payload)});
 			break;
 		case SR_DF_LOGIC:
+			if (auto logic = dynamic_cast<Logic *>(_payload.get())) {
+				logic->_structure = static_cast<
+					const struct sr_datafeed_logic *>(structure->payload);
+				return;
+			}
 			_payload.reset(new Logic{
 				static_cast<const struct sr_datafeed_logic *>(
 					structure->payload)});
 			break;
 		case SR_DF_ANALOG:
+			if (auto analog = dynamic_cast<Analog *>(_payload.get())) {
+				analog->_structure = static_cast<
+					const struct sr_datafeed_analog *>(structure->payload);
+				return;
+			}
 			_payload.reset(new Analog{
 				static_cast<const struct sr_datafeed_analog *>(
 					structure->payload)});
 			break;
+		default:
+			_payload.reset();
+			break;
 	}
 }
 
-Packet::~Packet()
-{
-}
-
 const PacketType *Packet::type() const
 {
 	return PacketType::get(_structure->type);
@@ -1217,6 +1352,58 @@ unsigned int Logic::unit_size() const
 	return _structure->unitsize;
 }
 
+size_t Logic::num_samples() const
+{
+	return _structure->unitsize ? _structure->length / _structure->unitsize : 0;
+}
+
+LogicChannelStates Logic::channel_states(unsigned int channel) const
+{
+	if (channel >= _structure->unitsize * 8)
+		throw Error(SR_ERR_ARG);
+	return LogicChannelStates{static_cast<const uint8_t *>(_structure->data),
+		num_samples(), _structure->unitsize, channel};
+}
+
+LogicTransitions Logic::transitions(unsigned int channel) const
+{
+	if (channel >= _structure->unitsize * 8)
+		throw Error(SR_ERR_ARG);
+	return LogicTransitions{static_cast<const uint8_t *>(_structure->data),
+		num_samples(), _structure->unitsize, channel};
+}
+
+void Logic::get_channel_bits(unsigned int channel, uint8_t *dest,
+	size_t size) const
+{
+	const size_t samples = num_samples();
+	if (size < (samples + 7) / 8)
+		throw Error(SR_ERR_ARG);
+	check(sr_logic_channel_unpack(
+		static_cast<const uint8_t *>(_structure->data),
+		_structure->unitsize, samples, channel, dest));
+}
+
+LogicTransitionIterator LogicTransitions::begin() const
+{
+	return LogicTransitionIterator{_data, _num_samples, _unit_size, _channel,
+		sr_logic_channel_next_edge(_data, _unit_size, _num_samples,
+			_channel, 1)};
+}
+
+LogicTransitionIterator LogicTransitions::end() const
+{
+	return LogicTransitionIterator{_data, _num_samples, _unit_size, _channel,
+		_num_samples};
+}
+
+LogicTransitionIterator &LogicTransitionIterator::operator++()
+{
+	_index = sr_logic_channel_next_edge(_data, _unit_size, _num_samples,
+		_channel, _index + 1);
+	return *this;
+}
+
 Analog::Analog(const struct sr_datafeed_analog *structure) :
 	PacketPayload(),
 	_structure(structure)
@@ -1243,6 +1430,14 @@ void Analog::get_data_as_float(float *dest)
 	check(sr_analog_to_float(_structure, dest));
 }
 
+void Analog::get_data_as_float(float *dest, size_t size)
+{
+	if (size < static_cast<size_t>(_structure->num_samples) *
+			g_slist_length(_structure->meaning->channels))
+		throw Error(SR_ERR_ARG);
+	check(sr_analog_to_float(_structure, dest));
+}
+
 unsigned int Analog::num_samples() const
 {
 	return _structure->num_samples;
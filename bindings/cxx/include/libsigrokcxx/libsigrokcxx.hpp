@@ -79,6 +79,7 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 G_GNUC_END_IGNORE_DEPRECATIONS
 
 #include <functional>
+#include <iterator>
 #include <stdexcept>
 #include <memory>
 #include <vector>
@@ -588,7 +589,16 @@ private:
 	DatafeedCallbackFunction _callback;
 	DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback);
+	std::shared_ptr<Device> get_device(const struct sr_dev_inst *sdi);
 	Session *_session;
+	/* Device of the most recent packet, and the session's device list
+	   generation it was looked up in. */
+	const struct sr_dev_inst *_sdi;
+	std::weak_ptr<Device> _device;
+	unsigned int _devices_generation;
+	/* Packet object which is reused while the callback keeps no
+	   reference to it. */
+	std::shared_ptr<Packet> _packet;
 	friend class Session;
 };
 
@@ -606,6 +616,62 @@ private:
 	friend struct std::default_delete<SessionDevice>;
 };
 
+/** Histogram of durations, see struct sr_latency_histogram */
+struct SR_API LatencyHistogram
+{
+	/** Number of samples. */
+	uint64_t count;
+	/** Sum of all durations in us. */
+	uint64_t total_us;
+	/** Longest duration in us. */
+	uint64_t max_us;
+	/** Bucket n counts durations of [2^(n-1), 2^n) us. */
+	std::vector<uint64_t> buckets;
+};
+
+/** Datafeed counters of one device in a session */
+struct SR_API DeviceStatistics
+{
+	/** The device which sent the packets. */
+	std::shared_ptr<Device> device;
+	/** Packets sent, per packet type. */
+	std::map<const PacketType *, uint64_t> packets;
+	/** Payload bytes sent, per packet type. */
+	std::map<const PacketType *, uint64_t> bytes;
+	/** Number of logic samples sent. */
+	uint64_t logic_samples;
+	/** Number of analog samples sent. */
+	uint64_t analog_samples;
+};
+
+/** Latency of one datafeed processing stage */
+struct SR_API StageStatistics
+{
+	/** Transform module ID, empty for datafeed callbacks. */
+	std::string name;
+	/** Time spent in this stage per packet. */
+	LatencyHistogram latency;
+};
+
+/** Snapshot of a session's datafeed statistics */
+struct SR_API SessionStatistics
+{
+	/** Time since collection was enabled or reset, in us. */
+	uint64_t elapsed_us;
+	/** Per-device counters. */
+	std::vector<DeviceStatistics> devices;
+	/** Transforms in processing order. */
+	std::vector<StageStatistics> transforms;
+	/** Datafeed callbacks in registration order. */
+	std::vector<StageStatistics> callbacks;
+	/** Total time spent per packet in the session datafeed. */
+	LatencyHistogram send;
+	/** Main loop dispatch lag of fd and timer event sources. */
+	LatencyHistogram fd_lag;
+	/** Main loop dispatch lag of USB event sources. */
+	LatencyHistogram usb_lag;
+};
+
 /** A sigrok session */
 class SR_API Session : public UserOwned<Session>
 {
@@ -641,6 +707,13 @@ public:
 	void set_trigger(std::shared_ptr<Trigger> trigger);
 	/** Get filename this session was loaded from. */
 	std::string filename() const;
+	/** Enable or disable the collection of datafeed statistics.
+	 * @param enable Whether to collect statistics. */
+	void set_statistics_enabled(bool enable);
+	/** Reset all datafeed statistics to zero. */
+	void reset_statistics();
+	/** Get a snapshot of the datafeed statistics. */
+	SessionStatistics statistics();
 private:
 	explicit Session(std::shared_ptr<Context> context);
 	Session(std::shared_ptr<Context> context, std::string filename);
@@ -650,6 +723,7 @@ private:
 	const std::shared_ptr<Context> _context;
 	std::map<const struct sr_dev_inst *, std::unique_ptr<SessionDevice> > _owned_devices;
 	std::map<const struct sr_dev_inst *, std::shared_ptr<Device> > _other_devices;
+	unsigned int _devices_generation;
 	std::vector<std::unique_ptr<DatafeedCallbackData> > _datafeed_callbacks;
 	SessionStoppedCallback _stopped_callback;
 	std::string _filename;
@@ -673,6 +747,8 @@ private:
 	Packet(std::shared_ptr<Device> device,
 		const struct sr_datafeed_packet *structure);
 	~Packet();
+	void reuse(std::shared_ptr<Device> device,
+		const struct sr_datafeed_packet *structure);
 	const struct sr_datafeed_packet *_structure;
 	std::shared_ptr<Device> _device;
 	std::unique_ptr<PacketPayload> _payload;
@@ -741,6 +817,114 @@ private:
 	friend class Packet;
 };
 
+/** Iterator over the states of one channel in logic data */
+class SR_API LogicChannelIterator
+{
+public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef bool value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const bool *pointer;
+	typedef bool reference;
+
+	LogicChannelIterator() : _byte(nullptr), _unit_size(0), _shift(0) {}
+	bool operator*() const { return (*_byte >> _shift) & 1; }
+	LogicChannelIterator &operator++() { _byte += _unit_size; return *this; }
+	LogicChannelIterator operator++(int)
+		{ auto prev = *this; ++*this; return prev; }
+	bool operator==(const LogicChannelIterator &other) const
+		{ return _byte == other._byte; }
+	bool operator!=(const LogicChannelIterator &other) const
+		{ return _byte != other._byte; }
+private:
+	LogicChannelIterator(const uint8_t *byte, unsigned int unit_size,
+			unsigned int shift) :
+		_byte(byte), _unit_size(unit_size), _shift(shift) {}
+	const uint8_t *_byte;
+	unsigned int _unit_size;
+	unsigned int _shift;
+	friend class LogicChannelStates;
+};
+
+/** Range of the states of one channel in logic data, without copying */
+class SR_API LogicChannelStates
+{
+public:
+	/** Iterator to the first sample's state. */
+	LogicChannelIterator begin() const
+		{ return LogicChannelIterator{_data, _unit_size, _shift}; }
+	/** Iterator past the last sample's state. */
+	LogicChannelIterator end() const
+		{ return LogicChannelIterator{_data + _num_samples * _unit_size,
+			_unit_size, _shift}; }
+	/** Number of samples. */
+	size_t size() const { return _num_samples; }
+private:
+	LogicChannelStates(const uint8_t *data, size_t num_samples,
+			unsigned int unit_size, unsigned int channel) :
+		_data(data + channel / 8), _num_samples(num_samples),
+		_unit_size(unit_size), _shift(channel % 8) {}
+	const uint8_t *_data;
+	size_t _num_samples;
+	unsigned int _unit_size;
+	unsigned int _shift;
+	friend class Logic;
+};
+
+/** Iterator over the indices of samples where a logic channel changes */
+class SR_API LogicTransitionIterator
+{
+public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef uint64_t value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const uint64_t *pointer;
+	typedef uint64_t reference;
+
+	LogicTransitionIterator() :
+		_data(nullptr), _num_samples(0), _unit_size(0), _channel(0),
+		_index(0) {}
+	uint64_t operator*() const { return _index; }
+	LogicTransitionIterator &operator++();
+	LogicTransitionIterator operator++(int)
+		{ auto prev = *this; ++*this; return prev; }
+	bool operator==(const LogicTransitionIterator &other) const
+		{ return _index == other._index; }
+	bool operator!=(const LogicTransitionIterator &other) const
+		{ return _index != other._index; }
+private:
+	LogicTransitionIterator(const uint8_t *data, size_t num_samples,
+			unsigned int unit_size, unsigned int channel, uint64_t index) :
+		_data(data), _num_samples(num_samples), _unit_size(unit_size),
+		_channel(channel), _index(index) {}
+	const uint8_t *_data;
+	size_t _num_samples;
+	unsigned int _unit_size;
+	unsigned int _channel;
+	uint64_t _index;
+	friend class LogicTransitions;
+};
+
+/** Range of the indices of samples where a logic channel changes */
+class SR_API LogicTransitions
+{
+public:
+	/** Iterator to the first change. */
+	LogicTransitionIterator begin() const;
+	/** Iterator past the last change. */
+	LogicTransitionIterator end() const;
+private:
+	LogicTransitions(const uint8_t *data, size_t num_samples,
+			unsigned int unit_size, unsigned int channel) :
+		_data(data), _num_samples(num_samples), _unit_size(unit_size),
+		_channel(channel) {}
+	const uint8_t *_data;
+	size_t _num_samples;
+	unsigned int _unit_size;
+	unsigned int _channel;
+	friend class Logic;
+};
+
 /** Payload of a datafeed packet with logic data */
 class SR_API Logic :
 	public ParentOwned<Logic, Packet>,
@@ -753,6 +937,30 @@ public:
 	size_t data_length() const;
 	/* Size of each sample in bytes. */
 	unsigned int unit_size() const;
+	/** Number of samples in this packet. */
+	size_t num_samples() const;
+	/**
+	 * States of one channel, as a range over the packet's data.
+	 * The range is only valid as long as the packet's data is.
+	 * @param channel Index of the channel within a sample.
+	 */
+	LogicChannelStates channel_states(unsigned int channel) const;
+	/**
+	 * Indices of the samples where a channel's state differs from the
+	 * previous sample's. The range is only valid as long as the packet's
+	 * data is.
+	 * @param channel Index of the channel within a sample.
+	 */
+	LogicTransitions transitions(unsigned int channel) const;
+	/**
+	 * Fills dest with the states of one channel, one bit per sample,
+	 * least significant bit first.
+	 * @param channel Index of the channel within a sample.
+	 * @param dest Buffer for the states.
+	 * @param size Size of dest in bytes, at least (num_samples() + 7) / 8.
+	 */
+	void get_channel_bits(unsigned int channel, uint8_t *dest,
+		size_t size) const;
 private:
 	explicit Logic(const struct sr_datafeed_logic *structure);
 	~Logic();
@@ -778,6 +986,13 @@ public:
 	 * The pointer must have space for num_samples() floats.
 	 */
 	void get_data_as_float(float *dest);
+	/**
+	 * Fills dest with the analog data converted to float.
+	 * @param dest Buffer for the converted data.
+	 * @param size Number of floats which dest can hold, at least
+	 *             num_samples() times the number of channels.
+	 */
+	void get_data_as_float(float *dest, size_t size);
 	/** Number of samples in this packet. */
 	unsigned int num_samples() const;
 	/** Channels for which this packet contains data. */
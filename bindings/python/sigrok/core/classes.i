@@ -48,6 +48,7 @@ which provides access to the error code and description."
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <pygobject.h>
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/arrayobject.h>
@@ -71,6 +72,12 @@ typedef guint pyg_flags_type;
 #define string_to_python PyString_FromString
 #endif
 
+/*
+ * Nesting depth of datafeed callbacks into Python. Only modified with
+ * the GIL held.
+ */
+static int datafeed_depth = 0;
+
 %}
 
 %init %{
@@ -221,7 +228,9 @@ typedef guint pyg_flags_type;
 
         auto arglist = Py_BuildValue("(OO)", device_obj, packet_obj);
 
+        datafeed_depth++;
         auto result = PyObject_CallObject($input, arglist);
+        datafeed_depth--;
 
         Py_XDECREF(arglist);
         Py_XDECREF(device_obj);
@@ -400,6 +409,361 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     return output;
 }
 
+/*
+ * Owner of the memory behind a NumPy array of packet payload data.
+ *
+ * The payload data of packets which are passed to a datafeed callback is
+ * only valid until the callback returns. Arrays which are created during
+ * the callback are therefore backed by a copy, which the array owns, and
+ * remain valid for as long as Python references them. Arrays of other
+ * packets view the payload data in place, and keep the packet alive.
+ */
+struct PayloadData
+{
+    std::shared_ptr<sigrok::Packet> packet;
+    void *copy;
+};
+
+static void payload_data_destroy(PyObject *capsule)
+{
+    auto *const owner = static_cast<PayloadData *>(
+        PyCapsule_GetPointer(capsule, "sigrok.PayloadData"));
+    g_free(owner->copy);
+    delete owner;
+}
+
+/* Create a NumPy array of packet payload data. */
+PyObject *payload_to_array(std::shared_ptr<sigrok::Packet> packet,
+    int nd, npy_intp *dims, int typenum, void *data, size_t length)
+{
+    auto *const owner = new PayloadData{nullptr, nullptr};
+
+    if (datafeed_depth > 0 || !packet) {
+        owner->copy = g_malloc(length);
+        if (length)
+            memcpy(owner->copy, data, length);
+        data = owner->copy;
+    } else {
+        owner->packet = std::move(packet);
+    }
+
+    auto array = PyArray_SimpleNewFromData(nd, dims, typenum, data);
+    if (!array) {
+        g_free(owner->copy);
+        delete owner;
+        return nullptr;
+    }
+
+    auto base = PyCapsule_New(owner, "sigrok.PayloadData",
+        payload_data_destroy);
+    if (!base) {
+        Py_DECREF(array);
+        g_free(owner->copy);
+        delete owner;
+        return nullptr;
+    }
+
+    /* This steals the reference to base, even on failure. */
+    if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject *>(array),
+            base) < 0) {
+        Py_DECREF(array);
+        return nullptr;
+    }
+
+    return array;
+}
+
+/* Hand over a vector to a NumPy array, which takes ownership of it. */
+template <class T>
+static void vector_destroy(PyObject *capsule)
+{
+    delete static_cast<std::vector<T> *>(
+        PyCapsule_GetPointer(capsule, "sigrok.BatchData"));
+}
+
+template <class T>
+static PyObject *vector_to_array(std::vector<T> *vec,
+    int nd, npy_intp *dims, int typenum)
+{
+    auto array = PyArray_SimpleNewFromData(nd, dims, typenum, vec->data());
+    if (!array) {
+        delete vec;
+        return nullptr;
+    }
+
+    auto base = PyCapsule_New(vec, "sigrok.BatchData", vector_destroy<T>);
+    if (!base) {
+        Py_DECREF(array);
+        delete vec;
+        return nullptr;
+    }
+
+    if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject *>(array),
+            base) < 0) {
+        Py_DECREF(array);
+        return nullptr;
+    }
+
+    return array;
+}
+
+/*
+ * Accumulator for batched datafeed callbacks.
+ *
+ * Logic and analog packets are collected without holding the GIL. The
+ * Python callback is called once per batch, with one contiguous array of
+ * logic samples, and one contiguous array of samples per analog channel.
+ * A batch is passed on when it holds the configured number of packets,
+ * when the configured interval has elapsed since its first packet, when
+ * the data format or the analog measurement changes, and before any other
+ * type of packet, which includes the end of the stream.
+ *
+ * The interval gets enforced by a timer in the session's main context,
+ * so a batch doesn't wait for the next packet when the source stalls.
+ * The main context is the one which dispatches the source that sends the
+ * batch's first packet, which keeps the callback in the session's thread.
+ */
+class DatafeedBatch
+{
+public:
+    DatafeedBatch(PyObject *callback, unsigned int max_packets,
+            double max_interval) :
+        _callback(callback),
+        _max_packets(max_packets ? max_packets : 1),
+        _max_interval(max_interval * G_USEC_PER_SEC),
+        _packets(0),
+        _start(0),
+        _unit_size(0),
+        _logic(nullptr),
+        _mq(nullptr),
+        _unit(nullptr),
+        _timer(nullptr)
+    {
+        Py_XINCREF(_callback);
+    }
+
+    ~DatafeedBatch()
+    {
+        discard();
+        auto gstate = PyGILState_Ensure();
+        Py_XDECREF(_callback);
+        PyGILState_Release(gstate);
+    }
+
+    void add(std::shared_ptr<sigrok::Device> device,
+        std::shared_ptr<sigrok::Packet> packet)
+    {
+        const int type = packet->type()->id();
+
+        if (type != SR_DF_LOGIC && type != SR_DF_ANALOG) {
+            flush();
+            return;
+        }
+
+        if (_packets && device != _device)
+            flush();
+
+        if (type == SR_DF_LOGIC)
+            add_logic(std::dynamic_pointer_cast<sigrok::Logic>(
+                packet->payload()));
+        else
+            add_analog(std::dynamic_pointer_cast<sigrok::Analog>(
+                packet->payload()));
+
+        if (!_packets++) {
+            _device = std::move(device);
+            _start = g_get_monotonic_time();
+            start_timer();
+        }
+
+        if (_packets >= _max_packets ||
+                g_get_monotonic_time() - _start >= _max_interval)
+            flush();
+    }
+
+private:
+    void add_logic(std::shared_ptr<sigrok::Logic> logic)
+    {
+        const unsigned int unit_size = logic->unit_size();
+
+        if (_logic && unit_size != _unit_size)
+            flush();
+        if (!_logic)
+            _logic = new std::vector<uint8_t>();
+        _unit_size = unit_size;
+
+        auto data = static_cast<const uint8_t *>(logic->data_pointer());
+        _logic->insert(_logic->end(), data, data + logic->data_length());
+    }
+
+    void add_analog(std::shared_ptr<sigrok::Analog> analog)
+    {
+        const auto channels = analog->channels();
+        const size_t num_samples = analog->num_samples();
+        const auto mq = analog->mq();
+        const auto unit = analog->unit();
+        const auto mq_flags = analog->mq_flags();
+
+        /* Samples of a different meaning go to a batch of their own. */
+        if (!_analog.empty() && (mq != _mq || unit != _unit ||
+                mq_flags != _mq_flags))
+            flush();
+        _mq = mq;
+        _unit = unit;
+        _mq_flags = mq_flags;
+
+        _convert.resize(channels.size() * num_samples);
+        analog->get_data_as_float(_convert.data());
+
+        for (size_t i = 0; i < channels.size(); i++) {
+            auto &samples = _analog[channels[i]->name()];
+            if (!samples)
+                samples = new std::vector<float>();
+            samples->insert(samples->end(),
+                _convert.begin() + i * num_samples,
+                _convert.begin() + (i + 1) * num_samples);
+        }
+    }
+
+    static gboolean timer_expired(void *data)
+    {
+        auto batch = static_cast<DatafeedBatch *>(data);
+
+        /* The main context holds the source while it dispatches. */
+        g_source_unref(batch->_timer);
+        batch->_timer = nullptr;
+        try {
+            batch->flush();
+        } catch (const sigrok::Error &) {
+            /* The callback's error got printed, keep the session going. */
+        }
+
+        return G_SOURCE_REMOVE;
+    }
+
+    void start_timer()
+    {
+        GSource *current;
+
+        if (_max_interval <= 0)
+            return;
+        current = g_main_current_source();
+        if (!current)
+            return;
+
+        _timer = g_timeout_source_new((_max_interval + 999) / 1000);
+        g_source_set_callback(_timer, timer_expired, this, nullptr);
+        g_source_attach(_timer, g_source_get_context(current));
+    }
+
+    void stop_timer()
+    {
+        if (!_timer)
+            return;
+        g_source_destroy(_timer);
+        g_source_unref(_timer);
+        _timer = nullptr;
+    }
+
+    void discard()
+    {
+        stop_timer();
+        delete _logic;
+        _logic = nullptr;
+        for (auto &entry : _analog)
+            delete entry.second;
+        _analog.clear();
+        _device.reset();
+        _packets = 0;
+    }
+
+    void flush()
+    {
+        if (!_packets)
+            return;
+
+        auto gstate = PyGILState_Ensure();
+
+        auto device_obj = SWIG_NewPointerObj(
+            SWIG_as_voidptr(new std::shared_ptr<sigrok::Device>(_device)),
+            SWIGTYPE_p_std__shared_ptrT_sigrok__Device_t, SWIG_POINTER_OWN);
+
+        PyObject *logic_obj;
+        if (_logic) {
+            npy_intp dims[2];
+            dims[0] = _logic->size() / _unit_size;
+            dims[1] = _unit_size;
+            logic_obj = vector_to_array(_logic, 2, dims, NPY_UINT8);
+            _logic = nullptr;
+        } else {
+            Py_INCREF(Py_None);
+            logic_obj = Py_None;
+        }
+
+        auto analog_obj = PyDict_New();
+        for (auto &entry : _analog) {
+            npy_intp dims[1];
+            dims[0] = entry.second->size();
+            auto array = vector_to_array(entry.second, 1, dims, NPY_FLOAT);
+            if (array) {
+                PyDict_SetItemString(analog_obj, entry.first.c_str(), array);
+                Py_DECREF(array);
+            }
+        }
+        _analog.clear();
+
+        discard();
+
+        PyObject *result = nullptr;
+        if (logic_obj) {
+            auto arglist = Py_BuildValue("(OOO)",
+                device_obj, logic_obj, analog_obj);
+            result = PyObject_CallObject(_callback, arglist);
+            Py_XDECREF(arglist);
+        }
+
+        Py_XDECREF(device_obj);
+        Py_XDECREF(logic_obj);
+        Py_XDECREF(analog_obj);
+
+        bool completed = !PyErr_Occurred();
+
+        if (!completed)
+            PyErr_Print();
+
+        bool valid_result = (completed && result == Py_None);
+
+        Py_XDECREF(result);
+
+        if (completed && !valid_result)
+        {
+            PyErr_SetString(PyExc_TypeError,
+                "Datafeed callback did not return None");
+            PyErr_Print();
+        }
+
+        PyGILState_Release(gstate);
+
+        if (!valid_result)
+            throw sigrok::Error(SR_ERR);
+    }
+
+    PyObject *_callback;
+    unsigned int _max_packets;
+    gint64 _max_interval;
+    std::shared_ptr<sigrok::Device> _device;
+    unsigned int _packets;
+    gint64 _start;
+    unsigned int _unit_size;
+    std::vector<uint8_t> *_logic;
+    std::map<std::string, std::vector<float> *> _analog;
+    const sigrok::Quantity *_mq;
+    const sigrok::Unit *_unit;
+    std::vector<const sigrok::QuantityFlag *> _mq_flags;
+    std::vector<float> _convert;
+    GSource *_timer;
+};
+
 %}
 
 /* Ignore these methods, we will override them below. */
@@ -554,7 +918,9 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
         dims[1] = $self->num_samples();
         int typenum = NPY_FLOAT;
         void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(nd, dims, typenum, data);
+        size_t length = dims[0] * dims[1] * sizeof(float);
+        return payload_to_array($self->parent(), nd, dims, typenum,
+            data, length);
     }
 
 %pythoncode
@@ -573,7 +939,9 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
         dims[1] = $self->unit_size();
         int typenum = NPY_UINT8;
         void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(2, dims, typenum, data);
+        size_t length = dims[0] * dims[1];
+        return payload_to_array($self->parent(), 2, dims, typenum,
+            data, length);
     }
 
 %pythoncode
@@ -582,6 +950,47 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
 }
 }
 
+/* Support batched datafeed callbacks. */
+%extend sigrok::Session
+{
+    void _add_batched_datafeed_callback(PyObject *callback,
+        unsigned int max_packets, double max_interval)
+    {
+        if (!PyCallable_Check(callback))
+            throw sigrok::Error(SR_ERR_ARG);
+
+        auto batch = std::make_shared<DatafeedBatch>(callback,
+            max_packets, max_interval);
+
+        $self->add_datafeed_callback([=] (
+                std::shared_ptr<sigrok::Device> device,
+                std::shared_ptr<sigrok::Packet> packet) {
+            batch->add(std::move(device), std::move(packet));
+        });
+    }
+}
+
+%pythoncode
+{
+    def _Session_add_batched_datafeed_callback(self, callback,
+            packets=64, interval=0.05):
+        """Add a datafeed callback which receives data in batches.
+
+        The callback is called as callback(device, logic, analog). logic
+        is a NumPy array of shape (samples, unit size) with the logic data
+        of up to the given number of packets, or None. analog is a dict
+        mapping channel names to NumPy arrays of float samples. A batch is
+        passed on after the given number of packets, after the given
+        interval in seconds even when no more packets arrive, when the
+        analog quantity, unit or flags change, and before any packet which
+        holds no samples, like the end of the acquisition. All samples of
+        a batch share one analog meaning. The arrays own their data, and
+        remain valid after the callback."""
+        self._add_batched_datafeed_callback(callback, packets, interval)
+
+    Session.add_batched_datafeed_callback = _Session_add_batched_datafeed_callback
+}
+
 /* Create logic packet from Python buffer. */
 %extend sigrok::Context
 {
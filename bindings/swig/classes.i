@@ -81,6 +81,16 @@ template< class T > class enable_shared_from_this;
 
 %ignore sigrok::DatafeedCallbackData;
 
+/* Iterator based views of packet data are for C++ use only. */
+%ignore sigrok::LogicChannelIterator;
+%ignore sigrok::LogicChannelStates;
+%ignore sigrok::LogicTransitionIterator;
+%ignore sigrok::LogicTransitions;
+%ignore sigrok::Logic::channel_states;
+%ignore sigrok::Logic::transitions;
+%ignore sigrok::Logic::get_channel_bits;
+%ignore sigrok::Analog::get_data_as_float(float *, size_t);
+
 #ifndef SWIGJAVA
 
 #define SWIG_ATTRIBUTE_TEMPLATE
@@ -89,6 +89,9 @@ enum sr_valid_code {
 
 #define SR_MAX_CHANNELNAME_LEN 32
 
+/** Buffer size which fits any string from sr_float_to_string(). */
+#define SR_FLOAT_STRING_SIZE 16
+
 /* Handy little macros */
 #define SR_HZ(n)  (n)
 #define SR_KHZ(n) ((n) * UINT64_C(1000))
@@ -107,6 +110,12 @@ enum sr_loglevel {
 	SR_LOG_SPEW = 5, /**< Output very noisy debug messages. */
 };
 
+/** Flags for sr_log_async_start(). */
+enum sr_log_async_flags {
+	/** Have sr_log() wait for ring space instead of dropping messages. */
+	SR_LOG_ASYNC_LOSSLESS = 1 << 0,
+};
+
 /*
  * Use SR_API to mark public API symbols, and SR_PRIV for private symbols.
  *
@@ -581,6 +590,68 @@ struct sr_analog_spec {
 	int8_t spec_digits;
 };
 
+/** Number of buckets in a struct sr_latency_histogram. */
+#define SR_LATENCY_HIST_BUCKETS 24
+
+/** Number of datafeed packet types, see enum sr_packettype. */
+#define SR_DF_TYPE_COUNT (SR_DF_ANALOG - SR_DF_HEADER + 1)
+
+/**
+ * Histogram of durations in microseconds. Bucket 0 counts durations
+ * below 1us, bucket n counts durations of [2^(n-1), 2^n) us. The last
+ * bucket also counts all longer durations.
+ */
+struct sr_latency_histogram {
+	/** Number of samples. */
+	uint64_t count;
+	/** Sum of all durations, in us. */
+	uint64_t total_us;
+	/** Longest duration, in us. */
+	uint64_t max_us;
+	/** Duration buckets. */
+	uint64_t buckets[SR_LATENCY_HIST_BUCKETS];
+};
+
+/** Datafeed counters of one device in a session. */
+struct sr_session_dev_stats {
+	/** The device which sent the packets. */
+	const struct sr_dev_inst *sdi;
+	/** Packets sent, indexed by (packet type - SR_DF_HEADER). */
+	uint64_t packets[SR_DF_TYPE_COUNT];
+	/** Payload bytes sent, indexed by (packet type - SR_DF_HEADER). */
+	uint64_t bytes[SR_DF_TYPE_COUNT];
+	/** Number of logic samples sent. */
+	uint64_t logic_samples;
+	/** Number of analog samples sent. */
+	uint64_t analog_samples;
+};
+
+/** Latency of one datafeed processing stage in a session. */
+struct sr_session_stage_stats {
+	/** Transform module ID, or NULL for datafeed callbacks. */
+	const char *name;
+	/** Time spent in this stage per packet. */
+	struct sr_latency_histogram latency;
+};
+
+/** Snapshot of a session's datafeed statistics, see sr_session_stats_get(). */
+struct sr_session_stats {
+	/** Time since collection was enabled or reset, in us. */
+	uint64_t elapsed_us;
+	/** Per-device counters, list of struct sr_session_dev_stats. */
+	GSList *devices;
+	/** Transforms in processing order, list of struct sr_session_stage_stats. */
+	GSList *transforms;
+	/** Datafeed callbacks in registration order, list of struct sr_session_stage_stats. */
+	GSList *callbacks;
+	/** Total time spent per packet in the session datafeed. */
+	struct sr_latency_histogram send;
+	/** Main loop dispatch lag of fd and timer event sources. */
+	struct sr_latency_histogram fd_lag;
+	/** Main loop dispatch lag of USB event sources. */
+	struct sr_latency_histogram usb_lag;
+};
+
 /** Generic option struct used by various subsystems. */
 struct sr_option {
 	/* Short name suitable for commandline usage, [a-z0-9-]. */
@@ -620,10 +691,12 @@ enum sr_output_flag {
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
 };
 
+struct sr_convert_job;
 struct sr_input;
 struct sr_input_module;
 struct sr_output;
 struct sr_output_module;
+struct sr_output_sink;
 struct sr_transform;
 struct sr_transform_module;
 
@@ -57,6 +57,36 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API int sr_a2l_threshold_packed(const float *input, uint64_t count,
+		float threshold, uint8_t *output);
+SR_API int sr_a2l_schmitt_trigger_packed(const float *input, uint64_t count,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output);
+SR_API int sr_logic_channel_unpack(const uint8_t *data, size_t unitsize,
+		uint64_t count, unsigned int channel, uint8_t *output);
+SR_API uint64_t sr_logic_channel_next_edge(const uint8_t *data,
+		size_t unitsize, uint64_t count, unsigned int channel,
+		uint64_t start);
+
+/*--- convert.c -------------------------------------------------------------*/
+
+typedef void (*sr_convert_progress_callback)(const struct sr_convert_job *job,
+		uint64_t bytes_done, uint64_t bytes_total, gboolean finished,
+		void *cb_data);
+
+SR_API struct sr_convert_job *sr_convert_job_new(const char *input_file,
+		const char *input_format, GHashTable *input_options,
+		const char *output_format, GHashTable *output_options,
+		const char *output_file);
+SR_API int sr_convert_job_transform_add(struct sr_convert_job *job,
+		const char *id, GHashTable *options);
+SR_API const char *sr_convert_job_input_file_get(const struct sr_convert_job *job);
+SR_API const char *sr_convert_job_output_file_get(const struct sr_convert_job *job);
+SR_API int sr_convert_job_result_get(const struct sr_convert_job *job);
+SR_API int sr_convert_job_cancel(struct sr_convert_job *job);
+SR_API void sr_convert_job_free(struct sr_convert_job *job);
+SR_API int sr_convert_run(struct sr_context *ctx, GSList *jobs,
+		unsigned int num_threads, sr_convert_progress_callback cb,
+		void *cb_data);
 
 /*--- log.c -----------------------------------------------------------------*/
 
@@ -68,6 +98,8 @@ SR_API int sr_log_loglevel_get(void);
 SR_API int sr_log_callback_set(sr_log_callback cb, void *cb_data);
 SR_API int sr_log_callback_set_default(void);
 SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data);
+SR_API int sr_log_async_start(size_t ring_size, uint32_t flags);
+SR_API int sr_log_async_stop(void);
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -140,6 +172,8 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 		struct sr_dev_inst *sdi);
 SR_API int sr_session_dev_list(struct sr_session *session, GSList **devlist);
 SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig);
+SR_API int sr_session_dev_threads_set(struct sr_session *session,
+		gboolean enable);
 
 /* Datafeed setup */
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
@@ -154,6 +188,20 @@ SR_API int sr_session_is_running(struct sr_session *session);
 SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data);
 
+/* Datafeed statistics */
+SR_API int sr_session_stats_enable(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_stats_reset(struct sr_session *session);
+SR_API int sr_session_stats_get(struct sr_session *session,
+		struct sr_session_stats **stats);
+SR_API void sr_session_stats_free(struct sr_session_stats *stats);
+
+/* Analog reading coalescing */
+SR_API int sr_session_analog_coalesce_set(struct sr_session *session,
+		unsigned int max_samples, unsigned int max_ms);
+SR_API int sr_analog_timestamps_get(const struct sr_datafeed_analog *analog,
+		const int64_t **timestamps);
+
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
@@ -176,6 +224,10 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in);
 SR_API const struct sr_input_module *sr_input_module_get(const struct sr_input *in);
 SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in);
 SR_API int sr_input_send(const struct sr_input *in, GString *buf);
+SR_API int sr_input_send_mapped(const struct sr_input *in,
+		void *data, size_t len);
+SR_API int sr_input_send_file(const struct sr_input *in,
+		const char *filename, uint64_t *offset);
 SR_API int sr_input_end(const struct sr_input *in);
 SR_API int sr_input_reset(const struct sr_input *in);
 SR_API void sr_input_free(const struct sr_input *in);
@@ -200,6 +252,19 @@ SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out);
 SR_API int sr_output_free(const struct sr_output *o);
 
+/*--- output/sink.c ---------------------------------------------------------*/
+
+SR_API int sr_output_sink_new_buffer(struct sr_output_sink **sink);
+SR_API int sr_output_sink_new_fd(int fd, struct sr_output_sink **sink);
+SR_API int sr_output_sink_new_file(const char *filename,
+		struct sr_output_sink **sink);
+SR_API GString *sr_output_sink_buffer(struct sr_output_sink *sink);
+SR_API int sr_output_send_to_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink);
+SR_API int sr_output_sink_flush(struct sr_output_sink *sink);
+SR_API int sr_output_sink_free(struct sr_output_sink *sink);
+
 /*--- transform/transform.c -------------------------------------------------*/
 
 SR_API const struct sr_transform_module **sr_transform_list(void);
@@ -241,6 +306,7 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 		sr_resource_open_callback open_cb,
 		sr_resource_close_callback close_cb,
 		sr_resource_read_callback read_cb, void *cb_data);
+SR_API int sr_resource_cache_clear(struct sr_context *ctx);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
@@ -263,6 +329,7 @@ SR_API int sr_snprintf_ascii(char *buf, size_t buf_size,
 		const char *format, ...);
 SR_API int sr_vsnprintf_ascii(char *buf, size_t buf_size,
 		const char *format, va_list args);
+SR_API int sr_float_to_string(float value, char *buf, size_t buf_size);
 SR_API int sr_parse_rational(const char *str, struct sr_rational *ret);
 SR_API char *sr_text_trim_spaces(char *s);
 SR_API char *sr_text_next_line(char *s, size_t l, char **next, size_t *taken);
@@ -676,6 +676,7 @@ SR_API int sr_exit(struct sr_context *ctx)
 	libusb_exit(ctx->libusb_ctx);
 #endif
 
+	sr_resource_cache_free(ctx);
 	g_free(sr_driver_list(ctx));
 	g_free(ctx);
 
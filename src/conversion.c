@@ -23,6 +23,7 @@
  * Conversion helper functions.
  */
 
+#include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -107,3 +108,310 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 
 	return SR_OK;
 }
+
+static inline unsigned int lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	unsigned int bit;
+
+	for (bit = 0; !(word & 1); bit++)
+		word >>= 1;
+
+	return bit;
+#endif
+}
+
+/* Get a word with bits [first, last) set, last can be 64. */
+static inline uint64_t bit_range(unsigned int first, unsigned int last)
+{
+	uint64_t below_last;
+
+	below_last = last < 64 ? ((uint64_t)1 << last) - 1 : ~(uint64_t)0;
+
+	return below_last & (~(uint64_t)0 << first);
+}
+
+/* Gather the lowest bits of eight bytes of 0 or 1 into one byte. */
+static inline uint8_t pack_flags8(const uint8_t *flags)
+{
+	return (RL64(flags) * 0x0102040810204080ULL) >> 56;
+}
+
+/* Get a word with bit i set where the flag at offset i is set. */
+static inline uint64_t pack_flags64(const uint8_t *flags)
+{
+	uint64_t word;
+	unsigned int i;
+
+	word = 0;
+	for (i = 0; i < 8; i++)
+		word |= (uint64_t)pack_flags8(&flags[8 * i]) << (8 * i);
+
+	return word;
+}
+
+/**
+ * Convert analog values to a bitmap of logic values by using a fixed
+ * threshold.
+ *
+ * Sample n is stored in bit (n % 8) of output byte n / 8, like
+ * sr_logic_channel_unpack() does. Unused bits of the last output byte
+ * are cleared.
+ *
+ * @param[in] input The analog input values.
+ * @param[in] count The number of samples to process.
+ * @param[in] threshold The threshold to use. Values at or above it
+ *                      become 1.
+ * @param[out] output The converted output values. Must provide space
+ *                    for (count + 7) / 8 bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_threshold_packed(const float *input, uint64_t count,
+		float threshold, uint8_t *output)
+{
+	uint8_t flags[64], bits;
+	unsigned int i;
+
+	if (!input || !output)
+		return SR_ERR_ARG;
+
+	/*
+	 * Compare blocks of 64 values into flag bytes, which the
+	 * compiler can vectorize, then gather the flags into bits.
+	 */
+	while (count >= 64) {
+		for (i = 0; i < 64; i++)
+			flags[i] = input[i] >= threshold;
+		for (i = 0; i < 8; i++)
+			output[i] = pack_flags8(&flags[8 * i]);
+		input += 64;
+		output += 8;
+		count -= 64;
+	}
+
+	while (count) {
+		bits = 0;
+		for (i = 0; i < 8 && i < count; i++)
+			bits |= (input[i] >= threshold) << i;
+		*output++ = bits;
+		input += i;
+		count -= i;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Convert analog values to a bitmap of logic values by using a
+ * Schmitt-trigger algorithm.
+ *
+ * The output layout is the same as for sr_a2l_threshold_packed().
+ *
+ * @param[in] input The analog input values.
+ * @param[in] count The number of samples to process.
+ * @param[in] lo_thr The low threshold - result becomes 0 below it.
+ * @param[in] hi_thr The high threshold - result becomes 1 above it.
+ * @param[in,out] state The internal converter state. Must contain the
+ *                      state of logic sample n-1, will contain the state
+ *                      of logic sample n+count upon exit.
+ * @param[out] output The converted output values. Must provide space
+ *                    for (count + 7) / 8 bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_schmitt_trigger_packed(const float *input, uint64_t count,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output)
+{
+	uint8_t lo_flags[64], hi_flags[64];
+	unsigned int i, n, pos;
+	uint64_t lo, hi, bits, pending;
+	uint8_t s;
+
+	if (!input || !state || !output)
+		return SR_ERR_ARG;
+
+	s = *state ? 1 : 0;
+	while (count) {
+		/* Compare blocks of up to 64 values against both thresholds. */
+		if (count >= 64) {
+			n = 64;
+			for (i = 0; i < 64; i++)
+				lo_flags[i] = input[i] < lo_thr;
+			for (i = 0; i < 64; i++)
+				hi_flags[i] = input[i] > hi_thr;
+		} else {
+			n = count;
+			memset(lo_flags, 0, sizeof(lo_flags));
+			memset(hi_flags, 0, sizeof(hi_flags));
+			for (i = 0; i < n; i++) {
+				lo_flags[i] = input[i] < lo_thr;
+				hi_flags[i] = input[i] > hi_thr;
+			}
+		}
+		lo = pack_flags64(lo_flags);
+		hi = pack_flags64(hi_flags);
+
+		/*
+		 * Only visit the samples which change the state: the next
+		 * one below the low threshold while the state is 1, or the
+		 * next one above the high threshold while it is 0. Most
+		 * blocks don't change the state at all.
+		 */
+		bits = 0;
+		pos = 0;
+		while (pos < n) {
+			pending = (s ? lo : hi) & (~(uint64_t)0 << pos);
+			i = pending ? lowest_bit(pending) : n;
+			if (!s) {
+				if (!pending)
+					break;
+				pos = i;
+				s = 1;
+				continue;
+			}
+			/* The low threshold wins, the sample at i is 0. */
+			bits |= bit_range(pos, i);
+			pos = i + 1;
+			s = !pending;
+		}
+		for (i = 0; i < n; i += 8)
+			*output++ = bits >> i;
+		input += n;
+		count -= n;
+	}
+	*state = s;
+
+	return SR_OK;
+}
+
+/* Collect the bytes holding a channel's bit from 8 consecutive samples. */
+static inline uint64_t logic_gather8(const uint8_t *data, size_t unitsize)
+{
+	uint64_t bytes;
+	unsigned int i;
+
+	if (unitsize == 1)
+		return RL64(data);
+
+	bytes = 0;
+	for (i = 0; i < 8; i++)
+		bytes |= (uint64_t)data[i * unitsize] << (8 * i);
+
+	return bytes;
+}
+
+/**
+ * Extract the states of one logic channel into a bitmap.
+ *
+ * Sample n of the channel is stored in bit (n % 8) of output byte n / 8.
+ * Unused bits of the last output byte are cleared.
+ *
+ * @param[in] data The logic samples, unitsize bytes per sample.
+ * @param[in] unitsize The size of a sample in bytes.
+ * @param[in] count The number of samples to process.
+ * @param[in] channel The index of the channel to extract.
+ * @param[out] output The channel's states. Must provide space for
+ *                    (count + 7) / 8 bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_channel_unpack(const uint8_t *data, size_t unitsize,
+		uint64_t count, unsigned int channel, uint8_t *output)
+{
+	const uint64_t lsbs = 0x0101010101010101ULL;
+	unsigned int shift, i;
+	uint64_t bytes;
+	uint8_t last;
+
+	if (!data || !output || !unitsize || channel >= unitsize * 8)
+		return SR_ERR_ARG;
+
+	data += channel / 8;
+	shift = channel % 8;
+
+	/*
+	 * Process eight samples at a time: mask the channel's bit in each
+	 * of the eight bytes, and let a multiplication move the bits into
+	 * the most significant byte.
+	 */
+	while (count >= 8) {
+		bytes = (logic_gather8(data, unitsize) >> shift) & lsbs;
+		*output++ = (bytes * 0x0102040810204080ULL) >> 56;
+		data += 8 * unitsize;
+		count -= 8;
+	}
+
+	if (count) {
+		last = 0;
+		for (i = 0; i < count; i++)
+			last |= ((data[i * unitsize] >> shift) & 1) << i;
+		*output = last;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Find the next change of a logic channel's state.
+ *
+ * @param[in] data The logic samples, unitsize bytes per sample.
+ * @param[in] unitsize The size of a sample in bytes.
+ * @param[in] count The number of samples in data.
+ * @param[in] channel The index of the channel to inspect.
+ * @param[in] start The index of the first sample to inspect. Sample 0
+ *                  never is a change, since it has no predecessor.
+ *
+ * @return The index of the first sample from start on whose state of
+ *         the channel differs from the previous sample's, or count if
+ *         there is none, or if an argument is invalid.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_channel_next_edge(const uint8_t *data,
+		size_t unitsize, uint64_t count, unsigned int channel,
+		uint64_t start)
+{
+	uint64_t mask, bytes, prev;
+
+	if (!data || !unitsize || channel >= unitsize * 8)
+		return count;
+	if (start < 1)
+		start = 1;
+	if (start >= count)
+		return count;
+
+	data += channel / 8;
+	mask = 0x0101010101010101ULL << (channel % 8);
+
+	/*
+	 * Compare eight samples at a time against their predecessors, by
+	 * XOR-ing the gathered bytes with themselves shifted by one byte.
+	 */
+	prev = data[(start - 1) * unitsize];
+	while (count - start >= 8) {
+		bytes = logic_gather8(&data[start * unitsize], unitsize);
+		if ((bytes ^ ((bytes << 8) | prev)) & mask)
+			break;
+		prev = bytes >> 56;
+		start += 8;
+	}
+
+	for (; start < count; start++) {
+		if ((data[start * unitsize] ^ data[(start - 1) * unitsize]) & mask)
+			return start;
+	}
+
+	return count;
+}
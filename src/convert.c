@@ -0,0 +1,658 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "convert"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Batch conversion of files between input and output formats.
+ */
+
+/**
+ * @defgroup grp_convert Batch conversion
+ *
+ * Convert files from one format into another, several at a time.
+ *
+ * A conversion job names an input file and its format, an optional
+ * chain of transforms, and an output format and file. A batch of jobs
+ * gets run by a pool of worker threads. Every job has a session of its
+ * own, so jobs don't share any state besides the libsigrok context.
+ *
+ * The input gets mapped into memory and passed to the input module in
+ * slices, output gets written to the destination file in chunks. The
+ * memory a job needs is therefore bounded by the slice size and by the
+ * modules' own buffering, not by the size of the files.
+ *
+ * Jobs can be cancelled from any thread, e.g. from the progress
+ * callback. A cancelled job stops before its next slice of input, and
+ * removes the partial output file.
+ *
+ * @{
+ */
+
+/* Size of the slices of input data which get sent at a time. */
+#define SLICE_SIZE (16 * 1024 * 1024)
+
+struct convert_transform {
+	char *id;
+	GHashTable *options;
+};
+
+struct sr_convert_job {
+	char *input_file;
+	char *input_format;
+	GHashTable *input_options;
+	GSList *transforms;
+	char *output_format;
+	GHashTable *output_options;
+	char *output_file;
+
+	int result;
+	gint cancelled;
+	uint64_t bytes_done;
+	uint64_t bytes_total;
+
+	/* Used while the job runs. */
+	const struct sr_output *out;
+	struct sr_output_sink *sink;
+	int feed_result;
+	GAsyncQueue *progress;
+};
+
+/* Progress of a job, passed from a worker to the calling thread. */
+struct convert_progress {
+	struct sr_convert_job *job;
+	uint64_t bytes_done;
+	gboolean finished;
+};
+
+static GHashTable *options_ref(GHashTable *options)
+{
+	return options ? g_hash_table_ref(options) : NULL;
+}
+
+static void options_unref(GHashTable *options)
+{
+	if (options)
+		g_hash_table_unref(options);
+}
+
+static void convert_transform_free(void *data)
+{
+	struct convert_transform *ct;
+
+	ct = data;
+	g_free(ct->id);
+	options_unref(ct->options);
+	g_free(ct);
+}
+
+/**
+ * Create a new conversion job.
+ *
+ * @param input_file The file to convert. Must not be NULL.
+ * @param input_format The ID of the input module to read the file with.
+ *                     If NULL, the format gets detected from the file.
+ * @param input_options Options for the input module, as for
+ *                      sr_input_new(). May be NULL. The job takes a
+ *                      reference.
+ * @param output_format The ID of the output module. Must not be NULL.
+ * @param output_options Options for the output module, as for
+ *                       sr_output_new(). May be NULL. The job takes a
+ *                       reference.
+ * @param output_file The file to write. Must not be NULL.
+ *
+ * @return A new job, or NULL on invalid arguments. The job must be freed
+ *         with sr_convert_job_free().
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_convert_job *sr_convert_job_new(const char *input_file,
+		const char *input_format, GHashTable *input_options,
+		const char *output_format, GHashTable *output_options,
+		const char *output_file)
+{
+	struct sr_convert_job *job;
+
+	if (!input_file || !*input_file || !output_format
+			|| !output_file || !*output_file) {
+		sr_err("Invalid conversion job arguments.");
+		return NULL;
+	}
+
+	job = g_malloc0(sizeof(*job));
+	job->input_file = g_strdup(input_file);
+	job->input_format = g_strdup(input_format);
+	job->input_options = options_ref(input_options);
+	job->output_format = g_strdup(output_format);
+	job->output_options = options_ref(output_options);
+	job->output_file = g_strdup(output_file);
+	job->result = SR_ERR_NA;
+
+	return job;
+}
+
+/**
+ * Append a transform to a conversion job's chain of transforms.
+ *
+ * Transforms get applied in the order they were added.
+ *
+ * @param job The job. Must not be NULL.
+ * @param id The ID of the transform module. Must not be NULL.
+ * @param options Options for the transform module, as for
+ *                sr_transform_new(). May be NULL. The job takes a
+ *                reference.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_job_transform_add(struct sr_convert_job *job,
+		const char *id, GHashTable *options)
+{
+	struct convert_transform *ct;
+
+	if (!job || !id)
+		return SR_ERR_ARG;
+
+	ct = g_malloc0(sizeof(*ct));
+	ct->id = g_strdup(id);
+	ct->options = options_ref(options);
+	job->transforms = g_slist_append(job->transforms, ct);
+
+	return SR_OK;
+}
+
+/**
+ * Get a conversion job's input file name.
+ *
+ * @since 0.6.0
+ */
+SR_API const char *sr_convert_job_input_file_get(const struct sr_convert_job *job)
+{
+	return job ? job->input_file : NULL;
+}
+
+/**
+ * Get a conversion job's output file name.
+ *
+ * @since 0.6.0
+ */
+SR_API const char *sr_convert_job_output_file_get(const struct sr_convert_job *job)
+{
+	return job ? job->output_file : NULL;
+}
+
+/**
+ * Get the result of a conversion job.
+ *
+ * @return SR_OK if the job was run successfully, an SR_ERR_* error code
+ *         if it failed, or SR_ERR_NA if it has not been run yet or was
+ *         cancelled.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_job_result_get(const struct sr_convert_job *job)
+{
+	return job ? job->result : SR_ERR_ARG;
+}
+
+/**
+ * Cancel a conversion job.
+ *
+ * This may be called from any thread, also while sr_convert_run() runs
+ * the job. A job which has not started yet gets skipped, a running job
+ * stops before its next slice of input and removes its output file. A
+ * job which has already finished is not affected. Cancellation sticks,
+ * the job does not get run by later calls to sr_convert_run() either.
+ *
+ * @param job The job. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_job_cancel(struct sr_convert_job *job)
+{
+	if (!job)
+		return SR_ERR_ARG;
+
+	g_atomic_int_set(&job->cancelled, 1);
+
+	return SR_OK;
+}
+
+/**
+ * Free a conversion job.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_convert_job_free(struct sr_convert_job *job)
+{
+	if (!job)
+		return;
+
+	g_free(job->input_file);
+	g_free(job->input_format);
+	options_unref(job->input_options);
+	g_slist_free_full(job->transforms, convert_transform_free);
+	g_free(job->output_format);
+	options_unref(job->output_options);
+	g_free(job->output_file);
+	g_free(job);
+}
+
+static void convert_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_convert_job *job;
+	GString *out;
+	int ret;
+
+	(void)sdi;
+
+	job = cb_data;
+	if (job->feed_result != SR_OK)
+		return;
+
+	if (job->sink) {
+		ret = sr_output_send_to_sink(job->out, packet, job->sink);
+	} else {
+		/* The module writes the output file itself. */
+		out = NULL;
+		ret = sr_output_send(job->out, packet, &out);
+		if (out)
+			g_string_free(out, TRUE);
+	}
+	if (ret != SR_OK) {
+		sr_err("%s: Failed to write output.", job->output_file);
+		job->feed_result = ret;
+	}
+}
+
+static void convert_progress_push(struct sr_convert_job *job,
+		gboolean finished)
+{
+	struct convert_progress *p;
+
+	p = g_malloc0(sizeof(*p));
+	p->job = job;
+	p->bytes_done = job->bytes_done;
+	p->finished = finished;
+	g_async_queue_push(job->progress, p);
+}
+
+/* Create the input module, with the job's options if there are any. */
+static int convert_input_new(struct sr_convert_job *job,
+		const struct sr_input **in)
+{
+	const struct sr_input_module *imod;
+	int ret;
+
+	*in = NULL;
+	if (job->input_format) {
+		imod = sr_input_find(job->input_format);
+		if (!imod) {
+			sr_err("Unknown input format '%s'.", job->input_format);
+			return SR_ERR_ARG;
+		}
+	} else {
+		ret = sr_input_scan_file(job->input_file, in);
+		if (ret != SR_OK || !*in) {
+			sr_err("%s: Could not detect the input format.",
+				job->input_file);
+			return SR_ERR_DATA;
+		}
+		if (!job->input_options)
+			return SR_OK;
+		imod = sr_input_module_get(*in);
+		sr_input_free(*in);
+	}
+
+	*in = sr_input_new(imod, job->input_options);
+
+	return *in ? SR_OK : SR_ERR_ARG;
+}
+
+static int convert_transforms_new(struct sr_convert_job *job,
+		struct sr_dev_inst *sdi, GSList **transforms)
+{
+	const struct sr_transform_module *tmod;
+	const struct sr_transform *t;
+	struct convert_transform *ct;
+	GSList *l;
+
+	for (l = job->transforms; l; l = l->next) {
+		ct = l->data;
+		tmod = sr_transform_find(ct->id);
+		if (!tmod) {
+			sr_err("Unknown transform '%s'.", ct->id);
+			return SR_ERR_ARG;
+		}
+		t = sr_transform_new(tmod, ct->options, sdi);
+		if (!t) {
+			sr_err("Failed to create transform '%s'.", ct->id);
+			return SR_ERR_ARG;
+		}
+		*transforms = g_slist_append(*transforms, (void *)t);
+	}
+
+	return SR_OK;
+}
+
+static int convert_output_new(struct sr_convert_job *job,
+		struct sr_dev_inst *sdi)
+{
+	const struct sr_output_module *omod;
+
+	omod = sr_output_find(job->output_format);
+	if (!omod) {
+		sr_err("Unknown output format '%s'.", job->output_format);
+		return SR_ERR_ARG;
+	}
+	job->out = sr_output_new(omod, job->output_options, sdi,
+		job->output_file);
+	if (!job->out)
+		return SR_ERR_ARG;
+	if (sr_output_test_flag(omod, SR_OUTPUT_INTERNAL_IO_HANDLING))
+		return SR_OK;
+
+	return sr_output_sink_new_file(job->output_file, &job->sink);
+}
+
+static int convert_job_run(struct sr_context *ctx, struct sr_convert_job *job)
+{
+	GMappedFile *file;
+	GError *error;
+	const struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GSList *transforms, *l;
+	uint8_t *data;
+	size_t size;
+	gboolean cancelled;
+	int ret, err;
+
+	job->bytes_done = 0;
+	job->bytes_total = 0;
+	job->out = NULL;
+	job->sink = NULL;
+	job->feed_result = SR_OK;
+
+	/*
+	 * Transforms modify packets in place. Map the file writable, the
+	 * mapping is private, so pages only get copied when written to.
+	 */
+	error = NULL;
+	file = g_mapped_file_new(job->input_file, TRUE, &error);
+	if (!file) {
+		sr_err("Failed to map %s: %s", job->input_file, error->message);
+		g_error_free(error);
+		return SR_ERR_IO;
+	}
+	data = (uint8_t *)g_mapped_file_get_contents(file);
+	size = g_mapped_file_get_length(file);
+	job->bytes_total = size;
+
+	in = NULL;
+	session = NULL;
+	transforms = NULL;
+	cancelled = FALSE;
+
+	ret = convert_input_new(job, &in);
+	if (ret != SR_OK)
+		goto done;
+
+	/* Feed the start of the file until the device is known. */
+	while (!sr_input_dev_inst_get(in) && job->bytes_done < size) {
+		ret = sr_input_send_slice(in, data, size, &job->bytes_done,
+			SLICE_SIZE);
+		if (ret != SR_OK)
+			goto done;
+	}
+	sdi = sr_input_dev_inst_get(in);
+	if (!sdi) {
+		sr_err("%s: No usable data found.", job->input_file);
+		ret = SR_ERR_DATA;
+		goto done;
+	}
+
+	if ((ret = sr_session_new(ctx, &session)) != SR_OK)
+		goto done;
+	if ((ret = sr_session_dev_add(session, sdi)) != SR_OK)
+		goto done;
+	sr_session_datafeed_callback_add(session, convert_datafeed, job);
+	if ((ret = convert_transforms_new(job, sdi, &transforms)) != SR_OK)
+		goto done;
+	if ((ret = convert_output_new(job, sdi)) != SR_OK)
+		goto done;
+
+	while (job->bytes_done < size) {
+		if (g_atomic_int_get(&job->cancelled)) {
+			sr_dbg("%s: Cancelled.", job->input_file);
+			cancelled = TRUE;
+			ret = SR_ERR_NA;
+			goto done;
+		}
+		ret = sr_input_send_slice(in, data, size, &job->bytes_done,
+			SLICE_SIZE);
+		if (ret == SR_OK)
+			ret = job->feed_result;
+		if (ret != SR_OK)
+			goto done;
+		convert_progress_push(job, FALSE);
+	}
+	ret = sr_input_end(in);
+	if (ret == SR_OK)
+		ret = job->feed_result;
+	if (ret == SR_OK && job->sink)
+		ret = sr_output_sink_flush(job->sink);
+
+done:
+	/*
+	 * Transforms may refer to the device's channels, and the device
+	 * instance belongs to the input. Tear down in reverse order.
+	 */
+	if (session)
+		sr_session_destroy(session);
+	for (l = transforms; l; l = l->next)
+		sr_transform_free(l->data);
+	g_slist_free(transforms);
+	if (job->out)
+		sr_output_free(job->out);
+	job->out = NULL;
+	if (job->sink) {
+		err = sr_output_sink_free(job->sink);
+		if (ret == SR_OK)
+			ret = err;
+	}
+	job->sink = NULL;
+	if (in)
+		sr_input_free(in);
+	g_mapped_file_unref(file);
+	if (cancelled)
+		g_remove(job->output_file);
+
+	return ret;
+}
+
+static void convert_worker(void *data, void *user_data)
+{
+	struct sr_convert_job *job;
+	struct sr_context *ctx;
+
+	job = data;
+	ctx = user_data;
+
+	if (g_atomic_int_get(&job->cancelled)) {
+		sr_dbg("Skipping cancelled job %s.", job->input_file);
+		convert_progress_push(job, TRUE);
+		return;
+	}
+
+	sr_dbg("Converting %s to %s.", job->input_file, job->output_file);
+	job->result = convert_job_run(ctx, job);
+	if (job->result == SR_ERR_NA && g_atomic_int_get(&job->cancelled))
+		sr_info("Cancelled converting %s.", job->input_file);
+	else if (job->result != SR_OK)
+		sr_err("Failed to convert %s: %s.", job->input_file,
+			sr_strerror(job->result));
+	convert_progress_push(job, TRUE);
+}
+
+/*
+ * Modules set up their option defaults the first time they are asked
+ * for their options. Make sure this has happened before the workers
+ * create modules concurrently.
+ */
+static void convert_options_prime(void)
+{
+	const struct sr_input_module **imods;
+	const struct sr_output_module **omods;
+	const struct sr_transform_module **tmods;
+	unsigned int i;
+
+	imods = sr_input_list();
+	for (i = 0; imods[i]; i++) {
+		if (imods[i]->options)
+			imods[i]->options();
+	}
+	omods = sr_output_list();
+	for (i = 0; omods[i]; i++) {
+		if (omods[i]->options)
+			omods[i]->options();
+	}
+	tmods = sr_transform_list();
+	for (i = 0; tmods[i]; i++) {
+		if (tmods[i]->options)
+			tmods[i]->options();
+	}
+}
+
+/**
+ * Run a batch of conversion jobs.
+ *
+ * The jobs get run by a pool of worker threads, each job in a session
+ * of its own. The function returns when all jobs have finished. The
+ * progress callback gets called from the calling thread only, after
+ * every slice of a job's input was processed, and once more when the
+ * job has finished.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param jobs List of struct sr_convert_job pointers.
+ * @param num_threads Maximum number of jobs to run at the same time.
+ *                    If 0, the number of processors gets used.
+ * @param cb Progress callback. May be NULL.
+ * @param cb_data Data to pass to the callback.
+ *
+ * @retval SR_OK All jobs were run successfully.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR At least one job failed or was cancelled. Use
+ *                sr_convert_job_result_get() to find out which.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_run(struct sr_context *ctx, GSList *jobs,
+		unsigned int num_threads, sr_convert_progress_callback cb,
+		void *cb_data)
+{
+	struct sr_convert_job *job;
+	struct convert_progress *p;
+	GAsyncQueue *progress;
+	GThreadPool *pool;
+	GError *error;
+	GSList *l;
+	unsigned int pending;
+	int ret;
+
+	if (!ctx)
+		return SR_ERR_ARG;
+	for (l = jobs; l; l = l->next) {
+		if (!l->data)
+			return SR_ERR_ARG;
+	}
+	if (!jobs)
+		return SR_OK;
+
+	if (!num_threads) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		num_threads = g_get_num_processors();
+#else
+		num_threads = 4;
+#endif
+	}
+	num_threads = MIN(num_threads, g_slist_length(jobs));
+
+	convert_options_prime();
+
+	progress = g_async_queue_new();
+	error = NULL;
+	pool = g_thread_pool_new(convert_worker, ctx, num_threads, TRUE, &error);
+	if (!pool) {
+		sr_err("Failed to create worker threads: %s", error->message);
+		g_error_free(error);
+		g_async_queue_unref(progress);
+		return SR_ERR;
+	}
+
+	pending = 0;
+	for (l = jobs; l; l = l->next) {
+		job = l->data;
+		job->result = SR_ERR_NA;
+		job->progress = progress;
+		g_thread_pool_push(pool, job, NULL);
+		pending++;
+	}
+
+	while (pending) {
+		p = g_async_queue_pop(progress);
+		if (p->finished)
+			pending--;
+		if (cb)
+			cb(p->job, p->bytes_done, p->job->bytes_total,
+				p->finished, cb_data);
+		g_free(p);
+	}
+	g_thread_pool_free(pool, FALSE, TRUE);
+	g_async_queue_unref(progress);
+
+	ret = SR_OK;
+	for (l = jobs; l; l = l->next) {
+		job = l->data;
+		job->progress = NULL;
+		if (job->result != SR_OK)
+			ret = SR_ERR;
+	}
+
+	return ret;
+}
+
+/** @} */
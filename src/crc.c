@@ -18,26 +18,87 @@
  */
 
 #include <config.h>
+#include <glib.h>
 #include <stdint.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
-SR_PRIV uint16_t sr_crc16(uint16_t crc, const uint8_t *buffer, int len)
-{
-	int i;
+/*
+ * Table driven calculation of reflected CRC16 flavors, processing eight
+ * input bytes per step ("slice-by-8"). Table 0 is the classic bytewise
+ * lookup table, table k holds the CRC of a byte which is followed by k
+ * zero bytes. The eight bytes of a step are looked up independently,
+ * and their results get combined. The tables are built on first use.
+ */
+struct sr_crc16_engine {
+	uint16_t poly;
+	gsize initialized;
+	uint16_t table[8][256];
+};
 
-	if (!buffer || len < 0)
-		return crc;
+static struct sr_crc16_engine crc16_modbus = { .poly = 0xA001, };
+static struct sr_crc16_engine crc16_mcrf4xx = { .poly = 0x8408, };
+
+static const struct sr_crc16_engine *crc16_engine_get(
+	struct sr_crc16_engine *engine)
+{
+	uint16_t crc;
+	size_t b, i, k;
 
-	while (len--) {
-		crc ^= *buffer++;
-		for (i = 0; i < 8; i++) {
-			int carry = crc & 1;
-			crc >>= 1;
-			if (carry)
-				crc ^= 0xA001;
+	if (g_once_init_enter(&engine->initialized)) {
+		for (b = 0; b < 256; b++) {
+			crc = b;
+			for (i = 0; i < 8; i++)
+				crc = (crc >> 1) ^ ((crc & 1) ? engine->poly : 0);
+			engine->table[0][b] = crc;
+		}
+		for (k = 1; k < 8; k++) {
+			for (b = 0; b < 256; b++) {
+				crc = engine->table[k - 1][b];
+				engine->table[k][b] = (crc >> 8)
+					^ engine->table[0][crc & 0xff];
+			}
 		}
+		g_once_init_leave(&engine->initialized, 1);
 	}
 
+	return engine;
+}
+
+static uint16_t crc16_update(const struct sr_crc16_engine *engine,
+	uint16_t crc, const uint8_t *buffer, size_t len)
+{
+	const uint16_t (*t)[256];
+
+	t = engine->table;
+	while (len >= 8) {
+		crc ^= buffer[0] | (buffer[1] << 8);
+		crc = t[7][crc & 0xff] ^ t[6][crc >> 8]
+			^ t[5][buffer[2]] ^ t[4][buffer[3]]
+			^ t[3][buffer[4]] ^ t[2][buffer[5]]
+			^ t[1][buffer[6]] ^ t[0][buffer[7]];
+		buffer += 8;
+		len -= 8;
+	}
+	while (len--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *buffer++) & 0xff];
+
 	return crc;
 }
+
+SR_PRIV uint16_t sr_crc16(uint16_t crc, const uint8_t *buffer, int len)
+{
+	if (!buffer || len < 0)
+		return crc;
+
+	return crc16_update(crc16_engine_get(&crc16_modbus), crc, buffer, len);
+}
+
+SR_PRIV uint16_t sr_crc16_mcrf4xx(uint16_t crc, const uint8_t *buffer,
+	size_t len)
+{
+	if (!buffer)
+		return crc;
+
+	return crc16_update(crc16_engine_get(&crc16_mcrf4xx), crc, buffer, len);
+}
@@ -52,14 +52,48 @@ SR_PRIV int ezusb_reset(struct libusb_device_handle *hdl, int set_clear)
 	return ret;
 }
 
+/*
+ * Describe the device behind a handle, for the records of uploaded
+ * images. Scans upload firmware before device instances exist.
+ */
+static void ezusb_image_dev(struct sr_dev_inst *sdi,
+			    struct sr_usb_dev_inst *usb,
+			    libusb_device_handle *hdl)
+{
+	libusb_device *dev;
+
+	dev = libusb_get_device(hdl);
+	memset(usb, 0, sizeof(*usb));
+	usb->bus = libusb_get_bus_number(dev);
+	usb->address = libusb_get_device_address(dev);
+	usb->devhdl = hdl;
+	memset(sdi, 0, sizeof(*sdi));
+	sdi->inst_type = SR_INST_USB;
+	sdi->conn = usb;
+}
+
 SR_PRIV int ezusb_install_firmware(struct sr_context *ctx,
 				   libusb_device_handle *hdl,
 				   const char *name)
 {
+	struct sr_dev_inst sdi;
+	struct sr_usb_dev_inst usb;
 	unsigned char *firmware;
 	size_t length, offset, chunksize;
 	int ret, result;
 
+	/*
+	 * The firmware runs from RAM, and the device re-enumerates when it
+	 * starts, which gives it a new address. The record only matches
+	 * while the previous enumeration is still around, e.g. when a scan
+	 * runs again before the device came back.
+	 */
+	ezusb_image_dev(&sdi, &usb, hdl);
+	if (sr_resource_image_current(&sdi, ctx, SR_RESOURCE_FIRMWARE, name)) {
+		sr_info("Firmware '%s' was uploaded already.", name);
+		return SR_OK;
+	}
+
 	/* Max size is 64 kiB since the value field of the setup packet,
 	 * which holds the firmware offset, is only 16 bit wide.
 	 */
@@ -69,6 +103,7 @@ SR_PRIV int ezusb_install_firmware(struct sr_context *ctx,
 		return SR_ERR;
 
 	sr_info("Uploading firmware '%s'.", name);
+	sr_resource_image_uploaded(&sdi, ctx, SR_RESOURCE_FIRMWARE, NULL);
 
 	result = SR_OK;
 	offset = 0;
@@ -89,6 +124,7 @@ SR_PRIV int ezusb_install_firmware(struct sr_context *ctx,
 		offset += chunksize;
 	}
 	g_free(firmware);
+	sr_resource_image_uploaded(&sdi, ctx, SR_RESOURCE_FIRMWARE, name);
 
 	sr_info("Firmware upload done.");
 
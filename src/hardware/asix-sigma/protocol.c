@@ -821,15 +821,20 @@ static int sigma_fw_2_bitbang(struct sr_context *ctx, const char *name,
 	return SR_OK;
 }
 
-static int upload_firmware(struct sr_context *ctx, struct dev_context *devc,
+static int upload_firmware(const struct sr_dev_inst *sdi,
 	enum sigma_firmware_idx firmware_idx)
 {
+	struct sr_context *ctx;
+	struct dev_context *devc;
 	int ret;
 	uint8_t *buf;
 	uint8_t pins;
 	size_t buf_size;
 	const char *firmware;
 
+	ctx = ((struct drv_context *)sdi->driver->context)->sr_ctx;
+	devc = sdi->priv;
+
 	/* Check for valid firmware file selection. */
 	if (firmware_idx >= ARRAY_SIZE(firmware_files))
 		return SR_ERR_ARG;
@@ -843,6 +848,22 @@ static int upload_firmware(struct sr_context *ctx, struct dev_context *devc,
 		return SR_OK;
 	}
 
+	/*
+	 * The netlist survives a rescan of the device. When this context
+	 * uploaded the same image before, and the FPGA still responds to
+	 * the logic-analyzer mode initialization, then it is still active.
+	 */
+	if (sr_resource_image_current(sdi, ctx, SR_RESOURCE_FIRMWARE, firmware)) {
+		PURGE_FTDI_BOTH(&devc->ftdi.ctx);
+		if (sigma_fpga_init_la(devc) == SR_OK) {
+			sr_info("Firmware file '%s' is still active.", firmware);
+			devc->state = SIGMA_IDLE;
+			devc->firmware_idx = firmware_idx;
+			return SR_OK;
+		}
+	}
+	sr_resource_image_uploaded(sdi, ctx, SR_RESOURCE_FIRMWARE, NULL);
+
 	devc->state = SIGMA_CONFIG;
 
 	/* Set the cable to bitbang mode. */
@@ -903,6 +924,7 @@ static int upload_firmware(struct sr_context *ctx, struct dev_context *devc,
 	/* Keep track of successful firmware download completion. */
 	devc->state = SIGMA_IDLE;
 	devc->firmware_idx = firmware_idx;
+	sr_resource_image_uploaded(sdi, ctx, SR_RESOURCE_FIRMWARE, firmware);
 	sr_info("Firmware uploaded.");
 
 	return SR_OK;
@@ -1084,13 +1106,11 @@ SR_PRIV int sigma_store_hw_config(const struct sr_dev_inst *sdi)
 SR_PRIV int sigma_set_samplerate(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct drv_context *drvc;
 	uint64_t samplerate;
 	int ret;
 	size_t num_channels;
 
 	devc = sdi->priv;
-	drvc = sdi->driver->context;
 
 	/* Accept any caller specified rate which the hardware supports. */
 	ret = sigma_normalize_samplerate(devc->clock.samplerate, &samplerate);
@@ -1104,13 +1124,13 @@ SR_PRIV int sigma_set_samplerate(const struct sr_dev_inst *sdi)
 	 */
 	num_channels = devc->interp.num_channels;
 	if (samplerate <= SR_MHZ(50)) {
-		ret = upload_firmware(drvc->sr_ctx, devc, SIGMA_FW_50MHZ);
+		ret = upload_firmware(sdi, SIGMA_FW_50MHZ);
 		num_channels = 16;
 	} else if (samplerate == SR_MHZ(100)) {
-		ret = upload_firmware(drvc->sr_ctx, devc, SIGMA_FW_100MHZ);
+		ret = upload_firmware(sdi, SIGMA_FW_100MHZ);
 		num_channels = 8;
 	} else if (samplerate == SR_MHZ(200)) {
-		ret = upload_firmware(drvc->sr_ctx, devc, SIGMA_FW_200MHZ);
+		ret = upload_firmware(sdi, SIGMA_FW_200MHZ);
 		num_channels = 4;
 	}
 
@@ -1260,34 +1280,91 @@ static int flush_submit_buffer(struct dev_context *devc)
 	return SR_OK;
 }
 
+/*
+ * Determine how many of the next samples may get submitted. User
+ * specified limits are enforced exactly, but don't apply when triggers
+ * are used (the hardware's sample memory holds the pre/post trigger
+ * data then).
+ */
+static size_t submit_limit_remain(struct dev_context *devc, size_t count)
+{
+	struct sr_sw_limits *limits;
+	uint64_t remain;
+
+	if (devc->use_triggers)
+		return count;
+
+	limits = &devc->limit.submit;
+	if (sr_sw_limits_check(limits))
+		return 0;
+	if (limits->limit_samples) {
+		remain = limits->limit_samples - limits->samples_read;
+		if (count > remain)
+			count = remain;
+	}
+
+	return count;
+}
+
+/*
+ * Queue a number of repetitions of a sample value. Fills the buffer in
+ * runs between flushes, which is how RLE gaps get expanded.
+ */
 static int addto_submit_buffer(struct dev_context *devc,
 	uint16_t sample, size_t count)
 {
 	struct submit_buffer *buffer;
-	struct sr_sw_limits *limits;
+	size_t run, idx;
 	int ret;
 
 	buffer = devc->buffer;
-	limits = &devc->limit.submit;
-	if (!devc->use_triggers && sr_sw_limits_check(limits))
-		count = 0;
+	count = submit_limit_remain(devc, count);
+	sr_sw_limits_update_samples_read(&devc->limit.submit, count);
+
+	while (count) {
+		run = buffer->max_samples - buffer->curr_samples;
+		if (run > count)
+			run = count;
+		for (idx = 0; idx < run; idx++)
+			write_u16le_inc(&buffer->write_pointer, sample);
+		buffer->curr_samples += run;
+		count -= run;
+		if (buffer->curr_samples == buffer->max_samples) {
+			ret = flush_submit_buffer(devc);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
 
-	/*
-	 * Individually accumulate and check each sample, such that
-	 * accumulation between flushes won't exceed local storage, and
-	 * enforcement of user specified limits is exact.
-	 */
-	while (count--) {
-		write_u16le_inc(&buffer->write_pointer, sample);
-		buffer->curr_samples++;
+	return SR_OK;
+}
+
+/* Queue a sequence of individual sample values. */
+static int addto_submit_buffer_many(struct dev_context *devc,
+	const uint16_t *samples, size_t count)
+{
+	struct submit_buffer *buffer;
+	size_t run, idx;
+	int ret;
+
+	buffer = devc->buffer;
+	count = submit_limit_remain(devc, count);
+	sr_sw_limits_update_samples_read(&devc->limit.submit, count);
+
+	while (count) {
+		run = buffer->max_samples - buffer->curr_samples;
+		if (run > count)
+			run = count;
+		for (idx = 0; idx < run; idx++)
+			write_u16le_inc(&buffer->write_pointer, samples[idx]);
+		buffer->curr_samples += run;
+		samples += run;
+		count -= run;
 		if (buffer->curr_samples == buffer->max_samples) {
 			ret = flush_submit_buffer(devc);
 			if (ret != SR_OK)
 				return ret;
 		}
-		sr_sw_limits_update_samples_read(limits, 1);
-		if (!devc->use_triggers && sr_sw_limits_check(limits))
-			break;
 	}
 
 	return SR_OK;
@@ -1811,22 +1888,17 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
 /*
  * Deinterlace sample data that was retrieved at 100MHz samplerate.
  * One 16bit item contains two samples of 8bits each. The bits of
- * multiple samples are interleaved.
+ * multiple samples are interleaved. Gather every other bit by means
+ * of shifts and masks, without a loop over the individual bits.
  */
 static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
 {
 	uint16_t outdata;
 
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
-	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
-	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
-	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
-	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
+	outdata = (indata >> idx) & 0x5555;
+	outdata = (outdata | (outdata >> 1)) & 0x3333;
+	outdata = (outdata | (outdata >> 2)) & 0x0f0f;
+	outdata = (outdata | (outdata >> 4)) & 0x00ff;
 	return outdata;
 }
 
@@ -1839,22 +1911,84 @@ static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx)
 {
 	uint16_t outdata;
 
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
+	outdata = (indata >> idx) & 0x1111;
+	outdata = (outdata | (outdata >> 3)) & 0x0303;
+	outdata = (outdata | (outdata >> 6)) & 0x000f;
 	return outdata;
 }
 
+/*
+ * Deinterlace all events of a DRAM cluster into a list of samples.
+ * Returns the number of samples.
+ */
+static size_t sigma_deinterlace_cluster(struct dev_context *devc,
+	struct sigma_dram_cluster *dram_cluster, size_t events_in_cluster,
+	uint16_t *samples)
+{
+	uint16_t item16;
+	size_t evt, count;
+
+	count = 0;
+	switch (devc->interp.samples_per_event) {
+	case 4:
+		for (evt = 0; evt < events_in_cluster; evt++) {
+			item16 = sigma_dram_cluster_data(dram_cluster, evt);
+			samples[count++] = sigma_deinterlace_data_4x4(item16, 0);
+			samples[count++] = sigma_deinterlace_data_4x4(item16, 1);
+			samples[count++] = sigma_deinterlace_data_4x4(item16, 2);
+			samples[count++] = sigma_deinterlace_data_4x4(item16, 3);
+		}
+		break;
+	case 2:
+		for (evt = 0; evt < events_in_cluster; evt++) {
+			item16 = sigma_dram_cluster_data(dram_cluster, evt);
+			samples[count++] = sigma_deinterlace_data_2x8(item16, 0);
+			samples[count++] = sigma_deinterlace_data_2x8(item16, 1);
+		}
+		break;
+	default:
+		for (evt = 0; evt < events_in_cluster; evt++)
+			samples[count++] = sigma_dram_cluster_data(dram_cluster, evt);
+		break;
+	}
+
+	return count;
+}
+
+/*
+ * Check whether software trigger checks need to run for the events
+ * of the next cluster: either the check period is open already, or
+ * it opens while the cluster's events get iterated.
+ */
+static gboolean sigma_cluster_needs_check(struct dev_context *devc,
+	size_t events_in_cluster)
+{
+	struct sigma_sample_interp *interp;
+	struct sigma_location loc;
+
+	interp = &devc->interp;
+	if (interp->trig_chk.armed)
+		return TRUE;
+	if (interp->trig_chk.matched)
+		return FALSE;
+
+	loc = interp->iter;
+	while (events_in_cluster--) {
+		sigma_location_increment(&loc);
+		if (sigma_location_is_eq(&loc, &interp->trig_arm, TRUE))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 static void sigma_decode_dram_cluster(struct dev_context *devc,
 	struct sigma_dram_cluster *dram_cluster,
 	size_t events_in_cluster)
 {
-	uint16_t tsdiff, ts, sample, item16;
-	size_t count;
-	size_t evt;
+	uint16_t tsdiff, ts, sample;
+	uint16_t samples[EVENTS_PER_CLUSTER * 4];
+	size_t count, per_event, evt, idx;
 
 	/*
 	 * If this cluster is not adjacent to the previously received
@@ -1882,31 +2016,29 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	 * before submission is transparent to this code path, specific
 	 * buffer depth is neither assumed nor required here.
 	 */
-	sample = 0;
+	count = sigma_deinterlace_cluster(devc, dram_cluster,
+		events_in_cluster, samples);
+	if (!count)
+		return;
+
+	/*
+	 * Most clusters are outside of the short period of software
+	 * trigger checks. Submit all of their samples at once, and
+	 * advance the iteration position by the cluster's events.
+	 */
+	if (!sigma_cluster_needs_check(devc, events_in_cluster)) {
+		(void)addto_submit_buffer_many(devc, samples, count);
+		devc->interp.last.sample = samples[count - 1];
+		for (evt = 0; evt < events_in_cluster; evt++)
+			sigma_location_increment(&devc->interp.iter);
+		return;
+	}
+
+	per_event = count / events_in_cluster;
+	idx = 0;
 	for (evt = 0; evt < events_in_cluster; evt++) {
-		item16 = sigma_dram_cluster_data(dram_cluster, evt);
-		if (devc->interp.samples_per_event == 4) {
-			sample = sigma_deinterlace_data_4x4(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 2);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 3);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-		} else if (devc->interp.samples_per_event == 2) {
-			sample = sigma_deinterlace_data_2x8(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_2x8(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-		} else {
-			sample = item16;
+		while (idx < (evt + 1) * per_event) {
+			sample = samples[idx++];
 			check_and_submit_sample(devc, sample, 1);
 			devc->interp.last.sample = sample;
 		}
@@ -224,12 +224,11 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 {
 	const char *name = NULL;
 	uint64_t sum;
-	struct sr_resource bitstream;
 	struct drv_context *drvc;
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	unsigned char *buf;
-	ssize_t chunksize;
+	uint8_t *bitstream;
+	size_t bitstream_size, chunksize;
 	int transferred;
 	int result, ret;
 	const uint8_t cmd[3] = {0, 0, 0};
@@ -256,58 +255,69 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
+	/*
+	 * The FPGA keeps its configuration until the device resets, which
+	 * also makes it re-enumerate. There is no way to query the loaded
+	 * bitstream, so trust the record of the previous upload.
+	 */
+	if (sr_resource_image_current(sdi, drvc->sr_ctx,
+			SR_RESOURCE_FIRMWARE, name)) {
+		sr_dbg("FPGA firmware '%s' is loaded already.", name);
+		return SR_OK;
+	}
+
 	sr_dbg("Uploading FPGA firmware '%s'.", name);
 
-	result = sr_resource_open(drvc->sr_ctx, &bitstream,
-			SR_RESOURCE_FIRMWARE, name);
-	if (result != SR_OK)
-		return result;
+	bitstream = sr_resource_load(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+			name, &bitstream_size, 16 * 1024 * 1024);
+	if (!bitstream)
+		return SR_ERR;
+
+	/* The FPGA's state is unknown from here on. */
+	sr_resource_image_uploaded(sdi, drvc->sr_ctx,
+			SR_RESOURCE_FIRMWARE, NULL);
 
 	/* Tell the device firmware is coming. */
 	if ((ret = libusb_control_transfer(usb->devhdl, LIBUSB_REQUEST_TYPE_VENDOR |
 			LIBUSB_ENDPOINT_OUT, DS_CMD_CONFIG, 0x0000, 0x0000,
 			(unsigned char *)&cmd, sizeof(cmd), USB_TIMEOUT)) < 0) {
 		sr_err("Failed to upload FPGA firmware: %s.", libusb_error_name(ret));
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_free(bitstream);
 		return SR_ERR;
 	}
 
 	/* Give the FX2 time to get ready for FPGA firmware upload. */
 	g_usleep(FPGA_UPLOAD_DELAY);
 
-	buf = g_malloc(FW_BUFSIZE);
 	sum = 0;
 	result = SR_OK;
-	while (1) {
-		chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
-				buf, FW_BUFSIZE);
-		if (chunksize < 0)
-			result = SR_ERR;
-		if (chunksize <= 0)
-			break;
-
+	while (sum < bitstream_size) {
+		chunksize = MIN(bitstream_size - sum, FW_BUFSIZE);
 		if ((ret = libusb_bulk_transfer(usb->devhdl, 2 | LIBUSB_ENDPOINT_OUT,
-				buf, chunksize, &transferred, USB_TIMEOUT)) < 0) {
+				bitstream + sum, chunksize, &transferred,
+				USB_TIMEOUT)) < 0) {
 			sr_err("Unable to configure FPGA firmware: %s.",
 					libusb_error_name(ret));
 			result = SR_ERR;
 			break;
 		}
 		sum += transferred;
-		sr_spew("Uploaded %" PRIu64 "/%" PRIu64 " bytes.",
-			sum, bitstream.size);
+		sr_spew("Uploaded %" PRIu64 "/%zu bytes.",
+			sum, bitstream_size);
 
-		if (transferred != chunksize) {
+		if ((size_t)transferred != chunksize) {
 			sr_err("Short transfer while uploading FPGA firmware.");
 			result = SR_ERR;
 			break;
 		}
 	}
-	g_free(buf);
-	sr_resource_close(drvc->sr_ctx, &bitstream);
+	g_free(bitstream);
 
-	if (result == SR_OK)
+	if (result == SR_OK) {
+		sr_resource_image_uploaded(sdi, drvc->sr_ctx,
+				SR_RESOURCE_FIRMWARE, name);
 		sr_dbg("FPGA firmware upload done.");
+	}
 
 	return result;
 }
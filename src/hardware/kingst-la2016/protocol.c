@@ -289,11 +289,12 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 {
 	struct drv_context *drvc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_resource bitstream;
-	uint32_t bitstream_size;
+	uint8_t *bitstream;
+	size_t bitstream_size;
 	uint8_t buffer[sizeof(uint32_t)];
 	uint8_t *wrptr;
 	uint8_t block[4096];
+	const uint8_t *rdptr;
 	int len, act_len;
 	unsigned int pos;
 	int ret;
@@ -304,20 +305,21 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 
 	sr_info("Uploading FPGA bitstream '%s'.", bitstream_fname);
 
-	ret = sr_resource_open(drvc->sr_ctx, &bitstream,
-		SR_RESOURCE_FIRMWARE, bitstream_fname);
-	if (ret != SR_OK) {
+	bitstream = sr_resource_load(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+		bitstream_fname, &bitstream_size, UINT32_MAX);
+	if (!bitstream) {
 		sr_err("Cannot find FPGA bitstream %s.", bitstream_fname);
-		return ret;
+		return SR_ERR;
 	}
+	sr_resource_image_uploaded(sdi, drvc->sr_ctx,
+		SR_RESOURCE_FIRMWARE, NULL);
 
-	bitstream_size = (uint32_t)bitstream.size;
 	wrptr = buffer;
-	write_u32le_inc(&wrptr, bitstream_size);
+	write_u32le_inc(&wrptr, (uint32_t)bitstream_size);
 	ret = ctrl_out(sdi, CMD_FPGA_INIT, 0x00, 0, buffer, wrptr - buffer);
 	if (ret != SR_OK) {
 		sr_err("Cannot initiate FPGA bitstream upload.");
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_free(bitstream);
 		return ret;
 	}
 	zero_pad_to = bitstream_size;
@@ -327,26 +329,23 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 
 	pos = 0;
 	while (1) {
-		if (pos < bitstream.size) {
-			len = (int)sr_resource_read(drvc->sr_ctx, &bitstream,
-				block, sizeof(block));
-			if (len < 0) {
-				sr_err("Cannot read FPGA bitstream.");
-				sr_resource_close(drvc->sr_ctx, &bitstream);
-				return SR_ERR_IO;
-			}
+		if (pos < bitstream_size) {
+			/* Send the image straight from the loaded buffer. */
+			len = MIN(bitstream_size - pos, sizeof(block));
+			rdptr = &bitstream[pos];
 		} else {
 			/*  Zero-pad until 'zero_pad_to'. */
 			len = zero_pad_to - pos;
 			if ((unsigned)len > sizeof(block))
 				len = sizeof(block);
 			memset(&block, 0, len);
+			rdptr = block;
 		}
 		if (len == 0)
 			break;
 
 		ret = libusb_bulk_transfer(usb->devhdl, USB_EP_FPGA_BITSTREAM,
-			&block[0], len, &act_len, DEFAULT_TIMEOUT_MS);
+			(uint8_t *)rdptr, len, &act_len, DEFAULT_TIMEOUT_MS);
 		if (ret != 0) {
 			sr_dbg("Cannot write FPGA bitstream, block %#x len %d: %s.",
 				pos, (int)len, libusb_error_name(ret));
@@ -361,11 +360,12 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 		}
 		pos += len;
 	}
-	sr_resource_close(drvc->sr_ctx, &bitstream);
+	g_free(bitstream);
 	if (ret != SR_OK)
 		return ret;
-	sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.",
-		bitstream.size);
+	sr_resource_image_uploaded(sdi, drvc->sr_ctx,
+		SR_RESOURCE_FIRMWARE, bitstream_fname);
+	sr_info("FPGA bitstream upload (%zu bytes) done.", bitstream_size);
 
 	return SR_OK;
 }
@@ -570,6 +570,8 @@ static void la2016_prepare_stream(const struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 	stream = &devc->stream;
+	if (stream->stl)
+		soft_trigger_logic_free(stream->stl);
 	memset(stream, 0, sizeof(*stream));
 
 	stream->enabled_count = 0;
@@ -581,9 +583,11 @@ static void la2016_prepare_stream(const struct sr_dev_inst *sdi)
 			continue;
 		channel_mask = 1UL << ch->index;
 		stream->enabled_mask |= channel_mask;
-		stream->channel_masks[stream->enabled_count++] = channel_mask;
+		stream->channel_ids[stream->enabled_count++] = ch->index;
 	}
 	stream->channel_index = 0;
+	stream->unitsize = devc->model->channel_count == 32
+		? sizeof(uint32_t) : sizeof(uint16_t);
 }
 
 /*
@@ -607,6 +611,7 @@ static int set_trigger_config(const struct sr_dev_inst *sdi)
 	struct sr_trigger_stage *stage1;
 	struct sr_trigger_match *match;
 	uint32_t ch_mask;
+	uint64_t pre_trigger_samples;
 	int ret;
 	uint8_t buf[REG_UNKNOWN_30 - REG_TRIGGER]; /* Width of REG_TRIGGER. */
 	uint8_t *wrptr;
@@ -676,9 +681,7 @@ static int set_trigger_config(const struct sr_dev_inst *sdi)
 	 * Don't configure hardware trigger parameters in streaming mode
 	 * or when the device lacks local memory. Yet the above dump of
 	 * derived parameters from user specs is considered valueable.
-	 *
-	 * TODO Add support for soft triggers when hardware triggers in
-	 * the device are not used or are not available at all.
+	 * Streaming mode checks the trigger condition in software.
 	 */
 	if (!devc->model->memory_bits || devc->continuous) {
 		if (!devc->model->memory_bits)
@@ -689,6 +692,20 @@ static int set_trigger_config(const struct sr_dev_inst *sdi)
 		cfg.level = 0;
 		cfg.high_or_falling = 0;
 	}
+	if (devc->continuous && trigger && trigger->stages) {
+		pre_trigger_samples = 0;
+		if (devc->sw_limits.limit_samples) {
+			pre_trigger_samples = devc->sw_limits.limit_samples;
+			pre_trigger_samples *= devc->capture_ratio;
+			pre_trigger_samples /= 100;
+		}
+		devc->stream.stl = soft_trigger_logic_new(sdi, trigger,
+			(int)pre_trigger_samples);
+		if (!devc->stream.stl)
+			return SR_ERR_MALLOC;
+		sr_dbg("Streaming mode. Soft trigger, %" PRIu64 " pre-trigger samples.",
+			pre_trigger_samples);
+	}
 
 	devc->trigger_involved = cfg.enabled != 0;
 
@@ -1027,6 +1044,8 @@ SR_PRIV int la2016_upload_firmware(const struct sr_dev_inst *sdi,
 }
 
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *xfer);
+static int la2016_decoder_start(const struct sr_dev_inst *sdi);
+static void la2016_decoder_stop(const struct sr_dev_inst *sdi);
 
 static void la2016_usbxfer_release_cb(gpointer p)
 {
@@ -1257,12 +1276,19 @@ static int la2016_stop_acquisition(const struct sr_dev_inst *sdi)
 
 SR_PRIV int la2016_abort_acquisition(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	int ret;
 
 	ret = la2016_stop_acquisition(sdi);
 	if (ret != SR_OK)
 		return ret;
 
+	/* Stop the decoder first, it would resubmit transfers. */
+	devc = sdi->priv;
+	if (devc->decoder) {
+		la2016_decoder_stop(sdi);
+		devc->download_finished = TRUE;
+	}
 	(void)la2016_usbxfer_cancel_all(sdi);
 
 	return SR_OK;
@@ -1307,6 +1333,10 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
 		return ret;
 	}
 
+	ret = la2016_decoder_start(sdi);
+	if (ret != SR_OK)
+		return ret;
+
 	ret = la2016_usbxfer_submit_all(sdi);
 	if (ret != SR_OK) {
 		sr_err("Cannot submit USB bulk transfers.");
@@ -1322,6 +1352,165 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/*
+ * The download of sample memory runs as a pipeline: the USB transfers
+ * stay in flight, a decoder thread expands the run length encoded
+ * sample memory, and the session feed receives the decoded samples in
+ * the thread which runs the session.
+ *
+ * Completed transfers get passed to the decoder thread, which resubmits
+ * them when their content was processed. The transfers' pool thereby
+ * bounds the amount of raw sample memory which is waiting for decode.
+ * Decoded samples are passed back in blocks, which come from a small
+ * pool, too. When the session feed falls behind the decoder thread
+ * stalls, and the USB transfers stall with it. Which is fine because the
+ * device keeps the capture in its memory.
+ */
+
+#define DECODE_BLOCK_SAMPLES	(1024 * 1024)
+#define DECODE_BLOCK_COUNT	4
+
+struct decode_block {
+	uint8_t *data;
+	size_t count;		/* Number of samples in the block. */
+	int64_t trigger_at;	/* Sample index of the trigger, or -1. */
+	gboolean last;		/* Marks the end of the download. */
+};
+
+struct la2016_decoder {
+	struct sr_dev_inst *sdi;
+	GThread *thread;
+	/* Received transfers, and the decoder itself to terminate. */
+	GAsyncQueue *xfers;
+	/* Decoded sample blocks, and unused blocks. */
+	GAsyncQueue *blocks;
+	GAsyncQueue *free_blocks;
+	size_t blocks_allocated;
+	struct decode_block *block;
+	int stop;
+	gboolean finished;
+
+	size_t unitsize;
+	uint64_t total_samples;
+	uint64_t samples_limit;
+	uint32_t n_bytes_to_read;
+	uint32_t n_reps_until_trigger;
+	gboolean trigger_pending;
+	int last_seq;
+	size_t seq_errors;
+};
+
+/* Get the block to decode into, wait for the feed if all are in use. */
+static struct decode_block *decode_get_block(struct la2016_decoder *dec)
+{
+	struct decode_block *block;
+
+	if (dec->block)
+		return dec->block;
+
+	block = g_async_queue_try_pop(dec->free_blocks);
+	if (!block && dec->blocks_allocated < DECODE_BLOCK_COUNT) {
+		block = g_malloc0(sizeof(*block));
+		block->data = g_malloc(DECODE_BLOCK_SAMPLES * dec->unitsize);
+		dec->blocks_allocated++;
+	}
+	while (!block) {
+		if (g_atomic_int_get(&dec->stop))
+			return NULL;
+		block = g_async_queue_timeout_pop(dec->free_blocks,
+			100 * 1000);
+	}
+	block->count = 0;
+	block->trigger_at = -1;
+	block->last = FALSE;
+	dec->block = block;
+
+	return block;
+}
+
+static void decode_push_block(struct la2016_decoder *dec)
+{
+	if (!dec->block)
+		return;
+	if (!dec->block->count && dec->block->trigger_at < 0) {
+		g_async_queue_push(dec->free_blocks, dec->block);
+	} else {
+		g_async_queue_push(dec->blocks, dec->block);
+	}
+	dec->block = NULL;
+}
+
+/* No more sample data to decode, tell the session feed. */
+static void decode_finish(struct la2016_decoder *dec)
+{
+	struct decode_block *last;
+
+	if (dec->finished)
+		return;
+	dec->finished = TRUE;
+
+	decode_push_block(dec);
+	last = g_malloc0(sizeof(*last));
+	last->trigger_at = -1;
+	last->last = TRUE;
+	g_async_queue_push(dec->blocks, last);
+
+	if (dec->seq_errors)
+		sr_warn("Sample memory had %zu sequence errors.",
+			dec->seq_errors);
+	sr_dbg("Decoder done after %" PRIu64 " samples.", dec->total_samples);
+}
+
+static void decode_mark_trigger(struct la2016_decoder *dec)
+{
+	struct decode_block *block;
+
+	block = decode_get_block(dec);
+	if (!block)
+		return;
+	block->trigger_at = block->count;
+	dec->trigger_pending = FALSE;
+}
+
+/*
+ * Emit a run of identical samples. The pattern holds the sample value
+ * repeated to fill 8 bytes, as both unit sizes divide that. Runs get
+ * written in 8 byte words, and every run starts at a sample boundary.
+ */
+static gboolean decode_fill(struct la2016_decoder *dec,
+	const uint8_t *pattern, size_t count)
+{
+	struct decode_block *block;
+	uint8_t *wrptr;
+	size_t chunk, bytes;
+
+	if (dec->samples_limit) {
+		if (dec->total_samples + count > dec->samples_limit)
+			count = dec->samples_limit - dec->total_samples;
+	}
+	while (count) {
+		block = decode_get_block(dec);
+		if (!block)
+			return FALSE;
+		chunk = MIN(count, DECODE_BLOCK_SAMPLES - block->count);
+		wrptr = &block->data[block->count * dec->unitsize];
+		bytes = chunk * dec->unitsize;
+		while (bytes >= 8) {
+			memcpy(wrptr, pattern, 8);
+			wrptr += 8;
+			bytes -= 8;
+		}
+		memcpy(wrptr, pattern, bytes);
+		block->count += chunk;
+		dec->total_samples += chunk;
+		count -= chunk;
+		if (block->count == DECODE_BLOCK_SAMPLES)
+			decode_push_block(dec);
+	}
+
+	return !dec->samples_limit || dec->total_samples < dec->samples_limit;
+}
+
 /*
  * A chunk of sample memory was received via USB. These chunks contain
  * transfers of 16 or 32 bytes each (model dependent size and layout).
@@ -1341,103 +1530,306 @@ static int la2016_start_download(const struct sr_dev_inst *sdi)
  * - 6x (u32 pins, and u8 count)
  * - 2x u8 sequence number (inverted, and normal)
  *
- * This implementation silently ignores the (weak) sequence number.
+ * The sequence number is only checked for continuity, a mismatch gets
+ * counted and reported when the download completes.
  */
-static void send_chunk(struct sr_dev_inst *sdi,
+static void decode_chunk(struct la2016_decoder *dec,
 	const uint8_t *data_buffer, size_t data_length)
 {
 	struct dev_context *devc;
-	size_t num_xfers, num_pkts, num_seqs;
+	size_t num_xfers, num_pkts, idx;
 	const uint8_t *rp;
 	uint32_t sample_value;
 	size_t repetitions;
-	uint8_t sample_buff[sizeof(sample_value)];
-
-	devc = sdi->priv;
-
-	/* Ignore incoming USB data after complete sample data download. */
-	if (devc->download_finished)
-		return;
+	uint8_t pattern[8];
+	int seq, seq_inv;
 
-	if (devc->trigger_involved && !devc->trigger_marked && devc->info.n_rep_packets_before_trigger == 0) {
-		feed_queue_logic_send_trigger(devc->feed_queue);
-		devc->trigger_marked = TRUE;
-	}
+	devc = dec->sdi->priv;
 
-	/*
-	 * Adjust the number of remaining bytes to read from the device
-	 * before the processing of the currently received chunk affects
-	 * the variable which holds the number of received bytes.
-	 */
-	if (data_length > devc->n_bytes_to_read)
-		devc->n_bytes_to_read = 0;
-	else
-		devc->n_bytes_to_read -= data_length;
+	if (data_length > dec->n_bytes_to_read)
+		data_length = dec->n_bytes_to_read;
+	dec->n_bytes_to_read -= data_length;
 
-	/* Process the received chunk of capture data. */
-	sample_value = 0;
 	rp = data_buffer;
 	num_xfers = data_length / devc->transfer_size;
 	while (num_xfers--) {
 		num_pkts = devc->packets_per_chunk;
 		while (num_pkts--) {
-
-			if (devc->model->channel_count == 32)
+			if (dec->unitsize == sizeof(uint32_t)) {
 				sample_value = read_u32le_inc(&rp);
-			else if (devc->model->channel_count == 16)
+				for (idx = 0; idx < sizeof(pattern); idx += 4)
+					write_u32le(&pattern[idx], sample_value);
+			} else {
 				sample_value = read_u16le_inc(&rp);
+				for (idx = 0; idx < sizeof(pattern); idx += 2)
+					write_u16le(&pattern[idx], sample_value);
+			}
 			repetitions = read_u8_inc(&rp);
 
-			devc->total_samples += repetitions;
-
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit_one(devc->feed_queue,
-				sample_buff, repetitions);
-			sr_sw_limits_update_samples_read(&devc->sw_limits,
-				repetitions);
-
-			if (devc->trigger_involved && !devc->trigger_marked) {
-				if (!--devc->n_reps_until_trigger) {
-					feed_queue_logic_send_trigger(devc->feed_queue);
-					devc->trigger_marked = TRUE;
-					sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
-						devc->total_samples,
-						(double)devc->total_samples / devc->samplerate * 1e3);
-				}
+			if (!decode_fill(dec, pattern, repetitions)) {
+				decode_finish(dec);
+				return;
 			}
+			if (dec->trigger_pending && !--dec->n_reps_until_trigger)
+				decode_mark_trigger(dec);
 		}
-		/* Skip the sequence number bytes. */
-		num_seqs = devc->sequence_size;
-		while (num_seqs--)
-			(void)read_u8_inc(&rp);
+
+		if (devc->sequence_size == 2) {
+			seq_inv = read_u8_inc(&rp);
+			seq = read_u8_inc(&rp);
+			if ((seq ^ seq_inv) != 0xff)
+				dec->seq_errors++;
+		} else {
+			seq = read_u8_inc(&rp);
+		}
+		if (dec->last_seq >= 0 && seq != ((dec->last_seq + 1) & 0xff))
+			dec->seq_errors++;
+		dec->last_seq = seq;
 	}
 
 	/*
-	 * Check for several conditions which shall terminate the
-	 * capture data download: When the amount of capture data in
-	 * the device is exhausted. When the user specified samples
-	 * count limit is reached.
+	 * A partial block is kept for the next chunk. Blocks get passed
+	 * to the feed when they are full, or when decoding finishes.
 	 */
-	if (!devc->n_bytes_to_read) {
-		devc->download_finished = TRUE;
-	} else {
-		sr_dbg("%" PRIu32 " more bytes to download from the device.",
-			devc->n_bytes_to_read);
+	if (!dec->n_bytes_to_read)
+		decode_finish(dec);
+}
+
+static void *decode_thread(void *data)
+{
+	struct la2016_decoder *dec;
+	struct libusb_transfer *xfer;
+	void *item;
+
+	dec = data;
+	while ((item = g_async_queue_pop(dec->xfers)) != dec) {
+		xfer = item;
+		if (dec->finished)
+			continue;
+		decode_chunk(dec, xfer->buffer, xfer->actual_length);
+		if (dec->finished || g_atomic_int_get(&dec->stop))
+			continue;
+		if (la2016_usbxfer_resubmit(dec->sdi, xfer) != SR_OK)
+			decode_finish(dec);
 	}
-	if (!devc->download_finished && sr_sw_limits_check(&devc->sw_limits)) {
-		sr_dbg("Acquisition limit reached.");
-		devc->download_finished = TRUE;
+	decode_push_block(dec);
+
+	return NULL;
+}
+
+static void la2016_decoder_free_block(void *p)
+{
+	struct decode_block *block;
+
+	block = p;
+	g_free(block->data);
+	g_free(block);
+}
+
+static void la2016_decoder_stop(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct la2016_decoder *dec;
+	void *item;
+
+	devc = sdi->priv;
+	dec = devc->decoder;
+	if (!dec)
+		return;
+
+	g_atomic_int_set(&dec->stop, 1);
+	g_async_queue_push(dec->xfers, dec);
+	g_thread_join(dec->thread);
+
+	while (g_async_queue_try_pop(dec->xfers))
+		;
+	while ((item = g_async_queue_try_pop(dec->blocks)))
+		la2016_decoder_free_block(item);
+	while ((item = g_async_queue_try_pop(dec->free_blocks)))
+		la2016_decoder_free_block(item);
+	g_async_queue_unref(dec->xfers);
+	g_async_queue_unref(dec->blocks);
+	g_async_queue_unref(dec->free_blocks);
+	g_free(dec);
+	devc->decoder = NULL;
+}
+
+static int la2016_decoder_start(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct la2016_decoder *dec;
+	GError *error;
+
+	devc = sdi->priv;
+	la2016_decoder_stop(sdi);
+
+	dec = g_malloc0(sizeof(*dec));
+	dec->sdi = (struct sr_dev_inst *)sdi;
+	dec->xfers = g_async_queue_new();
+	dec->blocks = g_async_queue_new();
+	dec->free_blocks = g_async_queue_new();
+	dec->unitsize = devc->model->channel_count == 32
+		? sizeof(uint32_t) : sizeof(uint16_t);
+	dec->samples_limit = devc->sw_limits.limit_samples;
+	dec->n_bytes_to_read = devc->n_bytes_to_read;
+	dec->n_reps_until_trigger = devc->n_reps_until_trigger;
+	dec->trigger_pending = devc->trigger_involved;
+	dec->last_seq = -1;
+	devc->decoder = dec;
+
+	if (dec->trigger_pending && !dec->n_reps_until_trigger)
+		decode_mark_trigger(dec);
+
+	error = NULL;
+	dec->thread = g_thread_try_new("la2016-decode", decode_thread,
+		dec, &error);
+	if (!dec->thread) {
+		sr_err("Cannot create decoder thread: %s.", error->message);
+		g_error_free(error);
+		if (dec->block)
+			la2016_decoder_free_block(dec->block);
+		g_async_queue_unref(dec->xfers);
+		g_async_queue_unref(dec->blocks);
+		g_async_queue_unref(dec->free_blocks);
+		g_free(dec);
+		devc->decoder = NULL;
+		return SR_ERR;
 	}
-	if (devc->download_finished) {
-		sr_dbg("Download finished, flushing session feed queue.");
-		feed_queue_logic_flush(devc->feed_queue);
+
+	return SR_OK;
+}
+
+static int send_logic(const struct sr_dev_inst *sdi,
+	uint8_t *data, size_t count, size_t unitsize)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	if (!count)
+		return SR_OK;
+
+	logic.length = count * unitsize;
+	logic.unitsize = unitsize;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	return sr_session_send(sdi, &packet);
+}
+
+/* Pass decoded samples to the session feed. Runs in the session's thread. */
+static void la2016_decoder_feed(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct la2016_decoder *dec;
+	struct decode_block *block;
+	size_t pre_count, unitsize;
+
+	devc = sdi->priv;
+	dec = devc->decoder;
+	unitsize = dec->unitsize;
+
+	while ((block = g_async_queue_try_pop(dec->blocks))) {
+		if (block->last) {
+			g_free(block);
+			devc->download_finished = TRUE;
+			continue;
+		}
+
+		pre_count = block->count;
+		if (block->trigger_at >= 0)
+			pre_count = block->trigger_at;
+		send_logic(sdi, block->data, pre_count, unitsize);
+		devc->total_samples += pre_count;
+		if (block->trigger_at >= 0) {
+			std_session_send_df_trigger(sdi);
+			devc->trigger_marked = TRUE;
+			sr_dbg("Trigger position after %" PRIu64 " samples, %.6fms.",
+				devc->total_samples,
+				(double)devc->total_samples / devc->samplerate * 1e3);
+		}
+		send_logic(sdi, &block->data[pre_count * unitsize],
+			block->count - pre_count, unitsize);
+		devc->total_samples += block->count - pre_count;
+		sr_sw_limits_update_samples_read(&devc->sw_limits,
+			block->count);
+
+		g_async_queue_push(dec->free_blocks, block);
+	}
+}
+
+/*
+ * Transpose a 32x32 bit matrix in place, row i's bit j becomes row j's
+ * bit i. Swaps ever smaller blocks of bits: 16x16 blocks, then 8x8 blocks
+ * within those, and so on. See "Hacker's Delight", section 7-3.
+ */
+static void transpose32(uint32_t *rows)
+{
+	uint32_t mask, t;
+	size_t j, k;
+
+	mask = 0x0000ffff;
+	for (j = 16; j; j >>= 1, mask ^= mask << j) {
+		for (k = 0; k < 32; k = (k + j + 1) & ~j) {
+			t = ((rows[k] >> j) ^ rows[k + j]) & mask;
+			rows[k] ^= t << j;
+			rows[k + j] ^= t;
+		}
 	}
-	sr_dbg("Total samples after chunk: %" PRIu64 ".", devc->total_samples);
+}
+
+/*
+ * Pass a block of unpacked stream samples to the session feed. Before
+ * the soft trigger fired, the samples go to the soft trigger's pre-trigger
+ * buffer instead, which gets sent when the trigger fires.
+ */
+static void stream_submit(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct stream_state_t *stream;
+	uint8_t *data;
+	size_t count;
+	uint64_t remain;
+	int offset, pre_trigger_samples;
+
+	devc = sdi->priv;
+	stream = &devc->stream;
+
+	data = stream->unpacked;
+	count = stream->unpacked_count;
+	stream->unpacked_count = 0;
+	if (!count)
+		return;
+
+	if (stream->stl && !stream->trigger_fired) {
+		offset = soft_trigger_logic_check(stream->stl, data,
+			count * stream->unitsize, &pre_trigger_samples);
+		if (offset < 0)
+			return;
+		stream->trigger_fired = TRUE;
+		devc->trigger_marked = TRUE;
+		sr_sw_limits_update_samples_read(&devc->sw_limits,
+			pre_trigger_samples);
+		devc->total_samples += pre_trigger_samples;
+		sr_dbg("Soft trigger fired after %d pre-trigger samples.",
+			pre_trigger_samples);
+		data += offset * stream->unitsize;
+		count -= offset;
+	}
+
+	if (devc->sw_limits.limit_samples) {
+		remain = devc->sw_limits.limit_samples;
+		remain -= MIN(remain, devc->sw_limits.samples_read);
+		count = MIN(count, remain);
+	}
+	feed_queue_logic_submit_many(devc->feed_queue, data, count);
+	sr_sw_limits_update_samples_read(&devc->sw_limits, count);
+	devc->total_samples += count;
 }
 
 /*
  * Process a chunk of capture data in streaming mode. The memory layout
- * is rather different from "normal mode" (see the send_chunk() routine
+ * is rather different from "normal mode" (see the decode_chunk() routine
  * above). In streaming mode data is not compressed, and memory cells
  * neither contain raw sampled pin values at a given point in time. The
  * memory content needs transformation.
@@ -1449,26 +1841,28 @@ static void send_chunk(struct sr_dev_inst *sdi,
  * sampled later. After all 16bit entities for all enabled channels
  * were seen, the first enabled channel's next chunk follows.
  *
- * Implementor's note: This routine is inspired by convert_sample_data()
+ * Each channel's entity thus is a row of a bit matrix with channels for
+ * rows and sample times for columns. Transposing that matrix gets the
+ * rows for all 16 sample times, with all channels' pin values in each.
+ * Unpacked samples are collected, and passed on in blocks.
+ *
+ * Implementor's note: The layout was derived from convert_sample_data()
  * in the https://github.com/AlexUg/sigrok implementation. Which in turn
  * appears to have been derived from the saleae-logic16 sigrok driver.
- * The code is phrased conservatively to verify the layout as discussed
- * above, performance was not a priority. Operation was verified with an
- * LA2016 device. The LA5032 reportedly shares the 16 samples per channel
- * layout, just round-robins through a potentially larger set of enabled
- * channels before returning to the first of the channels.
+ * Operation was verified with an LA2016 device. The LA5032 reportedly
+ * shares the 16 samples per channel layout, just round-robins through
+ * a potentially larger set of enabled channels before returning to the
+ * first of the channels.
  */
 static void stream_data(struct sr_dev_inst *sdi,
 	const uint8_t *data_buffer, size_t data_length)
 {
 	struct dev_context *devc;
 	struct stream_state_t *stream;
-	size_t bit_count;
+	const size_t bit_count = 16;
 	const uint8_t *rp;
-	uint32_t sample_value;
-	uint8_t sample_buff[sizeof(sample_value)];
+	uint8_t *wrptr;
 	size_t bit_idx;
-	uint32_t ch_mask;
 
 	devc = sdi->priv;
 	stream = &devc->stream;
@@ -1479,43 +1873,40 @@ static void stream_data(struct sr_dev_inst *sdi,
 	sr_dbg("Stream mode, got another chunk: %p, length %zu.",
 		data_buffer, data_length);
 
-	/* TODO Add soft trigger support when in stream mode? */
-
 	/* All channels' chunks carry 16 samples for one channel. */
-	bit_count = 16;
 	data_length /= sizeof(uint16_t);
 
 	rp = data_buffer;
-	sample_value = 0;
 	while (data_length--) {
-		/* Get another entity. */
-		sample_value = read_u16le_inc(&rp);
-
-		/* Map the entity's bits to a channel's samples. */
-		ch_mask = stream->channel_masks[stream->channel_index];
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			if (sample_value & (1UL << bit_idx))
-				stream->sample_data[bit_idx] |= ch_mask;
-		}
+		/* Get another entity, the row of its channel. */
+		stream->bit_matrix[stream->channel_ids[stream->channel_index]] =
+			read_u16le_inc(&rp);
 
 		/*
-		 * Advance to the next channel. Submit a block of
+		 * Advance to the next channel. Unpack a block of
 		 * samples when all channels' data was seen.
 		 */
 		stream->channel_index++;
 		if (stream->channel_index != stream->enabled_count)
 			continue;
-		for (bit_idx = 0; bit_idx < bit_count; bit_idx++) {
-			sample_value = stream->sample_data[bit_idx];
-			write_u32le(sample_buff, sample_value);
-			feed_queue_logic_submit_one(devc->feed_queue,
-				sample_buff, 1);
-		}
-		sr_sw_limits_update_samples_read(&devc->sw_limits, bit_count);
-		devc->total_samples += bit_count;
-		memset(stream->sample_data, 0, sizeof(stream->sample_data));
 		stream->channel_index = 0;
+
+		transpose32(stream->bit_matrix);
+		wrptr = &stream->unpacked[stream->unpacked_count * stream->unitsize];
+		if (stream->unitsize == sizeof(uint32_t)) {
+			for (bit_idx = 0; bit_idx < bit_count; bit_idx++)
+				write_u32le_inc(&wrptr, stream->bit_matrix[bit_idx]);
+		} else {
+			for (bit_idx = 0; bit_idx < bit_count; bit_idx++)
+				write_u16le_inc(&wrptr, stream->bit_matrix[bit_idx]);
+		}
+		stream->unpacked_count += bit_count;
+		memset(stream->bit_matrix, 0, sizeof(stream->bit_matrix));
+
+		if (stream->unpacked_count + bit_count > LA2016_STREAM_UNPACK_SIZE)
+			stream_submit(sdi);
 	}
+	stream_submit(sdi);
 
 	/*
 	 * Need we count empty or failed USB transfers? This version
@@ -1566,11 +1957,16 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	 * perfectly acceptable. Reaching (or exceeding) the sw limits
 	 * or exhausting the device's captured data will complete the
 	 * sample data download.
+	 *
+	 * Downloads get decoded in the decoder thread, which resubmits
+	 * the transfer when done with it.
 	 */
-	if (devc->continuous)
-		stream_data(sdi, transfer->buffer, transfer->actual_length);
-	else
-		send_chunk(sdi, transfer->buffer, transfer->actual_length);
+	if (!devc->continuous) {
+		if (!was_cancelled && devc->decoder)
+			g_async_queue_push(devc->decoder->xfers, transfer);
+		return;
+	}
+	stream_data(sdi, transfer->buffer, transfer->actual_length);
 
 	/*
 	 * Re-submit completed transfers (regardless of timeout or
@@ -1683,6 +2079,10 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 		}
 	}
 
+	/* Pass the decoder's output to the session feed. */
+	if (devc->decoder)
+		la2016_decoder_feed(sdi);
+
 	/* Postprocess completion of sample data download. */
 	if (devc->download_finished) {
 		sr_dbg("Download finished, post processing.");
@@ -1690,6 +2090,7 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 		la2016_stop_acquisition(sdi);
 		usb_source_remove(sdi->session, drvc->sr_ctx);
 
+		la2016_decoder_stop(sdi);
 		la2016_usbxfer_cancel_all(sdi);
 		memset(&tv, 0, sizeof(tv));
 		libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
@@ -1697,6 +2098,10 @@ SR_PRIV int la2016_receive_data(int fd, int revents, void *cb_data)
 		feed_queue_logic_flush(devc->feed_queue);
 		feed_queue_logic_free(devc->feed_queue);
 		devc->feed_queue = NULL;
+		if (devc->stream.stl) {
+			soft_trigger_logic_free(devc->stream.stl);
+			devc->stream.stl = NULL;
+		}
 		if (devc->frame_begin_sent) {
 			std_session_send_df_frame_end(sdi);
 			devc->frame_begin_sent = FALSE;
@@ -1867,15 +2272,30 @@ SR_PRIV int la2016_identify_device(const struct sr_dev_inst *sdi,
 
 SR_PRIV int la2016_init_hardware(const struct sr_dev_inst *sdi)
 {
+	struct drv_context *drvc;
 	struct dev_context *devc;
 	const char *bitstream_fn;
 	int ret;
 	uint16_t state;
 
+	drvc = sdi->driver->context;
 	devc = sdi->priv;
 	bitstream_fn = devc ? devc->fpga_bitstream : "";
 
-	ret = check_fpga_bitstream(sdi);
+	/*
+	 * The FPGA keeps its configuration while the device is powered,
+	 * also across sessions, and gets re-used when its registers look
+	 * sane. Upload again when this context has put another image onto
+	 * the device before (a replaced file, or another model's image).
+	 */
+	if (sr_resource_image_current(sdi, drvc->sr_ctx,
+			SR_RESOURCE_FIRMWARE, bitstream_fn))
+		ret = check_fpga_bitstream(sdi);
+	else if (sr_resource_image_differs(sdi, drvc->sr_ctx,
+			SR_RESOURCE_FIRMWARE, bitstream_fn))
+		ret = SR_ERR_DATA;
+	else
+		ret = check_fpga_bitstream(sdi);
 	if (ret != SR_OK) {
 		ret = upload_fpga_bitstream(sdi, bitstream_fn);
 		if (ret != SR_OK) {
@@ -1920,6 +2340,14 @@ SR_PRIV int la2016_deinit_hardware(const struct sr_dev_inst *sdi)
 
 SR_PRIV void la2016_release_resources(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	if (devc->stream.stl) {
+		soft_trigger_logic_free(devc->stream.stl);
+		devc->stream.stl = NULL;
+	}
+	la2016_decoder_stop(sdi);
 	(void)la2016_usbxfer_release(sdi);
 }
 
@@ -93,6 +93,7 @@
 #define LA2016_STREAM_MBPS_MAX	200	/* In units of Mbps. */
 #define LA2016_STREAM_PUSH_THR	16	/* In units of Mbps. */
 #define LA2016_STREAM_PUSH_IVAL	250	/* In units of ms. */
+#define LA2016_STREAM_UNPACK_SIZE	4096	/* In units of samples. */
 
 /*
  * Whether to de-initialize the device hardware in the driver's close
@@ -157,14 +158,20 @@ struct dev_context {
 	uint32_t read_pos;
 
 	struct feed_queue_logic *feed_queue;
+	struct la2016_decoder *decoder;
 	GSList *transfers;
 	size_t transfer_bufsize;
 	struct stream_state_t {
 		size_t enabled_count;
 		uint32_t enabled_mask;
-		uint32_t channel_masks[32];
+		size_t channel_ids[32];
 		size_t channel_index;
-		uint32_t sample_data[32];
+		uint32_t bit_matrix[32]; /* Rows are channels, columns samples. */
+		size_t unitsize;
+		size_t unpacked_count;
+		uint8_t unpacked[LA2016_STREAM_UNPACK_SIZE * sizeof(uint32_t)];
+		struct soft_trigger_logic *stl;
+		gboolean trigger_fired;
 		uint64_t flush_period_ms;
 		uint64_t last_flushed;
 	} stream;
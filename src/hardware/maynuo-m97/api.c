@@ -208,7 +208,6 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 static int dev_close(struct sr_dev_inst *sdi)
 {
-	struct dev_context *devc;
 	struct sr_modbus_dev_inst *modbus;
 
 	modbus = sdi->conn;
@@ -216,15 +215,6 @@ static int dev_close(struct sr_dev_inst *sdi)
 	if (!modbus)
 		return SR_ERR_BUG;
 
-	devc = sdi->priv;
-
-	if (devc->expecting_registers) {
-		/* Wait for the last data that was requested from the device. */
-		uint16_t registers[devc->expecting_registers];
-		sr_modbus_read_holding_registers(modbus, -1,
-			devc->expecting_registers, registers);
-	}
-
 	maynuo_m97_set_bit(modbus, PC1, 0);
 
 	return sr_modbus_close(modbus);
@@ -244,6 +234,9 @@ static int config_get(uint32_t key, GVariant **data,
 	modbus = sdi->conn;
 	devc = sdi->priv;
 
+	/* Don't interfere with a running acquisition's requests. */
+	sr_poll_bus_lock(devc->poll);
+
 	ret = SR_OK;
 	switch (key) {
 	case SR_CONF_LIMIT_SAMPLES:
@@ -308,9 +301,12 @@ static int config_get(uint32_t key, GVariant **data,
 			*data = g_variant_new_boolean(ivalue);
 		break;
 	default:
-		return SR_ERR_NA;
+		ret = SR_ERR_NA;
+		break;
 	}
 
+	sr_poll_bus_unlock(devc->poll);
+
 	return ret;
 }
 
@@ -319,31 +315,44 @@ static int config_set(uint32_t key, GVariant *data,
 {
 	struct dev_context *devc;
 	struct sr_modbus_dev_inst *modbus;
+	int ret;
 
 	(void)cg;
 
 	modbus = sdi->conn;
 	devc = sdi->priv;
 
+	/* Don't interfere with a running acquisition's requests. */
+	sr_poll_bus_lock(devc->poll);
+
 	switch (key) {
 	case SR_CONF_LIMIT_SAMPLES:
 	case SR_CONF_LIMIT_MSEC:
-		return sr_sw_limits_config_set(&devc->limits, key, data);
+		ret = sr_sw_limits_config_set(&devc->limits, key, data);
+		break;
 	case SR_CONF_ENABLED:
-		return maynuo_m97_set_input(modbus, g_variant_get_boolean(data));
+		ret = maynuo_m97_set_input(modbus, g_variant_get_boolean(data));
+		break;
 	case SR_CONF_VOLTAGE_TARGET:
-		return maynuo_m97_set_float(modbus, UFIX, g_variant_get_double(data));
+		ret = maynuo_m97_set_float(modbus, UFIX, g_variant_get_double(data));
+		break;
 	case SR_CONF_CURRENT_LIMIT:
-		return maynuo_m97_set_float(modbus, IFIX, g_variant_get_double(data));
+		ret = maynuo_m97_set_float(modbus, IFIX, g_variant_get_double(data));
+		break;
 	case SR_CONF_OVER_VOLTAGE_PROTECTION_THRESHOLD:
-		return maynuo_m97_set_float(modbus, UMAX, g_variant_get_double(data));
+		ret = maynuo_m97_set_float(modbus, UMAX, g_variant_get_double(data));
+		break;
 	case SR_CONF_OVER_CURRENT_PROTECTION_THRESHOLD:
-		return maynuo_m97_set_float(modbus, IMAX, g_variant_get_double(data));
+		ret = maynuo_m97_set_float(modbus, IMAX, g_variant_get_double(data));
+		break;
 	default:
-		return SR_ERR_NA;
+		ret = SR_ERR_NA;
+		break;
 	}
 
-	return SR_OK;
+	sr_poll_bus_unlock(devc->poll);
+
+	return ret;
 }
 
 static int config_list(uint32_t key, GVariant **data,
@@ -381,30 +390,30 @@ static int config_list(uint32_t key, GVariant **data,
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct sr_modbus_dev_inst *modbus;
-	int ret;
 
-	modbus = sdi->conn;
 	devc = sdi->priv;
 
-	if ((ret = sr_modbus_source_add(sdi->session, modbus, G_IO_IN, 10,
-			maynuo_m97_receive_data, (void *)sdi)) != SR_OK)
-		return ret;
-
 	sr_sw_limits_acquisition_start(&devc->limits);
 	std_session_send_df_header(sdi);
 
-	return maynuo_m97_capture_start(sdi);
+	devc->poll = sr_poll_add(sdi->session, sdi->conn, "U+I",
+		POLL_INTERVAL_MS, maynuo_m97_poll_run, maynuo_m97_poll_done, (void *)sdi);
+	if (!devc->poll)
+		return SR_ERR;
+
+	return SR_OK;
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
-	struct sr_modbus_dev_inst *modbus;
+	struct dev_context *devc;
 
-	std_session_send_df_end(sdi);
+	devc = sdi->priv;
 
-	modbus = sdi->conn;
-	sr_modbus_source_remove(sdi->session, modbus);
+	sr_poll_remove(devc->poll);
+	devc->poll = NULL;
+
+	std_session_send_df_end(sdi);
 
 	return SR_OK;
 }
@@ -18,6 +18,7 @@
  */
 
 #include <config.h>
+#include <string.h>
 #include "protocol.h"
 
 SR_PRIV int maynuo_m97_get_bit(struct sr_modbus_dev_inst *modbus,
@@ -147,38 +148,35 @@ static void maynuo_m97_session_send_value(const struct sr_dev_inst *sdi, struct
 	g_slist_free(analog.meaning->channels);
 }
 
-SR_PRIV int maynuo_m97_capture_start(const struct sr_dev_inst *sdi)
+/* Runs in the poll thread. */
+SR_PRIV int maynuo_m97_poll_run(void *cb_data, GByteArray *reply)
 {
-	struct dev_context *devc;
-	struct sr_modbus_dev_inst *modbus;
+	struct sr_dev_inst *sdi;
+	uint16_t registers[4];
 	int ret;
 
-	modbus = sdi->conn;
-	devc = sdi->priv;
+	sdi = cb_data;
+
+	ret = sr_modbus_read_holding_registers(sdi->conn, U, 4, registers);
+	if (ret == SR_OK)
+		g_byte_array_append(reply, (const uint8_t *)registers,
+			sizeof(registers));
 
-	if ((ret = sr_modbus_read_holding_registers(modbus, U, 4, NULL)) == SR_OK)
-		devc->expecting_registers = 4;
 	return ret;
 }
 
-SR_PRIV int maynuo_m97_receive_data(int fd, int revents, void *cb_data)
+SR_PRIV void maynuo_m97_poll_done(int result, const uint8_t *reply,
+		size_t reply_len, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct sr_modbus_dev_inst *modbus;
 	uint16_t registers[4];
 
-	(void)fd;
-	(void)revents;
-
-	if (!(sdi = cb_data))
-		return TRUE;
-
-	modbus = sdi->conn;
+	sdi = cb_data;
 	devc = sdi->priv;
 
-	devc->expecting_registers = 0;
-	if (sr_modbus_read_holding_registers(modbus, -1, 4, registers) == SR_OK) {
+	if (result == SR_OK && reply_len == sizeof(registers)) {
+		memcpy(registers, reply, sizeof(registers));
 		std_session_send_df_frame_begin(sdi);
 
 		maynuo_m97_session_send_value(sdi, sdi->channels->data,
@@ -192,11 +190,6 @@ SR_PRIV int maynuo_m97_receive_data(int fd, int revents, void *cb_data)
 		sr_sw_limits_update_samples_read(&devc->limits, 1);
 	}
 
-	if (sr_sw_limits_check(&devc->limits)) {
+	if (sr_sw_limits_check(&devc->limits))
 		sr_dev_acquisition_stop(sdi);
-		return TRUE;
-	}
-
-	maynuo_m97_capture_start(sdi);
-	return TRUE;
 }
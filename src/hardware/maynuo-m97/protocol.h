@@ -26,6 +26,9 @@
 
 #define LOG_PREFIX "maynuo-m97"
 
+/* Time between readings of voltage and current, in ms. */
+#define POLL_INTERVAL_MS 10
+
 struct maynuo_m97_model {
 	unsigned int id;
 	const char *name;
@@ -37,7 +40,7 @@ struct maynuo_m97_model {
 struct dev_context {
 	const struct maynuo_m97_model *model;
 	struct sr_sw_limits limits;
-	int expecting_registers;
+	struct sr_poll *poll;
 };
 
 enum maynuo_m97_coil {
@@ -149,7 +152,8 @@ SR_PRIV int maynuo_m97_get_model_version(struct sr_modbus_dev_inst *modbus,
 
 SR_PRIV const char *maynuo_m97_mode_to_str(enum maynuo_m97_mode mode);
 
-SR_PRIV int maynuo_m97_capture_start(const struct sr_dev_inst *sdi);
-SR_PRIV int maynuo_m97_receive_data(int fd, int revents, void *cb_data);
+SR_PRIV int maynuo_m97_poll_run(void *cb_data, GByteArray *reply);
+SR_PRIV void maynuo_m97_poll_done(int result, const uint8_t *reply,
+		size_t reply_len, void *cb_data);
 
 #endif
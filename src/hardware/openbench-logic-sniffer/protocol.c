@@ -354,17 +354,169 @@ SR_PRIV void abort_acquisition(const struct sr_dev_inst *sdi)
 	std_session_send_df_end(sdi);
 }
 
+/* Setup the received sample layout before the first byte gets decoded. */
+static void ols_setup_sample_layout(struct dev_context *devc)
+{
+	unsigned int i;
+
+	/*
+	 * Some channel groups may have been turned off, to speed up
+	 * transfer between the hardware and the PC. Received samples
+	 * only contain the enabled groups' bytes, in ascending order.
+	 */
+	devc->num_changroups = 0;
+	for (i = 0; i < 4; i++) {
+		if (((devc->capture_flags >> 2) & (1 << i)) == 0)
+			devc->changroup_pos[devc->num_changroups++] = i;
+	}
+}
+
+/*
+ * Store one received sample (or RLE count), of num_changroups bytes.
+ * The OLS sends its sample buffer backwards, samples get stored in
+ * reverse order here, so the buffer can go to the session bus as is.
+ */
+static void ols_store_sample(struct dev_context *devc, const uint8_t *bytes)
+{
+	uint8_t expanded[4];
+	unsigned int i, count;
+	uint8_t *dst;
+	size_t unitsize;
+
+	devc->cnt_samples++;
+	devc->cnt_samples_rle++;
+	if (devc->capture_flags & CAPTURE_FLAG_RLE) {
+		/*
+		 * In RLE mode the high bit of the sample is the "count"
+		 * flag, meaning this sample is the number of times the
+		 * previous sample occurred.
+		 */
+		if (bytes[devc->num_changroups - 1] & 0x80) {
+			devc->rle_count = 0;
+			for (i = devc->num_changroups; i > 0; i--)
+				devc->rle_count = (devc->rle_count << 8) | bytes[i - 1];
+			devc->rle_count &= ~(0x80U << (devc->num_changroups - 1) * 8);
+			devc->cnt_samples_rle += devc->rle_count;
+			return;
+		}
+	}
+
+	count = devc->rle_count + 1;
+	devc->rle_count = 0;
+	if (count > devc->limit_samples - devc->num_samples) {
+		/* Save us from overrunning the buffer. */
+		count = devc->limit_samples - devc->num_samples;
+	}
+	devc->num_samples += count;
+
+	/*
+	 * Expand the enabled channel groups to 32 bits little endian,
+	 * whatever is listening on the bus will be expecting a full
+	 * sample of devc->unitsize bytes. Cropping to that size happens
+	 * when the sample gets stored.
+	 */
+	memset(expanded, 0, sizeof(expanded));
+	for (i = 0; i < devc->num_changroups; i++)
+		expanded[devc->changroup_pos[i]] = bytes[i];
+
+	unitsize = devc->unitsize;
+	dst = devc->raw_sample_buf +
+		(devc->limit_samples - devc->num_samples) * unitsize;
+	if (unitsize == 1) {
+		memset(dst, expanded[0], count);
+	} else {
+		for (i = 0; i < count; i++, dst += unitsize)
+			memcpy(dst, expanded, unitsize);
+	}
+}
+
+/*
+ * Decode a block of received bytes. Complete samples get taken from
+ * the block directly, only samples which span two blocks get collected
+ * in devc->sample.
+ */
+static void ols_decode_bytes(struct dev_context *devc,
+	const uint8_t *buf, size_t len)
+{
+	size_t need;
+
+	while (len && devc->num_samples < devc->limit_samples) {
+		if (devc->num_bytes == 0 && len >= devc->num_changroups) {
+			ols_store_sample(devc, buf);
+			buf += devc->num_changroups;
+			len -= devc->num_changroups;
+			continue;
+		}
+		need = devc->num_changroups - devc->num_bytes;
+		if (need > len)
+			need = len;
+		memcpy(&devc->sample[devc->num_bytes], buf, need);
+		devc->num_bytes += need;
+		buf += need;
+		len -= need;
+		if ((unsigned int)devc->num_bytes == devc->num_changroups) {
+			ols_store_sample(devc, devc->sample);
+			devc->num_bytes = 0;
+		}
+	}
+}
+
+/* Send the (properly-ordered) buffer to the frontend. */
+static void ols_send_samples(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	unsigned int num_pre_trigger_samples;
+	uint8_t *data;
+
+	devc = sdi->priv;
+
+	sr_dbg("Received %d bytes, %d samples, %d decompressed samples.",
+	       devc->cnt_bytes, devc->cnt_samples,
+	       devc->cnt_samples_rle);
+
+	data = devc->raw_sample_buf +
+		(devc->limit_samples - devc->num_samples) * devc->unitsize;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = devc->unitsize;
+
+	num_pre_trigger_samples = 0;
+	if (devc->trigger_at_smpl != OLS_NO_TRIGGER) {
+		/*
+		 * A trigger was set up, so we need to tell the frontend
+		 * about it.
+		 */
+		num_pre_trigger_samples = MIN((unsigned int)devc->trigger_at_smpl,
+			devc->num_samples);
+		if (num_pre_trigger_samples > 0) {
+			/* There are pre-trigger samples, send those first. */
+			logic.length = num_pre_trigger_samples * devc->unitsize;
+			logic.data = data;
+			sr_session_send(sdi, &packet);
+		}
+
+		/* Send the trigger. */
+		std_session_send_df_trigger(sdi);
+	}
+
+	/* Send post-trigger / all captured samples. */
+	logic.length = (devc->num_samples - num_pre_trigger_samples) *
+		devc->unitsize;
+	logic.data = data + num_pre_trigger_samples * devc->unitsize;
+	if (logic.length)
+		sr_session_send(sdi, &packet);
+}
+
 SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 {
 	struct dev_context *devc;
 	struct sr_dev_inst *sdi;
 	struct sr_serial_dev_inst *serial;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	uint32_t sample;
-	int num_changroups, offset, j;
-	unsigned int i;
-	unsigned char byte;
+	uint8_t buf[4096];
+	size_t total;
+	int len;
 
 	(void)fd;
 
@@ -385,164 +537,46 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 		}
 		/* fill with 1010... for debugging */
 		memset(devc->raw_sample_buf, 0x82, devc->limit_samples * 4);
-	}
-
-	num_changroups = 0;
-	for (i = 0x20; i > 0x02; i >>= 1) {
-		if ((devc->capture_flags & i) == 0) {
-			num_changroups++;
-		}
+		ols_setup_sample_layout(devc);
 	}
 
 	if (revents == G_IO_IN && devc->num_samples < devc->limit_samples) {
-		if (serial_read_nonblocking(serial, &byte, 1) != 1)
-			return FALSE;
-		devc->cnt_bytes++;
-
-		/* Ignore it if we've read enough. */
-		if (devc->num_samples >= devc->limit_samples)
-			return TRUE;
-
-		devc->sample[devc->num_bytes++] = byte;
-		sr_spew("Received byte 0x%.2x.", byte);
-		if (devc->num_bytes == num_changroups) {
-			devc->cnt_samples++;
-			devc->cnt_samples_rle++;
-			/*
-			 * Got a full sample. Convert from the OLS's little-endian
-			 * sample to the local format.
-			 */
-			sample = devc->sample[0] | (devc->sample[1] << 8) |
-				 (devc->sample[2] << 16) |
-				 (devc->sample[3] << 24);
-			sr_dbg("Received sample 0x%.*x.", devc->num_bytes * 2,
-			       sample);
-			if (devc->capture_flags & CAPTURE_FLAG_RLE) {
-				/*
-				 * In RLE mode the high bit of the sample is the
-				 * "count" flag, meaning this sample is the number
-				 * of times the previous sample occurred.
-				 */
-				if (devc->sample[devc->num_bytes - 1] & 0x80) {
-					/* Clear the high bit. */
-					sample &= ~(0x80 << (devc->num_bytes -
-							     1) * 8);
-					devc->rle_count = sample;
-					devc->cnt_samples_rle +=
-						devc->rle_count;
-					sr_dbg("RLE count: %u.",
-					       devc->rle_count);
-					devc->num_bytes = 0;
-					return TRUE;
-				}
-			}
-			devc->num_samples += devc->rle_count + 1;
-			if (devc->num_samples > devc->limit_samples) {
-				/* Save us from overrunning the buffer. */
-				devc->rle_count -=
-					devc->num_samples - devc->limit_samples;
-				devc->num_samples = devc->limit_samples;
-			}
-
-			if (num_changroups < 4) {
-				/*
-				 * Some channel groups may have been turned
-				 * off, to speed up transfer between the
-				 * hardware and the PC. Expand that here before
-				 * submitting it over the session bus --
-				 * whatever is listening on the bus will be
-				 * expecting a full sample of devc->unitsize bytes,
-				 * based on the maximum number of channels.
-				 * For simplicity we expand the sample to 32 bits
-				 * little endian, and crop below
-				 */
-				j = 0;
-				uint8_t tmp_sample[4] = { 0, 0, 0, 0 };
-				for (i = 0; i < 4; i++) {
-					if (((devc->capture_flags >> 2) &
-					     (1 << i)) == 0) {
-						/*
-						 * This channel group was
-						 * enabled, copy from received
-						 * sample.
-						 */
-						tmp_sample[i] =
-							devc->sample[j++];
-					}
-				}
-				memcpy(devc->sample, tmp_sample, 4);
-				sr_spew("Expanded sample: 0x%.2hhx%.2hhx%.2hhx%.2hhx ",
-					devc->sample[3], devc->sample[2],
-					devc->sample[1], devc->sample[0]);
-			}
-
-			/*
-			 * the OLS sends its sample buffer backwards.
-			 * store it in reverse order here, so we can dump
-			 * this on the session bus later.
-			 * Here cropping to devc->unitsize happens
-			 */
-			offset = (devc->limit_samples - devc->num_samples) * devc->unitsize;
-			for (i = 0; i <= devc->rle_count; i++) {
-				memcpy(devc->raw_sample_buf + offset + (i * devc->unitsize),
-				       devc->sample, devc->unitsize);
-			}
-			memset(devc->sample, 0, 4);
-			devc->num_bytes = 0;
-			devc->rle_count = 0;
-		}
-	} else {
 		/*
-		 * This is the main loop telling us a timeout was reached, or
-		 * we've acquired all the samples we asked for -- we're done.
-		 * Send the (properly-ordered) buffer to the frontend.
+		 * Take everything the serial port has buffered, rather
+		 * than a single byte per main loop dispatch. Limit the
+		 * amount per dispatch, so that a fast link cannot starve
+		 * other event sources.
 		 */
-		sr_dbg("Received %d bytes, %d samples, %d decompressed samples.",
-		       devc->cnt_bytes, devc->cnt_samples,
-		       devc->cnt_samples_rle);
-		if (devc->trigger_at_smpl != OLS_NO_TRIGGER) {
-			/*
-			 * A trigger was set up, so we need to tell the frontend
-			 * about it.
-			 */
-			if (devc->trigger_at_smpl > 0) {
-				/* There are pre-trigger samples, send those first. */
-				packet.type = SR_DF_LOGIC;
-				packet.payload = &logic;
-				logic.length = devc->trigger_at_smpl * devc->unitsize;
-				logic.unitsize = devc->unitsize;
-				logic.data = devc->raw_sample_buf +
-					     (devc->limit_samples -
-					      devc->num_samples) *
-						     devc->unitsize;
-				sr_session_send(sdi, &packet);
-			}
-
-			/* Send the trigger. */
-			std_session_send_df_trigger(sdi);
+		total = 0;
+		while (total < OLS_RECV_MAX_PER_DISPATCH &&
+		       devc->num_samples < devc->limit_samples) {
+			len = serial_read_nonblocking(serial, buf, sizeof(buf));
+			if (len < 0)
+				return FALSE;
+			if (len == 0)
+				break;
+			total += len;
+			devc->cnt_bytes += len;
+			sr_spew("Received %d bytes.", len);
+			ols_decode_bytes(devc, buf, len);
+			if ((size_t)len < sizeof(buf))
+				break;
 		}
+		if (devc->num_samples < devc->limit_samples)
+			return TRUE;
+		/* We've acquired all the samples we asked for. */
+	}
 
-		/* Send post-trigger / all captured samples. */
-		int num_pre_trigger_samples = devc->trigger_at_smpl ==
-							      OLS_NO_TRIGGER ?
-							    0 :
-							    devc->trigger_at_smpl;
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length =
-			(devc->num_samples - num_pre_trigger_samples) * devc->unitsize;
-		logic.unitsize = devc->unitsize;
-		logic.data = devc->raw_sample_buf +
-			     (num_pre_trigger_samples + devc->limit_samples -
-			      devc->num_samples) *
-				     devc->unitsize;
-		sr_session_send(sdi, &packet);
-
-		g_free(devc->raw_sample_buf);
+	/*
+	 * This is the main loop telling us a timeout was reached, or
+	 * we've acquired all the samples we asked for -- we're done.
+	 */
+	ols_send_samples(sdi);
+	g_free(devc->raw_sample_buf);
+	devc->raw_sample_buf = NULL;
 
-		serial_flush(serial);
-		abort_acquisition(sdi);
-	}
+	serial_flush(serial);
+	abort_acquisition(sdi);
 
 	return TRUE;
 }
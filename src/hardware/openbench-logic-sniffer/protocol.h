@@ -32,6 +32,7 @@
 #define CLOCK_RATE                   SR_MHZ(100)
 #define MIN_NUM_SAMPLES              4
 #define DEFAULT_SAMPLERATE           SR_KHZ(200)
+#define OLS_RECV_MAX_PER_DISPATCH    (64 * 1024)
 
 /* Command opcodes */
 #define CMD_RESET                     0x00
@@ -123,6 +124,8 @@ struct dev_context {
 	int cnt_samples;
 	int cnt_samples_rle;
 
+	unsigned int num_changroups;
+	uint8_t changroup_pos[4];
 	unsigned int rle_count;
 	unsigned char sample[4];
 	unsigned char *raw_sample_buf;
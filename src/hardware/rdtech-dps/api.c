@@ -309,12 +309,21 @@ static int dev_open(struct sr_dev_inst *sdi)
 	if (sr_modbus_open(modbus) < 0)
 		return SR_ERR;
 
+	ret = rdtech_dps_state_plan_new(sdi);
+	if (ret != SR_OK) {
+		sr_modbus_close(modbus);
+		return ret;
+	}
+
 	memset(&state, 0, sizeof(state));
 	state.lock = TRUE;
 	state.mask |= STATE_LOCK;
 	ret = rdtech_dps_set_state(sdi, &state);
-	if (ret != SR_OK)
+	if (ret != SR_OK) {
+		rdtech_dps_state_plan_free(sdi);
+		sr_modbus_close(modbus);
 		return ret;
+	}
 
 	return SR_OK;
 }
@@ -332,6 +341,7 @@ static int dev_close(struct sr_dev_inst *sdi)
 	state.lock = FALSE;
 	state.mask |= STATE_LOCK;
 	(void)rdtech_dps_set_state(sdi, &state);
+	rdtech_dps_state_plan_free(sdi);
 
 	return sr_modbus_close(modbus);
 }
@@ -127,6 +127,94 @@ static int rdtech_dps_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return ret;
 }
 
+/*
+ * The registers which make up the device state, each model's live values
+ * and its protection thresholds. The blocks are far apart, and stay two
+ * reads. Transports which pipeline requests get both of them in a single
+ * round trip, on serial lines this takes as long as before.
+ */
+static const struct sr_modbus_regmap_entry dps_state_regs[] = {
+	{ REG_DPS_USET, REG_DPS_ENABLE - REG_DPS_USET + 1, },
+	{ PRE_DPS_OVPSET, 2, },
+};
+
+static const struct sr_modbus_regmap_entry rd_state_regs[] = {
+	{ REG_RD_VOLT_TGT, REG_RD_ENABLE - REG_RD_VOLT_TGT + 1, },
+	{ REG_RD_OVP_THR, 2, },
+};
+
+static const struct sr_modbus_regmap_entry rd_range_state_regs[] = {
+	{ REG_RD_VOLT_TGT, REG_RD_RANGE - REG_RD_VOLT_TGT + 1, },
+	{ REG_RD_OVP_THR, 2, },
+};
+
+/*
+ * Plan the reads of the model's state registers. The map only depends
+ * on the model, so this is done once when the device gets opened.
+ */
+SR_PRIV int rdtech_dps_state_plan_new(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	const struct sr_modbus_regmap_entry *entries;
+	size_t count;
+
+	devc = sdi->priv;
+	switch (devc->model->model_type) {
+	case MODEL_DPS:
+		entries = dps_state_regs;
+		count = ARRAY_SIZE(dps_state_regs);
+		break;
+	case MODEL_RD:
+		if (devc->model->n_ranges > 1) {
+			entries = rd_range_state_regs;
+			count = ARRAY_SIZE(rd_range_state_regs);
+		} else {
+			entries = rd_state_regs;
+			count = ARRAY_SIZE(rd_state_regs);
+		}
+		break;
+	default:
+		return SR_ERR_BUG;
+	}
+
+	/* Undefined registers between the blocks may not be readable. */
+	sr_modbus_read_plan_free(devc->state_plan);
+	devc->state_plan = sr_modbus_read_plan_new(entries, count, 0);
+	if (!devc->state_plan)
+		return SR_ERR_BUG;
+
+	return SR_OK;
+}
+
+SR_PRIV void rdtech_dps_state_plan_free(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	sr_modbus_read_plan_free(devc->state_plan);
+	devc->state_plan = NULL;
+}
+
+/* Retries failed reads of the state registers, like the above. */
+static int rdtech_dps_read_state_regs(struct sr_modbus_dev_inst *modbus,
+	struct sr_modbus_read_plan *plan, uint16_t *const *registers)
+{
+	size_t retries;
+	int ret;
+
+	if (!plan)
+		return SR_ERR_DEV_CLOSED;
+
+	retries = 3;
+	while (retries--) {
+		ret = sr_modbus_read_plan_run(modbus, plan, registers);
+		if (ret == SR_OK)
+			break;
+	}
+
+	return ret;
+}
+
 /* Set one 16bit register. LE format for DPS devices. */
 static int rdtech_dps_set_reg(const struct sr_dev_inst *sdi,
 	uint16_t address, uint16_t value)
@@ -311,7 +399,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	struct dev_context *devc;
 	struct sr_modbus_dev_inst *modbus;
 	gboolean get_config, get_init_state, get_curr_meas;
-	uint16_t registers[14];
+	uint16_t registers[14], thr_registers[2];
+	uint16_t *const state_registers[] = { registers, thr_registers, };
 	int ret;
 	const uint8_t *rdptr;
 	uint16_t uset_raw, iset_raw, uout_raw, iout_raw, power_raw;
@@ -369,17 +458,16 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	switch (devc->model->model_type) {
 	case MODEL_DPS:
 		/*
-		 * Transfer a chunk of registers in a single call. It's
+		 * Transfer the register map in a single call. It's
 		 * unfortunate that the model dependency and the sparse
-		 * register map force us to open code addresses, sizes,
-		 * and the sequence of the registers and how to interpret
-		 * their bit fields. But then this is not too unusual for
-		 * a hardware specific device driver ...
+		 * register map force us to open code the sequence of the
+		 * registers and how to interpret their bit fields. But
+		 * then this is not too unusual for a hardware specific
+		 * device driver ...
 		 */
 		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_DPS_USET, REG_DPS_ENABLE - REG_DPS_USET + 1,
-			registers);
+		ret = rdtech_dps_read_state_regs(modbus, devc->state_plan,
+			state_registers);
 		g_mutex_unlock(&devc->rw_mutex);
 		if (ret != SR_OK)
 			return ret;
@@ -407,16 +495,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		out_state = read_u16be_inc(&rdptr); /* ENABLE */
 		is_out_enabled = out_state != 0;
 
-		/* Transfer another chunk of registers in a single call. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			PRE_DPS_OVPSET, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
 		/* Interpret the second registers chunk's values. */
-		rdptr = (const void *)registers;
+		rdptr = (const void *)thr_registers;
 		ovpset_raw = read_u16be_inc(&rdptr); /* PRE OVPSET */
 		ovp_threshold = ovpset_raw * devc->voltage_multiplier;
 		ocpset_raw = read_u16be_inc(&rdptr); /* PRE OCPSET */
@@ -425,14 +505,10 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		break;
 
 	case MODEL_RD:
-		/* Retrieve a set of adjacent registers. */
+		/* Retrieve the register map. */
 		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_VOLT_TGT,
-			devc->model->n_ranges > 1
-				? REG_RD_RANGE - REG_RD_VOLT_TGT + 1
-				: REG_RD_ENABLE - REG_RD_VOLT_TGT + 1,
-			registers);
+		ret = rdtech_dps_read_state_regs(modbus, devc->state_plan,
+			state_registers);
 		g_mutex_unlock(&devc->rw_mutex);
 		if (ret != SR_OK)
 			return ret;
@@ -464,16 +540,8 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 			range = read_u16be_inc(&rdptr) ? 1 : 0; /* RANGE */
 		}
 
-		/* Retrieve a set of adjacent registers. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_OVP_THR, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
-		/* Interpret the registers' raw content. */
-		rdptr = (const void *)registers;
+		/* Interpret the thresholds' raw content. */
+		rdptr = (const void *)thr_registers;
 		ovpset_raw = read_u16be_inc(&rdptr); /* OVP THR */
 		ovp_threshold = ovpset_raw / devc->voltage_multiplier;
 		ocpset_raw = read_u16be_inc(&rdptr); /* OCP THR */
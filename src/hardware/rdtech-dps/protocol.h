@@ -67,6 +67,7 @@ struct dev_context {
 	gboolean curr_out_state;
 	size_t curr_range;
 	gboolean acquisition_started;
+	struct sr_modbus_read_plan *state_plan;
 };
 
 /* Container to get and set parameter values. */
@@ -110,6 +111,8 @@ SR_PRIV int rdtech_dps_set_state(const struct sr_dev_inst *sdi,
 SR_PRIV int rdtech_dps_get_model_version(struct sr_modbus_dev_inst *modbus,
 	enum rdtech_dps_model_type model_type,
 	uint16_t *model, uint16_t *version, uint32_t *serno);
+SR_PRIV int rdtech_dps_state_plan_new(const struct sr_dev_inst *sdi);
+SR_PRIV void rdtech_dps_state_plan_free(const struct sr_dev_inst *sdi);
 SR_PRIV void rdtech_dps_update_multipliers(const struct sr_dev_inst *sdi);
 SR_PRIV int rdtech_dps_update_range(const struct sr_dev_inst *sdi);
 SR_PRIV int rdtech_dps_seed_receive(const struct sr_dev_inst *sdi);
@@ -42,6 +42,8 @@
 #define REG_LED_BLUE		0x11
 #define REG_STATUS		0x40
 
+#define BITSTREAM_NAME		"saleae-logicpro16-fpga.bitstream"
+
 static void iterate_lfsr(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc = sdi->priv;
@@ -506,12 +508,16 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 
 	sr_info("Uploading bitstream '%s'.", name);
 
+	/* The FPGA's state is unknown from here on. */
+	sr_resource_image_uploaded(sdi, drvc->sr_ctx,
+		SR_RESOURCE_FIRMWARE, NULL);
+
 	req[0] = 0x00;
 	req[1] = COMMAND_INIT_BITSTREAM;
 
 	ret = transact(sdi, req, sizeof(req), rsp, sizeof(rsp));
 	if (ret != SR_OK)
-		return ret;
+		goto out;
 	if (rsp[0] != 0x00) {
 		sr_err("Failed to start bitstream upload (0x%02x).", rsp[0]);
 		ret = SR_ERR;
@@ -541,6 +547,8 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 		ret = SR_ERR;
 		goto out;
 	}
+	sr_resource_image_uploaded(sdi, drvc->sr_ctx,
+		SR_RESOURCE_FIRMWARE, name);
 
  out:
 	g_free(bitstream);
@@ -590,6 +598,7 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi)
 {
+	struct drv_context *drvc = sdi->driver->context;
 	uint8_t reg_val;
 	uint8_t dummy[8];
 	uint8_t serial[8];
@@ -610,14 +619,22 @@ SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi)
 	if (ret != SR_OK)
 		return ret;
 
-	/* Check if we need to upload the bitstream. */
+	/*
+	 * Check if we need to upload the bitstream. The FPGA keeps it while
+	 * the device is powered, the scratch register tells that it is
+	 * configured. Upload again when this context has put another image
+	 * onto the device before.
+	 */
 	ret = read_reg(sdi, 0x7f, &reg_val);
 	if (ret != SR_OK)
 		return ret;
-	if (reg_val == 0xaa) {
+	if (reg_val == 0xaa && (sr_resource_image_current(sdi, drvc->sr_ctx,
+			SR_RESOURCE_FIRMWARE, BITSTREAM_NAME) ||
+			!sr_resource_image_differs(sdi, drvc->sr_ctx,
+			SR_RESOURCE_FIRMWARE, BITSTREAM_NAME))) {
 		sr_info("Skipping bitstream upload.");
 	} else {
-		ret = upload_bitstream(sdi, "saleae-logicpro16-fpga.bitstream");
+		ret = upload_bitstream(sdi, BITSTREAM_NAME);
 		if (ret != SR_OK)
 			return ret;
 	}
@@ -254,7 +254,7 @@ static void receive_data(struct sr_dev_inst *sdi, unsigned char *data, int len)
 	if (!testo_check_packet_prefix(devc->reply, devc->reply_size))
 		return;
 
-	crc = crc16_mcrf4xx(0xffff, devc->reply, devc->reply_size - 2);
+	crc = sr_crc16_mcrf4xx(0xffff, devc->reply, devc->reply_size - 2);
 	if (crc == RL16(&devc->reply[devc->reply_size - 2])) {
 		testo_receive_packet(sdi);
 		sr_sw_limits_update_samples_read(&devc->sw_limits, 1);
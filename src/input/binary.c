@@ -66,7 +66,9 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+/* Send the complete samples at the start of the data, in chunks. */
+static int send_samples(struct sr_input *in, uint8_t *data,
+	size_t len, size_t *consumed)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
@@ -91,21 +93,33 @@ static int process_buffer(struct sr_input *in)
 	logic.unitsize = inc->unitsize;
 
 	/* Cut off at multiple of unitsize. */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = len / logic.unitsize * logic.unitsize;
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = data + i;
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		chunk /= logic.unitsize;
 		chunk *= logic.unitsize;
 		logic.length = chunk;
 		sr_session_send(in->sdi, &packet);
 	}
-	g_string_erase(in->buf, 0, chunk_size);
+	*consumed = chunk_size;
 
 	return SR_OK;
 }
 
+static int process_buffer(struct sr_input *in)
+{
+	size_t consumed;
+	int ret;
+
+	ret = send_samples(in, (uint8_t *)in->buf->str, in->buf->len,
+		&consumed);
+	g_string_erase(in->buf, 0, consumed);
+
+	return ret;
+}
+
 static int receive(struct sr_input *in, GString *buf)
 {
 	int ret;
@@ -123,6 +137,12 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+static int receive_mapped(struct sr_input *in, uint8_t *data,
+	size_t len, size_t *consumed)
+{
+	return send_samples(in, data, len, consumed);
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -174,6 +194,7 @@ SR_PRIV struct sr_input_module input_binary = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.reset = reset,
 };
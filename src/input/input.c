@@ -31,6 +31,9 @@
 
 /** @cond PRIVATE */
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+/* Amounts of data which get copied at most, for mapped input. */
+#define HEADER_SLICE	(64 * 1024)
+#define JOIN_SIZE	(64 * 1024)
 /** @endcond */
 
 /**
@@ -601,6 +604,197 @@ SR_API int sr_input_send(const struct sr_input *in, GString *buf)
 	return in->module->receive((struct sr_input *)in, buf);
 }
 
+/**
+ * Send data to the specified input instance, without copying it.
+ *
+ * This works like sr_input_send(), but the data remains owned by the
+ * caller, and only needs to be valid during the call (e.g. a region of
+ * a memory mapped file). Input modules which support it parse directly
+ * from the caller's memory, and only the small unconsumed tail of the
+ * data gets copied. For other modules, and until the device instance
+ * is ready, the data gets copied like sr_input_send() would do.
+ *
+ * The data may get modified. Modules pass it on as the payload of
+ * datafeed packets, and the session's transforms work on packets in
+ * place. Map files privately (copy-on-write), like sr_input_send_file()
+ * does, when their content must not change.
+ *
+ * @param in The input instance. Must not be NULL.
+ * @param data The data to send, may get modified.
+ * @param len The number of bytes in @a data.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error code from the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_mapped(const struct sr_input *in_ro,
+		void *data, size_t len)
+{
+	struct sr_input *in;
+	uint8_t *rdptr;
+	GString *buf;
+	size_t prev, join, used, consumed;
+	int ret;
+
+	in = (struct sr_input *)in_ro;	/* "un-const" */
+	if (!in || !in->module || (!data && len))
+		return SR_ERR_ARG;
+	if (!len)
+		return SR_OK;
+
+	if (!in->module->receive_mapped || !in->sdi_ready) {
+		buf = g_string_new_len(data, len);
+		ret = sr_input_send(in, buf);
+		g_string_free(buf, TRUE);
+		return ret;
+	}
+
+	sr_spew("Lending %zu bytes to %s module.", len, in->module->id);
+	rdptr = data;
+
+	/*
+	 * Complete the tail which previous calls left in the receive
+	 * buffer, by appending the start of the new data. Only bytes
+	 * which the module consumed from the new data get skipped.
+	 */
+	while (in->buf->len && len) {
+		prev = in->buf->len;
+		join = MIN(len, JOIN_SIZE);
+		g_string_append_len(in->buf, (const char *)rdptr, join);
+		consumed = 0;
+		ret = in->module->receive_mapped(in,
+			(uint8_t *)in->buf->str, in->buf->len, &consumed);
+		if (ret != SR_OK)
+			return ret;
+		if (consumed >= prev) {
+			used = consumed - prev;
+			g_string_truncate(in->buf, 0);
+		} else {
+			used = join;
+			g_string_erase(in->buf, 0, consumed);
+		}
+		rdptr += used;
+		len -= used;
+	}
+	if (!len)
+		return SR_OK;
+
+	/* Process the bulk of the data in place, keep the tail. */
+	consumed = 0;
+	ret = in->module->receive_mapped(in, rdptr, len, &consumed);
+	if (ret != SR_OK)
+		return ret;
+	if (consumed < len)
+		g_string_append_len(in->buf, (const char *)rdptr + consumed,
+			len - consumed);
+
+	return SR_OK;
+}
+
+/**
+ * Send the next slice of mapped data to the specified input instance.
+ *
+ * Slices are small until the input instance's device is ready, since
+ * the data gets copied. After that, modules which cannot parse in place
+ * get the usual chunk size, others get up to @a max_len bytes.
+ *
+ * @param in The input instance. Must not be NULL.
+ * @param data The start of the mapped data.
+ * @param size The size of the mapped data.
+ * @param[in,out] offset The position of the slice in the data, gets
+ *                advanced past the slice when it was sent.
+ * @param max_len The maximum slice size.
+ *
+ * @retval SR_OK Success.
+ * @retval other Error code from the input module.
+ *
+ * @private
+ */
+SR_PRIV int sr_input_send_slice(const struct sr_input *in,
+		uint8_t *data, size_t size, uint64_t *offset,
+		size_t max_len)
+{
+	size_t len;
+	int ret;
+
+	len = MIN(size - *offset, max_len);
+	if (!in->sdi_ready)
+		len = MIN(len, HEADER_SLICE);
+	else if (!in->module->receive_mapped)
+		len = MIN(len, CHUNK_SIZE);
+	ret = sr_input_send_mapped(in, data + *offset, len);
+	if (ret == SR_OK)
+		*offset += len;
+
+	return ret;
+}
+
+/**
+ * Send a file's content to the specified input instance.
+ *
+ * The file gets memory mapped, and its content gets passed to the input
+ * module by means of sr_input_send_mapped(). Like sr_input_send(), the
+ * call returns the moment the input instance's device gets ready, to
+ * give the caller the chance to examine the device instance, and to
+ * setup the session. Call the function again with the same @a offset
+ * to send the rest of the file, then call sr_input_end(). Calls at
+ * the end of the file do nothing.
+ *
+ * @param in The input instance. Must not be NULL.
+ * @param filename The name of the file to send. Must not be NULL.
+ * @param[in,out] offset The file position to start at, gets advanced
+ *                to the position after the sent data. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO The file could not get mapped.
+ * @retval other Error code from the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_file(const struct sr_input *in,
+		const char *filename, uint64_t *offset)
+{
+	GMappedFile *file;
+	GError *error;
+	uint8_t *data;
+	size_t size;
+	gboolean was_ready;
+	int ret;
+
+	if (!in || !in->module || !filename || !offset)
+		return SR_ERR_ARG;
+
+	/*
+	 * The session's transforms modify packets in place. The mapping
+	 * is private, pages only get copied when written to.
+	 */
+	error = NULL;
+	file = g_mapped_file_new(filename, TRUE, &error);
+	if (!file) {
+		sr_err("Failed to map %s: %s", filename, error->message);
+		g_error_free(error);
+		return SR_ERR_IO;
+	}
+	data = (uint8_t *)g_mapped_file_get_contents(file);
+	size = g_mapped_file_get_length(file);
+
+	ret = SR_OK;
+	while (*offset < size) {
+		was_ready = in->sdi_ready;
+		ret = sr_input_send_slice(in, data, size, offset, size);
+		if (ret != SR_OK)
+			break;
+		if (!was_ready && in->sdi_ready)
+			break;
+	}
+	g_mapped_file_unref(file);
+
+	return ret;
+}
+
 /**
  * Signal the input module no more data will come.
  *
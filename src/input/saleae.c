@@ -845,18 +845,17 @@ static int parse_next_item(struct sr_input *in,
 	/* UNREACH */
 }
 
-static int parse_samples(struct sr_input *in)
+/* Process the complete sample data items at the start of the data. */
+static int parse_items(struct sr_input *in, const uint8_t *start,
+	size_t blen, size_t *consumed)
 {
-	const uint8_t *buff, *start;
-	size_t blen;
-
+	const uint8_t *buff;
 	const uint8_t *curr, *next;
 	size_t len;
 	int rc;
 
-	start = (const uint8_t *)in->buf->str;
 	buff = start;
-	blen = in->buf->len;
+	*consumed = 0;
 	while (have_next_item(in, buff, blen, &curr, &next)) {
 		len = next - curr;
 		rc = parse_next_item(in, curr, len);
@@ -864,13 +863,23 @@ static int parse_samples(struct sr_input *in)
 			return rc;
 		buff += len;
 		blen -= len;
+		*consumed = buff - start;
 	}
-	len = buff - start;
-	g_string_erase(in->buf, 0, len);
 
 	return SR_OK;
 }
 
+static int parse_samples(struct sr_input *in)
+{
+	size_t len;
+	int rc;
+
+	rc = parse_items(in, (const uint8_t *)in->buf->str, in->buf->len, &len);
+	g_string_erase(in->buf, 0, len);
+
+	return rc;
+}
+
 /*
  * Try to auto detect an input's file format. Mismatch is non-fatal.
  * Silent operation by design. Not all details need to be available.
@@ -1029,6 +1038,21 @@ static int receive(struct sr_input *in, GString *buf)
 	return parse_samples(in);
 }
 
+static int receive_mapped(struct sr_input *in, uint8_t *data,
+	size_t len, size_t *consumed)
+{
+	struct context *inc;
+
+	/* receive() took the header before the device instance got ready. */
+	inc = in->priv;
+	if (!inc->module_state.got_header) {
+		*consumed = 0;
+		return SR_ERR_BUG;
+	}
+
+	return parse_items(in, data, len, consumed);
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -1209,6 +1233,7 @@ SR_PRIV struct sr_input_module input_saleae = {
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.cleanup = cleanup,
 	.reset = reset,
@@ -159,32 +159,36 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int find_data_chunk(GString *buf, int initial_offset)
+/*
+ * Find the start of the samples. Returns their offset, 0 when more data
+ * is needed to tell, or -1 when the data doesn't look like a WAV file.
+ */
+static int find_data_chunk(const char *buf, size_t len, int initial_offset)
 {
 	unsigned int offset, i;
 
 	offset = initial_offset;
-	while (offset < MIN(MAX_DATA_CHUNK_OFFSET, buf->len)) {
-		if (!memcmp(buf->str + offset, "data", 4))
+	while (offset + 8 <= MIN(MAX_DATA_CHUNK_OFFSET, len)) {
+		if (!memcmp(buf + offset, "data", 4))
 			/* Skip into the samples. */
 			return offset + 8;
 		for (i = 0; i < 4; i++) {
-			if (!isalnum(buf->str[offset + i])
-					&& !isblank(buf->str[offset + i]))
+			if (!isalnum(buf[offset + i])
+					&& !isblank(buf[offset + i]))
 				/* Doesn't look like a chunk ID. */
 				return -1;
 		}
 		/* Skip past this chunk. */
-		offset += 8 + RL32(buf->str + offset + 4);
+		offset += 8 + RL32(buf + offset + 4);
 	}
 
-	if (offset > MAX_DATA_CHUNK_OFFSET)
+	if (offset + 8 > MAX_DATA_CHUNK_OFFSET)
 		return -1;
 
-	return offset;
+	return 0;
 }
 
-static void send_chunk(const struct sr_input *in, int offset, int num_samples)
+static void send_chunk(const struct sr_input *in, const char *s, int num_samples)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
@@ -194,13 +198,12 @@ static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 	struct context *inc;
 	float *fdata;
 	int total_samples, samplenum;
-	char *s, *d;
+	char *d;
 
 	inc = in->priv;
 
 	total_samples = num_samples * inc->num_channels;
 	fdata = g_malloc0(total_samples * sizeof(float));
-	s = in->buf->str + offset;
 	d = (char *)fdata;
 
 	for (samplenum = 0; samplenum < total_samples; samplenum++) {
@@ -245,12 +248,15 @@ static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 	g_free(fdata);
 }
 
-static int process_buffer(struct sr_input *in)
+/* Convert the complete samples at the start of the data. */
+static int process_data(struct sr_input *in, const char *buf, size_t len,
+	size_t *consumed)
 {
 	struct context *inc;
 	int offset, chunk_samples, total_samples, processed, max_chunk_samples;
 	int num_samples, i;
 
+	*consumed = 0;
 	inc = in->priv;
 	if (!inc->started) {
 		std_session_send_df_header(in->sdi);
@@ -261,20 +267,22 @@ static int process_buffer(struct sr_input *in)
 
 	if (!inc->found_data) {
 		/* Skip past size of 'fmt ' chunk. */
-		i = 20 + RL32(in->buf->str + 16);
-		offset = find_data_chunk(in->buf, i);
-		if (offset < 0) {
-			if (in->buf->len > MAX_DATA_CHUNK_OFFSET) {
-				sr_err("Couldn't find data chunk.");
-				return SR_ERR;
-			}
+		i = 20 + RL32(buf + 16);
+		offset = find_data_chunk(buf, len, i);
+		if (offset < 0 || (!offset && len > MAX_DATA_CHUNK_OFFSET)) {
+			sr_err("Couldn't find data chunk.");
+			return SR_ERR;
+		}
+		if (!offset) {
+			/* Wait for more data. */
+			return SR_OK;
 		}
 		inc->found_data = TRUE;
 	} else
 		offset = 0;
 
 	/* Round off up to the last channels * unitsize boundary. */
-	chunk_samples = (in->buf->len - offset) / inc->samplesize;
+	chunk_samples = (len - offset) / inc->samplesize;
 	max_chunk_samples = CHUNK_SIZE / inc->samplesize;
 	processed = 0;
 	total_samples = chunk_samples;
@@ -283,24 +291,31 @@ static int process_buffer(struct sr_input *in)
 			num_samples = max_chunk_samples;
 		else
 			num_samples = chunk_samples;
-		send_chunk(in, offset, num_samples);
+		send_chunk(in, buf + offset, num_samples);
 		offset += num_samples * inc->samplesize;
 		chunk_samples -= num_samples;
 		processed += num_samples;
 	}
-
-	if ((unsigned int)offset < in->buf->len) {
-		/*
-		 * The incoming buffer wasn't processed completely. Stash
-		 * the leftover data for next time.
-		 */
-		g_string_erase(in->buf, 0, offset);
-	} else
-		g_string_truncate(in->buf, 0);
+	*consumed = offset;
 
 	return SR_OK;
 }
 
+static int process_buffer(struct sr_input *in)
+{
+	size_t consumed;
+	int ret;
+
+	/*
+	 * The incoming buffer may not get processed completely. Stash
+	 * the leftover data for next time.
+	 */
+	ret = process_data(in, in->buf->str, in->buf->len, &consumed);
+	g_string_erase(in->buf, 0, consumed);
+
+	return ret;
+}
+
 /*
  * Check the channel list for consistency across file re-import. See
  * the VCD input module for more details and motivation.
@@ -380,6 +395,12 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+static int receive_mapped(struct sr_input *in, uint8_t *data,
+	size_t len, size_t *consumed)
+{
+	return process_data(in, (const char *)data, len, consumed);
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -426,6 +447,7 @@ SR_PRIV struct sr_input_module input_wav = {
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.reset = reset,
 };
@@ -1213,6 +1213,8 @@ struct sr_context {
 	sr_resource_close_callback resource_close_cb;
 	sr_resource_read_callback resource_read_cb;
 	void *resource_cb_data;
+	GHashTable *resource_cache;
+	GHashTable *resource_images;
 };
 
 /** Input module metadata keys. */
@@ -1339,6 +1341,30 @@ struct sr_input_module {
 	 */
 	int (*receive) (struct sr_input *in, GString *buf);
 
+	/**
+	 * Process data which the caller lends to the input instance.
+	 *
+	 * This function is optional. It gets used instead of receive()
+	 * after the device instance became ready, when applications pass
+	 * memory mapped files or other buffers they own. The module parses
+	 * directly from @a data, and reports how many bytes it consumed.
+	 * Common code keeps the unconsumed tail in in->buf, and passes it
+	 * together with the next data. The module must neither keep
+	 * references to @a data nor modify in->buf. It may pass @a data
+	 * on as packet payload, which transforms modify in place.
+	 *
+	 * @param[in] in The input instance.
+	 * @param[in] data The data to process, only valid during the call.
+	 * @param[in] len The number of bytes in @a data.
+	 * @param[out] consumed The number of processed bytes at the start
+	 *             of @a data (complete sample units or items).
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_mapped) (struct sr_input *in, uint8_t *data,
+		size_t len, size_t *consumed);
+
 	/**
 	 * Signal the input module no more data will come.
 	 *
@@ -1478,6 +1504,24 @@ struct sr_output_module {
 	int (*receive) (const struct sr_output *o,
 			const struct sr_datafeed_packet *packet, GString **out);
 
+	/**
+	 * Alternative to receive(), which appends any output generated in
+	 * response to the packet to the caller's GString <code>out</code>.
+	 * This lets callers reuse one buffer for all packets, see
+	 * sr_output_send_to_sink(). Modules implement either receive() or
+	 * append().
+	 *
+	 * @param o Pointer to the respective 'struct sr_output'.
+	 * @param packet The complete packet.
+	 * @param out The GString to append output to. Never NULL. May hold
+	 * output of previous packets, which must be left alone.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*append) (const struct sr_output *o,
+			const struct sr_datafeed_packet *packet, GString *out);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the output module, and can be used to free any internal
@@ -1574,6 +1618,19 @@ struct sr_transform_module {
 	 * @retval other Negative error code.
 	 */
 	int (*cleanup) (struct sr_transform *t);
+
+	/**
+	 * Tell where the bit of a logic channel ends up in the samples
+	 * this transform module sends. Can be NULL, if the module keeps
+	 * all logic bits in their positions.
+	 *
+	 * @param t Pointer to the respective 'struct sr_transform'.
+	 * @param bit The bit position in the samples the module receives.
+	 *
+	 * @return The bit position in the samples the module sends, or -1
+	 *         when the module drops the bit.
+	 */
+	int (*logic_bit) (const struct sr_transform *t, int bit);
 };
 
 #ifdef HAVE_LIBUSB_1_0
@@ -1818,6 +1875,32 @@ SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
 
 /*--- session.c -------------------------------------------------------------*/
 
+/** Datafeed statistics collection state of a session. */
+struct sr_session_instr {
+	/** Whether statistics get collected. */
+	gboolean enabled;
+	/** Protects the counters, which may get queried by other threads. */
+	GMutex mutex;
+	/** Time when collection was enabled or reset. */
+	int64_t start_us;
+	/** Per-device counters, struct sr_session_dev_stats keyed by sdi. */
+	GHashTable *devices;
+	/**
+	 * Per-stage latencies, struct sr_session_stage_stats keyed by
+	 * struct sr_transform or struct datafeed_callback pointers.
+	 */
+	GHashTable *stages;
+	struct sr_latency_histogram send;
+	struct sr_latency_histogram fd_lag;
+	struct sr_latency_histogram usb_lag;
+};
+
+/** Event source types for sr_session_stats_lag(). */
+enum sr_session_source_type {
+	SR_SESSION_SOURCE_FD,
+	SR_SESSION_SOURCE_USB,
+};
+
 struct sr_session {
 	/** Context this session exists in. */
 	struct sr_context *ctx;
@@ -1848,8 +1931,25 @@ struct sr_session {
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Datafeed statistics, NULL until first enabled. */
+	struct sr_session_instr *instr;
+	/** Whether each device runs in a thread of its own. */
+	gboolean dev_threads;
+	/** Device threads state while running, NULL otherwise. */
+	struct sr_session_threads *threads;
+	/** Analog reading coalescing, NULL unless enabled. */
+	struct sr_session_coalesce *coalesce;
 };
 
+/** Get a session's statistics state if collection is enabled, else NULL. */
+static inline struct sr_session_instr *sr_session_instr_get(
+		const struct sr_session *session)
+{
+	if (G_LIKELY(!session->instr || !session->instr->enabled))
+		return NULL;
+	return session->instr;
+}
+
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 		void *key, GSource *source);
 SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
@@ -1882,6 +1982,61 @@ SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
 
+/*--- session_stats.c -------------------------------------------------------*/
+
+SR_PRIV void sr_session_stats_packet(struct sr_session_instr *instr,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_stats_stage(struct sr_session_instr *instr,
+		const void *key, const char *name, int64_t duration_us);
+SR_PRIV void sr_session_stats_send(struct sr_session_instr *instr,
+		int64_t duration_us);
+SR_PRIV void sr_session_stats_lag(struct sr_session *session,
+		enum sr_session_source_type type, int64_t lag_us);
+SR_PRIV void sr_session_stats_cleanup(struct sr_session *session);
+
+/*--- session_coalesce.c ----------------------------------------------------*/
+
+struct sr_session_coalesce;
+
+SR_PRIV int sr_session_coalesce_packet(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_coalesce_flush(struct sr_session *session);
+SR_PRIV void sr_session_coalesce_cleanup(struct sr_session *session);
+
+/*--- session_threads.c -----------------------------------------------------*/
+
+struct sr_session_threads;
+
+SR_PRIV int sr_session_threads_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_PRIV GMainContext *sr_session_threads_context(
+		const struct sr_session *session);
+SR_PRIV int sr_session_threads_init(struct sr_session *session,
+		GMainContext *main_context);
+SR_PRIV int sr_session_threads_dev_start(struct sr_session *session,
+		struct sr_dev_inst *sdi);
+SR_PRIV void sr_session_threads_stop(struct sr_session *session);
+SR_PRIV void sr_session_threads_finish(struct sr_session *session);
+
+/*--- poll.c ----------------------------------------------------------------*/
+
+struct sr_poll;
+
+/** Runs a poll's request in the bus thread, stores the reply. */
+typedef int (*sr_poll_run_callback)(void *cb_data, GByteArray *reply);
+/** Receives a poll's result in the thread which runs the driver. */
+typedef void (*sr_poll_done_callback)(int result, const uint8_t *reply,
+		size_t reply_len, void *cb_data);
+
+SR_PRIV struct sr_poll *sr_poll_add(struct sr_session *session,
+		const void *bus, const char *key, unsigned int interval_ms,
+		sr_poll_run_callback run, sr_poll_done_callback done,
+		void *cb_data);
+SR_PRIV void sr_poll_remove(struct sr_poll *poll);
+SR_PRIV void sr_poll_bus_lock(struct sr_poll *poll);
+SR_PRIV void sr_poll_bus_unlock(struct sr_poll *poll);
+
 /*--- session_file.c --------------------------------------------------------*/
 
 #if !HAVE_ZIP_DISCARD
@@ -1893,6 +2048,17 @@ SR_PRIV void sr_zip_discard(struct zip *archive);
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
 
+/*--- input/input.c ---------------------------------------------------------*/
+
+SR_PRIV int sr_input_send_slice(const struct sr_input *in,
+		uint8_t *data, size_t size, uint64_t *offset,
+		size_t max_len);
+
+/*--- transform/transform.c -------------------------------------------------*/
+
+SR_PRIV int sr_transform_logic_bit(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch);
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
@@ -1991,6 +2157,15 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 SR_PRIV void *sr_resource_load(struct sr_context *ctx, int type,
 		const char *name, size_t *size, size_t max_size)
 		G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV const char *sr_resource_digest(struct sr_context *ctx, int type,
+		const char *name);
+SR_PRIV gboolean sr_resource_image_current(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, int type, const char *name);
+SR_PRIV gboolean sr_resource_image_differs(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, int type, const char *name);
+SR_PRIV void sr_resource_image_uploaded(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, int type, const char *name);
+SR_PRIV void sr_resource_cache_free(struct sr_context *ctx);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
@@ -2229,6 +2404,7 @@ SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 /*--- tcp.c -----------------------------------------------------------------*/
 
 SR_PRIV gboolean sr_fd_is_readable(int fd);
+SR_PRIV gboolean sr_fd_wait_readable(int fd, unsigned int timeout_ms);
 
 SR_PRIV struct sr_tcp_dev_inst *sr_tcp_dev_inst_new(
 	const char *host_addr, const char *tcp_port);
@@ -2312,8 +2488,51 @@ SR_PRIV int bv_get_value(float *out, const struct binary_value_spec *spec,
  */
 SR_PRIV uint16_t sr_crc16(uint16_t crc, const uint8_t *buffer, int len);
 
+/**
+ * Calculate a CRC16 checksum using the 0x1021 polynomial, bit reversed.
+ *
+ * This CRC16 flavor is also known as CRC16-MCRF4XX.
+ *
+ * @param crc Initial value (typically 0xffff)
+ * @param buffer Input buffer
+ * @param len Buffer length
+ * @return Checksum
+ */
+SR_PRIV uint16_t sr_crc16_mcrf4xx(uint16_t crc, const uint8_t *buffer,
+	size_t len);
+
 /*--- modbus/modbus.c -------------------------------------------------------*/
 
+/** A Modbus request and the buffer which receives its reply. */
+struct sr_modbus_transaction {
+	/** The request PDU to send. */
+	uint8_t *request;
+	int request_size;
+	/** Buffer for the reply PDU, the size of the expected reply. */
+	uint8_t *reply;
+	int reply_size;
+	/** Outcome of this transaction, SR_OK or SR_ERR_*. */
+	int result;
+};
+
+/** A range of holding registers for sr_modbus_read_holding_registers_multi(). */
+struct sr_modbus_register_range {
+	int address;
+	int nb_registers;
+	/** Buffer for the received registers' values. */
+	uint16_t *registers;
+	/** Outcome of reading this range, SR_OK or SR_ERR_*. */
+	int result;
+};
+
+/** A block of holding registers in a driver's register map. */
+struct sr_modbus_regmap_entry {
+	int address;
+	int nb_registers;
+};
+
+struct sr_modbus_read_plan;
+
 struct sr_modbus_dev_inst {
 	const char *name;
 	const char *prefix;
@@ -2326,9 +2545,13 @@ struct sr_modbus_dev_inst {
 		int timeout, sr_receive_data_callback cb, void *cb_data);
 	int (*source_remove)(struct sr_session *session, void *priv);
 	int (*send)(void *priv, const uint8_t *buffer, int buffer_size);
-	int (*read_begin)(void *priv, uint8_t *function_code);
+	int (*read_begin)(void *priv, uint8_t *function_code,
+		unsigned int timeout_ms);
 	int (*read_data)(void *priv, uint8_t *buf, int maxlen);
 	int (*read_end)(void *priv);
+	/* Optional, runs several transactions with all of them in flight. */
+	int (*transact)(void *priv, struct sr_modbus_transaction *xfers,
+		size_t count, unsigned int timeout_ms);
 	int (*close)(void *priv);
 	void (*free)(void *priv);
 	unsigned int read_timeout_ms;
@@ -2352,11 +2575,22 @@ SR_PRIV int sr_modbus_reply(struct sr_modbus_dev_inst *modbus,
 SR_PRIV int sr_modbus_request_reply(struct sr_modbus_dev_inst *modbus,
                                     uint8_t *request, int request_size,
                                     uint8_t *reply, int reply_size);
+SR_PRIV int sr_modbus_request_reply_multi(struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_transaction *xfers, size_t count);
 SR_PRIV int sr_modbus_read_coils(struct sr_modbus_dev_inst *modbus,
                                  int address, int nb_coils, uint8_t *coils);
 SR_PRIV int sr_modbus_read_holding_registers(struct sr_modbus_dev_inst *modbus,
                                              int address, int nb_registers,
                                              uint16_t *registers);
+SR_PRIV int sr_modbus_read_holding_registers_multi(
+		struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_register_range *ranges, size_t count);
+SR_PRIV struct sr_modbus_read_plan *sr_modbus_read_plan_new(
+		const struct sr_modbus_regmap_entry *entries, size_t count,
+		int max_gap);
+SR_PRIV int sr_modbus_read_plan_run(struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_read_plan *plan, uint16_t *const *registers);
+SR_PRIV void sr_modbus_read_plan_free(struct sr_modbus_read_plan *plan);
 SR_PRIV int sr_modbus_write_coil(struct sr_modbus_dev_inst *modbus,
                                  int address, int value);
 SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib/gprintf.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -63,6 +64,75 @@ static void *sr_log_cb_data = NULL;
 /** @endcond */
 static int64_t sr_log_start_time = 0;
 
+/** @cond PRIVATE */
+#define LOG_ASYNC_RING_SIZE_DEFAULT	(64 * 1024)
+#define LOG_ASYNC_RING_SIZE_MIN		1024
+#define LOG_ASYNC_RING_SIZE_MAX		(64 * 1024 * 1024)
+#define LOG_ASYNC_RECORD_MAX		1024
+#define LOG_ASYNC_POLL_INTERVAL_US	(5 * 1000)
+#define LOG_RECORD_WRAP			-1
+/** @endcond */
+
+/*
+ * Binary log record as it is stored in a per-thread ring. The header
+ * is followed by one 64bit slot per printf(3) argument (including '*'
+ * width and precision arguments), and by the NUL terminated text of
+ * string arguments. String slots hold the text offset, or UINT64_MAX
+ * for NULL pointers. The total record size is a multiple of 8 bytes.
+ *
+ * The format string is not copied. Callers of sr_log() always pass
+ * string literals (see the sr_err() et al macros), which stay valid
+ * until the formatter thread gets to expand them.
+ *
+ * A record with a loglevel of LOG_RECORD_WRAP only has its size and
+ * loglevel fields set, and instructs the reader to skip the remaining
+ * space up to the end of the ring's buffer.
+ */
+struct log_record {
+	uint32_t size;
+	int32_t loglevel;
+	uint32_t num_slots;
+	uint32_t text_len;
+	int64_t timestamp;
+	const char *format;
+	uint64_t slots[];
+};
+
+/*
+ * Single producer single consumer ring. The producer is the thread
+ * which owns the ring, the consumer is the formatter thread. Read and
+ * write positions are free running counters, masked by (size - 1).
+ */
+struct log_ring {
+	uint8_t *buf;
+	guint size;
+	gint head;
+	gint tail;
+	gint dropped;
+	gint orphaned;
+};
+
+/** @cond PRIVATE */
+enum log_async_state {
+	LOG_ASYNC_OFF = 0,
+	LOG_ASYNC_RUNNING,
+	LOG_ASYNC_STOPPING,
+};
+/** @endcond */
+
+static void log_ring_release(void *data);
+
+static GMutex log_async_mutex;
+static GCond log_async_cond;
+static GSList *log_async_rings;
+static GThread *log_async_thread;
+static GPrivate log_async_ring_key = G_PRIVATE_INIT(log_ring_release);
+static GPrivate log_async_formatter_key;
+static gint log_async_state = LOG_ASYNC_OFF;
+static gint log_async_writers;
+static guint log_async_ring_size = LOG_ASYNC_RING_SIZE_DEFAULT;
+static uint32_t log_async_flags;
+
 /**
  * Set the libsigrok loglevel.
  *
@@ -182,28 +252,18 @@ SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data)
 	return SR_OK;
 }
 
-static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args)
+/* Print the 'sr:' prefix, and optionally the time stamp. */
+static int log_print_prefix(int64_t stamp_us)
 {
 	int ret;
 	uint64_t elapsed_us, minutes;
 	unsigned int rest_us, seconds, microseconds;
-	char *raw_output, *output, c;
-	ssize_t print_len;
-	size_t raw_len;
-	const char *raw_ptr;
-	char *out_ptr;
 
-	/* This specific log callback doesn't need the void pointer data. */
-	(void)cb_data;
-
-	(void)loglevel;
-
-	/* Prefix with 'sr:'. Optionally prefix with timestamp. */
 	ret = fputs("sr: ", stderr);
 	if (ret < 0)
 		return SR_ERR;
 	if (cur_loglevel >= LOGLEVEL_TIMESTAMP) {
-		elapsed_us = g_get_monotonic_time() - sr_log_start_time;
+		elapsed_us = stamp_us - sr_log_start_time;
 
 		minutes = elapsed_us / G_TIME_SPAN_MINUTE;
 		rest_us = elapsed_us % G_TIME_SPAN_MINUTE;
@@ -216,6 +276,28 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 			return SR_ERR;
 	}
 
+	return SR_OK;
+}
+
+static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args)
+{
+	int ret;
+	char *raw_output, *output, c;
+	ssize_t print_len;
+	size_t raw_len;
+	const char *raw_ptr;
+	char *out_ptr;
+
+	/* This specific log callback doesn't need the void pointer data. */
+	(void)cb_data;
+
+	(void)loglevel;
+
+	/* Prefix with 'sr:'. Optionally prefix with timestamp. */
+	ret = log_print_prefix(g_get_monotonic_time());
+	if (ret != SR_OK)
+		return ret;
+
 	/* Print the caller's message into a local buffer. */
 	raw_output = NULL;
 	print_len = g_vasprintf(&raw_output, format, args);
@@ -250,6 +332,790 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 	return SR_OK;
 }
 
+/** @cond PRIVATE */
+enum log_arg_class {
+	LOG_ARG_INVALID = -1,
+	LOG_ARG_NONE,
+	LOG_ARG_INT,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_STRING,
+	LOG_ARG_POINTER,
+};
+
+enum log_arg_length {
+	LOG_LEN_DEFAULT,
+	LOG_LEN_LONG,
+	LOG_LEN_LLONG,
+	LOG_LEN_INTMAX,
+	LOG_LEN_SIZE,
+	LOG_LEN_PTRDIFF,
+	LOG_LEN_LDOUBLE,
+};
+/** @endcond */
+
+/* A single conversion specification within a printf(3) format string. */
+struct log_conversion {
+	const char *start;
+	const char *end;
+	enum log_arg_class arg_class;
+	enum log_arg_length length;
+	gboolean star_width;
+	gboolean star_precision;
+	/* Literal precision, or -1 when there is none (or it is '*'). */
+	int precision;
+};
+
+/*
+ * Find the next conversion specification in a printf(3) format string.
+ * Returns FALSE when the format string has no more conversions. Returns
+ * an arg_class of LOG_ARG_INVALID for conversions which the asynchronous
+ * logger does not support (like %n, or wide strings and characters).
+ */
+static gboolean log_next_conversion(const char *format,
+		struct log_conversion *conv)
+{
+	const char *p;
+
+	p = strchr(format, '%');
+	if (!p)
+		return FALSE;
+
+	conv->start = p++;
+	conv->arg_class = LOG_ARG_INVALID;
+	conv->length = LOG_LEN_DEFAULT;
+	conv->star_width = FALSE;
+	conv->star_precision = FALSE;
+	conv->precision = -1;
+
+	if (*p == '%') {
+		conv->end = p + 1;
+		conv->arg_class = LOG_ARG_NONE;
+		return TRUE;
+	}
+
+	/* Flags, field width, precision. */
+	while (*p && strchr("-+ #0'", *p))
+		p++;
+	if (*p == '*') {
+		conv->star_width = TRUE;
+		p++;
+	}
+	while (g_ascii_isdigit(*p))
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			conv->star_precision = TRUE;
+			p++;
+		} else {
+			conv->precision = 0;
+		}
+		while (g_ascii_isdigit(*p)) {
+			if (conv->precision < G_MAXINT / 10)
+				conv->precision = conv->precision * 10 + (*p - '0');
+			p++;
+		}
+	}
+
+	/* Length modifier, including the MSVCRT I64 flavour of PRIu64. */
+	switch (*p) {
+	case 'h':
+		p++;
+		if (*p == 'h')
+			p++;
+		break;
+	case 'l':
+		p++;
+		conv->length = LOG_LEN_LONG;
+		if (*p == 'l') {
+			p++;
+			conv->length = LOG_LEN_LLONG;
+		}
+		break;
+	case 'q':
+		p++;
+		conv->length = LOG_LEN_LLONG;
+		break;
+	case 'j':
+		p++;
+		conv->length = LOG_LEN_INTMAX;
+		break;
+	case 'z':
+		p++;
+		conv->length = LOG_LEN_SIZE;
+		break;
+	case 't':
+		p++;
+		conv->length = LOG_LEN_PTRDIFF;
+		break;
+	case 'L':
+		p++;
+		conv->length = LOG_LEN_LDOUBLE;
+		break;
+	case 'I':
+		if (p[1] == '6' && p[2] == '4') {
+			p += 3;
+			conv->length = LOG_LEN_LLONG;
+		} else if (p[1] == '3' && p[2] == '2') {
+			p += 3;
+		}
+		break;
+	}
+
+	/* Conversion specifier. */
+	conv->end = *p ? p + 1 : p;
+	switch (*p) {
+	case 'c':
+		if (conv->length == LOG_LEN_DEFAULT)
+			conv->arg_class = LOG_ARG_INT;
+		break;
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		if (conv->length != LOG_LEN_LDOUBLE)
+			conv->arg_class = LOG_ARG_INT;
+		break;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		conv->arg_class = LOG_ARG_DOUBLE;
+		break;
+	case 's':
+		if (conv->length == LOG_LEN_DEFAULT)
+			conv->arg_class = LOG_ARG_STRING;
+		break;
+	case 'p':
+		conv->arg_class = LOG_ARG_POINTER;
+		break;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Serialize a log message into a binary record. Returns the record's
+ * size, or 0 if the message cannot be represented (unsupported format,
+ * or too many arguments). The caller then falls back to synchronous
+ * output. String arguments get truncated when they don't fit.
+ */
+static size_t log_record_encode(struct log_record *rec, size_t max_size,
+		int loglevel, const char *format, va_list args)
+{
+	struct log_conversion conv;
+	const char *fmt, *str, *nul;
+	char *text;
+	size_t num_slots, slot, hdr_len, text_len, text_max, len;
+	int precision;
+	double d;
+
+	num_slots = 0;
+	for (fmt = format; log_next_conversion(fmt, &conv); fmt = conv.end) {
+		if (conv.arg_class == LOG_ARG_INVALID)
+			return 0;
+		if (conv.arg_class == LOG_ARG_NONE)
+			continue;
+		num_slots++;
+		if (conv.star_width)
+			num_slots++;
+		if (conv.star_precision)
+			num_slots++;
+	}
+	hdr_len = sizeof(*rec) + num_slots * sizeof(rec->slots[0]);
+	if (hdr_len >= max_size)
+		return 0;
+
+	text = (char *)&rec->slots[num_slots];
+	text_max = max_size - hdr_len;
+	text_len = 0;
+	slot = 0;
+	for (fmt = format; log_next_conversion(fmt, &conv); fmt = conv.end) {
+		if (conv.star_width)
+			rec->slots[slot++] = (int64_t)va_arg(args, int);
+		precision = conv.precision;
+		if (conv.star_precision) {
+			precision = va_arg(args, int);
+			rec->slots[slot++] = (int64_t)precision;
+		}
+		switch (conv.arg_class) {
+		case LOG_ARG_INT:
+			switch (conv.length) {
+			case LOG_LEN_LONG:
+				rec->slots[slot++] = (int64_t)va_arg(args, long);
+				break;
+			case LOG_LEN_LLONG:
+				rec->slots[slot++] = (int64_t)va_arg(args, long long);
+				break;
+			case LOG_LEN_INTMAX:
+				rec->slots[slot++] = (int64_t)va_arg(args, intmax_t);
+				break;
+			case LOG_LEN_SIZE:
+				rec->slots[slot++] = va_arg(args, size_t);
+				break;
+			case LOG_LEN_PTRDIFF:
+				rec->slots[slot++] = (int64_t)va_arg(args, ptrdiff_t);
+				break;
+			default:
+				rec->slots[slot++] = (int64_t)va_arg(args, int);
+				break;
+			}
+			break;
+		case LOG_ARG_DOUBLE:
+			if (conv.length == LOG_LEN_LDOUBLE)
+				d = (double)va_arg(args, long double);
+			else
+				d = va_arg(args, double);
+			memcpy(&rec->slots[slot++], &d, sizeof(d));
+			break;
+		case LOG_ARG_STRING:
+			str = va_arg(args, const char *);
+			if (!str) {
+				rec->slots[slot++] = UINT64_MAX;
+				break;
+			}
+			if (text_len >= text_max)
+				return 0;
+			/*
+			 * With a precision, the argument need not be NUL
+			 * terminated (think "%.11s" on a receive buffer).
+			 * A negative '*' precision counts as none.
+			 */
+			len = text_max - text_len - 1;
+			if (precision < 0) {
+				len = MIN(len, strlen(str));
+			} else {
+				len = MIN(len, (size_t)precision);
+				nul = memchr(str, '\0', len);
+				if (nul)
+					len = nul - str;
+			}
+			memcpy(&text[text_len], str, len);
+			text[text_len + len] = '\0';
+			rec->slots[slot++] = text_len;
+			text_len += len + 1;
+			break;
+		case LOG_ARG_POINTER:
+			rec->slots[slot++] = (uintptr_t)va_arg(args, void *);
+			break;
+		default:
+			break;
+		}
+	}
+
+	rec->size = (hdr_len + text_len + 7) & ~(size_t)7;
+	rec->loglevel = loglevel;
+	rec->num_slots = num_slots;
+	rec->text_len = text_len;
+	rec->timestamp = g_get_monotonic_time();
+	rec->format = format;
+
+	return rec->size;
+}
+
+/*
+ * Rebuild a conversion specification, with the values of '*' width
+ * and precision arguments substituted into the text.
+ */
+static void log_conversion_spec(const struct log_conversion *conv,
+		const struct log_record *rec, size_t *slot, GString *spec)
+{
+	const char *p;
+	gboolean width_done;
+	int value;
+
+	g_string_truncate(spec, 0);
+	width_done = !conv->star_width;
+	for (p = conv->start; p < conv->end; p++) {
+		if (*p != '*') {
+			g_string_append_c(spec, *p);
+			continue;
+		}
+		value = (int)(int64_t)rec->slots[(*slot)++];
+		if (!width_done) {
+			width_done = TRUE;
+			if (value < 0) {
+				g_string_append_c(spec, '-');
+				value = -value;
+			}
+		} else if (value < 0) {
+			/* Negative precision is taken as if it was omitted. */
+			g_string_truncate(spec, spec->len - 1);
+			continue;
+		}
+		g_string_append_printf(spec, "%d", value);
+	}
+}
+
+/* Expand a binary log record to text, with line breaks stripped. */
+static void log_record_decode(const struct log_record *rec,
+		GString *out, GString *spec)
+{
+	struct log_conversion conv;
+	const char *fmt, *text, *str;
+	size_t slot, i, j;
+	uint64_t value;
+	double d;
+
+	g_string_truncate(out, 0);
+	text = (const char *)&rec->slots[rec->num_slots];
+	slot = 0;
+	for (fmt = rec->format; log_next_conversion(fmt, &conv); fmt = conv.end) {
+		g_string_append_len(out, fmt, conv.start - fmt);
+		if (conv.arg_class == LOG_ARG_NONE) {
+			g_string_append_c(out, '%');
+			continue;
+		}
+		log_conversion_spec(&conv, rec, &slot, spec);
+		value = rec->slots[slot++];
+		switch (conv.arg_class) {
+		case LOG_ARG_INT:
+			switch (conv.length) {
+			case LOG_LEN_LONG:
+				g_string_append_printf(out, spec->str, (long)value);
+				break;
+			case LOG_LEN_LLONG:
+				g_string_append_printf(out, spec->str, (long long)value);
+				break;
+			case LOG_LEN_INTMAX:
+				g_string_append_printf(out, spec->str, (intmax_t)value);
+				break;
+			case LOG_LEN_SIZE:
+				g_string_append_printf(out, spec->str, (size_t)value);
+				break;
+			case LOG_LEN_PTRDIFF:
+				g_string_append_printf(out, spec->str, (ptrdiff_t)value);
+				break;
+			default:
+				g_string_append_printf(out, spec->str, (int)value);
+				break;
+			}
+			break;
+		case LOG_ARG_DOUBLE:
+			memcpy(&d, &value, sizeof(d));
+			if (conv.length == LOG_LEN_LDOUBLE)
+				g_string_append_printf(out, spec->str, (long double)d);
+			else
+				g_string_append_printf(out, spec->str, d);
+			break;
+		case LOG_ARG_STRING:
+			str = (value == UINT64_MAX) ? NULL : &text[value];
+			g_string_append_printf(out, spec->str, str);
+			break;
+		case LOG_ARG_POINTER:
+			g_string_append_printf(out, spec->str,
+				(void *)(uintptr_t)value);
+			break;
+		default:
+			break;
+		}
+	}
+	g_string_append(out, fmt);
+
+	for (i = j = 0; i < out->len; i++) {
+		if (out->str[i] == '\r' || out->str[i] == '\n')
+			continue;
+		out->str[j++] = out->str[i];
+	}
+	g_string_truncate(out, j);
+}
+
+static struct log_ring *log_ring_new(guint size)
+{
+	struct log_ring *ring;
+
+	ring = g_malloc0(sizeof(*ring));
+	ring->buf = g_malloc(size);
+	ring->size = size;
+
+	return ring;
+}
+
+static void log_ring_free(struct log_ring *ring)
+{
+	g_free(ring->buf);
+	g_free(ring);
+}
+
+/* Thread exit notification: leave the ring for the formatter to drain. */
+static void log_ring_release(void *data)
+{
+	struct log_ring *ring;
+
+	ring = data;
+	g_atomic_int_set(&ring->orphaned, 1);
+}
+
+/* Get the calling thread's ring, create and register it upon first use. */
+static struct log_ring *log_ring_get(void)
+{
+	struct log_ring *ring;
+
+	ring = g_private_get(&log_async_ring_key);
+	if (ring)
+		return ring;
+
+	ring = log_ring_new(log_async_ring_size);
+	g_mutex_lock(&log_async_mutex);
+	log_async_rings = g_slist_prepend(log_async_rings, ring);
+	g_mutex_unlock(&log_async_mutex);
+	g_private_set(&log_async_ring_key, ring);
+
+	return ring;
+}
+
+/*
+ * Copy a record into the ring. Returns FALSE when the ring is full.
+ * Records never wrap around the end of the buffer, the remaining space
+ * gets skipped over by means of a LOG_RECORD_WRAP marker instead.
+ */
+static gboolean log_ring_push(struct log_ring *ring,
+		const struct log_record *rec)
+{
+	guint head, tail, offset, contiguous, need;
+	struct log_record *wrap;
+
+	head = (guint)ring->head;
+	tail = (guint)g_atomic_int_get(&ring->tail);
+	offset = head & (ring->size - 1);
+	contiguous = ring->size - offset;
+	need = rec->size;
+	if (contiguous < rec->size)
+		need += contiguous;
+	if (ring->size - (head - tail) < need)
+		return FALSE;
+
+	if (contiguous < rec->size) {
+		wrap = (struct log_record *)&ring->buf[offset];
+		wrap->size = contiguous;
+		wrap->loglevel = LOG_RECORD_WRAP;
+		head += contiguous;
+		offset = 0;
+	}
+	memcpy(&ring->buf[offset], rec, rec->size);
+	g_atomic_int_set(&ring->head, (gint)(head + rec->size));
+
+	return TRUE;
+}
+
+/* Get the oldest record in the ring, or NULL if the ring is empty. */
+static const struct log_record *log_ring_peek(struct log_ring *ring)
+{
+	const struct log_record *rec;
+	guint head, tail;
+
+	head = (guint)g_atomic_int_get(&ring->head);
+	tail = (guint)ring->tail;
+	while (tail != head) {
+		rec = (const struct log_record *)&ring->buf[tail & (ring->size - 1)];
+		if (rec->loglevel != LOG_RECORD_WRAP)
+			return rec;
+		tail += rec->size;
+		g_atomic_int_set(&ring->tail, (gint)tail);
+	}
+
+	return NULL;
+}
+
+static void log_ring_pop(struct log_ring *ring, const struct log_record *rec)
+{
+	g_atomic_int_set(&ring->tail, (gint)((guint)ring->tail + rec->size));
+}
+
+/* Pass a formatted message to the currently selected log callback. */
+static int log_async_emit_cb(sr_log_callback cb, void *cb_data,
+		int loglevel, const char *format, ...)
+{
+	int ret;
+	va_list args;
+
+	va_start(args, format);
+	ret = cb(cb_data, loglevel, format, args);
+	va_end(args);
+
+	return ret;
+}
+
+static void log_async_emit(int loglevel, int64_t timestamp, const char *text)
+{
+	sr_log_callback cb;
+	void *cb_data;
+
+	cb = sr_log_cb;
+	cb_data = sr_log_cb_data;
+	if (!cb)
+		return;
+
+	/* Keep the time of the sr_log() call for the built-in sink. */
+	if (cb == sr_logv) {
+		if (log_print_prefix(timestamp) != SR_OK)
+			return;
+		g_fprintf(stderr, "%s\n", text);
+		return;
+	}
+	log_async_emit_cb(cb, cb_data, loglevel, "%s", text);
+}
+
+/*
+ * Drain all registered rings, and emit their records in the order of
+ * their time stamps. Rings of terminated threads get released after
+ * they were drained. Returns the number of emitted records.
+ *
+ * Log callbacks run without the lock held, they may log themselves,
+ * or wait for other threads which log (and register their rings).
+ */
+static size_t log_async_drain(GString *out, GString *spec)
+{
+	GSList *l, *next;
+	struct log_ring *ring, *oldest_ring;
+	const struct log_record *rec, *oldest;
+	char note[64];
+	size_t count;
+	int dropped, n, loglevel;
+	int64_t timestamp;
+
+	dropped = 0;
+	g_mutex_lock(&log_async_mutex);
+	for (l = log_async_rings; l; l = l->next) {
+		ring = l->data;
+		n = g_atomic_int_get(&ring->dropped);
+		g_atomic_int_add(&ring->dropped, -n);
+		dropped += n;
+	}
+	g_mutex_unlock(&log_async_mutex);
+	if (dropped) {
+		g_snprintf(note, sizeof(note), "log: %d messages dropped.",
+			dropped);
+		log_async_emit(SR_LOG_WARN, g_get_monotonic_time(), note);
+	}
+
+	/*
+	 * Only the formatter thread consumes records, and it holds the
+	 * lock while it picks one. Releasing the record (after copying
+	 * it to text) before the callback runs keeps the order intact.
+	 */
+	count = 0;
+	while (TRUE) {
+		g_mutex_lock(&log_async_mutex);
+		oldest = NULL;
+		oldest_ring = NULL;
+		for (l = log_async_rings; l; l = l->next) {
+			ring = l->data;
+			rec = log_ring_peek(ring);
+			if (!rec)
+				continue;
+			if (!oldest || rec->timestamp < oldest->timestamp) {
+				oldest = rec;
+				oldest_ring = ring;
+			}
+		}
+		if (!oldest) {
+			g_mutex_unlock(&log_async_mutex);
+			break;
+		}
+		log_record_decode(oldest, out, spec);
+		loglevel = oldest->loglevel;
+		timestamp = oldest->timestamp;
+		log_ring_pop(oldest_ring, oldest);
+		g_mutex_unlock(&log_async_mutex);
+
+		log_async_emit(loglevel, timestamp, out->str);
+		count++;
+	}
+	if (count && sr_log_cb == sr_logv)
+		fflush(stderr);
+
+	g_mutex_lock(&log_async_mutex);
+	for (l = log_async_rings; l; l = next) {
+		next = l->next;
+		ring = l->data;
+		if (!g_atomic_int_get(&ring->orphaned))
+			continue;
+		if (log_ring_peek(ring) || g_atomic_int_get(&ring->dropped))
+			continue;
+		log_async_rings = g_slist_delete_link(log_async_rings, l);
+		log_ring_free(ring);
+	}
+	g_mutex_unlock(&log_async_mutex);
+
+	return count;
+}
+
+/* Formatter thread body. */
+static void *log_async_thread_func(void *data)
+{
+	GString *out, *spec;
+	GMutex wait_mutex;
+	int64_t deadline;
+
+	(void)data;
+
+	g_private_set(&log_async_formatter_key, GINT_TO_POINTER(1));
+	out = g_string_sized_new(256);
+	spec = g_string_sized_new(32);
+	g_mutex_init(&wait_mutex);
+
+	while (g_atomic_int_get(&log_async_state) == LOG_ASYNC_RUNNING) {
+		if (log_async_drain(out, spec))
+			continue;
+		/* Producers never signal, they don't take locks. Poll. */
+		deadline = g_get_monotonic_time() + LOG_ASYNC_POLL_INTERVAL_US;
+		g_mutex_lock(&wait_mutex);
+		g_cond_wait_until(&log_async_cond, &wait_mutex, deadline);
+		g_mutex_unlock(&wait_mutex);
+	}
+
+	/*
+	 * Wait for in-flight sr_log() calls, then flush what's left. Keep
+	 * draining meanwhile, lossless writers may wait for ring space.
+	 */
+	while (g_atomic_int_get(&log_async_writers)) {
+		if (!log_async_drain(out, spec))
+			g_thread_yield();
+	}
+	log_async_drain(out, spec);
+
+	g_mutex_clear(&wait_mutex);
+	g_string_free(spec, TRUE);
+	g_string_free(out, TRUE);
+
+	return NULL;
+}
+
+/*
+ * Queue a message for the formatter thread. Returns SR_ERR_NA when the
+ * message must be logged synchronously instead.
+ */
+static int log_async_push(int loglevel, const char *format, va_list args)
+{
+	uint64_t buf[LOG_ASYNC_RECORD_MAX / sizeof(uint64_t)];
+	struct log_record *rec;
+	struct log_ring *ring;
+	va_list args_copy;
+	size_t size;
+
+	rec = (struct log_record *)buf;
+	va_copy(args_copy, args);
+	size = log_record_encode(rec, sizeof(buf), loglevel, format, args_copy);
+	va_end(args_copy);
+	if (!size)
+		return SR_ERR_NA;
+
+	ring = log_ring_get();
+	if (rec->size > ring->size / 2)
+		return SR_ERR_NA;
+	while (!log_ring_push(ring, rec)) {
+		if (!(log_async_flags & SR_LOG_ASYNC_LOSSLESS)) {
+			g_atomic_int_inc(&ring->dropped);
+			break;
+		}
+		g_thread_yield();
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Start the asynchronous log backend.
+ *
+ * Once started, sr_log() no longer formats messages in the calling
+ * thread. Instead, it serializes the format string pointer and the
+ * arguments into a binary record, and puts it into a lock-free ring
+ * which is private to the calling thread. A background formatter thread
+ * collects the records, expands them to text, and passes them to the
+ * currently selected log callback. This keeps the cost of enabled debug
+ * output away from acquisition threads.
+ *
+ * Note that custom log callbacks get invoked from the formatter thread
+ * while the asynchronous backend is active. Messages from different
+ * threads are emitted in the order of their time stamps.
+ *
+ * By default, records which don't fit into a full ring get dropped,
+ * and the number of lost messages is reported later (bounded loss).
+ * Pass SR_LOG_ASYNC_LOSSLESS in @a flags to have the logging thread
+ * wait for the formatter instead.
+ *
+ * @param ring_size The size of each thread's ring in bytes, or 0 for
+ *                  the default of 64KiB. Gets rounded up to a power of
+ *                  two. Applies to rings which get created after this
+ *                  call.
+ * @param flags Zero, or a combination of enum sr_log_async_flags values.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid ring size.
+ * @retval SR_ERR The asynchronous backend is already running, or the
+ *         formatter thread could not be created.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_async_start(size_t ring_size, uint32_t flags)
+{
+	size_t power;
+	GError *error;
+
+	if (!ring_size)
+		ring_size = LOG_ASYNC_RING_SIZE_DEFAULT;
+	if (ring_size < LOG_ASYNC_RING_SIZE_MIN
+			|| ring_size > LOG_ASYNC_RING_SIZE_MAX) {
+		sr_err("Invalid log ring size %zu.", ring_size);
+		return SR_ERR_ARG;
+	}
+	sr_next_power_of_two(ring_size - 1, NULL, &power);
+
+	if (log_async_thread) {
+		sr_err("Asynchronous logging already started.");
+		return SR_ERR;
+	}
+
+	log_async_ring_size = power;
+	log_async_flags = flags;
+	g_atomic_int_set(&log_async_state, LOG_ASYNC_RUNNING);
+
+	error = NULL;
+	log_async_thread = g_thread_try_new("sr-log", log_async_thread_func,
+		NULL, &error);
+	if (!log_async_thread) {
+		g_atomic_int_set(&log_async_state, LOG_ASYNC_OFF);
+		sr_err("Cannot create log formatter thread: %s.",
+			error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Stop the asynchronous log backend.
+ *
+ * All messages which were queued before this call get emitted before
+ * this function returns. Subsequent sr_log() calls are handled
+ * synchronously again. Does nothing when the backend is not running.
+ *
+ * @retval SR_OK Success.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_async_stop(void)
+{
+	if (!log_async_thread)
+		return SR_OK;
+
+	g_atomic_int_set(&log_async_state, LOG_ASYNC_STOPPING);
+	g_cond_signal(&log_async_cond);
+	g_thread_join(log_async_thread);
+	log_async_thread = NULL;
+	g_atomic_int_set(&log_async_state, LOG_ASYNC_OFF);
+
+	return SR_OK;
+}
+
 /** @private */
 SR_PRIV int sr_log(int loglevel, const char *format, ...)
 {
@@ -265,7 +1131,16 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 		return SR_OK;
 
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
+	ret = SR_ERR_NA;
+	if (g_atomic_int_get(&log_async_state) == LOG_ASYNC_RUNNING) {
+		g_atomic_int_inc(&log_async_writers);
+		if (g_atomic_int_get(&log_async_state) == LOG_ASYNC_RUNNING
+				&& !g_private_get(&log_async_formatter_key))
+			ret = log_async_push(loglevel, format, args);
+		g_atomic_int_add(&log_async_writers, -1);
+	}
+	if (ret == SR_ERR_NA)
+		ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
 	va_end(args);
 
 	return ret;
@@ -25,9 +25,11 @@
 
 #define LOG_PREFIX "modbus"
 
+SR_PRIV extern const struct sr_modbus_dev_inst modbus_tcp_dev;
 SR_PRIV extern const struct sr_modbus_dev_inst modbus_serial_rtu_dev;
 
 static const struct sr_modbus_dev_inst *modbus_devs[] = {
+	&modbus_tcp_dev,
 #ifdef HAVE_SERIAL_COMM
 	&modbus_serial_rtu_dev, /* Must be last as it matches any resource. */
 #endif
@@ -258,7 +260,7 @@ SR_PRIV int sr_modbus_reply(struct sr_modbus_dev_inst *modbus,
 
 	laststart = g_get_monotonic_time();
 
-	ret = modbus->read_begin(modbus->priv, reply);
+	ret = modbus->read_begin(modbus->priv, reply, modbus->read_timeout_ms);
 	if (ret != SR_OK)
 		return ret;
 	if (*reply & 0x80)
@@ -313,6 +315,50 @@ SR_PRIV int sr_modbus_request_reply(struct sr_modbus_dev_inst *modbus,
 	return sr_modbus_reply(modbus, reply, reply_size);
 }
 
+/**
+ * Send several Modbus commands and receive their replies.
+ *
+ * Transports which support it have all of the requests in flight at the
+ * same time, so that the transactions cost a single round trip instead
+ * of one each. Other transports run the transactions one after another.
+ *
+ * @param modbus Previously initialized Modbus device structure.
+ * @param xfers The transactions to run. Each one's result field receives
+ *              the transaction's outcome.
+ * @param count The number of transactions.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments, or the
+ *         error of the first transaction which failed.
+ */
+SR_PRIV int sr_modbus_request_reply_multi(struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_transaction *xfers, size_t count)
+{
+	size_t i;
+	int ret;
+
+	if (!xfers && count)
+		return SR_ERR_ARG;
+
+	if (modbus->transact) {
+		ret = modbus->transact(modbus->priv, xfers, count,
+			modbus->read_timeout_ms);
+		if (ret != SR_OK)
+			return ret;
+	} else {
+		for (i = 0; i < count; i++)
+			xfers[i].result = sr_modbus_request_reply(modbus,
+				xfers[i].request, xfers[i].request_size,
+				xfers[i].reply, xfers[i].reply_size);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (xfers[i].result != SR_OK)
+			return xfers[i].result;
+	}
+
+	return SR_OK;
+}
+
 enum {
 	MODBUS_READ_COILS = 0x01,
 	MODBUS_READ_HOLDING_REGISTERS = 0x03,
@@ -478,6 +524,255 @@ SR_PRIV int sr_modbus_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return SR_OK;
 }
 
+/**
+ * Read several ranges of holding registers.
+ *
+ * The read commands are issued with sr_modbus_request_reply_multi(), on
+ * transports which support it all of them are in flight at the same time.
+ *
+ * @param modbus Previously initialized Modbus device structure.
+ * @param ranges The register ranges to read. Each one's result field
+ *               receives the outcome of reading that range.
+ * @param count The number of ranges.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments,
+ *         SR_ERR_DATA upon invalid data, or SR_ERR on failure.
+ */
+SR_PRIV int sr_modbus_read_holding_registers_multi(
+		struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_register_range *ranges, size_t count)
+{
+	struct sr_modbus_transaction *xfers;
+	uint8_t *request, *reply;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < count; i++) {
+		if (ranges[i].address < 0 || ranges[i].address > 0xFFFF
+		    || ranges[i].nb_registers < 1
+		    || ranges[i].nb_registers > 125 || !ranges[i].registers)
+			return SR_ERR_ARG;
+	}
+	if (!count)
+		return SR_OK;
+
+	xfers = g_malloc0(count * sizeof(*xfers));
+	for (i = 0; i < count; i++) {
+		request = g_malloc(5);
+		W8(request + 0, MODBUS_READ_HOLDING_REGISTERS);
+		WB16(request + 1, ranges[i].address);
+		WB16(request + 3, ranges[i].nb_registers);
+		xfers[i].request = request;
+		xfers[i].request_size = 5;
+		xfers[i].reply_size = 2 + (2 * ranges[i].nb_registers);
+		xfers[i].reply = g_malloc(xfers[i].reply_size);
+	}
+
+	sr_modbus_request_reply_multi(modbus, xfers, count);
+
+	ret = SR_OK;
+	for (i = 0; i < count; i++) {
+		reply = xfers[i].reply;
+		if (xfers[i].result != SR_OK)
+			ranges[i].result = xfers[i].result;
+		else if (sr_modbus_error_check(reply))
+			ranges[i].result = SR_ERR_DATA;
+		else if (reply[0] != MODBUS_READ_HOLDING_REGISTERS
+		    || R8(reply + 1) != (uint8_t)(2 * ranges[i].nb_registers))
+			ranges[i].result = SR_ERR_DATA;
+		else
+			ranges[i].result = SR_OK;
+		if (ranges[i].result == SR_OK)
+			memcpy(ranges[i].registers, reply + 2,
+				2 * ranges[i].nb_registers);
+		else if (ret == SR_OK)
+			ret = ranges[i].result;
+		g_free(xfers[i].request);
+		g_free(xfers[i].reply);
+	}
+	g_free(xfers);
+
+	return ret;
+}
+
+/*
+ * A read plan covers a register map with as few read commands as
+ * possible. Blocks which are adjacent, or only a few registers apart,
+ * share a command: on a serial line each command costs a frame with its
+ * address, CRC and inter-frame gaps in either direction, which is worth
+ * more than a few unused registers. Gaps are only spanned when the
+ * caller permits it though, as some devices reject reads of undefined
+ * registers.
+ */
+
+struct modbus_plan_scatter {
+	/* Index of the read which covers the entry. */
+	size_t read;
+	/* The entry's first register within that read. */
+	int offset;
+	int nb_registers;
+};
+
+struct sr_modbus_read_plan {
+	size_t num_entries;
+	struct modbus_plan_scatter *scatter;
+	size_t num_reads;
+	struct sr_modbus_register_range *reads;
+};
+
+#define MODBUS_MAX_READ_REGISTERS 125
+
+static int regmap_entry_cmp(const void *a, const void *b, void *data)
+{
+	const struct sr_modbus_regmap_entry *entries;
+	int addr_a, addr_b;
+
+	entries = data;
+	addr_a = entries[*(const size_t *)a].address;
+	addr_b = entries[*(const size_t *)b].address;
+
+	return (addr_a > addr_b) - (addr_a < addr_b);
+}
+
+/**
+ * Plan the reads which get a register map's holding registers.
+ *
+ * Blocks of the map get merged into as few read commands as possible.
+ * Each read command gets at most 125 registers, as the protocol limits.
+ *
+ * @param entries The register map's blocks, in any order. Blocks may
+ *                overlap.
+ * @param count The number of blocks.
+ * @param max_gap The number of unused registers a read may span to merge
+ *                two blocks. Use 0 to only merge adjacent blocks.
+ *
+ * @return The read plan, or NULL upon invalid arguments. Free it with
+ *         sr_modbus_read_plan_free().
+ */
+SR_PRIV struct sr_modbus_read_plan *sr_modbus_read_plan_new(
+		const struct sr_modbus_regmap_entry *entries, size_t count,
+		int max_gap)
+{
+	struct sr_modbus_read_plan *plan;
+	struct sr_modbus_register_range *read;
+	const struct sr_modbus_regmap_entry *entry;
+	size_t *order, i;
+	int end, entry_end;
+
+	if (!entries || !count || max_gap < 0)
+		return NULL;
+	for (i = 0; i < count; i++) {
+		if (entries[i].address < 0 || entries[i].nb_registers < 1
+		    || entries[i].nb_registers > MODBUS_MAX_READ_REGISTERS
+		    || entries[i].address + entries[i].nb_registers > 0x10000)
+			return NULL;
+	}
+
+	order = g_malloc(count * sizeof(*order));
+	for (i = 0; i < count; i++)
+		order[i] = i;
+	g_qsort_with_data(order, count, sizeof(*order),
+		regmap_entry_cmp, (void *)entries);
+
+	plan = g_malloc0(sizeof(*plan));
+	plan->num_entries = count;
+	plan->scatter = g_malloc(count * sizeof(*plan->scatter));
+	plan->reads = g_malloc0(count * sizeof(*plan->reads));
+
+	/*
+	 * Sweep the blocks by address. A block joins the current read when
+	 * it starts close enough to its end, and the read doesn't exceed
+	 * the size limit.
+	 */
+	read = NULL;
+	end = 0;
+	for (i = 0; i < count; i++) {
+		entry = &entries[order[i]];
+		entry_end = entry->address + entry->nb_registers;
+		if (!read || entry->address > end + max_gap
+		    || MAX(end, entry_end) - read->address
+				> MODBUS_MAX_READ_REGISTERS) {
+			read = &plan->reads[plan->num_reads++];
+			read->address = entry->address;
+			end = entry_end;
+		}
+		end = MAX(end, entry_end);
+		read->nb_registers = end - read->address;
+		plan->scatter[order[i]].read = read - plan->reads;
+		plan->scatter[order[i]].offset = entry->address - read->address;
+		plan->scatter[order[i]].nb_registers = entry->nb_registers;
+	}
+	g_free(order);
+
+	for (i = 0; i < plan->num_reads; i++)
+		plan->reads[i].registers = g_malloc(plan->reads[i].nb_registers
+			* sizeof(*plan->reads[i].registers));
+
+	sr_spew("Planned %zu reads for %zu register blocks.",
+		plan->num_reads, count);
+
+	return plan;
+}
+
+/**
+ * Read a register map's holding registers, following a read plan.
+ *
+ * On transports which support it, all of the plan's reads are in flight
+ * at the same time.
+ *
+ * @param modbus Previously initialized Modbus device structure.
+ * @param plan The read plan, from sr_modbus_read_plan_new().
+ * @param registers Buffers for the registers' values, one for each block
+ *                  of the register map the plan was made for, in the
+ *                  map's order.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments,
+ *         SR_ERR_DATA upon invalid data, or SR_ERR on failure.
+ */
+SR_PRIV int sr_modbus_read_plan_run(struct sr_modbus_dev_inst *modbus,
+		struct sr_modbus_read_plan *plan, uint16_t *const *registers)
+{
+	const struct modbus_plan_scatter *scatter;
+	size_t i;
+	int ret;
+
+	if (!plan || !registers)
+		return SR_ERR_ARG;
+
+	ret = sr_modbus_read_holding_registers_multi(modbus,
+		plan->reads, plan->num_reads);
+	if (ret != SR_OK)
+		return ret;
+
+	for (i = 0; i < plan->num_entries; i++) {
+		scatter = &plan->scatter[i];
+		memcpy(registers[i],
+			plan->reads[scatter->read].registers + scatter->offset,
+			scatter->nb_registers * sizeof(*registers[i]));
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Free a read plan.
+ *
+ * @param plan The read plan, from sr_modbus_read_plan_new(). Can be NULL.
+ */
+SR_PRIV void sr_modbus_read_plan_free(struct sr_modbus_read_plan *plan)
+{
+	size_t i;
+
+	if (!plan)
+		return;
+
+	for (i = 0; i < plan->num_reads; i++)
+		g_free(plan->reads[i].registers);
+	g_free(plan->reads);
+	g_free(plan->scatter);
+	g_free(plan);
+}
+
 /**
  * Send a Modbus write coil command.
  *
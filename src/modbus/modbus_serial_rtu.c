@@ -105,12 +105,16 @@ static int modbus_serial_rtu_send(void *priv,
 	return SR_OK;
 }
 
-static int modbus_serial_rtu_read_begin(void *priv, uint8_t *function_code)
+static int modbus_serial_rtu_read_begin(void *priv, uint8_t *function_code,
+		unsigned int timeout_ms)
 {
 	struct modbus_serial_rtu *modbus = priv;
 	uint8_t slave_addr;
 	int ret;
 
+	/* RTU keeps its short wait for the reply, probes depend on it. */
+	(void)timeout_ms;
+
 	ret = serial_read_blocking(modbus->serial, &slave_addr, 1, 500);
 	if (ret != 1 || slave_addr != modbus->slave_addr)
 		return SR_ERR;
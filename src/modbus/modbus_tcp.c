@@ -0,0 +1,373 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "modbus_tcp"
+
+/*
+ * Modbus TCP wraps each PDU in a 7 byte MBAP header: a transaction ID,
+ * the protocol ID (always 0), the number of bytes which follow, and the
+ * unit ID. The transaction ID gets echoed in the reply, which lets a
+ * client have several requests in flight on the same connection, and
+ * match the replies as they arrive.
+ */
+
+#define MBAP_HEADER_SIZE	7
+#define MODBUS_MAX_PDU_SIZE	253
+#define DEFAULT_PORT		"502"
+
+/*
+ * Gateways commonly serve only a limited number of outstanding requests
+ * per connection, and silently drop the excess.
+ */
+#define MAX_PIPELINE		16
+
+struct modbus_tcp {
+	struct sr_tcp_dev_inst *tcp;
+	uint8_t unit_id;
+	uint16_t next_tid;
+	uint16_t pending_tid;
+	/* PDU of the reply which read_data() hands out. */
+	uint8_t reply[MODBUS_MAX_PDU_SIZE];
+	size_t reply_len;
+	size_t reply_pos;
+};
+
+static int modbus_tcp_dev_inst_new(void *priv, const char *resource,
+		char **params, const char *serialcomm, int modbusaddr)
+{
+	struct modbus_tcp *modbus = priv;
+	const char *port;
+
+	(void)resource;
+	(void)serialcomm;
+
+	if (!params || !params[1]) {
+		sr_err("Invalid parameters.");
+		return SR_ERR;
+	}
+	port = params[2] && *params[2] ? params[2] : DEFAULT_PORT;
+
+	modbus->tcp = sr_tcp_dev_inst_new(params[1], port);
+	if (!modbus->tcp)
+		return SR_ERR;
+	modbus->unit_id = modbusaddr;
+
+	return SR_OK;
+}
+
+static int modbus_tcp_open(void *priv)
+{
+	struct modbus_tcp *modbus = priv;
+
+	modbus->reply_len = 0;
+	modbus->reply_pos = 0;
+
+	return sr_tcp_connect(modbus->tcp);
+}
+
+static int modbus_tcp_source_add(struct sr_session *session, void *priv,
+		int events, int timeout, sr_receive_data_callback cb, void *cb_data)
+{
+	struct modbus_tcp *modbus = priv;
+
+	return sr_tcp_source_add(session, modbus->tcp, events, timeout,
+		cb, cb_data);
+}
+
+static int modbus_tcp_source_remove(struct sr_session *session, void *priv)
+{
+	struct modbus_tcp *modbus = priv;
+
+	return sr_tcp_source_remove(session, modbus->tcp);
+}
+
+static int modbus_tcp_write_all(struct modbus_tcp *modbus,
+		const uint8_t *data, size_t len)
+{
+	int ret;
+
+	while (len) {
+		ret = sr_tcp_write_bytes(modbus->tcp, data, len);
+		if (ret < 0) {
+			sr_err("Send error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		data += ret;
+		len -= ret;
+	}
+
+	return SR_OK;
+}
+
+static int modbus_tcp_read_all(struct modbus_tcp *modbus,
+		uint8_t *data, size_t len, unsigned int timeout_ms)
+{
+	int ret;
+
+	while (len) {
+		if (!sr_fd_wait_readable(modbus->tcp->sock_fd, timeout_ms)) {
+			sr_err("Timed out waiting for Modbus response.");
+			return SR_ERR_TIMEOUT;
+		}
+		ret = sr_tcp_read_bytes(modbus->tcp, data, len, FALSE);
+		if (ret < 0) {
+			sr_err("Receive error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		if (ret == 0) {
+			sr_err("Connection closed by peer.");
+			return SR_ERR;
+		}
+		data += ret;
+		len -= ret;
+	}
+
+	return SR_OK;
+}
+
+/* Append a request's frame, return the transaction ID it got. */
+static uint16_t modbus_tcp_frame(struct modbus_tcp *modbus, GByteArray *frames,
+		const uint8_t *request, int request_size)
+{
+	uint8_t header[MBAP_HEADER_SIZE];
+	uint16_t tid;
+
+	tid = modbus->next_tid++;
+	WB16(header + 0, tid);
+	WB16(header + 2, 0);
+	WB16(header + 4, request_size + 1);
+	W8(header + 6, modbus->unit_id);
+	g_byte_array_append(frames, header, sizeof(header));
+	g_byte_array_append(frames, request, request_size);
+
+	return tid;
+}
+
+/* Read one reply frame, of whichever transaction completes next. */
+static int modbus_tcp_read_frame(struct modbus_tcp *modbus, uint16_t *tid,
+		uint8_t *pdu, size_t *pdu_len, unsigned int timeout_ms)
+{
+	uint8_t header[MBAP_HEADER_SIZE];
+	size_t length;
+	int ret;
+
+	ret = modbus_tcp_read_all(modbus, header, sizeof(header), timeout_ms);
+	if (ret != SR_OK)
+		return ret;
+
+	length = RB16(header + 4);
+	if (RB16(header + 2) != 0 || length < 2
+	    || length - 1 > MODBUS_MAX_PDU_SIZE) {
+		/* The stream can't get resynchronized after this. */
+		sr_err("Invalid MBAP header.");
+		return SR_ERR_DATA;
+	}
+	*tid = RB16(header + 0);
+	*pdu_len = length - 1;
+
+	return modbus_tcp_read_all(modbus, pdu, *pdu_len, timeout_ms);
+}
+
+static int modbus_tcp_send(void *priv, const uint8_t *buffer, int buffer_size)
+{
+	struct modbus_tcp *modbus = priv;
+	GByteArray *frame;
+	int ret;
+
+	if (buffer_size > MODBUS_MAX_PDU_SIZE)
+		return SR_ERR_ARG;
+
+	frame = g_byte_array_sized_new(MBAP_HEADER_SIZE + buffer_size);
+	modbus->pending_tid = modbus_tcp_frame(modbus, frame,
+		buffer, buffer_size);
+	ret = modbus_tcp_write_all(modbus, frame->data, frame->len);
+	g_byte_array_free(frame, TRUE);
+
+	return ret;
+}
+
+static int modbus_tcp_read_begin(void *priv, uint8_t *function_code,
+		unsigned int timeout_ms)
+{
+	struct modbus_tcp *modbus = priv;
+	uint16_t tid;
+	int ret;
+
+	/* Skip replies to requests which timed out earlier. */
+	do {
+		ret = modbus_tcp_read_frame(modbus, &tid, modbus->reply,
+			&modbus->reply_len, timeout_ms);
+		if (ret != SR_OK)
+			return ret;
+		if (tid != modbus->pending_tid)
+			sr_dbg("Discarding stale reply, transaction %u.", tid);
+	} while (tid != modbus->pending_tid);
+
+	*function_code = modbus->reply[0];
+	modbus->reply_pos = 1;
+
+	return SR_OK;
+}
+
+static int modbus_tcp_read_data(void *priv, uint8_t *buf, int maxlen)
+{
+	struct modbus_tcp *modbus = priv;
+	size_t len;
+
+	len = modbus->reply_len - modbus->reply_pos;
+	if (!len)
+		return SR_ERR;
+	len = MIN(len, (size_t)maxlen);
+	memcpy(buf, modbus->reply + modbus->reply_pos, len);
+	modbus->reply_pos += len;
+
+	return len;
+}
+
+static int modbus_tcp_read_end(void *priv)
+{
+	struct modbus_tcp *modbus = priv;
+
+	modbus->reply_len = 0;
+	modbus->reply_pos = 0;
+
+	return SR_OK;
+}
+
+static int modbus_tcp_transact(void *priv, struct sr_modbus_transaction *xfers,
+		size_t count, unsigned int timeout_ms)
+{
+	struct modbus_tcp *modbus = priv;
+	struct sr_modbus_transaction *xfer;
+	GByteArray *frames;
+	gboolean *done;
+	uint8_t pdu[MODBUS_MAX_PDU_SIZE];
+	size_t pdu_len, sent, completed, i;
+	uint16_t first_tid, tid;
+	int ret;
+
+	for (i = 0; i < count; i++) {
+		if (!xfers[i].request || xfers[i].request_size < 1
+		    || xfers[i].request_size > MODBUS_MAX_PDU_SIZE
+		    || !xfers[i].reply || xfers[i].reply_size < 2)
+			return SR_ERR_ARG;
+	}
+
+	/*
+	 * The transactions get consecutive IDs, a reply's ID thus tells
+	 * which transaction it completes.
+	 */
+	first_tid = modbus->next_tid;
+	frames = g_byte_array_new();
+	done = g_malloc0(count * sizeof(*done));
+	sent = completed = 0;
+	ret = SR_OK;
+
+	while (completed < count) {
+		/* Top up the pipeline, with a single write. */
+		g_byte_array_set_size(frames, 0);
+		while (sent < count && sent - completed < MAX_PIPELINE) {
+			modbus_tcp_frame(modbus, frames, xfers[sent].request,
+				xfers[sent].request_size);
+			sent++;
+		}
+		if (frames->len) {
+			ret = modbus_tcp_write_all(modbus,
+				frames->data, frames->len);
+			if (ret != SR_OK)
+				break;
+		}
+
+		ret = modbus_tcp_read_frame(modbus, &tid, pdu, &pdu_len,
+			timeout_ms);
+		if (ret != SR_OK)
+			break;
+		i = (uint16_t)(tid - first_tid);
+		if (i >= sent || done[i]) {
+			sr_dbg("Discarding stale reply, transaction %u.", tid);
+			continue;
+		}
+
+		xfer = &xfers[i];
+		if (pdu[0] & 0x80) {
+			/* Exception replies carry a single code byte. */
+			memcpy(xfer->reply, pdu, MIN(pdu_len, 2));
+			xfer->result = pdu_len >= 2 ? SR_OK : SR_ERR_DATA;
+		} else if (pdu_len < (size_t)xfer->reply_size) {
+			sr_err("Incompletely read Modbus response.");
+			xfer->result = SR_ERR_DATA;
+		} else {
+			memcpy(xfer->reply, pdu, xfer->reply_size);
+			xfer->result = SR_OK;
+		}
+		done[i] = TRUE;
+		completed++;
+	}
+
+	/* Fail whatever is left, late replies get discarded later. */
+	for (i = 0; i < count; i++) {
+		if (!done[i])
+			xfers[i].result = ret;
+	}
+
+	g_free(done);
+	g_byte_array_free(frames, TRUE);
+
+	return ret;
+}
+
+static int modbus_tcp_close(void *priv)
+{
+	struct modbus_tcp *modbus = priv;
+
+	return sr_tcp_disconnect(modbus->tcp);
+}
+
+static void modbus_tcp_free(void *priv)
+{
+	struct modbus_tcp *modbus = priv;
+
+	sr_tcp_dev_inst_free(modbus->tcp);
+}
+
+SR_PRIV const struct sr_modbus_dev_inst modbus_tcp_dev = {
+	.name          = "Modbus TCP",
+	.prefix        = "tcp/",
+	.priv_size     = sizeof(struct modbus_tcp),
+	.scan          = NULL,
+	.dev_inst_new  = modbus_tcp_dev_inst_new,
+	.open          = modbus_tcp_open,
+	.source_add    = modbus_tcp_source_add,
+	.source_remove = modbus_tcp_source_remove,
+	.send          = modbus_tcp_send,
+	.read_begin    = modbus_tcp_read_begin,
+	.read_data     = modbus_tcp_read_data,
+	.read_end      = modbus_tcp_read_end,
+	.transact      = modbus_tcp_transact,
+	.close         = modbus_tcp_close,
+	.free          = modbus_tcp_free,
+};
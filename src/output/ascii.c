@@ -36,6 +36,9 @@
  */
 #define DEFAULT_ASCII_CHARS ".\"\\/"
 
+/* Number of samples which get rendered per channel at a time. */
+#define CHUNK_SAMPLES 4096
+
 struct context {
 	size_t num_enabled_channels;
 	size_t spl;
@@ -46,11 +49,21 @@ struct context {
 	char **aligned_names;
 	size_t max_namelen;
 	char **line_values;
-	uint8_t *prev_sample;
 	gboolean header_done;
 	GString **lines;
 	const char *charset;
 	gboolean edges;
+	/* Samples of the current byte which were not rendered yet. */
+	uint8_t *sample_buf;
+	/* State of the last rendered sample, -1 at the start of a line. */
+	int *prev_bit;
+	/* One channel's states of a chunk of samples, one bit per sample. */
+	uint8_t *bits;
+	/*
+	 * Text for each byte of states, first sample in the LSB, indexed
+	 * by the byte and the state of the preceding sample in bit 8.
+	 */
+	char text[512][8];
 };
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -58,7 +71,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	struct context *ctx;
 	struct sr_channel *ch;
 	GSList *l;
-	size_t j, max_namelen, alloc_line_len;
+	size_t i, j, max_namelen, alloc_line_len;
+	unsigned int charidx, curr, prev;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
@@ -79,14 +93,27 @@ static int init(struct sr_output *o, GHashTable *options)
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
 			continue;
-		if (!ch->enabled)
+		if (!ch->enabled || sr_transform_logic_bit(o->sdi, ch) < 0)
 			continue;
 		ctx->num_enabled_channels++;
 	}
 	ctx->channel_index = g_malloc0(sizeof(ctx->channel_index[0]) * ctx->num_enabled_channels);
 	ctx->aligned_names = g_malloc0(sizeof(ctx->aligned_names[0]) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc0(sizeof(ctx->lines[0]) * ctx->num_enabled_channels);
-	ctx->prev_sample = g_malloc0(g_slist_length(o->sdi->channels));
+	ctx->sample_buf = g_malloc0(ctx->num_enabled_channels);
+	ctx->prev_bit = g_malloc(sizeof(ctx->prev_bit[0]) * ctx->num_enabled_channels);
+	ctx->bits = g_malloc(CHUNK_SAMPLES / 8);
+
+	for (i = 0; i < 512; i++) {
+		for (j = 0, prev = i >> 8; j < 8; j++) {
+			curr = (i >> j) & 1;
+			charidx = curr;
+			if (ctx->edges && curr != prev)
+				charidx += 2;
+			ctx->text[i][j] = ctx->charset[charidx];
+			prev = curr;
+		}
+	}
 
 	/* Get the maximum length across all active logic channels. */
 	max_namelen = 0;
@@ -94,7 +121,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
 			continue;
-		if (!ch->enabled)
+		if (!ch->enabled || sr_transform_logic_bit(o->sdi, ch) < 0)
 			continue;
 		max_namelen = MAX(max_namelen, strlen(ch->name));
 	}
@@ -106,14 +133,15 @@ static int init(struct sr_output *o, GHashTable *options)
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
 			continue;
-		if (!ch->enabled)
+		if (!ch->enabled || sr_transform_logic_bit(o->sdi, ch) < 0)
 			continue;
 
-		ctx->channel_index[j] = ch->index;
+		ctx->channel_index[j] = sr_transform_logic_bit(o->sdi, ch);
 		ctx->aligned_names[j] = g_strdup_printf("%*s", (int)max_namelen, ch->name);
 
 		ctx->lines[j] = g_string_sized_new(alloc_line_len);
 		g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
+		ctx->prev_bit[j] = -1;
 
 		j++;
 	}
@@ -121,11 +149,10 @@ static int init(struct sr_output *o, GHashTable *options)
 	return SR_OK;
 }
 
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *out)
 {
 	struct context *ctx;
 	GVariant *gvar;
-	GString *header;
 	size_t num_channels;
 	char *samplerate_s;
 
@@ -138,19 +165,16 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 
-	header = g_string_sized_new(512);
-	g_string_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
+	g_string_append_printf(out, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
 	num_channels = g_slist_length(o->sdi->channels);
-	g_string_append_printf(header, "Acquisition with %zu/%zu channels",
+	g_string_append_printf(out, "Acquisition with %zu/%zu channels",
 			ctx->num_enabled_channels, num_channels);
 	if (ctx->samplerate != 0) {
 		samplerate_s = sr_samplerate_string(ctx->samplerate);
-		g_string_append_printf(header, " at %s", samplerate_s);
+		g_string_append_printf(out, " at %s", samplerate_s);
 		g_free(samplerate_s);
 	}
-	g_string_append_printf(header, "\n");
-
-	return header;
+	g_string_append_printf(out, "\n");
 }
 
 static void maybe_add_trigger(struct context *ctx, GString *out)
@@ -172,23 +196,80 @@ static void maybe_add_trigger(struct context *ctx, GString *out)
 		offset + 1, "^", offset);
 }
 
-static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+/* Render a byte of a channel's states, first sample in the LSB. */
+static inline const char *byte_text(struct context *ctx, size_t j,
+		unsigned int byte, unsigned int count)
+{
+	unsigned int prev;
+
+	/* The first sample of a line never is an edge. */
+	prev = ctx->prev_bit[j] < 0 ? (byte & 1) : (unsigned int)ctx->prev_bit[j];
+	ctx->prev_bit[j] = (byte >> (count - 1)) & 1;
+
+	return ctx->text[prev << 8 | byte];
+}
+
+/*
+ * Add a chunk of a channel's states to its line. Complete bytes are
+ * rendered right away, the samples of a partial byte are kept in
+ * sample_buf.
+ */
+static void append_bits(struct context *ctx, size_t j,
+		const uint8_t *bits, size_t count)
+{
+	GString *line;
+	unsigned int acc, have;
+	size_t len;
+	char *p;
+
+	line = ctx->lines[j];
+	acc = ctx->sample_buf[j];
+	have = ctx->spl_cnt & 7;
+
+	len = line->len;
+	g_string_set_size(line, len + 8 * ((have + count) / 8));
+	p = line->str + len;
+
+	for (; count >= 8; count -= 8) {
+		acc |= *bits++ << have;
+		memcpy(p, byte_text(ctx, j, acc & 0xff, 8), 8);
+		p += 8;
+		acc >>= 8;
+	}
+	if (count) {
+		acc |= *bits << have;
+		if (have + count >= 8) {
+			memcpy(p, byte_text(ctx, j, acc & 0xff, 8), 8);
+			acc >>= 8;
+		}
+	}
+	ctx->sample_buf[j] = acc;
+}
+
+/* Render the samples of a partial byte. */
+static void append_partial(struct context *ctx, size_t j)
+{
+	unsigned int count;
+
+	count = ctx->spl_cnt & 7;
+	if (count)
+		g_string_append_len(ctx->lines[j],
+			byte_text(ctx, j, ctx->sample_buf[j], count), count);
+	ctx->sample_buf[j] = 0;
+}
+
+static int append(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString *out)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	size_t idx, i, j;
-	size_t num_samples;
-	const uint8_t *curr_sample;
-	size_t bytepos;
-	uint8_t bitmask, curbit, prevbit;
-	char c;
-	size_t charidx;
-
-	*out = NULL;
+	size_t i, j;
+	const uint8_t *data;
+	uint64_t num_samples, count;
+
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -209,57 +290,58 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			gen_header(o, out);
 			ctx->header_done = TRUE;
-		} else {
-			*out = g_string_sized_new(512);
 		}
 
 		logic = packet->payload;
+		if (!logic->unitsize)
+			break;
+		data = logic->data;
 		num_samples = logic->length / logic->unitsize;
-		curr_sample = logic->data;
-		while (num_samples--) {
-			ctx->spl_cnt++;
+		while (num_samples) {
+			/*
+			 * Extract chunks of each channel's states eight samples
+			 * at a time, and render them a byte at a time.
+			 */
+			count = MIN(num_samples, CHUNK_SAMPLES);
+			if (ctx->spl > 0)
+				count = MIN(count, ctx->spl - ctx->spl_cnt);
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				bytepos = idx / 8;
-				bitmask = 1U << (idx % 8);
-				curbit = curr_sample[bytepos] & bitmask;
-				prevbit = ctx->prev_sample[bytepos] & bitmask;
-
-				charidx = curbit ? 1 : 0;
-				if (ctx->edges && ctx->spl_cnt > 1) {
-					if (curbit != prevbit)
-						charidx += 2;
-				}
-				c = ctx->charset[charidx];
-				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j + 1 == ctx->num_enabled_channels)
-						maybe_add_trigger(ctx, *out);
+				if (sr_logic_channel_unpack(data, logic->unitsize,
+						count, ctx->channel_index[j],
+						ctx->bits) != SR_OK)
+					memset(ctx->bits, 0, (count + 7) / 8);
+				append_bits(ctx, j, ctx->bits, count);
+			}
+			ctx->spl_cnt += count;
+			data += count * logic->unitsize;
+			num_samples -= count;
+
+			if (ctx->spl_cnt == ctx->spl) {
+				/* Flush line buffers. */
+				for (j = 0; j < ctx->num_enabled_channels; j++) {
+					append_partial(ctx, j);
+					g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+					g_string_append_c(out, '\n');
 					g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
+					ctx->prev_bit[j] = -1;
 				}
-			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
+				if (ctx->num_enabled_channels)
+					maybe_add_trigger(ctx, out);
 				ctx->spl_cnt = 0;
-			memcpy(ctx->prev_sample, curr_sample, logic->unitsize);
-			curr_sample += logic->unitsize;
+			}
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
+				append_partial(ctx, i);
+				g_string_append_len(out, ctx->lines[i]->str, ctx->lines[i]->len);
+				g_string_append_c(out, '\n');
 			}
-			maybe_add_trigger(ctx, *out);
+			maybe_add_trigger(ctx, out);
 		}
 		break;
 	}
@@ -279,7 +361,9 @@ static int cleanup(struct sr_output *o)
 		return SR_OK;
 
 	g_free(ctx->channel_index);
-	g_free(ctx->prev_sample);
+	g_free(ctx->sample_buf);
+	g_free(ctx->prev_bit);
+	g_free(ctx->bits);
 	for (i = 0; i < ctx->num_enabled_channels; i++) {
 		g_free(ctx->aligned_names[i]);
 		g_string_free(ctx->lines[i], TRUE);
@@ -319,6 +403,6 @@ SR_PRIV struct sr_output_module output_ascii = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.append = append,
 	.cleanup = cleanup,
 };
@@ -65,6 +65,8 @@
 
 struct ctx_channel {
 	struct sr_channel *ch;
+	/* Position of a logic channel's bit in the samples. */
+	int bit;
 	char *label;
 	float min, max;
 };
@@ -95,10 +97,21 @@ struct context {
 	uint32_t channels_seen;
 	uint64_t sample_rate;
 	uint64_t sample_scale;
-	uint64_t out_sample_count;
 	uint8_t *previous_sample;
 	float *analog_samples;
 	uint8_t *logic_samples;
+	gboolean have_analog, have_logic;
+	size_t previous_size, analog_size, logic_size, fdata_size;
+	float *fdata;
+	size_t value_len;
+
+	/*
+	 * Timestamp of the next row as decimal digits, which are kept at the
+	 * end of the buffer. Stepping from row to row is done on the digits.
+	 */
+	char time_buf[24];
+	size_t time_pos;
+	uint64_t time_step, time_step_rem, time_rem;
 	const char *xlabel;	/* Don't free: will point to a static string. */
 	const char *title;	/* Don't free: will point into the driver struct. */
 
@@ -147,6 +160,9 @@ static int init(struct sr_output *o, GHashTable *options)
 		g_hash_table_lookup(options, "label"), NULL);
 	ctx->dedup = g_variant_get_boolean(g_hash_table_lookup(options, "dedup"));
 	ctx->dedup &= ctx->time;
+	ctx->value_len = strlen(ctx->value);
+	ctx->time_pos = sizeof(ctx->time_buf) - 1;
+	ctx->time_buf[ctx->time_pos] = '0';
 
 	if (*ctx->gnuplot && g_strcmp0(ctx->record, "\n"))
 		sr_warn("gnuplot record separator must be newline.");
@@ -170,7 +186,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		ch = l->data;
 		if (ch->type == SR_CHANNEL_LOGIC) {
 			ctx->logic_channel_count++;
-			if (ch->enabled)
+			if (ch->enabled && sr_transform_logic_bit(o->sdi, ch) >= 0)
 				logic_channels++;
 		}
 		if (ch->type == SR_CHANNEL_ANALOG && ch->enabled)
@@ -184,18 +200,22 @@ static int init(struct sr_output *o, GHashTable *options)
 		sr_info("Outputting %d logic values", logic_channels);
 		ctx->num_logic_channels = logic_channels;
 	}
-	ctx->channels = g_malloc(sizeof(struct ctx_channel)
+	ctx->channels = g_malloc0(sizeof(struct ctx_channel)
 		* (ctx->num_analog_channels + ctx->num_logic_channels));
 
 	/* Once more to map the enabled channels. */
 	ctx->channel_count = g_slist_length(o->sdi->channels);
 	for (i = 0, l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC
+				&& sr_transform_logic_bit(o->sdi, ch) < 0)
+			continue;
 		if (ch->enabled) {
 			if (ch->type == SR_CHANNEL_ANALOG) {
 				ctx->channels[i].min = FLT_MAX;
 				ctx->channels[i].max = FLT_MIN;
 			} else if (ch->type == SR_CHANNEL_LOGIC) {
+				ctx->channels[i].bit = sr_transform_logic_bit(o->sdi, ch);
 				ctx->channels[i].min = 0;
 				ctx->channels[i].max = 1;
 			} else {
@@ -215,37 +235,47 @@ static const char *xlabels[] = {
 	"femtoseconds", "attoseconds",
 };
 
-static GString *gen_header(const struct sr_output *o,
-			   const struct sr_datafeed_header *hdr)
+static void set_sample_rate(struct context *ctx, uint64_t sample_rate)
+{
+	unsigned int i;
+
+	ctx->sample_rate = sample_rate;
+	i = 0;
+	ctx->sample_scale = 1;
+	while (ctx->sample_scale < ctx->sample_rate) {
+		i++;
+		ctx->sample_scale *= 1000;
+	}
+	if (i < ARRAY_SIZE(xlabels))
+		ctx->xlabel = xlabels[i];
+	sr_info("Set sample rate, scale to %" PRIu64 ", %" PRIu64 " %s",
+		ctx->sample_rate, ctx->sample_scale, ctx->xlabel);
+
+	if (ctx->sample_rate) {
+		ctx->time_step = ctx->sample_scale / ctx->sample_rate;
+		ctx->time_step_rem = ctx->sample_scale % ctx->sample_rate;
+	}
+}
+
+static void gen_header(const struct sr_output *o,
+		       const struct sr_datafeed_header *hdr, GString *out)
 {
 	struct context *ctx;
-	struct sr_channel *ch;
 	GVariant *gvar;
-	GString *header;
-	GSList *channels, *l;
+	GSList *channels;
 	unsigned int num_channels, i;
+	uint64_t sample_rate;
 	char *samplerate_s;
 
 	ctx = o->priv;
-	header = g_string_sized_new(512);
-
 	if (ctx->sample_rate == 0) {
+		sample_rate = 0;
 		if (sr_config_get(o->sdi->driver, o->sdi, NULL,
 				  SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
-			ctx->sample_rate = g_variant_get_uint64(gvar);
+			sample_rate = g_variant_get_uint64(gvar);
 			g_variant_unref(gvar);
 		}
-
-		i = 0;
-		ctx->sample_scale = 1;
-		while (ctx->sample_scale < ctx->sample_rate) {
-			i++;
-			ctx->sample_scale *= 1000;
-		}
-		if (i < ARRAY_SIZE(xlabels))
-			ctx->xlabel = xlabels[i];
-		sr_info("Set sample rate, scale to %" PRIu64 ", %" PRIu64 " %s",
-			ctx->sample_rate, ctx->sample_scale, ctx->xlabel);
+		set_sample_rate(ctx, sample_rate);
 	}
 	ctx->title = (o->sdi && o->sdi->driver) ? o->sdi->driver->longname : "unknown";
 
@@ -254,7 +284,7 @@ static GString *gen_header(const struct sr_output *o,
 		/* save_gnuplot knows how many lines we print. */
 		time_t secs;
 		secs = hdr->starttime.tv_sec;
-		g_string_append_printf(header,
+		g_string_append_printf(out,
 			"%s CSV generated by %s %s\n%s from %s on %s",
 			ctx->comment, PACKAGE_NAME,
 			sr_package_version_string_get(), ctx->comment,
@@ -263,22 +293,19 @@ static GString *gen_header(const struct sr_output *o,
 		/* Columns / channels */
 		channels = o->sdi ? o->sdi->channels : NULL;
 		num_channels = g_slist_length(channels);
-		g_string_append_printf(header, "%s Channels (%d/%d):",
+		g_string_append_printf(out, "%s Channels (%d/%d):",
 			ctx->comment, ctx->num_analog_channels +
 			ctx->num_logic_channels, num_channels);
-		for (l = channels; l; l = l->next) {
-			ch = l->data;
-			if (ch->enabled)
-				g_string_append_printf(header, " %s,", ch->name);
-		}
+		for (i = 0; i < ctx->num_analog_channels + ctx->num_logic_channels; i++)
+			g_string_append_printf(out, " %s,", ctx->channels[i].ch->name);
 		if (channels) {
 			/* Drop last separator. */
-			g_string_truncate(header, header->len - 1);
+			g_string_truncate(out, out->len - 1);
 		}
-		g_string_append_printf(header, "\n");
+		g_string_append_printf(out, "\n");
 		if (ctx->sample_rate != 0) {
 			samplerate_s = sr_samplerate_string(ctx->sample_rate);
-			g_string_append_printf(header, "%s Samplerate: %s\n",
+			g_string_append_printf(out, "%s Samplerate: %s\n",
 					       ctx->comment, samplerate_s);
 			g_free(samplerate_s);
 		}
@@ -289,7 +316,17 @@ static GString *gen_header(const struct sr_output *o,
 	if (ctx->time && !ctx->sample_rate)
 		sr_warn("Samplerate unknown, cannot provide timestamps.");
 
-	return header;
+}
+
+/* Grow a working buffer if needed, its content need not be kept. */
+static void *reserve(void *buf, size_t *alloc_size, size_t size)
+{
+	if (size <= *alloc_size)
+		return buf;
+	g_free(buf);
+	*alloc_size = size;
+
+	return g_malloc(size);
 }
 
 /*
@@ -327,9 +364,11 @@ static void process_analog(struct context *ctx,
 	float *fdata = NULL;
 	struct sr_channel *ch;
 
-	if (!ctx->analog_samples) {
-		ctx->analog_samples = g_malloc(analog->num_samples
+	if (!ctx->have_analog) {
+		ctx->analog_samples = reserve(ctx->analog_samples,
+			&ctx->analog_size, analog->num_samples
 			* sizeof(float) * ctx->num_analog_channels);
+		ctx->have_analog = TRUE;
 		if (!ctx->num_samples)
 			ctx->num_samples = analog->num_samples;
 	}
@@ -341,7 +380,8 @@ static void process_analog(struct context *ctx,
 	num_rcvd_ch = g_slist_length(meaning->channels);
 	ctx->channels_seen += num_rcvd_ch;
 	sr_dbg("Processing packet of %zu analog channels", num_rcvd_ch);
-	fdata = g_malloc(analog->num_samples * num_rcvd_ch * sizeof(float));
+	fdata = ctx->fdata = reserve(ctx->fdata, &ctx->fdata_size,
+		analog->num_samples * num_rcvd_ch * sizeof(float));
 	if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK)
 		sr_warn("Problems converting data to floating point values.");
 
@@ -358,6 +398,7 @@ static void process_analog(struct context *ctx,
 			if (ctx->channels[idx_have].ch != ch)
 				continue;
 			if (ctx->label_do && !ctx->label_names) {
+				g_free(ctx->channels[idx_have].label);
 				sr_analog_unit_to_string(analog,
 					&ctx->channels[idx_have].label);
 			}
@@ -367,7 +408,6 @@ static void process_analog(struct context *ctx,
 		}
 		idx_send++;
 	}
-	g_free(fdata);
 }
 
 /*
@@ -384,8 +424,10 @@ static void process_logic(struct context *ctx,
 	num_samples = logic->length / logic->unitsize;
 	ctx->channels_seen += ctx->logic_channel_count;
 	sr_dbg("Logic packet had %d channels", logic->unitsize * 8);
-	if (!ctx->logic_samples) {
-		ctx->logic_samples = g_malloc(num_samples * ctx->num_logic_channels);
+	if (!ctx->have_logic) {
+		ctx->logic_samples = reserve(ctx->logic_samples,
+			&ctx->logic_size, num_samples * ctx->num_logic_channels);
+		ctx->have_logic = TRUE;
 		if (!ctx->num_samples)
 			ctx->num_samples = num_samples;
 	}
@@ -397,7 +439,7 @@ static void process_logic(struct context *ctx,
 		if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
 			for (i = 0; i < num_samples; i++) {
 				sample = logic->data + i * logic->unitsize;
-				idx = ctx->channels[j].ch->index;
+				idx = ctx->channels[j].bit;
 				if (ctx->label_do && !ctx->label_names)
 					ctx->channels[j].label = "logic";
 				ctx->logic_samples[i * ctx->num_logic_channels + ch] = sample[idx / 8] & (1 << (idx % 8));
@@ -407,51 +449,91 @@ static void process_logic(struct context *ctx,
 	}
 }
 
-static void dump_saved_values(struct context *ctx, GString **out)
+/* Add to the decimal digits of the timestamp. */
+static void time_add(struct context *ctx, uint64_t value)
+{
+	char *p;
+	unsigned int digit;
+
+	p = ctx->time_buf + sizeof(ctx->time_buf);
+	while (value) {
+		p--;
+		if (p < ctx->time_buf + ctx->time_pos) {
+			*p = '0';
+			ctx->time_pos--;
+		}
+		digit = *p - '0' + value % 10;
+		value /= 10;
+		if (digit >= 10) {
+			digit -= 10;
+			value++;
+		}
+		*p = '0' + digit;
+	}
+}
+
+/* Advance the timestamp by one sample period. */
+static void time_next(struct context *ctx)
 {
-	unsigned int i, j, analog_size, num_channels;
-	double sample_time_dbl;
-	uint64_t sample_time_u64;
+	uint64_t step;
+
+	step = ctx->time_step;
+	ctx->time_rem += ctx->time_step_rem;
+	if (ctx->time_rem >= ctx->sample_rate) {
+		ctx->time_rem -= ctx->sample_rate;
+		step++;
+	}
+	time_add(ctx, step);
+}
+
+static void dump_saved_values(struct context *ctx, GString *out)
+{
+	unsigned int i, j, idx_analog, idx_logic, analog_size, num_channels;
 	float *analog_sample, value;
 	uint8_t *logic_sample;
+	char buf[SR_FLOAT_STRING_SIZE];
+	int len;
 
 	/* If we haven't seen samples we're expecting, skip them. */
-	if ((ctx->num_analog_channels && !ctx->analog_samples) ||
-	    (ctx->num_logic_channels && !ctx->logic_samples)) {
+	if ((ctx->num_analog_channels && !ctx->have_analog) ||
+	    (ctx->num_logic_channels && !ctx->have_logic)) {
 		sr_warn("Discarding partial packet");
 	} else {
 		sr_info("Dumping %u samples", ctx->num_samples);
 
-		if (!*out)
-			*out = g_string_sized_new(512);
 		num_channels =
 		    ctx->num_logic_channels + ctx->num_analog_channels;
 
 		if (ctx->label_do) {
 			if (ctx->time)
-				g_string_append_printf(*out, "%s%s",
+				g_string_append_printf(out, "%s%s",
 					ctx->label_names ? "Time" : ctx->xlabel,
 					ctx->value);
 			for (i = 0; i < num_channels; i++) {
-				g_string_append_printf(*out, "%s%s",
+				g_string_append_printf(out, "%s%s",
 					ctx->channels[i].label, ctx->value);
+				/* Unit labels were allocated, names are borrowed. */
 				if (ctx->channels[i].ch->type == SR_CHANNEL_ANALOG
-						&& ctx->label_names)
+						&& !ctx->label_names) {
 					g_free(ctx->channels[i].label);
+					ctx->channels[i].label = NULL;
+				}
 			}
 			if (ctx->do_trigger)
-				g_string_append_printf(*out, "Trigger%s",
+				g_string_append_printf(out, "Trigger%s",
 						       ctx->value);
 			/* Drop last separator. */
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			g_string_truncate(out, out->len - 1);
+			g_string_append(out, ctx->record);
 
 			ctx->label_do = FALSE;
 		}
 
 		analog_size = ctx->num_analog_channels * sizeof(float);
-		if (ctx->dedup && !ctx->previous_sample)
-			ctx->previous_sample = g_malloc0(analog_size + ctx->num_logic_channels);
+		if (ctx->dedup)
+			ctx->previous_sample = reserve(ctx->previous_sample,
+				&ctx->previous_size,
+				analog_size + ctx->num_logic_channels);
 
 		for (i = 0; i < ctx->num_samples; i++) {
 			analog_sample =
@@ -476,53 +558,52 @@ static void dump_saved_values(struct context *ctx, GString **out)
 			}
 
 			if (ctx->time && !ctx->sample_rate) {
-				g_string_append_printf(*out, "0%s", ctx->value);
+				g_string_append_c(out, '0');
+				g_string_append_len(out, ctx->value, ctx->value_len);
 			} else if (ctx->time) {
-				sample_time_dbl = ctx->out_sample_count++;
-				sample_time_dbl /= ctx->sample_rate;
-				sample_time_dbl *= ctx->sample_scale;
-				sample_time_u64 = sample_time_dbl;
-				g_string_append_printf(*out, "%" PRIu64 "%s",
-					sample_time_u64, ctx->value);
+				g_string_append_len(out,
+					ctx->time_buf + ctx->time_pos,
+					sizeof(ctx->time_buf) - ctx->time_pos);
+				g_string_append_len(out, ctx->value, ctx->value_len);
+				time_next(ctx);
 			}
 
+			/* Samples are kept per type, in the order of the columns. */
+			idx_analog = idx_logic = 0;
 			for (j = 0; j < num_channels; j++) {
 				if (ctx->channels[j].ch->type == SR_CHANNEL_ANALOG) {
-					value = ctx->analog_samples[i * ctx->num_analog_channels + j];
+					value = analog_sample[idx_analog++];
 					ctx->channels[j].max =
 					    fmax(value, ctx->channels[j].max);
 					ctx->channels[j].min =
 					    fmin(value, ctx->channels[j].min);
-					g_string_append_printf(*out, "%g%s",
-						value, ctx->value);
+					len = sr_float_to_string(value, buf, sizeof(buf));
+					g_string_append_len(out, buf, len);
+					g_string_append_len(out, ctx->value, ctx->value_len);
 				} else if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-					g_string_append_printf(*out, "%c%s",
-							       ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0', ctx->value);
+					g_string_append_c(out, logic_sample[idx_logic++] ? '1' : '0');
+					g_string_append_len(out, ctx->value, ctx->value_len);
 				} else {
 					sr_warn("Unexpected channel type: %d",
-						ctx->channels[i].ch->type);
+						ctx->channels[j].ch->type);
 				}
 			}
 
 			if (ctx->do_trigger) {
-				g_string_append_printf(*out, "%d%s",
-					ctx->trigger, ctx->value);
+				g_string_append_c(out, ctx->trigger ? '1' : '0');
+				g_string_append_len(out, ctx->value, ctx->value_len);
 				ctx->trigger = FALSE;
 			}
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			g_string_truncate(out, out->len - 1);
+			g_string_append(out, ctx->record);
 		}
 	}
 
-	/* Discard all of the working space. */
-	g_free(ctx->previous_sample);
-	g_free(ctx->analog_samples);
-	g_free(ctx->logic_samples);
+	/* Discard the saved values, keep the working space. */
 	ctx->channels_seen = 0;
 	ctx->num_samples = 0;
-	ctx->previous_sample = NULL;
-	ctx->analog_samples = NULL;
-	ctx->logic_samples = NULL;
+	ctx->have_analog = FALSE;
+	ctx->have_logic = FALSE;
 }
 
 static void save_gnuplot(struct context *ctx)
@@ -656,14 +737,16 @@ static void check_input_constraints(struct context *ctx)
 	sr_warn("Resulting CSV output data may be incomplete or incorrect.");
 }
 
-static int receive(const struct sr_output *o,
-		   const struct sr_datafeed_packet *packet, GString **out)
+static int append(const struct sr_output *o,
+		   const struct sr_datafeed_packet *packet, GString *out)
 {
 	struct context *ctx;
+	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_config *src;
+	GSList *l;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -671,17 +754,25 @@ static int receive(const struct sr_output *o,
 
 	sr_dbg("Got packet of type %d", packet->type);
 	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			set_sample_rate(ctx, g_variant_get_uint64(src->data));
+		}
+		break;
 	case SR_DF_HEADER:
 		ctx->have_checked = FALSE;
 		ctx->have_frames = FALSE;
 		ctx->pkt_snums = FALSE;
-		*out = gen_header(o, packet->payload);
+		gen_header(o, packet->payload, out);
 		break;
 	case SR_DF_TRIGGER:
 		ctx->trigger = TRUE;
 		break;
 	case SR_DF_LOGIC:
-		*out = g_string_sized_new(512);
 		logic = packet->payload;
 		ctx->pkt_snums = logic->length;
 		ctx->pkt_snums /= logic->length;
@@ -689,7 +780,6 @@ static int receive(const struct sr_output *o,
 		process_logic(ctx, logic);
 		break;
 	case SR_DF_ANALOG:
-		*out = g_string_sized_new(512);
 		analog = packet->payload;
 		ctx->pkt_snums = analog->num_samples;
 		ctx->pkt_snums /= g_slist_length(analog->meaning->channels);
@@ -698,7 +788,7 @@ static int receive(const struct sr_output *o,
 		break;
 	case SR_DF_FRAME_BEGIN:
 		ctx->have_frames = TRUE;
-		*out = g_string_new(ctx->frame);
+		g_string_append(out, ctx->frame);
 		/* Fallthrough */
 	case SR_DF_END:
 		/* Got to end of frame/session with part of the data. */
@@ -719,18 +809,28 @@ static int receive(const struct sr_output *o,
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
+	unsigned int i, num_channels;
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 
 	if (o->priv) {
 		ctx = o->priv;
+		num_channels = ctx->num_analog_channels + ctx->num_logic_channels;
+		for (i = 0; i < num_channels; i++) {
+			if (ctx->channels[i].ch->type == SR_CHANNEL_ANALOG
+					&& !ctx->label_names)
+				g_free(ctx->channels[i].label);
+		}
 		g_free((gpointer)ctx->record);
 		g_free((gpointer)ctx->frame);
 		g_free((gpointer)ctx->comment);
 		g_free((gpointer)ctx->gnuplot);
 		g_free((gpointer)ctx->value);
 		g_free(ctx->previous_sample);
+		g_free(ctx->analog_samples);
+		g_free(ctx->logic_samples);
+		g_free(ctx->fdata);
 		g_free(ctx->channels);
 		g_free(o->priv);
 		o->priv = NULL;
@@ -787,6 +887,6 @@ SR_PRIV struct sr_output_module output_csv = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.append = append,
 	.cleanup = cleanup,
 };
@@ -28,6 +28,9 @@
 
 #define DEFAULT_SAMPLES_PER_LINE 192
 
+/* Number of samples which get rendered per channel at a time. */
+#define CHUNK_SAMPLES 4096
+
 struct context {
 	unsigned int num_enabled_channels;
 	int spl;
@@ -41,6 +44,10 @@ struct context {
 	uint8_t *sample_buf;
 	gboolean header_done;
 	GString **lines;
+	/* One channel's states of a chunk of samples, one bit per sample. */
+	uint8_t *bits;
+	/* Text for each byte of states, first sample in the LSB. */
+	char text[256][3];
 };
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -49,6 +56,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	struct sr_channel *ch;
 	GSList *l;
 	unsigned int i, j;
+	uint8_t b;
+	static const char hexdigits[] = "0123456789abcdef";
 
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
@@ -62,7 +71,7 @@ static int init(struct sr_output *o, GHashTable *options)
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
 			continue;
-		if (!ch->enabled)
+		if (!ch->enabled || sr_transform_logic_bit(o->sdi, ch) < 0)
 			continue;
 		ctx->num_enabled_channels++;
 	}
@@ -70,15 +79,27 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
 	ctx->sample_buf = g_malloc(ctx->num_enabled_channels);
+	ctx->bits = g_malloc(CHUNK_SAMPLES / 8);
+
+	/* Hex digits show the first sample in the MSB. */
+	for (i = 0; i < 256; i++) {
+		b = i;
+		b = (b & 0xf0) >> 4 | (b & 0x0f) << 4;
+		b = (b & 0xcc) >> 2 | (b & 0x33) << 2;
+		b = (b & 0xaa) >> 1 | (b & 0x55) << 1;
+		ctx->text[i][0] = hexdigits[b >> 4];
+		ctx->text[i][1] = hexdigits[b & 0x0f];
+		ctx->text[i][2] = ' ';
+	}
 
 	j = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
 		ch = l->data;
 		if (ch->type != SR_CHANNEL_LOGIC)
 			continue;
-		if (!ch->enabled)
+		if (!ch->enabled || sr_transform_logic_bit(o->sdi, ch) < 0)
 			continue;
-		ctx->channel_index[j] = ch->index;
+		ctx->channel_index[j] = sr_transform_logic_bit(o->sdi, ch);
 		ctx->channel_names[j] = ch->name;
 		ctx->lines[j] = g_string_sized_new(80);
 		ctx->sample_buf[j] = 0;
@@ -89,11 +110,10 @@ static int init(struct sr_output *o, GHashTable *options)
 	return SR_OK;
 }
 
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *out)
 {
 	struct context *ctx;
 	GVariant *gvar;
-	GString *header;
 	int num_channels;
 	char *samplerate_s;
 
@@ -106,34 +126,89 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 
-	header = g_string_sized_new(512);
-	g_string_printf(header, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
+	g_string_append_printf(out, "%s %s\n", PACKAGE_NAME, sr_package_version_string_get());
 	num_channels = g_slist_length(o->sdi->channels);
-	g_string_append_printf(header, "Acquisition with %d/%d channels",
+	g_string_append_printf(out, "Acquisition with %d/%d channels",
 			ctx->num_enabled_channels, num_channels);
 	if (ctx->samplerate != 0) {
 		samplerate_s = sr_samplerate_string(ctx->samplerate);
-		g_string_append_printf(header, " at %s", samplerate_s);
+		g_string_append_printf(out, " at %s", samplerate_s);
 		g_free(samplerate_s);
 	}
-	g_string_append_printf(header, "\n");
+	g_string_append_printf(out, "\n");
+}
+
+/*
+ * Add a chunk of a channel's states to its line. Complete bytes are
+ * rendered right away, a partial byte is kept in sample_buf.
+ */
+static void append_bits(struct context *ctx, unsigned int j,
+		const uint8_t *bits, size_t count)
+{
+	GString *line;
+	unsigned int acc, have;
+	size_t len;
+	char *p;
+
+	line = ctx->lines[j];
+	acc = ctx->sample_buf[j];
+	have = ctx->spl_cnt & 7;
+
+	len = line->len;
+	g_string_set_size(line, len + 3 * ((have + count) / 8));
+	p = line->str + len;
+
+	for (; count >= 8; count -= 8) {
+		acc |= *bits++ << have;
+		memcpy(p, ctx->text[acc & 0xff], 3);
+		p += 3;
+		acc >>= 8;
+	}
+	if (count) {
+		acc |= *bits << have;
+		if (have + count >= 8) {
+			memcpy(p, ctx->text[acc & 0xff], 3);
+			acc >>= 8;
+		}
+	}
+	ctx->sample_buf[j] = acc;
+}
 
-	return header;
+static void flush_lines(struct context *ctx, GString *out)
+{
+	unsigned int j;
+	int offset;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+		g_string_append_c(out, '\n');
+		g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
+		ctx->sample_buf[j] = 0;
+	}
+	if (ctx->num_enabled_channels && ctx->trigger > -1) {
+		/*
+		 * Sample data lines have one character per nibble,
+		 * plus one separator per byte. Align trigger marker
+		 * to this layout.
+		 */
+		offset = ctx->trigger / 4 + ctx->trigger / 8;
+		g_string_append_printf(out, "T:%*s^ %d\n", offset, "", ctx->trigger);
+		ctx->trigger = -1;
+	}
 }
 
-static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+static int append(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString *out)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	int idx, pos, offset;
-	uint64_t i, j;
-	gchar *p;
+	const uint8_t *data;
+	uint64_t num_samples, count;
+	unsigned int i, j;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
@@ -154,60 +229,49 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			gen_header(o, out);
 			ctx->header_done = TRUE;
-		} else
-			*out = g_string_sized_new(512);
+		}
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
-			pos = ctx->spl_cnt & 7;
+		if (!logic->unitsize)
+			break;
+		data = logic->data;
+		num_samples = logic->length / logic->unitsize;
+		while (num_samples) {
+			/*
+			 * Extract chunks of each channel's states eight samples
+			 * at a time, and render them a byte at a time.
+			 */
+			count = MIN(num_samples, CHUNK_SAMPLES);
+			if (ctx->spl > 0)
+				count = MIN(count, (uint64_t)(ctx->spl - ctx->spl_cnt));
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				ctx->sample_buf[j] <<= 1;
-				if (*p & (1 << (idx % 8)))
-					ctx->sample_buf[j] |= 1;
-				if (ctx->spl_cnt && pos == 0) {
-					/* Buffered a byte's worth, output hex. */
-					g_string_append_printf(ctx->lines[j], "%.2x ",
-							ctx->sample_buf[j]);
-					ctx->sample_buf[j] = 0;
-				}
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per nibble,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger / 4 + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				}
+				if (sr_logic_channel_unpack(data, logic->unitsize,
+						count, ctx->channel_index[j],
+						ctx->bits) != SR_OK)
+					memset(ctx->bits, 0, (count + 7) / 8);
+				append_bits(ctx, j, ctx->bits, count);
 			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
+			ctx->spl_cnt += count;
+			data += count * logic->unitsize;
+			num_samples -= count;
+
+			if (ctx->spl_cnt == ctx->spl) {
+				flush_lines(ctx, out);
 				ctx->spl_cnt = 0;
+			}
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
 				if (ctx->spl_cnt & 7)
-					g_string_append_printf(ctx->lines[i], "%.2x ",
-							ctx->sample_buf[i] << (8 - (ctx->spl_cnt & 7)));
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
+					g_string_append_len(ctx->lines[i],
+						ctx->text[ctx->sample_buf[i]], 3);
+				g_string_append_len(out, ctx->lines[i]->str, ctx->lines[i]->len);
+				g_string_append_c(out, '\n');
 			}
 		}
 		break;
@@ -229,6 +293,7 @@ static int cleanup(struct sr_output *o)
 
 	g_free(ctx->channel_index);
 	g_free(ctx->sample_buf);
+	g_free(ctx->bits);
 	g_free(ctx->channel_names);
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
@@ -262,6 +327,6 @@ SR_PRIV struct sr_output_module output_hex = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.append = append,
 	.cleanup = cleanup,
 };
@@ -48,6 +48,9 @@
  *
  * Output modules generate a newly allocated GString. The caller is then
  * expected to free this with g_string_free() when finished with it.
+ * Alternatively, the caller can pass an output sink, which the modules'
+ * output gets appended to, or written to a file from, without allocating
+ * new memory for every packet. See sr_output_send_to_sink().
  *
  * @{
  */
@@ -336,7 +339,19 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	int ret;
+
+	if (o->module->receive)
+		return o->module->receive(o, packet, out);
+
+	*out = g_string_sized_new(512);
+	ret = o->module->append(o, packet, *out);
+	if (ret != SR_OK || !(*out)->len) {
+		g_string_free(*out, TRUE);
+		*out = NULL;
+	}
+
+	return ret;
 }
 
 /**
@@ -0,0 +1,541 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "output"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Output sinks, which receive the output of output modules.
+ */
+
+/**
+ * @addtogroup grp_output
+ *
+ * @{
+ */
+
+/* Buffered output gets written out in chunks of at least this size. */
+#define CHUNK_SIZE (256 * 1024)
+/* Maximum number of chunks which get written in one go. */
+#define MAX_CHUNKS 16
+/* Size of the window into a file which is mapped at a time. */
+#define MAP_SIZE (64 * 1024 * 1024)
+
+enum sink_type {
+	SINK_BUFFER,
+	SINK_FD,
+	SINK_FILE,
+};
+
+struct sr_output_sink {
+	enum sink_type type;
+	/* Output modules append their output to this buffer. */
+	GString *buf;
+	int fd;
+	/* Full chunks waiting to be written, and written chunks for reuse. */
+	GString *chunks[MAX_CHUNKS];
+	size_t num_chunks;
+	GString *spare[MAX_CHUNKS];
+	size_t num_spare;
+	/* Currently mapped window of a file sink. */
+	uint8_t *map;
+	uint64_t map_offset;
+	size_t map_pos;
+};
+
+static struct sr_output_sink *sink_new(enum sink_type type)
+{
+	struct sr_output_sink *sink;
+
+	sink = g_malloc0(sizeof(*sink));
+	sink->type = type;
+	sink->fd = -1;
+	sink->buf = g_string_sized_new(type == SINK_BUFFER ? 512 : CHUNK_SIZE);
+
+	return sink;
+}
+
+static GString *fd_get_chunk(struct sr_output_sink *sink)
+{
+	if (sink->num_spare)
+		return sink->spare[--sink->num_spare];
+
+	return g_string_sized_new(CHUNK_SIZE);
+}
+
+static void fd_put_chunk(struct sr_output_sink *sink, GString *chunk)
+{
+	/* Don't hold on to excessive amounts of memory. */
+	if (sink->num_spare == MAX_CHUNKS || chunk->allocated_len > 4 * CHUNK_SIZE) {
+		g_string_free(chunk, TRUE);
+		return;
+	}
+	g_string_truncate(chunk, 0);
+	sink->spare[sink->num_spare++] = chunk;
+}
+
+static int fd_write_chunks(struct sr_output_sink *sink)
+{
+	size_t i, first;
+	ssize_t written;
+	int ret;
+#ifdef HAVE_SYS_UIO_H
+	struct iovec iov[MAX_CHUNKS];
+
+	for (i = 0; i < sink->num_chunks; i++) {
+		iov[i].iov_base = sink->chunks[i]->str;
+		iov[i].iov_len = sink->chunks[i]->len;
+	}
+
+	ret = SR_OK;
+	first = 0;
+	while (first < sink->num_chunks) {
+		written = writev(sink->fd, &iov[first], sink->num_chunks - first);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written < 0) {
+			sr_err("Cannot write output: %s.", g_strerror(errno));
+			ret = SR_ERR_IO;
+			break;
+		}
+		while (first < sink->num_chunks &&
+				(size_t)written >= iov[first].iov_len) {
+			written -= iov[first].iov_len;
+			first++;
+		}
+		if (first < sink->num_chunks) {
+			iov[first].iov_base = (char *)iov[first].iov_base + written;
+			iov[first].iov_len -= written;
+		}
+	}
+#else
+	const char *data;
+	size_t len;
+
+	ret = SR_OK;
+	for (first = 0; ret == SR_OK && first < sink->num_chunks; first++) {
+		data = sink->chunks[first]->str;
+		len = sink->chunks[first]->len;
+		while (len) {
+			written = write(sink->fd, data, len);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written < 0) {
+				sr_err("Cannot write output: %s.", g_strerror(errno));
+				ret = SR_ERR_IO;
+				break;
+			}
+			data += written;
+			len -= written;
+		}
+	}
+#endif
+
+	for (i = 0; i < sink->num_chunks; i++)
+		fd_put_chunk(sink, sink->chunks[i]);
+	sink->num_chunks = 0;
+
+	return ret;
+}
+
+/* Queue a chunk of output, write queued chunks when the queue is full. */
+static int fd_queue_chunk(struct sr_output_sink *sink, GString *chunk)
+{
+	int ret;
+
+	ret = SR_OK;
+	if (sink->num_chunks == MAX_CHUNKS)
+		ret = fd_write_chunks(sink);
+	sink->chunks[sink->num_chunks++] = chunk;
+
+	return ret;
+}
+
+static int fd_commit(struct sr_output_sink *sink, gboolean flush)
+{
+	int ret;
+
+	ret = SR_OK;
+	if (sink->buf->len >= CHUNK_SIZE || (flush && sink->buf->len)) {
+		ret = fd_queue_chunk(sink, sink->buf);
+		sink->buf = fd_get_chunk(sink);
+	}
+	if (ret == SR_OK && sink->num_chunks &&
+			(flush || sink->num_chunks == MAX_CHUNKS))
+		ret = fd_write_chunks(sink);
+
+	return ret;
+}
+
+#ifdef HAVE_SYS_MMAN_H
+/* Map the next window of the file, and grow the file accordingly. */
+static int file_advance_map(struct sr_output_sink *sink)
+{
+	void *map;
+
+	if (sink->map) {
+		munmap(sink->map, MAP_SIZE);
+		sink->map = NULL;
+		sink->map_offset += MAP_SIZE;
+	}
+	sink->map_pos = 0;
+
+	if (ftruncate(sink->fd, sink->map_offset + MAP_SIZE) < 0) {
+		sr_err("Cannot grow output file: %s.", g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	map = mmap(NULL, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+		sink->fd, sink->map_offset);
+	if (map == MAP_FAILED) {
+		sr_err("Cannot map output file: %s.", g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	sink->map = map;
+
+	return SR_OK;
+}
+
+static int file_write(struct sr_output_sink *sink,
+		const char *data, size_t len)
+{
+	size_t count;
+	int ret;
+
+	while (len) {
+		if (!sink->map || sink->map_pos == MAP_SIZE) {
+			if ((ret = file_advance_map(sink)) != SR_OK)
+				return ret;
+		}
+		count = MIN(len, MAP_SIZE - sink->map_pos);
+		memcpy(sink->map + sink->map_pos, data, count);
+		sink->map_pos += count;
+		data += count;
+		len -= count;
+	}
+
+	return SR_OK;
+}
+
+static int file_close(struct sr_output_sink *sink)
+{
+	int ret;
+
+	ret = SR_OK;
+	if (sink->map)
+		munmap(sink->map, MAP_SIZE);
+	if (ftruncate(sink->fd, sink->map_offset + sink->map_pos) < 0) {
+		sr_err("Cannot truncate output file: %s.", g_strerror(errno));
+		ret = SR_ERR_IO;
+	}
+	close(sink->fd);
+
+	return ret;
+}
+#endif
+
+/* Pass on output which was appended to the sink's buffer. */
+static int sink_commit(struct sr_output_sink *sink, gboolean flush)
+{
+	int ret;
+
+	switch (sink->type) {
+	case SINK_FD:
+		return fd_commit(sink, flush);
+	case SINK_FILE:
+#ifdef HAVE_SYS_MMAN_H
+		ret = file_write(sink, sink->buf->str, sink->buf->len);
+		g_string_truncate(sink->buf, 0);
+		return ret;
+#else
+		(void)ret;
+		return SR_ERR_NA;
+#endif
+	default:
+		return SR_OK;
+	}
+}
+
+/* Pass on output which an output module returned in a GString. */
+static int sink_take(struct sr_output_sink *sink, GString *out)
+{
+	int ret;
+
+	ret = SR_OK;
+	switch (sink->type) {
+	case SINK_FD:
+		/* Write the module's GString as is, keep it for reuse. */
+		if (sink->buf->len) {
+			ret = fd_queue_chunk(sink, sink->buf);
+			sink->buf = fd_get_chunk(sink);
+		}
+		if (ret == SR_OK)
+			ret = fd_queue_chunk(sink, out);
+		else
+			g_string_free(out, TRUE);
+		return ret;
+	case SINK_FILE:
+#ifdef HAVE_SYS_MMAN_H
+		ret = file_write(sink, out->str, out->len);
+#else
+		ret = SR_ERR_NA;
+#endif
+		break;
+	default:
+		g_string_append_len(sink->buf, out->str, out->len);
+		break;
+	}
+	g_string_free(out, TRUE);
+
+	return ret;
+}
+
+/**
+ * Create an output sink which collects output in a memory buffer.
+ *
+ * The buffer is reused for all packets. The caller retrieves output from
+ * it with sr_output_sink_buffer(), and is expected to consume the output
+ * and truncate the buffer regularly.
+ *
+ * @param[out] sink The new sink. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_new_buffer(struct sr_output_sink **sink)
+{
+	if (!sink)
+		return SR_ERR_ARG;
+
+	*sink = sink_new(SINK_BUFFER);
+
+	return SR_OK;
+}
+
+/**
+ * Create an output sink which writes output to a file descriptor.
+ *
+ * Output is collected in a small number of reused buffers, and written
+ * with a single system call when enough output was collected.
+ *
+ * @param fd The file descriptor to write to. The caller keeps ownership,
+ *           and closes it after sr_output_sink_free().
+ * @param[out] sink The new sink. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_new_fd(int fd, struct sr_output_sink **sink)
+{
+	if (fd < 0 || !sink)
+		return SR_ERR_ARG;
+
+	*sink = sink_new(SINK_FD);
+	(*sink)->fd = fd;
+
+	return SR_OK;
+}
+
+/**
+ * Create an output sink which writes output to a memory mapped file.
+ *
+ * The file is created, or truncated if it exists. It is grown and mapped
+ * in large steps while output is written, and truncated to the size of
+ * the output by sr_output_sink_free().
+ *
+ * @param filename The name of the file to write to. Must not be NULL.
+ * @param[out] sink The new sink. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO The file cannot be created.
+ * @retval SR_ERR_NA Memory mapped files are not supported on this platform.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_new_file(const char *filename,
+		struct sr_output_sink **sink)
+{
+#ifdef HAVE_SYS_MMAN_H
+	int fd;
+
+	if (!filename || !sink)
+		return SR_ERR_ARG;
+
+	fd = g_open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		sr_err("Cannot create '%s': %s.", filename, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+
+	*sink = sink_new(SINK_FILE);
+	(*sink)->fd = fd;
+
+	return SR_OK;
+#else
+	(void)filename;
+	(void)sink;
+
+	return SR_ERR_NA;
+#endif
+}
+
+/**
+ * Get the buffer which a memory buffer sink collects output in.
+ *
+ * The caller may consume the output, and remove it from the buffer, for
+ * example with g_string_truncate(), at any time between calls to
+ * sr_output_send_to_sink(). The buffer remains owned by the sink.
+ *
+ * @param sink The sink to use. Must not be NULL.
+ *
+ * @return The sink's buffer, or NULL if the sink is not a memory buffer
+ *         sink.
+ *
+ * @since 0.6.0
+ */
+SR_API GString *sr_output_sink_buffer(struct sr_output_sink *sink)
+{
+	if (!sink || sink->type != SINK_BUFFER)
+		return NULL;
+
+	return sink->buf;
+}
+
+/**
+ * Send a packet to the specified output instance, and pass the output on
+ * to a sink.
+ *
+ * Output modules which support it append their output to the sink's
+ * buffers directly. The output of other modules is passed on without
+ * copying where possible.
+ *
+ * @param o The output instance to use. Must not be NULL.
+ * @param packet The packet to send. Must not be NULL.
+ * @param sink The sink which receives the output. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error code of the output module or the sink.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_to_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	GString *out;
+	int ret;
+
+	if (!o || !packet || !sink)
+		return SR_ERR_ARG;
+
+	if (o->module->append) {
+		ret = o->module->append(o, packet, sink->buf);
+		if (ret != SR_OK)
+			return ret;
+		return sink_commit(sink, FALSE);
+	}
+
+	out = NULL;
+	ret = o->module->receive(o, packet, &out);
+	if (out && out->len)
+		return sink_take(sink, out);
+	if (out)
+		g_string_free(out, TRUE);
+
+	return ret;
+}
+
+/**
+ * Write all output which a sink holds back.
+ *
+ * @param sink The sink to flush. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_IO Output could not be written.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_flush(struct sr_output_sink *sink)
+{
+	if (!sink)
+		return SR_ERR_ARG;
+
+	return sink_commit(sink, TRUE);
+}
+
+/**
+ * Flush and free an output sink.
+ *
+ * @param sink The sink to free. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO Output could not be written.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_free(struct sr_output_sink *sink)
+{
+	size_t i;
+	int ret;
+
+	if (!sink)
+		return SR_OK;
+
+	ret = sink_commit(sink, TRUE);
+#ifdef HAVE_SYS_MMAN_H
+	if (sink->type == SINK_FILE && file_close(sink) != SR_OK)
+		ret = SR_ERR_IO;
+#endif
+
+	for (i = 0; i < sink->num_chunks; i++)
+		g_string_free(sink->chunks[i], TRUE);
+	for (i = 0; i < sink->num_spare; i++)
+		g_string_free(sink->spare[i], TRUE);
+	g_string_free(sink->buf, TRUE);
+	g_free(sink);
+
+	return ret;
+}
+
+/** @} */
@@ -85,6 +85,7 @@ static int zip_create(const struct sr_output *o)
 	guint logic_channels, enabled_logic_channels;
 	guint enabled_analog_channels;
 	guint index;
+	int bit;
 
 	outc = o->priv;
 
@@ -126,9 +127,16 @@ static int zip_create(const struct sr_output *o)
 
 		switch (ch->type) {
 		case SR_CHANNEL_LOGIC:
+			/*
+			 * Transforms may have moved the channels' bits, the
+			 * probes are numbered after the bits in the samples.
+			 */
+			bit = sr_transform_logic_bit(o->sdi, ch);
+			if (bit < 0)
+				break;
 			if (ch->enabled)
 				enabled_logic_channels++;
-			logic_channels++;
+			logic_channels = MAX(logic_channels, (guint)bit + 1);
 			break;
 		case SR_CHANNEL_ANALOG:
 			if (ch->enabled)
@@ -170,7 +178,10 @@ static int zip_create(const struct sr_output *o)
 		s = NULL;
 		switch (ch->type) {
 		case SR_CHANNEL_LOGIC:
-			ch_nr = ch->index + 1;
+			bit = sr_transform_logic_bit(o->sdi, ch);
+			if (bit < 0)
+				break;
+			ch_nr = bit + 1;
 			s = g_strdup_printf("probe%zu", ch_nr);
 			break;
 		case SR_CHANNEL_ANALOG:
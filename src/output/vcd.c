@@ -40,7 +40,6 @@
 #define LOG_PREFIX "output/vcd"
 
 static const int with_queue_stats = 0;
-static const int with_pool_stats = 0;
 
 struct vcd_channel_desc {
 	size_t index;
@@ -67,12 +66,18 @@ struct context {
 	uint64_t period;
 	struct vcd_channel_desc *channels;
 	uint64_t samplerate;
-	GSList *free_list, *used_list;
-	size_t alloced, freed, reused, pooled;
-	GList *vcd_queue_list;
-	GList *vcd_queue_last;
+	GPtrArray *queue_heap;
+	GHashTable *queue_index;
+	struct vcd_queue_item *queue_last;
+	GPtrArray *queue_pool;
 	gboolean immediate_write;
-	uint8_t *last_logic;
+	/* Logic data as 64bit words, for change detection. */
+	size_t logic_words;
+	uint64_t *last_logic;
+	uint64_t *logic_diff;
+	uint64_t *logic_mask;
+	struct vcd_channel_desc **logic_desc;
+	size_t logic_desc_count;
 };
 
 /*
@@ -222,6 +227,8 @@ static int init(struct sr_output *o, GHashTable *options)
 		if (!ch->enabled)
 			continue;
 		if (ch->type == SR_CHANNEL_LOGIC) {
+			if (sr_transform_logic_bit(o->sdi, ch) < 0)
+				continue;
 			num_logic++;
 		} else if (ch->type == SR_CHANNEL_ANALOG) {
 			num_analog++;
@@ -246,15 +253,22 @@ static int init(struct sr_output *o, GHashTable *options)
 
 	/*
 	 * Reiterate input descriptions, to fill in output descriptions.
-	 * Map channel indices, and assign symbols to VCD channels.
+	 * Map channel indices, and assign symbols to VCD channels. Logic
+	 * channels map to their bits in the samples, which transforms may
+	 * have moved.
 	 */
 	desc_idx = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (!ch->enabled)
 			continue;
+		if (ch->type == SR_CHANNEL_LOGIC
+				&& sr_transform_logic_bit(o->sdi, ch) < 0)
+			continue;
 		desc = &ctx->channels[desc_idx];
 		desc->index = ch->index;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			desc->index = sr_transform_logic_bit(o->sdi, ch);
 		desc->name = vcd_identifier(desc_idx);
 		desc->type = ch->type;
 		/*
@@ -288,15 +302,28 @@ static int init(struct sr_output *o, GHashTable *options)
 		ctx->immediate_write = TRUE;
 
 	/*
-	 * Keep a copy of the last logic data bitmap around. To avoid
-	 * iterating over individual bits when nothing in the set has
-	 * changed. The overhead of two byte array compares should
-	 * outweight the tenfold bit count compared to byte counts.
+	 * Map logic data bit positions to channel descriptions. The mask
+	 * of enabled channels gets allocated when the unit size of logic
+	 * data is known.
 	 */
-	alloc_size = (ctx->logic_count + 7) / 8;
-	ctx->last_logic = g_malloc0(alloc_size);
-	if (ctx->logic_count && !ctx->last_logic)
-		return SR_ERR_MALLOC;
+	for (desc_idx = 0; desc_idx < ctx->enabled_count; desc_idx++) {
+		desc = &ctx->channels[desc_idx];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		if (ctx->logic_desc_count <= desc->index)
+			ctx->logic_desc_count = desc->index + 1;
+	}
+	ctx->logic_desc = g_malloc0(sizeof(ctx->logic_desc[0]) * ctx->logic_desc_count);
+	for (desc_idx = 0; desc_idx < ctx->enabled_count; desc_idx++) {
+		desc = &ctx->channels[desc_idx];
+		if (desc->type != SR_CHANNEL_LOGIC)
+			continue;
+		ctx->logic_desc[desc->index] = desc;
+	}
+
+	ctx->queue_heap = g_ptr_array_new();
+	ctx->queue_index = g_hash_table_new(g_int64_hash, g_int64_equal);
+	ctx->queue_pool = g_ptr_array_new();
 
 	return SR_OK;
 }
@@ -334,12 +361,11 @@ static uint64_t get_timescale_freq(uint64_t samplerate)
 }
 
 /* Emit a VCD file header. */
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *out)
 {
 	struct context *ctx;
 	struct sr_channel *ch;
 	GVariant *gvar;
-	GString *header;
 	GSList *l;
 	time_t t;
 	size_t num_channels, i;
@@ -370,25 +396,27 @@ static GString *gen_header(const struct sr_output *o)
 	frequency_s = sr_period_string(1, ctx->period);
 
 	/* Construct the VCD output file header. */
-	header = g_string_sized_new(512);
-	g_string_printf(header, "$date %s $end\n", timestamp);
-	g_string_append_printf(header, "$version %s %s $end\n",
+	g_string_append_printf(out, "$date %s $end\n", timestamp);
+	g_string_append_printf(out, "$version %s %s $end\n",
 		PACKAGE_NAME, sr_package_version_string_get());
-	g_string_append_printf(header, "$comment\n");
-	g_string_append_printf(header,
+	g_string_append_printf(out, "$comment\n");
+	g_string_append_printf(out,
 		"  Acquisition with %zu/%zu channels%s%s\n",
 		ctx->enabled_count, num_channels,
 		samplerate_s ? " at " : "", samplerate_s ? : "");
-	g_string_append_printf(header, "$end\n");
-	g_string_append_printf(header, "$timescale %s $end\n", frequency_s);
+	g_string_append_printf(out, "$end\n");
+	g_string_append_printf(out, "$timescale %s $end\n", frequency_s);
 
 	/* List generated VCD signals within a scope. */
-	g_string_append_printf(header, "$scope module %s $end\n", PACKAGE_NAME);
+	g_string_append_printf(out, "$scope module %s $end\n", PACKAGE_NAME);
 	i = 0;
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (!ch->enabled)
 			continue;
+		if (ch->type == SR_CHANNEL_LOGIC
+				&& sr_transform_logic_bit(o->sdi, ch) < 0)
+			continue;
 		desc = &ctx->channels[i++];
 		if (desc->type == SR_CHANNEL_LOGIC) {
 			type_text = "wire";
@@ -400,41 +428,33 @@ static GString *gen_header(const struct sr_output *o)
 			i--;
 			continue;
 		}
-		g_string_append_printf(header, "$var %s %s %s %s $end\n",
+		g_string_append_printf(out, "$var %s %s %s %s $end\n",
 			type_text, size_text, desc->name->str, ch->name);
 	}
-	g_string_append(header, "$upscope $end\n");
+	g_string_append(out, "$upscope $end\n");
 
-	g_string_append(header, "$enddefinitions $end\n");
+	g_string_append(out, "$enddefinitions $end\n");
 
 	g_free(timestamp);
 	g_free(samplerate_s);
 	g_free(frequency_s);
-
-	return header;
 }
 
 /*
- * Gets called when a session feed packet was received. Either creates
- * a VCD file header (once in the output module's lifetime), or an empty
- * GString. Callers will append the text representation of sample data
- * to that string as needed.
+ * Gets called when a session feed packet was received. Creates a VCD
+ * file header once in the output module's lifetime. Callers will append
+ * the text representation of sample data to the output as needed.
  */
-static GString *chk_header(const struct sr_output *o)
+static void chk_header(const struct sr_output *o, GString *out)
 {
 	struct context *ctx;
-	GString *s;
 
 	ctx = o->priv;
 
 	if (!ctx->header_done) {
 		ctx->header_done = TRUE;
-		s = gen_header(o);
-	} else {
-		s = g_string_sized_new(512);
+		gen_header(o, out);
 	}
-
-	return s;
 }
 
 /*
@@ -443,315 +463,118 @@ static GString *chk_header(const struct sr_output *o)
  * have seen samples from all involved channels for a given samplenumber.
  * Data for a given sample number can only get emitted when we are sure
  * no other channel's data can arrive any more.
+ *
+ * Queue items are kept in a binary min-heap ordered by sample number,
+ * and get looked up by sample number in a hash table. Items which were
+ * written out are kept in a pool for reuse.
  */
 
 static struct vcd_queue_item *queue_alloc_item(struct context *ctx, uint64_t snum)
 {
-	GSList *node;
 	struct vcd_queue_item *item;
 
-	/* Get an item from the free list if available. */
-	node = ctx->free_list;
-	if (node) {
-		ctx->reused++;
-
-		/* Unlink GSList node from the free list. */
-		ctx->free_list = node->next;
-		node->next = NULL;
-		item = node->data;
-		node->data = NULL;
-
-		/* Setup content of the item. */
-		item->samplenum = snum;
-		if (!item->values)
-			item->values = g_string_sized_new(32);
-		else
-			g_string_truncate(item->values, 0);
-
-		/* Keep GSList node in the used list (avoid free/alloc). */
-		node->next = ctx->used_list;
-		ctx->used_list = node;
-
-		return item;
+	if (ctx->queue_pool->len) {
+		item = g_ptr_array_remove_index_fast(ctx->queue_pool,
+			ctx->queue_pool->len - 1);
+		g_string_truncate(item->values, 0);
+	} else {
+		item = g_malloc0(sizeof(*item));
+		item->values = g_string_sized_new(32);
 	}
-
-	/* Dynamic allocation of an item. */
-	ctx->alloced++;
-	item = g_malloc0(sizeof(*item));
-	if (!item)
-		return NULL;
 	item->samplenum = snum;
-	item->values = g_string_sized_new(32);
-
-	/* Create a used list item, to later move to the free list. */
-	ctx->used_list = g_slist_prepend(ctx->used_list, item);
 
 	return item;
 }
 
-static void queue_free_item(struct context *ctx, struct vcd_queue_item *item)
+static void queue_free_item_cb(gpointer data, gpointer cb_data)
 {
-	GSList *node;
-
-	/*
-	 * Put item back into the free list. We can assume to find a
-	 * used list node, it got allocated when the item was acquired.
-	 */
-	node = ctx->used_list;
-	if (node) {
-		ctx->pooled++;
-
-		ctx->used_list = node->next;
-		node->next = NULL;
-		node->data = item;
-
-		item->samplenum = 0;
-		g_string_truncate(item->values, 0);
-
-		node->next = ctx->free_list;
-		ctx->free_list = node;
-
-		return;
-	}
-
-	/*
-	 * Release dynamically allocated resources. Could also be used
-	 * to release free list items when the use list is empty.
-	 */
-	ctx->freed++;
-	if (item->values)
-		g_string_free(item->values, TRUE);
-	g_free(item);
-}
-
-static void queue_drain_pool_cb(gpointer data, gpointer cb_data)
-{
-	struct context *ctx;
 	struct vcd_queue_item *item;
 
+	(void)cb_data;
+
 	item = data;
-	ctx = cb_data;
-	queue_free_item(ctx, item);
+	g_string_free(item->values, TRUE);
+	g_free(item);
 }
 
 static void queue_drain_pool(struct context *ctx)
 {
-	GSList *list;
-
-	/*
-	 * Grab the list and "empty" the context member. Then
-	 * iterate over the items, have dymamic memory released.
-	 * Then free the GSList nodes (but not their data parts).
-	 * Do this for the used and the free lists.
-	 */
-	list = ctx->used_list;
-	ctx->used_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
-
-	list = ctx->free_list;
-	ctx->free_list = NULL;
-	g_slist_foreach(list, queue_drain_pool_cb, ctx);
-	g_slist_free(list);
+	g_ptr_array_foreach(ctx->queue_heap, queue_free_item_cb, NULL);
+	g_ptr_array_free(ctx->queue_heap, TRUE);
+	g_ptr_array_foreach(ctx->queue_pool, queue_free_item_cb, NULL);
+	g_ptr_array_free(ctx->queue_pool, TRUE);
+	g_hash_table_destroy(ctx->queue_index);
 }
 
-static int cmp_snum(gconstpointer l, gconstpointer d)
+static void queue_heap_push(struct context *ctx, struct vcd_queue_item *item)
 {
-	const struct vcd_queue_item *list_item;
-	const uint64_t *snum_ptr;
-
-	list_item = l;
-	snum_ptr = d;
-	if (list_item->samplenum > *snum_ptr)
-		return +1;
-	if (list_item->samplenum < *snum_ptr)
-		return -1;
-	return 0;
+	struct vcd_queue_item **heap, *parent;
+	size_t pos;
+
+	g_ptr_array_add(ctx->queue_heap, item);
+	heap = (struct vcd_queue_item **)ctx->queue_heap->pdata;
+	pos = ctx->queue_heap->len - 1;
+	while (pos) {
+		parent = heap[(pos - 1) / 2];
+		if (parent->samplenum <= item->samplenum)
+			break;
+		heap[pos] = parent;
+		pos = (pos - 1) / 2;
+	}
+	heap[pos] = item;
 }
 
-static int cmp_items(gconstpointer a, gconstpointer b)
+static struct vcd_queue_item *queue_heap_pop(struct context *ctx)
 {
-	const struct vcd_queue_item *item_a, *item_b;
-
-	item_a = a;
-	item_b = b;
-	if (item_a->samplenum > item_b->samplenum)
-		return +1;
-	if (item_a->samplenum < item_b->samplenum)
-		return -1;
-	return 0;
+	struct vcd_queue_item **heap, *top, *item;
+	size_t pos, child, len;
+
+	heap = (struct vcd_queue_item **)ctx->queue_heap->pdata;
+	top = heap[0];
+	item = g_ptr_array_remove_index(ctx->queue_heap, ctx->queue_heap->len - 1);
+	len = ctx->queue_heap->len;
+	if (!len)
+		return top;
+
+	pos = 0;
+	while ((child = 2 * pos + 1) < len) {
+		if (child + 1 < len &&
+				heap[child + 1]->samplenum < heap[child]->samplenum)
+			child++;
+		if (item->samplenum <= heap[child]->samplenum)
+			break;
+		heap[pos] = heap[child];
+		pos = child;
+	}
+	heap[pos] = item;
+
+	return top;
 }
 
 /*
  * Position the current pointer of the VCD value queue to a specific
- * sample number. Create a new queue item when needed. The logic assumes
- * a specific use pattern: Reception of striped sample data for channels
- * and processing in strict order of sample numbers within a channel.
- * Lower sample numbers near the start of the queue when channels change
- * between session feed packets, before another linear sequence follows.
- *
- * Naive use of convenience glib routines would severely lose performance.
- * That's why custom code is used, which is as complex as it needs to be,
- * yet shall execute faster than a simpler implementation. For trivial
+ * sample number. Create a new queue item when needed. For trivial
  * cases (logic only, one analog channel only) this queue is bypassed.
  */
 static int queue_samplenum(struct context *ctx, uint64_t snum)
 {
-	struct vcd_queue_item *item, *add_item;
-	GList *walk_list, *after_snum, *before_snum, *add_list;
-	GList *last;
-	gboolean add_after_last, do_search;
+	struct vcd_queue_item *item;
 
 	/* Already at that position? */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
+	item = ctx->queue_last;
 	if (item && item->samplenum == snum)
 		return SR_OK;
 
-	/*
-	 * Search after the current position in the remaining queue. The
-	 * custom code uses the queue's being sorted by sample number.
-	 * Narrow down a later insert position as much as possible. This
-	 * avoids linear search in huge spaces later on.
-	 */
-	last = NULL;
-	add_after_last = FALSE;
-	after_snum = NULL;
-	before_snum = NULL;
-	walk_list = ctx->vcd_queue_last;
-	while (walk_list) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		last = walk_list;
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		if (!walk_list->next)
-			add_after_last = TRUE;
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * No exact match at or beyond the current position. Run another
-	 * search from the start of the queue, again restrict the space
-	 * which is searched, and narrow down the insert position when
-	 * no match is found.
-	 *
-	 * If the searched sample number is larger than any we have seen
-	 * before, or was in the above covered range but was not found,
-	 * then we know that another queue item needs to get added, and
-	 * where to put it. In that case we need not iterate the earlier
-	 * list items.
-	 */
-	walk_list = ctx->vcd_queue_list;
-	do_search = TRUE;
-	if (add_after_last)
-		do_search = FALSE;
-	if (before_snum)
-		do_search = FALSE;
-	while (do_search && walk_list && walk_list != ctx->vcd_queue_last) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		walk_list = walk_list->next;
-	}
-
-	/*
-	 * The complete existing queue was exhausted, no exact match was
-	 * found. A new queue item must get inserted. Identify a good
-	 * position where to start searching for the exact position to
-	 * link the new item to the list. Assume that the combination of
-	 * the glib routine's list traversal and the sample number check
-	 * in the callback is expensive, reduce the amount of work done.
-	 *
-	 * If we have seen an item with a larger sample number than the
-	 * wanted, check its immediate predecessor. If this has a smaller
-	 * sample number, then we found a perfect location to insert the
-	 * new item. If we know that the new item must be inserted after
-	 * the last traversed queue item, start there.
-	 */
-	if (!before_snum) do {
-		if (add_after_last)
-			break;
-		if (!after_snum)
-			break;
-		walk_list = after_snum->prev;
-		if (!walk_list)
-			break;
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-	} while (0);
-	add_list = add_after_last ? last : before_snum;
-	if (!add_list) {
-		walk_list = ctx->vcd_queue_list;
-		while (walk_list) {
-			item = walk_list->data;
-			if (!item)
-				break;
-			if (item->samplenum == snum) {
-				ctx->vcd_queue_last = walk_list;
-				return SR_OK;
-			}
-			if (item->samplenum > snum) {
-				after_snum = walk_list;
-				break;
-			}
-			add_list = walk_list;
-			walk_list = walk_list->next;
-		}
-	}
-	if (add_list && (item = add_list->data) && item->samplenum == snum) {
-		ctx->vcd_queue_last = add_list;
-		return SR_OK;
+	item = g_hash_table_lookup(ctx->queue_index, &snum);
+	if (!item) {
+		if (with_queue_stats)
+			sr_dbg("%s(), queue nr %" PRIu64, __func__, snum);
+		item = queue_alloc_item(ctx, snum);
+		g_hash_table_insert(ctx->queue_index, &item->samplenum, item);
+		queue_heap_push(ctx, item);
 	}
+	ctx->queue_last = item;
 
-	/*
-	 * Create a new queue item for the so far untracked sample
-	 * number. Immediately search for the inserted position (is
-	 * unfortunately not returned from the insert call), and
-	 * cache that position for subsequent lookups.
-	 */
-	if (with_queue_stats)
-		sr_dbg("%s(), queue nr %" PRIu64, __func__, snum);
-	add_item = queue_alloc_item(ctx, snum);
-	if (!add_item)
-		return SR_ERR_MALLOC;
-	if (!add_list)
-		add_list = ctx->vcd_queue_list;
-	if (add_list && add_list->prev)
-		add_list = add_list->prev;
-	walk_list = g_list_insert_sorted(add_list, add_item, cmp_items);
-	if (!walk_list->prev)
-		ctx->vcd_queue_list = walk_list;
-	walk_list = g_list_find_custom(walk_list, &snum, cmp_snum);
-	item = walk_list ? walk_list->data : NULL;
-	if (item && item->samplenum == snum) {
-		ctx->vcd_queue_last = walk_list;
-	}
 	return SR_OK;
 }
 
@@ -766,7 +589,7 @@ static GString *queue_value_text_prep(struct context *ctx)
 	GString *buff;
 
 	/* Cope with not-yet-positioned write pointers. */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
+	item = ctx->queue_last;
 	if (!item)
 		return NULL;
 
@@ -934,10 +757,8 @@ static uint64_t get_max_snum_flush(struct context *ctx)
 static int write_completed_changes(struct context *ctx, GString *out)
 {
 	uint64_t upto_snum;
-	GList **listref, *node;
 	struct vcd_queue_item *item;
 	int rc;
-	size_t dumped;
 
 	/* Determine the number which all data was received for so far. */
 	upto_snum = get_max_snum_export(ctx);
@@ -945,33 +766,28 @@ static int write_completed_changes(struct context *ctx, GString *out)
 		sr_spew("%s(), check up to %" PRIu64, __func__, upto_snum);
 
 	/*
-	 * Forward and consume those items from the head of the list
+	 * Forward and consume those items from the head of the queue
 	 * which we completely have accumulated and are certain about.
 	 */
-	dumped = 0;
-	listref = &ctx->vcd_queue_list;
-	while (*listref) {
+	while (ctx->queue_heap->len) {
 		/* Find items before the targetted sample number. */
-		node = *listref;
-		item = node->data;
-		if (!item)
-			break;
+		item = g_ptr_array_index(ctx->queue_heap, 0);
 		if (item->samplenum >= upto_snum)
 			break;
 
 		/*
-		 * Unlink the item from the list. Void cached positions.
+		 * Unlink the item from the queue. Void cached positions.
 		 * Append its timestamp and values to the caller's text.
 		 */
-		dumped++;
 		if (with_queue_stats)
 			sr_dbg("%s(), dump nr %" PRIu64,
 				__func__, item->samplenum);
-		if (ctx->vcd_queue_last == node)
-			ctx->vcd_queue_last = NULL;
-		*listref = g_list_remove_link(*listref, node);
+		queue_heap_pop(ctx);
+		g_hash_table_remove(ctx->queue_index, &item->samplenum);
+		if (ctx->queue_last == item)
+			ctx->queue_last = NULL;
 		rc = unqueue_item(ctx, item, out);
-		queue_free_item(ctx, item);
+		g_ptr_array_add(ctx->queue_pool, item);
 		if (rc != SR_OK)
 			return rc;
 	}
@@ -979,9 +795,68 @@ static int write_completed_changes(struct context *ctx, GString *out)
 	return SR_OK;
 }
 
+static inline unsigned int lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	unsigned int bit;
+
+	for (bit = 0; !(word & 1); bit++)
+		word >>= 1;
+
+	return bit;
+#endif
+}
+
+/* Get up to 8 bytes of a logic sample, as bits of a 64bit word. */
+static inline uint64_t load_logic_word(const uint8_t *data, size_t len)
+{
+	uint64_t word;
+
+	if (len == 8)
+		return RL64(data);
+
+	word = 0;
+	while (len--)
+		word |= (uint64_t)data[len] << (8 * len);
+
+	return word;
+}
+
+/*
+ * Provide the 64bit words which logic samples of the given unit size
+ * get compared in, and the mask of enabled channels' bits in them.
+ */
+static size_t prepare_logic_words(struct context *ctx, size_t unit_size)
+{
+	size_t words, w, index;
+
+	words = (unit_size + 7) / 8;
+	if (words <= ctx->logic_words)
+		return words;
+
+	ctx->last_logic = g_realloc(ctx->last_logic, words * sizeof(uint64_t));
+	ctx->logic_diff = g_realloc(ctx->logic_diff, words * sizeof(uint64_t));
+	ctx->logic_mask = g_realloc(ctx->logic_mask, words * sizeof(uint64_t));
+	for (w = ctx->logic_words; w < words; w++) {
+		ctx->last_logic[w] = 0;
+		ctx->logic_mask[w] = 0;
+		for (index = 0; index < 64; index++) {
+			if (64 * w + index >= ctx->logic_desc_count)
+				break;
+			if (ctx->logic_desc[64 * w + index])
+				ctx->logic_mask[w] |= UINT64_C(1) << index;
+		}
+	}
+	ctx->logic_words = words;
+
+	return words;
+}
+
 /* Get packets from the session feed, generate output text. */
-static int receive(const struct sr_output *o,
-	const struct sr_datafeed_packet *packet, GString **out)
+static int append(const struct sr_output *o,
+	const struct sr_datafeed_packet *packet, GString *out)
 {
 	struct context *ctx;
 	const struct sr_datafeed_meta *meta;
@@ -990,18 +865,18 @@ static int receive(const struct sr_output *o,
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
-	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	uint64_t snum_curr, word, diff;
+	size_t count, index, unit_size, words, w;
+	unsigned int bit;
 	gboolean changed;
 	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
+	uint8_t *sample, curbit;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
 	float *floats, value;
 	double ts;
 
-	*out = NULL;
 	if (!o || !o->priv)
 		return SR_ERR_BUG;
 	ctx = o->priv;
@@ -1017,7 +892,7 @@ static int receive(const struct sr_output *o,
 		}
 		break;
 	case SR_DF_LOGIC:
-		*out = chk_header(o);
+		chk_header(o, out);
 
 		logic = packet->payload;
 		sample = logic->data;
@@ -1026,13 +901,24 @@ static int receive(const struct sr_output *o,
 		snum_curr = get_last_snum_logic(ctx);
 		upd_last_snum_logic(ctx, count);
 
-		last_logic = ctx->last_logic;
+		words = prepare_logic_words(ctx, unit_size);
 		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
+			/*
+			 * Check whether any logic value has changed, one
+			 * 64bit word of the sample at a time. Initial values
+			 * get dumped with the first sample.
+			 */
+			changed = FALSE;
+			for (w = 0; w < words; w++) {
+				word = load_logic_word(&sample[8 * w],
+					MIN(8, unit_size - 8 * w));
+				diff = word ^ ctx->last_logic[w];
+				if (snum_curr == 0)
+					diff = ~UINT64_C(0);
+				ctx->logic_diff[w] = diff & ctx->logic_mask[w];
+				ctx->last_logic[w] = word;
+				changed |= ctx->logic_diff[w] != 0;
+			}
 
 			/*
 			 * Start or continue tracking that sample number.
@@ -1041,58 +927,46 @@ static int receive(const struct sr_output *o,
 			if (changed) {
 				if (ctx->immediate_write) {
 					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
+					append_vcd_timestamp(out, ts, FALSE);
 				} else {
 					queue_samplenum(ctx, snum_curr);
 				}
 			}
 
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
+			/* Only visit the logic channels which have changed. */
+			for (w = 0; changed && w < words; w++) {
+				diff = ctx->logic_diff[w];
+				while (diff) {
+					bit = lowest_bit(diff);
+					diff &= diff - 1;
+					desc = ctx->logic_desc[64 * w + bit];
+					curbit = (ctx->last_logic[w] >> bit) & 1;
+					desc->last.logic = curbit;
+
+					/*
+					 * Queue, or immediately emit the text for
+					 * the observed value change.
+					 */
+					if (ctx->immediate_write) {
+						g_string_append_c(out, ' ');
+						s_val = out;
+					} else {
+						s_val = queue_value_text_prep(ctx);
+						if (!s_val)
+							break;
+					}
+					format_vcd_value_bit(s_val, curbit, desc->name);
 				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
 			}
 
 			/* Advance to next set of logic samples. */
 			snum_curr++;
 			sample += unit_size;
 		}
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	case SR_DF_ANALOG:
-		*out = chk_header(o);
+		chk_header(o, out);
 
 		/*
 		 * This implementation expects one analog packet per
@@ -1110,8 +984,10 @@ static int receive(const struct sr_output *o,
 		desc = NULL;
 		for (index = 0; index < ctx->enabled_count; index++) {
 			desc = &ctx->channels[index];
-			if ((int)desc->index == channel->index)
+			if (desc->type == SR_CHANNEL_ANALOG
+					&& (int)desc->index == channel->index)
 				break;
+			desc = NULL;
 		}
 		if (!desc)
 			return SR_OK;
@@ -1150,8 +1026,8 @@ static int receive(const struct sr_output *o,
 			/* Queue, or emit the timestamp and the new value. */
 			if (ctx->immediate_write) {
 				ts = snum_to_ts(ctx, snum_curr + index);
-				append_vcd_timestamp(*out, ts, FALSE);
-				s_val = *out;
+				append_vcd_timestamp(out, ts, FALSE);
+				s_val = out;
 			} else {
 				queue_samplenum(ctx, snum_curr + index);
 				s_val = queue_value_text_prep(ctx);
@@ -1160,15 +1036,15 @@ static int receive(const struct sr_output *o,
 		}
 
 		g_free(floats);
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	case SR_DF_END:
-		*out = chk_header(o);
+		chk_header(o, out);
 		/* Push the final timestamp as length indicator. */
 		snum_curr = get_max_snum_flush(ctx);
 		queue_samplenum(ctx, snum_curr);
 		/* Flush previously queued value changes. */
-		write_completed_changes(ctx, *out);
+		write_completed_changes(ctx, out);
 		break;
 	}
 
@@ -1185,19 +1061,17 @@ static int cleanup(struct sr_output *o)
 
 	ctx = o->priv;
 
-	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
 	queue_drain_pool(ctx);
-	if (with_pool_stats)
-		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
-			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
 
 	while (ctx->enabled_count--) {
 		desc = &ctx->channels[ctx->enabled_count];
 		g_string_free(desc->name, TRUE);
 	}
 	g_free(ctx->channels);
+	g_free(ctx->last_logic);
+	g_free(ctx->logic_diff);
+	g_free(ctx->logic_mask);
+	g_free(ctx->logic_desc);
 	g_free(ctx);
 
 	return SR_OK;
@@ -1211,6 +1085,6 @@ struct sr_output_module output_vcd = {
 	.flags = 0,
 	.options = NULL,
 	.init = init,
-	.receive = receive,
+	.append = append,
 	.cleanup = cleanup,
 };
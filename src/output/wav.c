@@ -154,11 +154,10 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	g_string_append_len(gs, tmp, 4);
 }
 
-static GString *gen_header(const struct sr_output *o)
+static void gen_header(const struct sr_output *o, GString *out)
 {
 	struct out_context *outc;
 	GVariant *gvar;
-	GString *header;
 	char tmp[4];
 
 	outc = o->priv;
@@ -170,15 +169,12 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 
-	header = g_string_sized_new(512);
-	g_string_append(header, "RIFF");
+	g_string_append(out, "RIFF");
 	/* Total size. Max out the field. */
 	WL32(tmp, 0xffffffff);
-	g_string_append_len(header, tmp, 4);
-	g_string_append(header, "WAVE");
-	add_data_chunk(o, header);
-
-	return header;
+	g_string_append_len(out, tmp, 4);
+	g_string_append(out, "WAVE");
+	add_data_chunk(o, out);
 }
 
 /*
@@ -233,8 +229,8 @@ static int check_chanbuf_size(const struct sr_output *o)
 	return size;
 }
 
-static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+static int append(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString *out)
 {
 	struct out_context *outc;
 	const struct sr_datafeed_meta *meta;
@@ -248,7 +244,6 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	float *data;
 	uint8_t *buf;
 
-	*out = NULL;
 	if (!o || !o->sdi || !(outc = o->priv))
 		return SR_ERR_ARG;
 
@@ -264,10 +259,8 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_ANALOG:
 		if (!outc->header_done) {
-			*out = gen_header(o);
+			gen_header(o, out);
 			outc->header_done = TRUE;
-		} else {
-			*out = g_string_sized_new(512);
 		}
 
 		analog = packet->payload;
@@ -316,14 +309,13 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 
 		size = check_chanbuf_size(o);
 		if (size > MIN_DATA_CHUNK_SAMPLES)
-			if (flush_chanbufs(o, *out) != SR_OK)
+			if (flush_chanbufs(o, out) != SR_OK)
 				return SR_ERR;
 		break;
 	case SR_DF_END:
 		size = check_chanbuf_size(o);
 		if (size > 0) {
-			*out = g_string_sized_new(4 * size * outc->num_channels);
-			if (flush_chanbufs(o, *out) != SR_OK)
+			if (flush_chanbufs(o, out) != SR_OK)
 				return SR_ERR;
 		}
 		break;
@@ -372,6 +364,6 @@ SR_PRIV struct sr_output_module output_wav = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.append = append,
 	.cleanup = cleanup,
 };
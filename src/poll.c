@@ -0,0 +1,494 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "poll"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Scheduling of the periodic requests which drivers poll devices with.
+ */
+
+/*
+ * Drivers for power supplies, loads and the like query their device
+ * periodically, and wait for each reply. Doing so from the session's
+ * main loop blocks all other devices for the duration of a request.
+ *
+ * Drivers register their polls here instead. Each bus (a connection
+ * which carries one request at a time, like a serial port) gets a thread
+ * which runs the requests of all polls on the bus in the order of their
+ * deadlines. Requests on different buses run concurrently. A request's
+ * result gets passed to the driver in the thread which runs the driver's
+ * event sources, through an event source which is registered with the
+ * session like the drivers' own sources.
+ *
+ * Polls on the same bus which ask for the same thing share one request
+ * per period, when the drivers give them the same key. Drivers which
+ * need the bus for other requests (e.g. to change a setting) lock it
+ * while they use it. Drivers waiting for the lock go before any polls
+ * which are due, so a bus which is polled continuously doesn't starve
+ * them.
+ */
+
+struct poll_result {
+	int result;
+	GBytes *reply;
+};
+
+struct poll_bus {
+	const void *id;
+	GThread *thread;
+	/** Protects all of the below. */
+	GMutex mutex;
+	GCond cond;
+	/** List of struct poll_entry pointers. */
+	GSList *entries;
+	/** The entry whose request is being run. */
+	struct poll_entry *running;
+	/** Whether a driver has locked the bus. */
+	gboolean locked;
+	/** Number of drivers waiting to lock the bus. */
+	unsigned int lock_waiters;
+	gboolean quit;
+};
+
+/* A request, which one or more polls share. */
+struct poll_entry {
+	struct poll_bus *bus;
+	char *key;
+	/** List of struct sr_poll pointers. */
+	GSList *polls;
+	int64_t interval_us;
+	int64_t due_us;
+};
+
+struct sr_poll {
+	GSource base;
+	struct sr_session *session;
+	struct poll_entry *entry;
+	int64_t interval_us;
+	sr_poll_run_callback run;
+	sr_poll_done_callback done;
+	void *cb_data;
+	/** Results of struct poll_result, for the driver's thread. */
+	GAsyncQueue *results;
+};
+
+/* Buses by their ID, with a thread each while polls are registered. */
+static GMutex buses_mutex;
+static GHashTable *buses;
+
+static void poll_result_free(void *data)
+{
+	struct poll_result *res;
+
+	res = data;
+	g_bytes_unref(res->reply);
+	g_free(res);
+}
+
+static int64_t entry_interval(const struct poll_entry *entry)
+{
+	const struct sr_poll *poll;
+	int64_t interval_us;
+	GSList *l;
+
+	interval_us = G_MAXINT64;
+	for (l = entry->polls; l; l = l->next) {
+		poll = l->data;
+		interval_us = MIN(interval_us, poll->interval_us);
+	}
+
+	return interval_us;
+}
+
+/* Find the entry with the earliest deadline. */
+static struct poll_entry *entry_next(const struct poll_bus *bus)
+{
+	struct poll_entry *entry, *next;
+	GSList *l;
+
+	next = NULL;
+	for (l = bus->entries; l; l = l->next) {
+		entry = l->data;
+		if (!next || entry->due_us < next->due_us)
+			next = entry;
+	}
+
+	return next;
+}
+
+static void entry_complete(struct poll_entry *entry, int result,
+		GByteArray *reply)
+{
+	struct sr_poll *poll;
+	struct poll_result *res;
+	GBytes *bytes;
+	GSList *l;
+
+	bytes = g_byte_array_free_to_bytes(reply);
+	for (l = entry->polls; l; l = l->next) {
+		poll = l->data;
+		res = g_malloc(sizeof(*res));
+		res->result = result;
+		res->reply = g_bytes_ref(bytes);
+		g_async_queue_push(poll->results, res);
+		g_main_context_wakeup(g_source_get_context(&poll->base));
+	}
+	g_bytes_unref(bytes);
+}
+
+static void *bus_thread(void *data)
+{
+	struct poll_bus *bus;
+	struct poll_entry *entry;
+	struct sr_poll *poll;
+	GByteArray *reply;
+	int64_t now_us;
+	int ret;
+
+	bus = data;
+	g_mutex_lock(&bus->mutex);
+	while (!bus->quit) {
+		entry = entry_next(bus);
+		if (!entry || bus->locked || bus->lock_waiters) {
+			g_cond_wait(&bus->cond, &bus->mutex);
+			continue;
+		}
+		if (entry->due_us > g_get_monotonic_time()) {
+			g_cond_wait_until(&bus->cond, &bus->mutex, entry->due_us);
+			continue;
+		}
+
+		/* The first poll's driver runs the request for all of them. */
+		poll = entry->polls->data;
+		bus->running = entry;
+		g_mutex_unlock(&bus->mutex);
+
+		reply = g_byte_array_new();
+		ret = poll->run(poll->cb_data, reply);
+
+		g_mutex_lock(&bus->mutex);
+		bus->running = NULL;
+		entry_complete(entry, ret, reply);
+		/* Don't try to catch up with periods which were missed. */
+		now_us = g_get_monotonic_time();
+		entry->due_us += entry->interval_us;
+		if (entry->due_us < now_us)
+			entry->due_us = now_us;
+		g_cond_broadcast(&bus->cond);
+	}
+	g_mutex_unlock(&bus->mutex);
+
+	return NULL;
+}
+
+static gboolean poll_source_prepare(GSource *source, int *timeout)
+{
+	struct sr_poll *poll;
+
+	poll = (struct sr_poll *)source;
+	*timeout = -1;
+
+	return g_async_queue_length(poll->results) > 0;
+}
+
+static gboolean poll_source_check(GSource *source)
+{
+	struct sr_poll *poll;
+
+	poll = (struct sr_poll *)source;
+
+	return g_async_queue_length(poll->results) > 0;
+}
+
+static gboolean poll_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct sr_poll *poll;
+	struct poll_result *res;
+	const uint8_t *data;
+	size_t len;
+
+	(void)callback;
+	(void)user_data;
+
+	poll = (struct sr_poll *)source;
+	while (!g_source_is_destroyed(source)
+			&& (res = g_async_queue_try_pop(poll->results))) {
+		data = g_bytes_get_data(res->reply, &len);
+		poll->done(res->result, data, len, poll->cb_data);
+		poll_result_free(res);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void poll_source_finalize(GSource *source)
+{
+	struct sr_poll *poll;
+
+	poll = (struct sr_poll *)source;
+	/* Not set when the poll never got registered. */
+	if (poll->session)
+		sr_session_source_destroyed(poll->session, poll, source);
+	g_async_queue_unref(poll->results);
+}
+
+static struct poll_bus *bus_get(const void *id)
+{
+	struct poll_bus *bus;
+	GError *error;
+
+	if (!buses)
+		buses = g_hash_table_new(NULL, NULL);
+	bus = g_hash_table_lookup(buses, id);
+	if (bus)
+		return bus;
+
+	bus = g_malloc0(sizeof(*bus));
+	bus->id = id;
+	g_mutex_init(&bus->mutex);
+	g_cond_init(&bus->cond);
+
+	error = NULL;
+	bus->thread = g_thread_try_new("sr-poll", bus_thread, bus, &error);
+	if (!bus->thread) {
+		sr_err("Failed to create poll thread: %s", error->message);
+		g_error_free(error);
+		g_mutex_clear(&bus->mutex);
+		g_cond_clear(&bus->cond);
+		g_free(bus);
+		return NULL;
+	}
+	g_hash_table_insert(buses, (void *)id, bus);
+
+	return bus;
+}
+
+static void bus_free(struct poll_bus *bus)
+{
+	g_mutex_lock(&bus->mutex);
+	bus->quit = TRUE;
+	g_cond_broadcast(&bus->cond);
+	g_mutex_unlock(&bus->mutex);
+	g_thread_join(bus->thread);
+
+	g_mutex_clear(&bus->mutex);
+	g_cond_clear(&bus->cond);
+	g_free(bus);
+}
+
+/**
+ * Register a periodic request with the poll scheduler.
+ *
+ * The @a run callback performs the request and waits for the reply, in
+ * the thread of the bus. It stores the reply for the driver in the byte
+ * array it gets. The @a done callback gets the result in the thread
+ * which runs the session's (or the device's) event sources.
+ *
+ * Polls with the same @a bus and @a key share the request: it runs at
+ * the shortest of their intervals, and all of them get the result.
+ *
+ * The poll is an event source of the session, the session keeps running
+ * until the poll gets removed.
+ *
+ * @param session The session. Must not be NULL.
+ * @param bus Identifies the connection which the request uses, e.g. the
+ *            device's sdi->conn. Requests on the same bus never overlap.
+ * @param key Identifies the request, or NULL if it is never shared.
+ * @param interval_ms Time between requests. 0 polls as often as the bus
+ *                    allows.
+ * @param run Runs the request. Must not be NULL.
+ * @param done Receives the result. Must not be NULL.
+ * @param cb_data Data for the callbacks.
+ *
+ * @return The poll, or NULL upon failure.
+ *
+ * @private
+ */
+SR_PRIV struct sr_poll *sr_poll_add(struct sr_session *session,
+		const void *bus, const char *key, unsigned int interval_ms,
+		sr_poll_run_callback run, sr_poll_done_callback done,
+		void *cb_data)
+{
+	static GSourceFuncs poll_source_funcs = {
+		.prepare = &poll_source_prepare,
+		.check = &poll_source_check,
+		.dispatch = &poll_source_dispatch,
+		.finalize = &poll_source_finalize,
+	};
+	struct sr_poll *poll;
+	struct poll_bus *pbus;
+	struct poll_entry *entry;
+	GSList *l;
+	int ret;
+
+	if (!session || !bus || !run || !done)
+		return NULL;
+
+	poll = (struct sr_poll *)g_source_new(&poll_source_funcs,
+			sizeof(struct sr_poll));
+	poll->interval_us = (int64_t)interval_ms * 1000;
+	poll->run = run;
+	poll->done = done;
+	poll->cb_data = cb_data;
+	poll->results = g_async_queue_new_full(poll_result_free);
+	g_source_set_name(&poll->base, "poll");
+
+	ret = sr_session_source_add_internal(session, poll, &poll->base);
+	if (ret == SR_OK)
+		poll->session = session;
+	g_source_unref(&poll->base);
+	if (ret != SR_OK)
+		return NULL;
+
+	g_mutex_lock(&buses_mutex);
+	pbus = bus_get(bus);
+	if (!pbus) {
+		g_mutex_unlock(&buses_mutex);
+		sr_session_source_remove_internal(session, poll);
+		return NULL;
+	}
+
+	g_mutex_lock(&pbus->mutex);
+	entry = NULL;
+	for (l = key ? pbus->entries : NULL; l; l = l->next) {
+		entry = l->data;
+		if (entry->key && !strcmp(entry->key, key))
+			break;
+		entry = NULL;
+	}
+	if (!entry) {
+		entry = g_malloc0(sizeof(*entry));
+		entry->bus = pbus;
+		entry->key = g_strdup(key);
+		entry->due_us = g_get_monotonic_time();
+		pbus->entries = g_slist_append(pbus->entries, entry);
+	}
+	entry->polls = g_slist_append(entry->polls, poll);
+	entry->interval_us = entry_interval(entry);
+	poll->entry = entry;
+	g_cond_broadcast(&pbus->cond);
+	g_mutex_unlock(&pbus->mutex);
+
+	g_mutex_unlock(&buses_mutex);
+
+	return poll;
+}
+
+/**
+ * Remove a poll.
+ *
+ * Waits for a request of the poll which currently runs. The poll's
+ * callbacks don't get called any more after this function returns.
+ *
+ * @param poll The poll. May be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_poll_remove(struct sr_poll *poll)
+{
+	struct poll_entry *entry;
+	struct poll_bus *bus;
+
+	if (!poll)
+		return;
+
+	entry = poll->entry;
+	bus = entry->bus;
+
+	g_mutex_lock(&buses_mutex);
+	g_mutex_lock(&bus->mutex);
+	while (bus->running == entry)
+		g_cond_wait(&bus->cond, &bus->mutex);
+	entry->polls = g_slist_remove(entry->polls, poll);
+	if (entry->polls) {
+		entry->interval_us = entry_interval(entry);
+	} else {
+		bus->entries = g_slist_remove(bus->entries, entry);
+		g_free(entry->key);
+		g_free(entry);
+	}
+	poll->entry = NULL;
+	g_mutex_unlock(&bus->mutex);
+
+	if (!bus->entries) {
+		g_hash_table_remove(buses, bus->id);
+		bus_free(bus);
+	}
+	g_mutex_unlock(&buses_mutex);
+
+	sr_session_source_remove_internal(poll->session, poll);
+}
+
+/**
+ * Get exclusive use of a poll's bus.
+ *
+ * Drivers lock the bus while they send requests of their own, e.g. to
+ * change a setting. Polls don't run while the bus is locked. Waits for
+ * a request which currently runs, but not for polls which are due.
+ *
+ * @param poll The poll. May be NULL, in which case nothing happens.
+ *
+ * @private
+ */
+SR_PRIV void sr_poll_bus_lock(struct sr_poll *poll)
+{
+	struct poll_bus *bus;
+
+	if (!poll)
+		return;
+
+	bus = poll->entry->bus;
+	g_mutex_lock(&bus->mutex);
+	bus->lock_waiters++;
+	while (bus->locked || bus->running)
+		g_cond_wait(&bus->cond, &bus->mutex);
+	bus->lock_waiters--;
+	bus->locked = TRUE;
+	g_mutex_unlock(&bus->mutex);
+}
+
+/**
+ * Release a bus which was locked with sr_poll_bus_lock().
+ *
+ * @private
+ */
+SR_PRIV void sr_poll_bus_unlock(struct sr_poll *poll)
+{
+	struct poll_bus *bus;
+
+	if (!poll)
+		return;
+
+	bus = poll->entry->bus;
+	g_mutex_lock(&bus->mutex);
+	bus->locked = FALSE;
+	g_cond_broadcast(&bus->cond);
+	g_mutex_unlock(&bus->mutex);
+}
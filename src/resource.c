@@ -20,6 +20,8 @@
 #include <config.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
@@ -283,6 +285,8 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 		sr_err("%s: inconsistent callback pointers.", __func__);
 		return SR_ERR_ARG;
 	}
+	/* Content which was read through other hooks may differ. */
+	sr_resource_cache_clear(ctx);
 	return SR_OK;
 }
 
@@ -369,21 +373,24 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 	return n_read;
 }
 
-/**
- * Load a resource into memory.
- *
- * @param ctx libsigrok context. Must not be NULL.
- * @param type Resource type ID.
- * @param name Name of the resource. Must not be NULL.
- * @param[out] size Size in bytes of the returned buffer. Must not be NULL.
- * @param max_size Size limit. Error out if the resource is larger than this.
- *
- * @return A buffer containing the resource data, or NULL on failure. Must
- *         be freed by the caller using g_free().
- *
- * @private
- */
-SR_PRIV void *sr_resource_load(struct sr_context *ctx,
+/* A resource's content, kept in memory for repeated loads. */
+struct resource_cache_entry {
+	void *data;
+	size_t size;
+	char *digest;
+};
+
+static void cache_entry_free(void *data)
+{
+	struct resource_cache_entry *entry;
+
+	entry = data;
+	g_free(entry->data);
+	g_free(entry->digest);
+	g_free(entry);
+}
+
+static void *resource_read_all(struct sr_context *ctx,
 		int type, const char *name, size_t *size, size_t max_size)
 {
 	struct sr_resource res;
@@ -423,3 +430,314 @@ SR_PRIV void *sr_resource_load(struct sr_context *ctx,
 	*size = res_size;
 	return buf;
 }
+
+/*
+ * Look up a resource in the context's cache, and read it when it is
+ * not cached yet. Also computes the content's digest, which identifies
+ * the exact image that gets uploaded to devices.
+ */
+static const struct resource_cache_entry *resource_cache_get(
+		struct sr_context *ctx, int type, const char *name,
+		size_t max_size)
+{
+	struct resource_cache_entry *entry;
+	char *key;
+
+	if (!ctx->resource_cache) {
+		ctx->resource_cache = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, cache_entry_free);
+	}
+
+	key = g_strdup_printf("%d:%s", type, name);
+	entry = g_hash_table_lookup(ctx->resource_cache, key);
+	if (entry) {
+		g_free(key);
+		if (entry->size > max_size) {
+			sr_err("Size %zu of '%s' exceeds limit %zu.",
+				entry->size, name, max_size);
+			return NULL;
+		}
+		sr_spew("Using cached resource '%s'.", name);
+		return entry;
+	}
+
+	entry = g_malloc0(sizeof(*entry));
+	entry->data = resource_read_all(ctx, type, name, &entry->size,
+		max_size);
+	if (!entry->data) {
+		g_free(entry);
+		g_free(key);
+		return NULL;
+	}
+	entry->digest = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+		entry->data, entry->size);
+	sr_dbg("Cached resource '%s', %zu bytes, SHA-256 %s.",
+		name, entry->size, entry->digest);
+	g_hash_table_insert(ctx->resource_cache, key, entry);
+
+	return entry;
+}
+
+/**
+ * Load a resource into memory.
+ *
+ * The content is kept in the context's resource cache, later loads of
+ * the same resource don't access the file again.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ * @param[out] size Size in bytes of the returned buffer. Must not be NULL.
+ * @param max_size Size limit. Error out if the resource is larger than this.
+ *
+ * @return A buffer containing the resource data, or NULL on failure. Must
+ *         be freed by the caller using g_free().
+ *
+ * @private
+ */
+SR_PRIV void *sr_resource_load(struct sr_context *ctx,
+		int type, const char *name, size_t *size, size_t max_size)
+{
+	const struct resource_cache_entry *entry;
+	void *buf;
+
+	entry = resource_cache_get(ctx, type, name, max_size);
+	if (!entry)
+		return NULL;
+
+	buf = g_try_malloc(entry->size);
+	if (!buf && entry->size) {
+		sr_err("Failed to allocate buffer for '%s'.", name);
+		return NULL;
+	}
+	memcpy(buf, entry->data, entry->size);
+
+	*size = entry->size;
+	return buf;
+}
+
+/**
+ * Get the content digest of a resource.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ *
+ * @return The SHA-256 digest of the resource's content as a hex string,
+ *         or NULL on failure. Owned by the context's resource cache,
+ *         remains valid until the cache gets cleared.
+ *
+ * @private
+ */
+SR_PRIV const char *sr_resource_digest(struct sr_context *ctx,
+		int type, const char *name)
+{
+	const struct resource_cache_entry *entry;
+
+	entry = resource_cache_get(ctx, type, name, SIZE_MAX);
+
+	return entry ? entry->digest : NULL;
+}
+
+/**
+ * Drop all cached resource content.
+ *
+ * Applications should call this after they replaced resource files
+ * (e.g. firmware images) while the context exists, so that the next
+ * access reads the new content.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_resource_cache_clear(struct sr_context *ctx)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	if (ctx->resource_cache)
+		g_hash_table_remove_all(ctx->resource_cache);
+
+	return SR_OK;
+}
+
+/*
+ * Build the key which identifies a device's current connection. USB
+ * devices get a new address when they re-enumerate, or get unplugged
+ * and plugged in again, which also loses their uploaded images.
+ */
+static char *device_image_key(const struct sr_dev_inst *sdi)
+{
+#ifdef HAVE_LIBUSB_1_0
+	const struct sr_usb_dev_inst *usb;
+#endif
+	const char *drv_name;
+
+	drv_name = sdi->driver ? sdi->driver->name : "";
+#ifdef HAVE_LIBUSB_1_0
+	if (sdi->inst_type == SR_INST_USB && sdi->conn) {
+		usb = sdi->conn;
+		return g_strdup_printf("%s/usb/%d.%d", drv_name,
+			usb->bus, usb->address);
+	}
+#endif
+	if (sdi->serial_num && *sdi->serial_num)
+		return g_strdup_printf("%s/sn/%s", drv_name, sdi->serial_num);
+	if (sdi->connection_id && *sdi->connection_id)
+		return g_strdup_printf("%s/conn/%s", drv_name,
+			sdi->connection_id);
+
+	return NULL;
+}
+
+/* Get the digest of the image which was last uploaded to a device. */
+static const char *device_image_last(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx)
+{
+	const char *last;
+	char *key;
+
+	if (!sdi || !ctx || !ctx->resource_images)
+		return NULL;
+
+	key = device_image_key(sdi);
+	if (!key)
+		return NULL;
+	last = g_hash_table_lookup(ctx->resource_images, key);
+	g_free(key);
+
+	return last;
+}
+
+/**
+ * Check whether a device still runs an image which was uploaded before.
+ *
+ * Drivers call this before they upload firmware or FPGA bitstreams. The
+ * context remembers the content digest of the image which was last
+ * uploaded to each device connection. When it matches the resource's
+ * current content, the upload can be skipped. Drivers should still
+ * verify that the device responds as expected, where the protocol
+ * provides a means to do so, and upload when that fails.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID of the image.
+ * @param name Name of the image resource. Must not be NULL.
+ *
+ * @return TRUE when the device was seen to run the image, FALSE otherwise.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_resource_image_current(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, int type, const char *name)
+{
+	const char *digest, *last;
+
+	if (!name)
+		return FALSE;
+	last = device_image_last(sdi, ctx);
+	if (!last)
+		return FALSE;
+
+	digest = sr_resource_digest(ctx, type, name);
+	if (!digest || strcmp(digest, last) != 0)
+		return FALSE;
+	sr_dbg("Device runs image '%s' already.", name);
+
+	return TRUE;
+}
+
+/**
+ * Check whether a device runs another image than the one given.
+ *
+ * This is for devices which keep their configuration across sessions,
+ * and which drivers re-use when the device looks configured. It tells
+ * when this context uploaded a different image, or an older content of
+ * the resource, so that the driver uploads again.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID of the image.
+ * @param name Name of the image resource. Must not be NULL.
+ *
+ * @return TRUE when the last upload to the device was a different
+ *         image, FALSE when it was the same image, or nothing is known.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_resource_image_differs(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, int type, const char *name)
+{
+	const char *digest, *last;
+
+	if (!name)
+		return FALSE;
+	last = device_image_last(sdi, ctx);
+	if (!last)
+		return FALSE;
+
+	digest = sr_resource_digest(ctx, type, name);
+	if (digest && strcmp(digest, last) == 0)
+		return FALSE;
+	sr_dbg("Device runs another image than '%s'.", name);
+
+	return TRUE;
+}
+
+/**
+ * Record the image which was uploaded to a device.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID of the image.
+ * @param name Name of the image resource, or NULL when the device's
+ *             state is unknown (e.g. after a failed upload).
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_image_uploaded(const struct sr_dev_inst *sdi,
+		struct sr_context *ctx, int type, const char *name)
+{
+	const char *digest;
+	char *key;
+
+	if (!sdi || !ctx)
+		return;
+
+	key = device_image_key(sdi);
+	if (!key)
+		return;
+	if (!ctx->resource_images) {
+		ctx->resource_images = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, g_free);
+	}
+
+	digest = name ? sr_resource_digest(ctx, type, name) : NULL;
+	if (digest)
+		g_hash_table_replace(ctx->resource_images, key,
+			g_strdup(digest));
+	else
+		g_hash_table_remove(ctx->resource_images, key);
+	if (!digest)
+		g_free(key);
+}
+
+/**
+ * Release the context's resource cache and image records.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_cache_free(struct sr_context *ctx)
+{
+	if (ctx->resource_cache)
+		g_hash_table_destroy(ctx->resource_cache);
+	ctx->resource_cache = NULL;
+	if (ctx->resource_images)
+		g_hash_table_destroy(ctx->resource_images);
+	ctx->resource_images = NULL;
+}
@@ -117,6 +117,7 @@ static gboolean fd_source_dispatch(GSource *source,
 {
 	struct fd_source *fsource;
 	unsigned int revents;
+	int64_t ready_us;
 	gboolean keep;
 
 	fsource = (struct fd_source *)source;
@@ -126,6 +127,11 @@ static gboolean fd_source_dispatch(GSource *source,
 		sr_err("Callback not set, cannot dispatch event.");
 		return G_SOURCE_REMOVE;
 	}
+	if (sr_session_instr_get(fsource->session)) {
+		ready_us = revents ? g_source_get_time(source) : fsource->due_us;
+		sr_session_stats_lag(fsource->session, SR_SESSION_SOURCE_FD,
+			g_get_monotonic_time() - ready_us);
+	}
 	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))
 			(fsource->pollfd.fd, revents, user_data);
 
@@ -146,7 +152,9 @@ static void fd_source_finalize(GSource *source)
 
 	sr_dbg("%s: key %p", __func__, fsource->key);
 
-	sr_session_source_destroyed(fsource->session, fsource->key, source);
+	/* Not set when the source never got registered. */
+	if (fsource->session)
+		sr_session_source_destroyed(fsource->session, fsource->key, source);
 }
 
 /** Create an event source for I/O on a file descriptor.
@@ -261,6 +269,9 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	g_hash_table_unref(session->event_sources);
 
+	sr_session_stats_cleanup(session);
+	sr_session_coalesce_cleanup(session);
+
 	g_mutex_clear(&session->main_mutex);
 
 	g_free(session);
@@ -366,7 +377,11 @@ SR_API int sr_session_dev_add(struct sr_session *session,
 			       sr_strerror(ret));
 			return ret;
 		}
-		if ((ret = sr_dev_acquisition_start(sdi)) != SR_OK) {
+		if (session->threads)
+			ret = sr_session_threads_dev_start(session, sdi);
+		else
+			ret = sr_dev_acquisition_start(sdi);
+		if (ret != SR_OK) {
 			sr_err("Failed to start acquisition of device in "
 			       "running session (%s)", sr_strerror(ret));
 			return ret;
@@ -657,12 +672,17 @@ static int unset_main_context(struct sr_session *session)
 static unsigned int session_source_attach(struct sr_session *session,
 		GSource *source)
 {
+	GMainContext *main_context;
 	unsigned int id = 0;
 
 	g_mutex_lock(&session->main_mutex);
 
-	if (session->main_context)
-		id = g_source_attach(source, session->main_context);
+	/* Sources which get added by a device thread are dispatched there. */
+	main_context = sr_session_threads_context(session);
+	if (!main_context)
+		main_context = session->main_context;
+	if (main_context)
+		id = g_source_attach(source, main_context);
 	else
 		sr_err("Cannot add event source without main context.");
 
@@ -671,6 +691,18 @@ static unsigned int session_source_attach(struct sr_session *session,
 	return id;
 }
 
+/* Device threads register and unregister their event sources, too. */
+static unsigned int event_source_count(struct sr_session *session)
+{
+	unsigned int count;
+
+	g_mutex_lock(&session->main_mutex);
+	count = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
+
+	return count;
+}
+
 /* Idle handler; invoked when the number of registered event sources
  * for a running session drops to zero.
  */
@@ -679,16 +711,22 @@ static gboolean delayed_stop_check(void *data)
 	struct sr_session *session;
 
 	session = data;
+	g_mutex_lock(&session->main_mutex);
 	session->stop_check_id = 0;
+	g_mutex_unlock(&session->main_mutex);
 
 	/* Session already ended? */
 	if (!session->running)
 		return G_SOURCE_REMOVE;
 
 	/* New event sources may have been installed in the meantime. */
-	if (g_hash_table_size(session->event_sources) != 0)
+	if (event_source_count(session) != 0)
 		return G_SOURCE_REMOVE;
 
+	/* Let the device threads end, and pass on their last packets. */
+	sr_session_threads_finish(session);
+	sr_session_coalesce_flush(session);
+
 	session->running = FALSE;
 	unset_main_context(session);
 
@@ -715,15 +753,26 @@ static int stop_check_later(struct sr_session *session)
 	GSource *source;
 	unsigned int source_id;
 
-	if (session->stop_check_id != 0)
+	g_mutex_lock(&session->main_mutex);
+
+	if (session->stop_check_id != 0) {
+		g_mutex_unlock(&session->main_mutex);
 		return SR_OK; /* idle handler already installed */
+	}
 
 	source = g_idle_source_new();
 	g_source_set_callback(source, &delayed_stop_check, session, NULL);
 
-	source_id = session_source_attach(session, source);
+	/* Always check in the session's thread, also for device threads. */
+	source_id = 0;
+	if (session->main_context)
+		source_id = g_source_attach(source, session->main_context);
+	else
+		sr_err("Cannot add event source without main context.");
 	session->stop_check_id = source_id;
 
+	g_mutex_unlock(&session->main_mutex);
+
 	g_source_unref(source);
 
 	return (source_id != 0) ? SR_OK : SR_ERR;
@@ -810,6 +859,9 @@ SR_API int sr_session_start(struct sr_session *session)
 
 	session->running = TRUE;
 
+	if (session->dev_threads)
+		sr_session_threads_init(session, session->main_context);
+
 	/* Have all devices start acquisition. */
 	for (l = session->devs; l; l = l->next) {
 		if (!(sdi = l->data)) {
@@ -817,7 +869,10 @@ SR_API int sr_session_start(struct sr_session *session)
 			ret = SR_ERR;
 			break;
 		}
-		ret = sr_dev_acquisition_start(sdi);
+		if (session->threads)
+			ret = sr_session_threads_dev_start(session, sdi);
+		else
+			ret = sr_dev_acquisition_start(sdi);
 		if (ret != SR_OK) {
 			sr_err("Could not start %s device %s acquisition.",
 				sdi->driver->name, sdi->connection_id);
@@ -828,10 +883,15 @@ SR_API int sr_session_start(struct sr_session *session)
 	if (ret != SR_OK) {
 		/* If there are multiple devices, some of them may already have
 		 * started successfully. Stop them now before returning. */
-		lend = l->next;
-		for (l = session->devs; l != lend; l = l->next) {
-			sdi = l->data;
-			sr_dev_acquisition_stop(sdi);
+		if (session->threads) {
+			sr_session_threads_stop(session);
+			sr_session_threads_finish(session);
+		} else {
+			lend = l->next;
+			for (l = session->devs; l != lend; l = l->next) {
+				sdi = l->data;
+				sr_dev_acquisition_stop(sdi);
+			}
 		}
 		/* TODO: Handle delayed stops. Need to iterate the event
 		 * sources... */
@@ -841,7 +901,7 @@ SR_API int sr_session_start(struct sr_session *session)
 		return ret;
 	}
 
-	if (g_hash_table_size(session->event_sources) == 0)
+	if (event_source_count(session) == 0)
 		stop_check_later(session);
 
 	return SR_OK;
@@ -912,6 +972,11 @@ static gboolean session_stop_sync(void *user_data)
 
 	sr_info("Stopping.");
 
+	if (session->dev_threads) {
+		sr_session_threads_stop(session);
+		return G_SOURCE_REMOVE;
+	}
+
 	for (node = session->devs; node; node = node->next) {
 		sdi = node->data;
 		sr_dev_acquisition_stop(sdi);
@@ -1108,43 +1173,21 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 	return ret;
 }
 
-/**
- * Send a packet to whatever is listening on the datafeed bus.
- *
- * Hardware drivers use this to send a data packet to the frontend.
- *
- * @param sdi TODO.
- * @param packet The datafeed packet to send to the session bus.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR_ARG Invalid argument.
- *
- * @private
+/*
+ * Pass a packet through the session's transforms, and to the datafeed
+ * callbacks. Measure each stage's latency when statistics are enabled.
  */
-SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
-		const struct sr_datafeed_packet *packet)
+static int session_datafeed_run(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		struct sr_session_instr *instr)
 {
 	GSList *l;
 	struct datafeed_callback *cb_struct;
 	struct sr_datafeed_packet *packet_in, *packet_out;
 	struct sr_transform *t;
+	int64_t stage_start;
 	int ret;
 
-	if (!sdi) {
-		sr_err("%s: sdi was NULL", __func__);
-		return SR_ERR_ARG;
-	}
-
-	if (!packet) {
-		sr_err("%s: packet was NULL", __func__);
-		return SR_ERR_ARG;
-	}
-
-	if (!sdi->session) {
-		sr_err("%s: session was NULL", __func__);
-		return SR_ERR_BUG;
-	}
-
 	/*
 	 * Pass the packet to the first transform module. If that returns
 	 * another packet (instead of NULL), pass that packet to the next
@@ -1154,7 +1197,11 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 	for (l = sdi->session->transforms; l; l = l->next) {
 		t = l->data;
 		sr_spew("Running transform module '%s'.", t->module->id);
+		stage_start = instr ? g_get_monotonic_time() : 0;
 		ret = t->module->receive(t, packet_in, &packet_out);
+		if (instr)
+			sr_session_stats_stage(instr, t, t->module->id,
+				g_get_monotonic_time() - stage_start);
 		if (ret < 0) {
 			sr_err("Error while running transform module: %d.", ret);
 			return SR_ERR;
@@ -1184,12 +1231,73 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		if (sr_log_loglevel_get() >= SR_LOG_DBG)
 			datafeed_dump(packet);
 		cb_struct = l->data;
+		stage_start = instr ? g_get_monotonic_time() : 0;
 		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		if (instr)
+			sr_session_stats_stage(instr, cb_struct, NULL,
+				g_get_monotonic_time() - stage_start);
 	}
 
 	return SR_OK;
 }
 
+/**
+ * Send a packet to whatever is listening on the datafeed bus.
+ *
+ * Hardware drivers use this to send a data packet to the frontend.
+ *
+ * @param sdi TODO.
+ * @param packet The datafeed packet to send to the session bus.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session_instr *instr;
+	int64_t send_start;
+	int ret;
+
+	if (!sdi) {
+		sr_err("%s: sdi was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!packet) {
+		sr_err("%s: packet was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!sdi->session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	/* Device threads queue packets for the session's thread. */
+	if (sdi->session->threads && sr_session_threads_context(sdi->session))
+		return sr_session_threads_send(sdi, packet);
+
+	if (sdi->session->coalesce) {
+		ret = sr_session_coalesce_packet(sdi, packet);
+		if (ret != SR_ERR_NA)
+			return ret;
+	}
+
+	instr = sr_session_instr_get(sdi->session);
+	if (!instr)
+		return session_datafeed_run(sdi, packet, NULL);
+
+	send_start = g_get_monotonic_time();
+	sr_session_stats_packet(instr, sdi, packet);
+	ret = session_datafeed_run(sdi, packet, instr);
+	sr_session_stats_send(instr, g_get_monotonic_time() - send_start);
+
+	return ret;
+}
+
 /**
  * Add an event source for a file descriptor.
  *
@@ -1202,6 +1310,9 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
  * @retval SR_ERR_BUG Event source with @a key already installed.
  * @retval SR_ERR Other error.
  *
+ * Upon failure, the source is not registered with the session, and its
+ * finalize() method must not report its destruction.
+ *
  * @private
  */
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
@@ -1213,14 +1324,21 @@ SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 	 * already installed source. (Well it would, if we did not have
 	 * another sanity check there.)
 	 */
+	g_mutex_lock(&session->main_mutex);
 	if (g_hash_table_contains(session->event_sources, key)) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("Event source with key %p already exists.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_insert(session->event_sources, key, source);
+	g_mutex_unlock(&session->main_mutex);
 
-	if (session_source_attach(session, source) == 0)
+	if (session_source_attach(session, source) == 0) {
+		g_mutex_lock(&session->main_mutex);
+		g_hash_table_remove(session->event_sources, key);
+		g_mutex_unlock(&session->main_mutex);
 		return SR_ERR;
+	}
 
 	return SR_OK;
 }
@@ -1240,6 +1358,8 @@ SR_PRIV int sr_session_fd_source_add(struct sr_session *session,
 	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
 
 	ret = sr_session_source_add_internal(session, key, source);
+	if (ret != SR_OK)
+		((struct fd_source *)source)->session = NULL;
 	g_source_unref(source);
 
 	return ret;
@@ -1357,7 +1477,9 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 {
 	GSource *source;
 
+	g_mutex_lock(&session->main_mutex);
 	source = g_hash_table_lookup(session->event_sources, key);
+	g_mutex_unlock(&session->main_mutex);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
@@ -1453,24 +1575,30 @@ SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 		void *key, GSource *source)
 {
 	GSource *registered_source;
+	unsigned int count;
 
+	g_mutex_lock(&session->main_mutex);
 	registered_source = g_hash_table_lookup(session->event_sources, key);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
 	 */
 	if (!registered_source) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("No event source for key %p found.", key);
 		return SR_ERR_BUG;
 	}
 	if (registered_source != source) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("Event source for key %p does not match"
 			" destroyed source.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_remove(session->event_sources, key);
+	count = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
 
-	if (g_hash_table_size(session->event_sources) > 0)
+	if (count > 0)
 		return SR_OK;
 
 	/* If no event sources are left, consider the acquisition finished.
@@ -1514,6 +1642,8 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
@@ -1524,7 +1654,7 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
@@ -1534,12 +1664,12 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
+		logic_copy->data = g_malloc(logic->length);
 		if (!logic_copy->data) {
 			g_free(logic_copy);
 			return SR_ERR;
 		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
+		memcpy(logic_copy->data, logic->data, logic->length);
 		(*copy)->payload = logic_copy;
 		break;
 	case SR_DF_ANALOG:
@@ -1585,6 +1715,8 @@ SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
 	case SR_DF_HEADER:
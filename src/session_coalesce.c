@@ -0,0 +1,432 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Coalescing of single analog readings into packets of several samples.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/*
+ * Meters and power supplies send one analog packet per reading. When
+ * coalescing is enabled, the session collects the readings of each
+ * channel, and passes them on as one packet when enough samples were
+ * collected, or when the oldest sample is due. A reading which doesn't
+ * fit the collected ones (another quantity, unit, flags, or encoding)
+ * first passes on what was collected. Any other packet of a device
+ * passes on all of its device's collected readings first, so readings
+ * never get delayed beyond the end of an acquisition or a frame.
+ *
+ * Every sample's arrival time is kept, frontends can get them from
+ * within their datafeed callback with sr_analog_timestamps_get().
+ */
+
+struct analog_batch {
+	const struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	GByteArray *data;
+	GArray *timestamps;
+	uint32_t num_samples;
+	/** Monotonic time of the first collected sample, in us. */
+	int64_t first_us;
+};
+
+struct sr_session_coalesce {
+	unsigned int max_samples;
+	unsigned int max_ms;
+	/** Batches of struct analog_batch keyed by channel. */
+	GHashTable *batches;
+	/** The same batches in the order they were created. */
+	GSList *order;
+	GSource *timer;
+};
+
+/* The batch which is currently being passed to the datafeed, if any. */
+static GPrivate dispatching;
+
+static void batch_free(void *data)
+{
+	struct analog_batch *batch;
+
+	batch = data;
+	g_slist_free(batch->meaning.channels);
+	g_byte_array_free(batch->data, TRUE);
+	g_array_free(batch->timestamps, TRUE);
+	g_free(batch);
+}
+
+static int batch_flush(struct analog_batch *batch)
+{
+	int ret;
+
+	if (!batch->num_samples)
+		return SR_OK;
+
+	batch->analog.data = batch->data->data;
+	batch->analog.num_samples = batch->num_samples;
+	batch->analog.encoding = &batch->encoding;
+	batch->analog.meaning = &batch->meaning;
+	batch->analog.spec = &batch->spec;
+	batch->packet.type = SR_DF_ANALOG;
+	batch->packet.payload = &batch->analog;
+
+	g_private_set(&dispatching, batch);
+	ret = sr_session_send(batch->sdi, &batch->packet);
+	g_private_set(&dispatching, NULL);
+
+	g_byte_array_set_size(batch->data, 0);
+	g_array_set_size(batch->timestamps, 0);
+	batch->num_samples = 0;
+
+	return ret;
+}
+
+static int flush_dev(struct sr_session_coalesce *co,
+		const struct sr_dev_inst *sdi)
+{
+	struct analog_batch *batch;
+	GSList *l;
+	int ret;
+
+	ret = SR_OK;
+	for (l = co->order; l; l = l->next) {
+		batch = l->data;
+		if (sdi && batch->sdi != sdi)
+			continue;
+		if (batch_flush(batch) != SR_OK)
+			ret = SR_ERR;
+	}
+
+	return ret;
+}
+
+static gboolean timer_flush(void *data)
+{
+	struct sr_session_coalesce *co;
+	struct analog_batch *batch;
+	GSList *l;
+	int64_t due_us;
+
+	co = data;
+	due_us = g_get_monotonic_time() - (int64_t)co->max_ms * 1000;
+	for (l = co->order; l; l = l->next) {
+		batch = l->data;
+		if (batch->num_samples && batch->first_us <= due_us)
+			batch_flush(batch);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* Whether a reading can be appended to what was collected. */
+static gboolean batch_fits(const struct analog_batch *batch,
+		const struct sr_datafeed_analog *analog)
+{
+	const struct sr_analog_encoding *enc;
+
+	if (!batch->num_samples)
+		return TRUE;
+	enc = analog->encoding;
+	if (batch->encoding.unitsize != enc->unitsize
+			|| batch->encoding.is_signed != enc->is_signed
+			|| batch->encoding.is_float != enc->is_float
+			|| batch->encoding.is_bigendian != enc->is_bigendian
+			|| batch->encoding.digits != enc->digits
+			|| batch->encoding.is_digits_decimal != enc->is_digits_decimal
+			|| batch->encoding.scale.p != enc->scale.p
+			|| batch->encoding.scale.q != enc->scale.q
+			|| batch->encoding.offset.p != enc->offset.p
+			|| batch->encoding.offset.q != enc->offset.q)
+		return FALSE;
+	if (batch->meaning.mq != analog->meaning->mq
+			|| batch->meaning.unit != analog->meaning->unit
+			|| batch->meaning.mqflags != analog->meaning->mqflags)
+		return FALSE;
+	if (batch->spec.spec_digits != analog->spec->spec_digits)
+		return FALSE;
+
+	return TRUE;
+}
+
+/* Pass on readings which are due while no more readings arrive. */
+static void timer_start(struct sr_session *session,
+		struct sr_session_coalesce *co)
+{
+	g_mutex_lock(&session->main_mutex);
+	if (session->main_context) {
+		co->timer = g_timeout_source_new(co->max_ms);
+		g_source_set_callback(co->timer, timer_flush, co, NULL);
+		g_source_attach(co->timer, session->main_context);
+	}
+	g_mutex_unlock(&session->main_mutex);
+}
+
+static struct analog_batch *batch_get(struct sr_session_coalesce *co,
+		const struct sr_dev_inst *sdi, struct sr_channel *ch)
+{
+	struct analog_batch *batch;
+
+	batch = g_hash_table_lookup(co->batches, ch);
+	if (batch)
+		return batch;
+
+	batch = g_malloc0(sizeof(*batch));
+	batch->sdi = sdi;
+	batch->ch = ch;
+	batch->data = g_byte_array_new();
+	batch->timestamps = g_array_new(FALSE, FALSE, sizeof(int64_t));
+	g_hash_table_insert(co->batches, ch, batch);
+	co->order = g_slist_append(co->order, batch);
+
+	return batch;
+}
+
+/**
+ * Collect an analog reading, if it can get coalesced.
+ *
+ * @retval SR_OK The packet was collected, or passed on with collected
+ *               readings.
+ * @retval SR_ERR_NA The packet must get sent as usual. Collected readings
+ *                   of its device have been passed on before.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_coalesce_packet(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session_coalesce *co;
+	const struct sr_datafeed_analog *analog;
+	struct analog_batch *batch;
+	size_t size;
+	int64_t now_us, stamp_us;
+	uint32_t i;
+	int ret;
+
+	co = sdi->session->coalesce;
+	if (g_private_get(&dispatching))
+		return SR_ERR_NA;
+
+	analog = NULL;
+	if (packet->type == SR_DF_ANALOG)
+		analog = packet->payload;
+	if (!analog || !analog->meaning || !analog->meaning->channels
+			|| analog->meaning->channels->next
+			|| !analog->encoding || !analog->spec
+			|| !analog->num_samples
+			|| analog->num_samples >= co->max_samples) {
+		flush_dev(co, sdi);
+		return SR_ERR_NA;
+	}
+
+	if (!co->timer && co->max_ms)
+		timer_start(sdi->session, co);
+
+	ret = SR_OK;
+	batch = batch_get(co, sdi, analog->meaning->channels->data);
+	if (!batch_fits(batch, analog)
+			|| batch->num_samples + analog->num_samples > co->max_samples) {
+		if (batch_flush(batch) != SR_OK)
+			ret = SR_ERR;
+	}
+
+	now_us = g_get_monotonic_time();
+	if (!batch->num_samples) {
+		batch->encoding = *analog->encoding;
+		batch->meaning.mq = analog->meaning->mq;
+		batch->meaning.unit = analog->meaning->unit;
+		batch->meaning.mqflags = analog->meaning->mqflags;
+		if (!batch->meaning.channels)
+			batch->meaning.channels = g_slist_append(NULL, batch->ch);
+		batch->spec = *analog->spec;
+		batch->first_us = now_us;
+	}
+	size = (size_t)analog->num_samples * analog->encoding->unitsize;
+	g_byte_array_append(batch->data, analog->data, size);
+	stamp_us = g_get_real_time();
+	for (i = 0; i < analog->num_samples; i++)
+		g_array_append_val(batch->timestamps, stamp_us);
+	batch->num_samples += analog->num_samples;
+
+	if (batch->num_samples >= co->max_samples || (co->max_ms
+			&& now_us - batch->first_us >= (int64_t)co->max_ms * 1000)) {
+		if (batch_flush(batch) != SR_OK)
+			ret = SR_ERR;
+	}
+
+	return ret;
+}
+
+/**
+ * Pass on all collected readings, and stop the timer.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_coalesce_flush(struct sr_session *session)
+{
+	struct sr_session_coalesce *co;
+
+	co = session->coalesce;
+	if (!co)
+		return;
+
+	flush_dev(co, NULL);
+	if (co->timer) {
+		g_source_destroy(co->timer);
+		g_source_unref(co->timer);
+		co->timer = NULL;
+	}
+}
+
+/** @private */
+SR_PRIV void sr_session_coalesce_cleanup(struct sr_session *session)
+{
+	struct sr_session_coalesce *co;
+
+	co = session->coalesce;
+	if (!co)
+		return;
+
+	if (co->timer) {
+		g_source_destroy(co->timer);
+		g_source_unref(co->timer);
+	}
+	g_hash_table_destroy(co->batches);
+	g_slist_free(co->order);
+	g_free(co);
+	session->coalesce = NULL;
+}
+
+/**
+ * Coalesce single analog readings into packets of several samples.
+ *
+ * Drivers for meters, power supplies and the like send one analog packet
+ * per reading. With many such devices in a session, passing each packet
+ * through transforms and datafeed callbacks can cost more than handling
+ * the readings. When enabled, the session collects the readings of each
+ * channel, and passes them on in one packet of up to @a max_samples
+ * samples, no later than @a max_ms milliseconds after the first one
+ * arrived.
+ *
+ * Readings of a channel get passed on early when the measured quantity,
+ * unit, flags, or encoding change. All collected readings of a device
+ * get passed on before any other packet of the device. Packets with
+ * several channels or at least @a max_samples samples are passed on
+ * as they are.
+ *
+ * The time when each sample arrived is available through
+ * sr_analog_timestamps_get().
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_samples Maximum number of samples per packet. 0 or 1
+ *                    disables coalescing.
+ * @param max_ms Maximum time in ms a sample may wait. 0 means no limit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_analog_coalesce_set(struct sr_session *session,
+		unsigned int max_samples, unsigned int max_ms)
+{
+	struct sr_session_coalesce *co;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change analog coalescing while the session runs.");
+		return SR_ERR;
+	}
+
+	sr_session_coalesce_cleanup(session);
+	if (max_samples < 2)
+		return SR_OK;
+
+	co = g_malloc0(sizeof(*co));
+	co->max_samples = max_samples;
+	co->max_ms = max_ms;
+	co->batches = g_hash_table_new_full(NULL, NULL, NULL, batch_free);
+	session->coalesce = co;
+
+	return SR_OK;
+}
+
+/**
+ * Get the arrival times of the samples of a coalesced analog packet.
+ *
+ * Must be called from within a datafeed callback, for the analog payload
+ * which was passed to it.
+ *
+ * @param analog The analog payload. Must not be NULL.
+ * @param timestamps Pointer where to store the address of an array of
+ *                   analog->num_samples timestamps, in microseconds
+ *                   since the epoch. Valid until the callback returns.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The payload is not a coalesced one.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_timestamps_get(const struct sr_datafeed_analog *analog,
+		const int64_t **timestamps)
+{
+	struct analog_batch *batch;
+
+	if (!analog || !timestamps)
+		return SR_ERR_ARG;
+
+	*timestamps = NULL;
+	batch = g_private_get(&dispatching);
+	/* Transforms may have passed on another payload. */
+	if (!batch || &batch->analog != analog
+			|| analog->num_samples != batch->timestamps->len)
+		return SR_ERR_NA;
+	*timestamps = &g_array_index(batch->timestamps, int64_t, 0);
+
+	return SR_OK;
+}
+
+/** @} */
@@ -0,0 +1,358 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Collecting datafeed statistics of libsigrok sessions.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+static void latency_add(struct sr_latency_histogram *hist, int64_t us)
+{
+	size_t bucket;
+
+	if (us < 0)
+		us = 0;
+	bucket = us ? g_bit_storage((gulong)us) : 0;
+	if (bucket >= SR_LATENCY_HIST_BUCKETS)
+		bucket = SR_LATENCY_HIST_BUCKETS - 1;
+
+	hist->count++;
+	hist->total_us += us;
+	if ((uint64_t)us > hist->max_us)
+		hist->max_us = us;
+	hist->buckets[bucket]++;
+}
+
+/** @private */
+SR_PRIV void sr_session_stats_packet(struct sr_session_instr *instr,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session_dev_stats *dev;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	size_t idx;
+	uint64_t bytes;
+
+	if (packet->type < SR_DF_HEADER || packet->type > SR_DF_ANALOG)
+		return;
+	idx = packet->type - SR_DF_HEADER;
+
+	g_mutex_lock(&instr->mutex);
+
+	dev = g_hash_table_lookup(instr->devices, sdi);
+	if (!dev) {
+		dev = g_malloc0(sizeof(*dev));
+		dev->sdi = sdi;
+		g_hash_table_insert(instr->devices, (void *)sdi, dev);
+	}
+
+	bytes = 0;
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		bytes = logic->length;
+		if (logic->unitsize)
+			dev->logic_samples += logic->length / logic->unitsize;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		bytes = (uint64_t)analog->num_samples * analog->encoding->unitsize;
+		dev->analog_samples += analog->num_samples;
+		break;
+	default:
+		break;
+	}
+	dev->packets[idx]++;
+	dev->bytes[idx] += bytes;
+
+	g_mutex_unlock(&instr->mutex);
+}
+
+/** @private */
+SR_PRIV void sr_session_stats_stage(struct sr_session_instr *instr,
+		const void *key, const char *name, int64_t duration_us)
+{
+	struct sr_session_stage_stats *stage;
+
+	g_mutex_lock(&instr->mutex);
+
+	stage = g_hash_table_lookup(instr->stages, key);
+	if (!stage) {
+		stage = g_malloc0(sizeof(*stage));
+		stage->name = name;
+		g_hash_table_insert(instr->stages, (void *)key, stage);
+	}
+	latency_add(&stage->latency, duration_us);
+
+	g_mutex_unlock(&instr->mutex);
+}
+
+/** @private */
+SR_PRIV void sr_session_stats_send(struct sr_session_instr *instr,
+		int64_t duration_us)
+{
+	g_mutex_lock(&instr->mutex);
+	latency_add(&instr->send, duration_us);
+	g_mutex_unlock(&instr->mutex);
+}
+
+/**
+ * Account the delay between an event source becoming ready, and the
+ * main loop getting to dispatch it.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_stats_lag(struct sr_session *session,
+		enum sr_session_source_type type, int64_t lag_us)
+{
+	struct sr_session_instr *instr;
+
+	instr = sr_session_instr_get(session);
+	if (!instr)
+		return;
+
+	g_mutex_lock(&instr->mutex);
+	if (type == SR_SESSION_SOURCE_USB)
+		latency_add(&instr->usb_lag, lag_us);
+	else
+		latency_add(&instr->fd_lag, lag_us);
+	g_mutex_unlock(&instr->mutex);
+}
+
+/** @private */
+SR_PRIV void sr_session_stats_cleanup(struct sr_session *session)
+{
+	struct sr_session_instr *instr;
+
+	instr = session->instr;
+	if (!instr)
+		return;
+
+	g_hash_table_destroy(instr->devices);
+	g_hash_table_destroy(instr->stages);
+	g_mutex_clear(&instr->mutex);
+	g_free(instr);
+	session->instr = NULL;
+}
+
+static void stats_clear(struct sr_session_instr *instr)
+{
+	g_hash_table_remove_all(instr->devices);
+	g_hash_table_remove_all(instr->stages);
+	memset(&instr->send, 0, sizeof(instr->send));
+	memset(&instr->fd_lag, 0, sizeof(instr->fd_lag));
+	memset(&instr->usb_lag, 0, sizeof(instr->usb_lag));
+	instr->start_us = g_get_monotonic_time();
+}
+
+/**
+ * Enable or disable the collection of datafeed statistics.
+ *
+ * When enabled, the session counts the packets and payload bytes which
+ * each device sends, measures the time which each transform and each
+ * datafeed callback take to process a packet, and measures how late the
+ * main loop dispatches fd, timer, and USB event sources. Collection is
+ * disabled by default, since it adds a little overhead to every packet.
+ *
+ * Disabling the collection keeps the counters. Enabling it again
+ * continues where it was disabled.
+ *
+ * This function may be called while the session is running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to collect statistics, FALSE to stop collecting.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_enable(struct sr_session *session,
+		gboolean enable)
+{
+	struct sr_session_instr *instr;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (!session->instr && enable) {
+		instr = g_malloc0(sizeof(*instr));
+		g_mutex_init(&instr->mutex);
+		instr->devices = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, g_free);
+		instr->stages = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, g_free);
+		instr->start_us = g_get_monotonic_time();
+		session->instr = instr;
+	}
+	if (session->instr)
+		g_atomic_int_set(&session->instr->enabled, enable ? TRUE : FALSE);
+
+	return SR_OK;
+}
+
+/**
+ * Reset all datafeed statistics of a session to zero.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_reset(struct sr_session *session)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (!session->instr)
+		return SR_OK;
+
+	g_mutex_lock(&session->instr->mutex);
+	stats_clear(session->instr);
+	g_mutex_unlock(&session->instr->mutex);
+
+	return SR_OK;
+}
+
+static struct sr_session_stage_stats *stage_copy(
+		struct sr_session_instr *instr, const void *key,
+		const char *name)
+{
+	struct sr_session_stage_stats *stage, *copy;
+
+	copy = g_malloc0(sizeof(*copy));
+	stage = g_hash_table_lookup(instr->stages, key);
+	if (stage)
+		*copy = *stage;
+	copy->name = name;
+
+	return copy;
+}
+
+/**
+ * Get a snapshot of a session's datafeed statistics.
+ *
+ * The snapshot is consistent, and can be taken from any thread while
+ * the session is running. Transform and datafeed callback latencies are
+ * listed in the order in which they process packets. Stages which did
+ * not see any packet yet are listed with zero counts.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param[out] stats A newly allocated snapshot. Must not be NULL.
+ *             Free with sr_session_stats_free().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA Statistics collection was never enabled.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_get(struct sr_session *session,
+		struct sr_session_stats **stats)
+{
+	struct sr_session_instr *instr;
+	struct sr_session_stats *snap;
+	struct sr_session_dev_stats *dev;
+	const struct sr_transform *t;
+	GHashTableIter iter;
+	GSList *l;
+	void *value;
+
+	if (!session || !stats)
+		return SR_ERR_ARG;
+	*stats = NULL;
+
+	instr = session->instr;
+	if (!instr)
+		return SR_ERR_NA;
+
+	snap = g_malloc0(sizeof(*snap));
+
+	g_mutex_lock(&instr->mutex);
+
+	snap->elapsed_us = g_get_monotonic_time() - instr->start_us;
+	g_hash_table_iter_init(&iter, instr->devices);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		dev = g_malloc(sizeof(*dev));
+		*dev = *(struct sr_session_dev_stats *)value;
+		snap->devices = g_slist_prepend(snap->devices, dev);
+	}
+	snap->devices = g_slist_reverse(snap->devices);
+	for (l = session->transforms; l; l = l->next) {
+		t = l->data;
+		snap->transforms = g_slist_append(snap->transforms,
+			stage_copy(instr, t, t->module->id));
+	}
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		snap->callbacks = g_slist_append(snap->callbacks,
+			stage_copy(instr, l->data, NULL));
+	}
+	snap->send = instr->send;
+	snap->fd_lag = instr->fd_lag;
+	snap->usb_lag = instr->usb_lag;
+
+	g_mutex_unlock(&instr->mutex);
+
+	*stats = snap;
+
+	return SR_OK;
+}
+
+/**
+ * Free a statistics snapshot which was returned by sr_session_stats_get().
+ *
+ * @param stats The snapshot to free. Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_stats_free(struct sr_session_stats *stats)
+{
+	if (!stats)
+		return;
+
+	g_slist_free_full(stats->devices, g_free);
+	g_slist_free_full(stats->transforms, g_free);
+	g_slist_free_full(stats->callbacks, g_free);
+	g_free(stats);
+}
+
+/** @} */
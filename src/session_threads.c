@@ -0,0 +1,455 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Running the devices of a libsigrok session in threads of their own.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/*
+ * Each device gets a thread with a main context of its own. The driver's
+ * acquisition start and stop routines run in that thread, and all event
+ * sources which the driver adds from there get attached to the device's
+ * main context, so a device which blocks in a read doesn't delay the
+ * others.
+ *
+ * Datafeed packets which the drivers send get copied, and pushed to a
+ * queue which the session's main context drains. Transforms and datafeed
+ * callbacks thus still run in the thread which runs the session, one
+ * packet at a time, and see every device's packets in the order the
+ * device sent them.
+ *
+ * The queue is a lock-free stack: producers push with a compare and swap
+ * of the head pointer, the consumer takes the whole stack with another
+ * one, and reverses it to get the packets in the order of their pushes.
+ */
+
+struct queued_packet {
+	struct queued_packet *next;
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+};
+
+struct session_worker {
+	struct sr_session_threads *threads;
+	struct sr_dev_inst *sdi;
+	GThread *thread;
+	GMainContext *context;
+	int quit;
+
+	GMutex mutex;
+	GCond cond;
+	gboolean started;
+	int start_result;
+};
+
+struct sr_session_threads {
+	struct sr_session *session;
+	/** The session's main context, which dispatches the queue. */
+	GMainContext *main_context;
+	GSource *feed_source;
+	/** List of struct session_worker pointers. */
+	GSList *workers;
+	/** Most recently pushed packet, the stack of queued packets. */
+	struct queued_packet *queue;
+};
+
+struct feed_source {
+	GSource base;
+	struct sr_session_threads *threads;
+};
+
+/* The worker which runs in the current thread, if any. */
+static GPrivate current_worker;
+
+static struct queued_packet *queue_take(struct sr_session_threads *threads)
+{
+	struct queued_packet *head, *fifo, *next;
+
+	do {
+		head = g_atomic_pointer_get(&threads->queue);
+	} while (head && !g_atomic_pointer_compare_and_exchange(
+			&threads->queue, head, NULL));
+
+	/* Reverse the stack, to dispatch the oldest packet first. */
+	fifo = NULL;
+	while (head) {
+		next = head->next;
+		head->next = fifo;
+		fifo = head;
+		head = next;
+	}
+
+	return fifo;
+}
+
+static void queue_dispatch(struct sr_session_threads *threads)
+{
+	struct queued_packet *qp, *next;
+
+	for (qp = queue_take(threads); qp; qp = next) {
+		next = qp->next;
+		sr_session_send(qp->sdi, qp->packet);
+		sr_packet_free(qp->packet);
+		g_free(qp);
+	}
+}
+
+static gboolean feed_source_prepare(GSource *source, int *timeout)
+{
+	struct feed_source *fsource;
+
+	fsource = (struct feed_source *)source;
+	*timeout = -1;
+
+	return g_atomic_pointer_get(&fsource->threads->queue) != NULL;
+}
+
+static gboolean feed_source_check(GSource *source)
+{
+	struct feed_source *fsource;
+
+	fsource = (struct feed_source *)source;
+
+	return g_atomic_pointer_get(&fsource->threads->queue) != NULL;
+}
+
+static gboolean feed_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct feed_source *fsource;
+
+	(void)callback;
+	(void)user_data;
+
+	fsource = (struct feed_source *)source;
+	queue_dispatch(fsource->threads);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Queue a packet which a device's thread sends, for dispatch by the
+ * session's main context.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_threads_send(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct session_worker *worker;
+	struct sr_session_threads *threads;
+	struct queued_packet *qp, *head;
+	int ret;
+
+	worker = g_private_get(&current_worker);
+	threads = worker->threads;
+
+	qp = g_malloc(sizeof(*qp));
+	qp->sdi = sdi;
+	ret = sr_packet_copy(packet, &qp->packet);
+	if (ret != SR_OK) {
+		g_free(qp->packet);
+		g_free(qp);
+		return ret;
+	}
+
+	do {
+		head = g_atomic_pointer_get(&threads->queue);
+		qp->next = head;
+	} while (!g_atomic_pointer_compare_and_exchange(&threads->queue,
+			head, qp));
+
+	/* The consumer only needs a wakeup when it may have gone idle. */
+	if (!head)
+		g_main_context_wakeup(threads->main_context);
+
+	return SR_OK;
+}
+
+/**
+ * Get the main context of the device thread which is currently running,
+ * if it belongs to the session.
+ *
+ * @return The device thread's main context, or NULL when not called from
+ *         one of the session's device threads.
+ *
+ * @private
+ */
+SR_PRIV GMainContext *sr_session_threads_context(
+		const struct sr_session *session)
+{
+	struct session_worker *worker;
+
+	worker = g_private_get(&current_worker);
+	if (!worker || worker->threads->session != session)
+		return NULL;
+
+	return worker->context;
+}
+
+static void *worker_thread(void *data)
+{
+	struct session_worker *worker;
+	int ret;
+
+	worker = data;
+	g_main_context_push_thread_default(worker->context);
+	g_private_set(&current_worker, worker);
+
+	ret = sr_dev_acquisition_start(worker->sdi);
+
+	g_mutex_lock(&worker->mutex);
+	worker->start_result = ret;
+	worker->started = TRUE;
+	g_cond_signal(&worker->cond);
+	g_mutex_unlock(&worker->mutex);
+
+	while (!g_atomic_int_get(&worker->quit))
+		g_main_context_iteration(worker->context, TRUE);
+	/* Run whatever the driver's last callbacks left pending. */
+	while (g_main_context_iteration(worker->context, FALSE))
+		;
+
+	g_private_set(&current_worker, NULL);
+	g_main_context_pop_thread_default(worker->context);
+
+	return NULL;
+}
+
+static gboolean worker_stop(void *data)
+{
+	struct session_worker *worker;
+
+	worker = data;
+	sr_dev_acquisition_stop(worker->sdi);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void worker_join(struct session_worker *worker)
+{
+	g_atomic_int_set(&worker->quit, 1);
+	g_main_context_wakeup(worker->context);
+	g_thread_join(worker->thread);
+
+	g_main_context_unref(worker->context);
+	g_mutex_clear(&worker->mutex);
+	g_cond_clear(&worker->cond);
+	g_free(worker);
+}
+
+/**
+ * Set up the queue which passes the device threads' packets to the
+ * session's main context.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_threads_init(struct sr_session *session,
+		GMainContext *main_context)
+{
+	static GSourceFuncs feed_source_funcs = {
+		.prepare = &feed_source_prepare,
+		.check = &feed_source_check,
+		.dispatch = &feed_source_dispatch,
+	};
+	struct sr_session_threads *threads;
+	struct feed_source *fsource;
+
+	threads = g_malloc0(sizeof(*threads));
+	threads->session = session;
+	threads->main_context = g_main_context_ref(main_context);
+
+	/*
+	 * This source is not registered with the session, the session
+	 * stops when the drivers have removed their sources.
+	 */
+	fsource = (struct feed_source *)g_source_new(&feed_source_funcs,
+			sizeof(struct feed_source));
+	fsource->threads = threads;
+	threads->feed_source = &fsource->base;
+	g_source_set_name(threads->feed_source, "datafeed queue");
+	g_source_attach(threads->feed_source, main_context);
+
+	session->threads = threads;
+
+	return SR_OK;
+}
+
+/**
+ * Start a device's acquisition in a thread of its own.
+ *
+ * Blocks until the driver's acquisition start routine has returned.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_threads_dev_start(struct sr_session *session,
+		struct sr_dev_inst *sdi)
+{
+	struct sr_session_threads *threads;
+	struct session_worker *worker;
+	GError *error;
+	int ret;
+
+	threads = session->threads;
+	if (!threads)
+		return SR_ERR_BUG;
+
+	worker = g_malloc0(sizeof(*worker));
+	worker->threads = threads;
+	worker->sdi = sdi;
+	worker->context = g_main_context_new();
+	g_mutex_init(&worker->mutex);
+	g_cond_init(&worker->cond);
+
+	error = NULL;
+	worker->thread = g_thread_try_new("sr-device", worker_thread,
+			worker, &error);
+	if (!worker->thread) {
+		sr_err("Failed to create device thread: %s", error->message);
+		g_error_free(error);
+		g_main_context_unref(worker->context);
+		g_mutex_clear(&worker->mutex);
+		g_cond_clear(&worker->cond);
+		g_free(worker);
+		return SR_ERR;
+	}
+
+	g_mutex_lock(&worker->mutex);
+	while (!worker->started)
+		g_cond_wait(&worker->cond, &worker->mutex);
+	ret = worker->start_result;
+	g_mutex_unlock(&worker->mutex);
+
+	if (ret != SR_OK) {
+		worker_join(worker);
+		return ret;
+	}
+	threads->workers = g_slist_append(threads->workers, worker);
+
+	return SR_OK;
+}
+
+/**
+ * Have all device threads stop their device's acquisition.
+ *
+ * The drivers' acquisition stop routines run in the device threads,
+ * this function doesn't wait for them.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_threads_stop(struct sr_session *session)
+{
+	struct session_worker *worker;
+	GSList *l;
+
+	if (!session->threads)
+		return;
+
+	for (l = session->threads->workers; l; l = l->next) {
+		worker = l->data;
+		g_main_context_invoke(worker->context, worker_stop, worker);
+	}
+}
+
+/**
+ * Terminate the device threads, and dispatch the packets which are
+ * still queued.
+ *
+ * Must be called from the thread which runs the session, after all
+ * devices have stopped their acquisition.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_threads_finish(struct sr_session *session)
+{
+	struct sr_session_threads *threads;
+
+	threads = session->threads;
+	if (!threads)
+		return;
+
+	g_slist_free_full(threads->workers, (GDestroyNotify)worker_join);
+	threads->workers = NULL;
+	queue_dispatch(threads);
+
+	g_source_destroy(threads->feed_source);
+	g_source_unref(threads->feed_source);
+	g_main_context_unref(threads->main_context);
+	g_free(threads);
+	session->threads = NULL;
+}
+
+/**
+ * Have each device of a session run in a thread of its own.
+ *
+ * By default, all devices of a session run in the thread which runs the
+ * session, and share its main context. A driver which blocks, e.g. while
+ * it waits for a slow instrument's response, then delays the other
+ * devices' event processing.
+ *
+ * With device threads enabled, each device's acquisition gets started
+ * in a thread of its own, and the driver's event sources get dispatched
+ * by that thread. The datafeed packets still get passed to transforms
+ * and datafeed callbacks in the thread which runs the session, in the
+ * order each device sent them. This costs a copy of every packet.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to run devices in threads of their own, FALSE to
+ *               run them in the session's thread.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR The session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_dev_threads_set(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (session->running) {
+		sr_err("Cannot change device threads while the session runs.");
+		return SR_ERR;
+	}
+	session->dev_threads = enable;
+
+	return SR_OK;
+}
+
+/** @} */
@@ -23,7 +23,9 @@
 /** @endcond */
 #include <config.h>
 #include <ctype.h>
+#include <float.h>
 #include <locale.h>
+#include <math.h>
 #if defined(__FreeBSD__) || defined(__APPLE__)
 #include <xlocale.h>
 #endif
@@ -823,6 +825,210 @@ SR_API int sr_vsnprintf_ascii(char *buf, size_t buf_size,
 #endif
 }
 
+/* Scale a value by a power of ten, using exact powers where possible. */
+static double scale_pow10(double value, int exp)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22,
+	};
+
+	while (exp > 22) {
+		value *= pow10[22];
+		exp -= 22;
+	}
+	while (exp < -22) {
+		value /= pow10[22];
+		exp += 22;
+	}
+	if (exp >= 0)
+		return value * pow10[exp];
+
+	return value / pow10[-exp];
+}
+
+/*
+ * Check whether num * 10^-shift reads back as the float value. Without
+ * a decimal point, strtof() is independent of the locale.
+ */
+static gboolean float_reads_back(float value, uint32_t num, int shift)
+{
+	char str[24], *p;
+	unsigned int exp;
+
+	p = str + sizeof(str);
+	*--p = '\0';
+	exp = ABS(shift);
+	do {
+		*--p = '0' + exp % 10;
+		exp /= 10;
+	} while (exp);
+	if (shift > 0)
+		*--p = '-';
+	*--p = 'e';
+	do {
+		*--p = '0' + num % 10;
+		num /= 10;
+	} while (num);
+
+	return strtof(p, NULL) == value;
+}
+
+/**
+ * Convert a float to the shortest string which reads back as the same
+ * float value.
+ *
+ * Of all strings with the least number of significant digits which read
+ * back as the value, the one closest to the value is used. The text uses
+ * fixed notation for values from 1e-4 to below 1e9, and scientific
+ * notation otherwise, like printf's %g conversion. The decimal point is
+ * always '.', regardless of the locale. Infinite values and NaN are
+ * converted to "inf", "-inf" and "nan".
+ *
+ * This is considerably faster than printf(), and is meant for bulk
+ * conversion of sample data to text.
+ *
+ * @param value The value to convert.
+ * @param[out] buf The buffer to write the NUL terminated string to.
+ * @param buf_size The size of buf, must be at least
+ *                 SR_FLOAT_STRING_SIZE bytes.
+ *
+ * @return The length of the string, or SR_ERR_ARG if buf is NULL or
+ *         too small.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_float_to_string(float value, char *buf, size_t buf_size)
+{
+	double abs, lo, hi, scaled, slo, shi;
+	char digits[16], *p;
+	uint32_t num, nlo, nhi, qlo, qhi, pow;
+	int exp2, exp10, shift, ndigits, i, k;
+
+	if (!buf || buf_size < SR_FLOAT_STRING_SIZE)
+		return SR_ERR_ARG;
+
+	p = buf;
+	if (isnan(value)) {
+		strcpy(buf, "nan");
+		return 3;
+	}
+	if (signbit(value))
+		*p++ = '-';
+	abs = fabs((double)value);
+	if (isinf(abs)) {
+		strcpy(p, "inf");
+		return p + 3 - buf;
+	}
+	if (abs == 0) {
+		strcpy(p, "0");
+		return p + 1 - buf;
+	}
+
+	/*
+	 * Any decimal number between the midpoints to the neighbouring
+	 * floats reads back as the value. These bounds are exact in double
+	 * precision.
+	 */
+	lo = (abs + (double)nextafterf((float)abs, 0)) / 2;
+	if (abs < FLT_MAX)
+		hi = (abs + (double)nextafterf((float)abs, INFINITY)) / 2;
+	else
+		hi = abs + (abs - lo);
+
+	/* Scale the value to nine digits before the decimal point. */
+	frexp(abs, &exp2);
+	shift = 8 - (int)floor((exp2 - 1) * 0.30102999566398);
+	scaled = scale_pow10(abs, shift);
+	if (scaled < 1e8)
+		scaled = scale_pow10(abs, ++shift);
+	else if (scaled >= 1e9)
+		scaled = scale_pow10(abs, --shift);
+	slo = scale_pow10(lo, shift);
+	shi = scale_pow10(hi, shift);
+
+	/*
+	 * Get the range of nine digit numbers which read back as the value.
+	 * Nine digits always suffice for a float. The scaling is not exact,
+	 * so check the bounds when they are very close to the midpoints.
+	 */
+	nlo = (uint32_t)ceil(slo * (1 - 1e-14));
+	if (nlo < slo * (1 + 1e-14) && !float_reads_back((float)abs, nlo, shift))
+		nlo++;
+	nhi = (uint32_t)floor(shi * (1 + 1e-14));
+	if (nhi > shi * (1 - 1e-14) && !float_reads_back((float)abs, nhi, shift))
+		nhi--;
+
+	/*
+	 * Strip as many trailing digits as the range allows, then pick the
+	 * number in the range which is closest to the value.
+	 */
+	pow = 1000000000;
+	k = 9;
+	do {
+		k--;
+		pow /= 10;
+		qlo = nlo / pow + (nlo % pow ? 1 : 0);
+		qhi = nhi / pow;
+	} while (qlo > qhi && k > 0);
+	scaled /= pow;
+	num = (uint32_t)scaled;
+	if (scaled - num > 0.5 || (scaled - num == 0.5 && (num & 1)))
+		num++;
+	num = CLAMP(num, qlo, qhi);
+	shift -= k;
+
+	/* Get the significant digits, rounding may have added a tenth one. */
+	for (i = 9; i >= 0; i--, num /= 10)
+		digits[i] = '0' + num % 10;
+	i = 0;
+	while (digits[i] == '0')
+		i++;
+	exp10 = 9 - i - shift;
+	ndigits = 10 - i;
+	memmove(digits, digits + i, ndigits);
+	while (digits[ndigits - 1] == '0')
+		ndigits--;
+
+	if (exp10 >= -4 && exp10 < 9) {
+		if (exp10 < 0) {
+			*p++ = '0';
+			*p++ = '.';
+			for (i = exp10 + 1; i < 0; i++)
+				*p++ = '0';
+			memcpy(p, digits, ndigits);
+			p += ndigits;
+		} else if (ndigits <= exp10 + 1) {
+			memcpy(p, digits, ndigits);
+			p += ndigits;
+			for (i = ndigits; i <= exp10; i++)
+				*p++ = '0';
+		} else {
+			memcpy(p, digits, exp10 + 1);
+			p += exp10 + 1;
+			*p++ = '.';
+			memcpy(p, digits + exp10 + 1, ndigits - exp10 - 1);
+			p += ndigits - exp10 - 1;
+		}
+	} else {
+		*p++ = digits[0];
+		if (ndigits > 1) {
+			*p++ = '.';
+			memcpy(p, digits + 1, ndigits - 1);
+			p += ndigits - 1;
+		}
+		*p++ = 'e';
+		*p++ = exp10 < 0 ? '-' : '+';
+		exp10 = ABS(exp10);
+		*p++ = '0' + exp10 / 10;
+		*p++ = '0' + exp10 % 10;
+	}
+	*p = '\0';
+
+	return p - buf;
+}
+
 /**
  * Convert a sequence of bytes to its textual representation ("hex dump").
  *
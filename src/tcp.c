@@ -115,6 +115,53 @@ SR_PRIV gboolean sr_fd_is_readable(int fd)
 #endif
 }
 
+/**
+ * Wait until a file descriptor becomes readable.
+ *
+ * @param[in] fd The file descriptor to wait for.
+ * @param[in] timeout_ms Maximum time to wait in milliseconds.
+ *
+ * @return TRUE when readable, FALSE when the timeout expired or when
+ *   readability could not get determined.
+ */
+SR_PRIV gboolean sr_fd_wait_readable(int fd, unsigned int timeout_ms)
+{
+#if HAVE_POLL
+	struct pollfd fds[1];
+	int ret;
+
+	memset(fds, 0, sizeof(fds));
+	fds[0].fd = fd;
+	fds[0].events = POLLIN;
+	ret = poll(fds, ARRAY_SIZE(fds), timeout_ms);
+	if (ret <= 0)
+		return FALSE;
+	if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR)))
+		return FALSE;
+
+	return TRUE;
+#elif HAVE_SELECT
+	fd_set rfds;
+	struct timeval tv;
+	int ret;
+
+	FD_ZERO(&rfds);
+	FD_SET(fd, &rfds);
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	ret = select(fd + 1, &rfds, NULL, NULL, &tv);
+	if (ret <= 0)
+		return FALSE;
+	if (!FD_ISSET(fd, &rfds))
+		return FALSE;
+	return TRUE;
+#else
+	(void)fd;
+	(void)timeout_ms;
+	return FALSE;
+#endif
+}
+
 /**
  * Create a TCP communication instance.
  *
@@ -0,0 +1,674 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Reduce the rate of logic and analog data by an integer factor.
+ *
+ * Input samples get grouped into intervals of 'factor' samples, each
+ * interval results in one output sample. Analog intervals either get
+ * reduced to their mean, minimum or maximum value. The 'minmax' mode
+ * keeps an envelope: intervals span two output samples, and emit both
+ * their minimum and their maximum value in the order of occurrence, like
+ * the peak detect mode of oscilloscopes does.
+ *
+ * Logic data either gets sampled (first sample of every interval), or
+ * the 'transitions' mode ORs all transitions within an interval into
+ * the value which preceded the interval. A pulse which starts and ends
+ * within an interval then shows up as a single output sample, and the
+ * output still follows the input value when no glitch was seen.
+ *
+ * Intervals can span packets, a packet which does not complete any
+ * interval is consumed without output. A trailing partial interval at
+ * the end of the acquisition is discarded. Samplerate meta packets get
+ * rewritten to the output rate.
+ *
+ * The reductions are written as plain loops over contiguous memory,
+ * which compilers turn into SIMD code.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/decimate"
+
+/* Logic transitions get accumulated in blocks of this many bytes. */
+#define LANE_BYTES 64
+
+enum analog_mode {
+	ANALOG_MEAN,
+	ANALOG_MIN,
+	ANALOG_MAX,
+	ANALOG_MINMAX,
+};
+
+enum logic_mode {
+	LOGIC_SAMPLE,
+	LOGIC_TRANSITIONS,
+};
+
+/* State of an interval of one analog packet layout (channel list). */
+struct analog_stream {
+	size_t lanes;
+	uint64_t fill;
+	float *min, *max;
+	uint64_t *min_pos, *max_pos;
+	double *sum;
+};
+
+struct context {
+	uint64_t factor;
+	uint64_t target_rate;
+	uint64_t in_rate;
+	enum analog_mode analog_mode;
+	enum logic_mode logic_mode;
+
+	/* Logic interval state. */
+	size_t unitsize;
+	uint64_t logic_fill;
+	gboolean logic_started;
+	uint8_t *logic_ref;
+	uint8_t *logic_last;
+	uint8_t *logic_acc;
+
+	/* Analog interval state, keyed by the packets' first channel. */
+	GHashTable *streams;
+
+	/* Output packet storage, reused across calls. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_datafeed_meta meta;
+	struct sr_config rate_config;
+	uint8_t *logic_buf;
+	size_t logic_buf_size;
+	float *in_floats;
+	size_t in_floats_size;
+	float *out_floats;
+	size_t out_floats_size;
+};
+
+static void stream_free(void *data)
+{
+	struct analog_stream *s;
+
+	s = data;
+	g_free(s->min);
+	g_free(s->max);
+	g_free(s->min_pos);
+	g_free(s->max_pos);
+	g_free(s->sum);
+	g_free(s);
+}
+
+static void stream_reset(struct analog_stream *s)
+{
+	size_t i;
+
+	s->fill = 0;
+	for (i = 0; i < s->lanes; i++) {
+		s->min[i] = INFINITY;
+		s->max[i] = -INFINITY;
+		s->min_pos[i] = 0;
+		s->max_pos[i] = 0;
+		s->sum[i] = 0.0;
+	}
+}
+
+static struct analog_stream *stream_get(struct context *ctx,
+		const void *key, size_t lanes)
+{
+	struct analog_stream *s;
+
+	s = g_hash_table_lookup(ctx->streams, key);
+	if (s && s->lanes == lanes)
+		return s;
+
+	s = g_malloc0(sizeof(*s));
+	s->lanes = lanes;
+	s->min = g_malloc(lanes * sizeof(*s->min));
+	s->max = g_malloc(lanes * sizeof(*s->max));
+	s->min_pos = g_malloc(lanes * sizeof(*s->min_pos));
+	s->max_pos = g_malloc(lanes * sizeof(*s->max_pos));
+	s->sum = g_malloc(lanes * sizeof(*s->sum));
+	stream_reset(s);
+	g_hash_table_replace(ctx->streams, (void *)key, s);
+
+	return s;
+}
+
+/* Forget partial intervals, e.g. after the factor has changed. */
+static void reset_intervals(struct context *ctx)
+{
+	GHashTableIter iter;
+	void *value;
+
+	ctx->logic_fill = 0;
+	ctx->logic_started = FALSE;
+	g_hash_table_iter_init(&iter, ctx->streams);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		stream_reset(value);
+}
+
+static void update_factor(struct context *ctx)
+{
+	uint64_t factor;
+
+	if (!ctx->target_rate || !ctx->in_rate)
+		return;
+
+	factor = ctx->in_rate / ctx->target_rate;
+	if (!factor)
+		factor = 1;
+	if (factor == ctx->factor)
+		return;
+
+	sr_dbg("Decimating %" PRIu64 " Hz by %" PRIu64 ".",
+		ctx->in_rate, factor);
+	ctx->factor = factor;
+	reset_intervals(ctx);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	GVariant *gvar;
+	const char *s;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	ctx->factor = g_variant_get_uint64(g_hash_table_lookup(options, "factor"));
+	ctx->target_rate = g_variant_get_uint64(g_hash_table_lookup(options, "samplerate"));
+
+	s = g_variant_get_string(g_hash_table_lookup(options, "analog"), NULL);
+	if (!strcmp(s, "mean")) {
+		ctx->analog_mode = ANALOG_MEAN;
+	} else if (!strcmp(s, "min")) {
+		ctx->analog_mode = ANALOG_MIN;
+	} else if (!strcmp(s, "max")) {
+		ctx->analog_mode = ANALOG_MAX;
+	} else if (!strcmp(s, "minmax")) {
+		ctx->analog_mode = ANALOG_MINMAX;
+	} else {
+		sr_err("Unknown analog mode '%s'.", s);
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+
+	s = g_variant_get_string(g_hash_table_lookup(options, "logic"), NULL);
+	if (!strcmp(s, "sample")) {
+		ctx->logic_mode = LOGIC_SAMPLE;
+	} else if (!strcmp(s, "transitions")) {
+		ctx->logic_mode = LOGIC_TRANSITIONS;
+	} else {
+		sr_err("Unknown logic mode '%s'.", s);
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+
+	if (!ctx->factor)
+		ctx->factor = 1;
+	ctx->streams = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, stream_free);
+
+	if (sr_config_get(t->sdi->driver, t->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		ctx->in_rate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	update_factor(ctx);
+
+	return SR_OK;
+}
+
+/* OR the transitions between successive samples into acc. */
+static void or_transitions(uint8_t *acc, const uint8_t *prev,
+		const uint8_t *data, uint64_t count, size_t unitsize)
+{
+	uint8_t lanes[LANE_BYTES];
+	size_t i, len, pos;
+
+	for (i = 0; i < unitsize; i++)
+		acc[i] |= data[i] ^ prev[i];
+
+	len = count * unitsize;
+	pos = unitsize;
+	if (LANE_BYTES % unitsize == 0) {
+		/*
+		 * Byte i of a block always belongs to the same byte of
+		 * the sample, accumulate whole blocks before folding
+		 * them into the sample's bytes.
+		 */
+		memset(lanes, 0, sizeof(lanes));
+		for (; pos + LANE_BYTES <= len; pos += LANE_BYTES) {
+			for (i = 0; i < LANE_BYTES; i++)
+				lanes[i] |= data[pos + i] ^ data[pos + i - unitsize];
+		}
+		for (i = 0; i < LANE_BYTES; i++)
+			acc[i % unitsize] |= lanes[i];
+	}
+	for (; pos < len; pos++)
+		acc[pos % unitsize] |= data[pos] ^ data[pos - unitsize];
+}
+
+static int decimate_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic,
+		struct sr_datafeed_packet **packet_out)
+{
+	const uint8_t *data, *prev;
+	uint8_t *out;
+	uint64_t count, pos, take, out_count;
+	size_t unitsize, size, i;
+
+	unitsize = logic->unitsize;
+	if (!unitsize)
+		return SR_ERR_ARG;
+	count = logic->length / unitsize;
+	data = logic->data;
+	if (!count)
+		return SR_OK;
+
+	if (unitsize != ctx->unitsize) {
+		ctx->logic_ref = g_realloc(ctx->logic_ref, unitsize);
+		ctx->logic_last = g_realloc(ctx->logic_last, unitsize);
+		ctx->logic_acc = g_realloc(ctx->logic_acc, unitsize);
+		ctx->unitsize = unitsize;
+		ctx->logic_started = FALSE;
+		ctx->logic_fill = 0;
+	}
+	if (!ctx->logic_started) {
+		memcpy(ctx->logic_ref, data, unitsize);
+		memcpy(ctx->logic_last, data, unitsize);
+		memset(ctx->logic_acc, 0, unitsize);
+		ctx->logic_started = TRUE;
+	}
+
+	size = (count / ctx->factor + 1) * unitsize;
+	if (size > ctx->logic_buf_size) {
+		ctx->logic_buf = g_realloc(ctx->logic_buf, size);
+		ctx->logic_buf_size = size;
+	}
+	out = ctx->logic_buf;
+	out_count = 0;
+
+	for (pos = 0; pos < count; pos += take) {
+		take = ctx->factor - ctx->logic_fill;
+		if (take > count - pos)
+			take = count - pos;
+
+		if (ctx->logic_mode == LOGIC_SAMPLE) {
+			if (!ctx->logic_fill)
+				memcpy(ctx->logic_acc, data + pos * unitsize, unitsize);
+		} else {
+			prev = pos ? data + (pos - 1) * unitsize : ctx->logic_last;
+			or_transitions(ctx->logic_acc, prev,
+				data + pos * unitsize, take, unitsize);
+		}
+
+		ctx->logic_fill += take;
+		if (ctx->logic_fill < ctx->factor)
+			continue;
+
+		/* Interval complete, emit its sample. */
+		if (ctx->logic_mode == LOGIC_SAMPLE) {
+			memcpy(out, ctx->logic_acc, unitsize);
+		} else {
+			for (i = 0; i < unitsize; i++)
+				out[i] = ctx->logic_ref[i] ^ ctx->logic_acc[i];
+			memcpy(ctx->logic_ref, data + (pos + take - 1) * unitsize,
+				unitsize);
+			memset(ctx->logic_acc, 0, unitsize);
+		}
+		out += unitsize;
+		out_count++;
+		ctx->logic_fill = 0;
+	}
+	memcpy(ctx->logic_last, data + (count - 1) * unitsize, unitsize);
+
+	if (!out_count)
+		return SR_OK;
+
+	ctx->logic.length = out_count * unitsize;
+	ctx->logic.unitsize = unitsize;
+	ctx->logic.data = ctx->logic_buf;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* Fold count values (at the given stride) into one lane's interval. */
+static void reduce_lane(struct context *ctx, struct analog_stream *s,
+		size_t lane, const float *v, uint64_t count, size_t stride)
+{
+	float mn, mx, val;
+	double sum;
+	uint64_t i;
+
+	switch (ctx->analog_mode) {
+	case ANALOG_MEAN:
+		sum = 0.0;
+		for (i = 0; i < count; i++)
+			sum += v[i * stride];
+		s->sum[lane] += sum;
+		break;
+	case ANALOG_MIN:
+		mn = s->min[lane];
+		for (i = 0; i < count; i++) {
+			val = v[i * stride];
+			mn = val < mn ? val : mn;
+		}
+		s->min[lane] = mn;
+		break;
+	case ANALOG_MAX:
+		mx = s->max[lane];
+		for (i = 0; i < count; i++) {
+			val = v[i * stride];
+			mx = val > mx ? val : mx;
+		}
+		s->max[lane] = mx;
+		break;
+	case ANALOG_MINMAX:
+		mn = s->min[lane];
+		mx = s->max[lane];
+		for (i = 0; i < count; i++) {
+			val = v[i * stride];
+			mn = val < mn ? val : mn;
+			mx = val > mx ? val : mx;
+		}
+		/* Only locate the extremes when they have changed. */
+		if (mn < s->min[lane]) {
+			for (i = 0; v[i * stride] != mn; i++)
+				;
+			s->min[lane] = mn;
+			s->min_pos[lane] = s->fill + i;
+		}
+		if (mx > s->max[lane]) {
+			for (i = 0; v[i * stride] != mx; i++)
+				;
+			s->max[lane] = mx;
+			s->max_pos[lane] = s->fill + i;
+		}
+		break;
+	}
+}
+
+static int decimate_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct analog_stream *s;
+	const float *in;
+	float *out;
+	uint64_t count, pos, take, interval, out_count;
+	size_t lanes, lane, per_interval, size;
+	int ret;
+
+	if (!analog->meaning || !analog->meaning->channels)
+		return SR_ERR_ARG;
+	lanes = g_slist_length(analog->meaning->channels);
+	count = analog->num_samples;
+	if (!count)
+		return SR_OK;
+
+	size = count * lanes;
+	if (size > ctx->in_floats_size) {
+		ctx->in_floats = g_realloc(ctx->in_floats, size * sizeof(float));
+		ctx->in_floats_size = size;
+	}
+	ret = sr_analog_to_float(analog, ctx->in_floats);
+	if (ret != SR_OK)
+		return ret;
+	in = ctx->in_floats;
+
+	per_interval = ctx->analog_mode == ANALOG_MINMAX ? 2 : 1;
+	interval = ctx->factor * per_interval;
+	size = (count / interval + 1) * per_interval * lanes;
+	if (size > ctx->out_floats_size) {
+		ctx->out_floats = g_realloc(ctx->out_floats, size * sizeof(float));
+		ctx->out_floats_size = size;
+	}
+	out = ctx->out_floats;
+	out_count = 0;
+
+	s = stream_get(ctx, analog->meaning->channels->data, lanes);
+	for (pos = 0; pos < count; pos += take) {
+		take = interval - s->fill;
+		if (take > count - pos)
+			take = count - pos;
+
+		for (lane = 0; lane < lanes; lane++)
+			reduce_lane(ctx, s, lane, in + pos * lanes + lane,
+				take, lanes);
+		s->fill += take;
+		if (s->fill < interval)
+			continue;
+
+		/* Interval complete, emit its samples. */
+		for (lane = 0; lane < lanes; lane++) {
+			switch (ctx->analog_mode) {
+			case ANALOG_MEAN:
+				out[lane] = s->sum[lane] / interval;
+				break;
+			case ANALOG_MIN:
+				out[lane] = s->min[lane];
+				break;
+			case ANALOG_MAX:
+				out[lane] = s->max[lane];
+				break;
+			case ANALOG_MINMAX:
+				if (s->max_pos[lane] < s->min_pos[lane]) {
+					out[lane] = s->max[lane];
+					out[lanes + lane] = s->min[lane];
+				} else {
+					out[lane] = s->min[lane];
+					out[lanes + lane] = s->max[lane];
+				}
+				break;
+			}
+		}
+		out += per_interval * lanes;
+		out_count += per_interval;
+		stream_reset(s);
+	}
+
+	if (!out_count)
+		return SR_OK;
+
+	ctx->encoding = *analog->encoding;
+	ctx->encoding.unitsize = sizeof(float);
+	ctx->encoding.is_signed = TRUE;
+	ctx->encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	ctx->encoding.is_bigendian = TRUE;
+#else
+	ctx->encoding.is_bigendian = FALSE;
+#endif
+	ctx->encoding.scale.p = 1;
+	ctx->encoding.scale.q = 1;
+	ctx->encoding.offset.p = 0;
+	ctx->encoding.offset.q = 1;
+
+	ctx->analog.data = ctx->out_floats;
+	ctx->analog.num_samples = out_count;
+	ctx->analog.encoding = &ctx->encoding;
+	ctx->analog.meaning = analog->meaning;
+	ctx->analog.spec = analog->spec;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* Track the input samplerate, and announce the output samplerate. */
+static void rewrite_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_config *src;
+	GSList *l;
+	gboolean have_rate;
+
+	have_rate = FALSE;
+	for (l = meta_in->config; l; l = l->next) {
+		src = l->data;
+		if (src->key != SR_CONF_SAMPLERATE)
+			continue;
+		ctx->in_rate = g_variant_get_uint64(src->data);
+		have_rate = TRUE;
+	}
+	if (!have_rate)
+		return;
+	update_factor(ctx);
+	if (ctx->factor == 1)
+		return;
+
+	g_slist_free(ctx->meta.config);
+	ctx->meta.config = NULL;
+	if (ctx->rate_config.data)
+		g_variant_unref(ctx->rate_config.data);
+	ctx->rate_config.key = SR_CONF_SAMPLERATE;
+	ctx->rate_config.data = g_variant_ref_sink(
+		g_variant_new_uint64(ctx->in_rate / ctx->factor));
+
+	for (l = meta_in->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_SAMPLERATE)
+			src = &ctx->rate_config;
+		ctx->meta.config = g_slist_append(ctx->meta.config, (void *)src);
+	}
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->meta;
+	*packet_out = &ctx->packet;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_META:
+		*packet_out = packet_in;
+		rewrite_meta(ctx, packet_in->payload, packet_out);
+		return SR_OK;
+	case SR_DF_LOGIC:
+		*packet_out = NULL;
+		if (ctx->factor == 1)
+			break;
+		return decimate_logic(ctx, packet_in->payload, packet_out);
+	case SR_DF_ANALOG:
+		*packet_out = NULL;
+		if (ctx->factor == 1)
+			break;
+		return decimate_analog(ctx, packet_in->payload, packet_out);
+	case SR_DF_END:
+		reset_intervals(ctx);
+		break;
+	default:
+		break;
+	}
+
+	*packet_out = packet_in;
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	g_hash_table_destroy(ctx->streams);
+	g_slist_free(ctx->meta.config);
+	if (ctx->rate_config.data)
+		g_variant_unref(ctx->rate_config.data);
+	g_free(ctx->logic_ref);
+	g_free(ctx->logic_last);
+	g_free(ctx->logic_acc);
+	g_free(ctx->logic_buf);
+	g_free(ctx->in_floats);
+	g_free(ctx->out_floats);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of input samples per output sample", NULL, NULL },
+	{ "samplerate", "Samplerate", "Target samplerate, overrides the factor (0 = unused)", NULL, NULL },
+	{ "analog", "Analog mode", "Reduction of analog intervals (mean, min, max, minmax)", NULL, NULL },
+	{ "logic", "Logic mode", "Reduction of logic intervals (sample, transitions)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(1));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[2].def = g_variant_ref_sink(g_variant_new_string("mean"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("mean")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("min")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("max")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("minmax")));
+		options[2].values = l;
+		options[3].def = g_variant_ref_sink(g_variant_new_string("transitions"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("sample")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("transitions")));
+		options[3].values = l;
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_decimate = {
+	.id = "decimate",
+	.name = "Decimate",
+	.desc = "Reduce the samplerate, keeping peaks and glitches",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
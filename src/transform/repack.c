@@ -0,0 +1,360 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Compact a subset of the logic channels into the smallest unit size.
+ *
+ * Drivers send all their logic channels' bits, even when only a few of
+ * the channels are enabled. This transform extracts the selected
+ * channels' bits, and packs them into consecutive bits of samples which
+ * are just large enough.
+ *
+ * The selection is taken when the header packet passes. Bit n of the
+ * compacted samples then holds the n-th selected channel, counted in
+ * the order of the channels' indices. The device's channels are left
+ * alone, drivers keep using them while the acquisition runs. Output
+ * modules find the channels' compacted positions through
+ * sr_transform_logic_bit().
+ *
+ * Bits get extracted with per-byte lookup tables, which work like
+ * parallel bit extraction instructions without depending on them.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/repack"
+
+/* How to extract the selected bits of one byte of the input samples. */
+struct byte_map {
+	size_t in_byte;
+	size_t out_byte;
+	unsigned int shift;
+	unsigned int width;
+	uint8_t table[256];
+};
+
+struct context {
+	char **names;
+	/* Indices of the selected channels, in ascending order. */
+	GArray *selected;
+	gboolean active;
+
+	/* Extraction plan, for the input unit size it was made for. */
+	size_t in_unitsize;
+	size_t out_unitsize;
+	gboolean passthrough;
+	struct byte_map *maps;
+	size_t map_count;
+
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t *buf;
+	size_t buf_size;
+};
+
+static gboolean name_selected(char **names, const char *name)
+{
+	size_t i;
+
+	if (!names || !names[0] || !names[0][0])
+		return TRUE;
+	for (i = 0; names[i]; i++) {
+		if (!strcmp(names[i], name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	size_t i;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->names = g_strsplit(g_variant_get_string(g_hash_table_lookup(options,
+		"channels"), NULL), ",", 0);
+	for (i = 0; ctx->names[i]; i++)
+		g_strstrip(ctx->names[i]);
+	ctx->selected = g_array_new(FALSE, FALSE, sizeof(int));
+
+	return SR_OK;
+}
+
+static int cmp_index(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/* Take the selection of logic channels, for the upcoming acquisition. */
+static void select_channels(const struct sr_transform *t,
+		struct context *ctx)
+{
+	const struct sr_channel *ch;
+	GSList *l;
+	int index, lowest_other;
+
+	g_array_set_size(ctx->selected, 0);
+	lowest_other = G_MAXINT;
+	for (l = t->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		if (ch->enabled && name_selected(ctx->names, ch->name))
+			g_array_append_val(ctx->selected, ch->index);
+		else if (ch->index < lowest_other)
+			lowest_other = ch->index;
+	}
+	g_array_sort(ctx->selected, cmp_index);
+	ctx->out_unitsize = (ctx->selected->len + 7) / 8;
+	ctx->in_unitsize = 0;
+	g_free(ctx->maps);
+	ctx->maps = NULL;
+	ctx->map_count = 0;
+
+	/*
+	 * Data passes unmodified when the selected channels already are
+	 * at their compacted positions, and the other channels' bits are
+	 * not within the compacted samples.
+	 */
+	ctx->passthrough = lowest_other >= (int)(8 * ctx->out_unitsize);
+	for (index = 0; index < (int)ctx->selected->len; index++) {
+		if (g_array_index(ctx->selected, int, index) != index)
+			ctx->passthrough = FALSE;
+	}
+	ctx->active = TRUE;
+
+	sr_dbg("Compacting %u logic channels into %zu byte(s).",
+		ctx->selected->len, ctx->out_unitsize);
+}
+
+/*
+ * Plan the extraction for an input unit size: for every input byte
+ * which holds selected channels, tabulate the compacted bits of all
+ * 256 byte values, and the position where they go in the output.
+ */
+static void make_plan(struct context *ctx, size_t unitsize)
+{
+	struct byte_map *map;
+	size_t byte, i;
+	unsigned int value, bit, width, out_bit;
+	int index;
+	uint8_t mask;
+
+	g_free(ctx->maps);
+	ctx->maps = g_malloc0(unitsize * sizeof(*ctx->maps));
+	ctx->map_count = 0;
+	ctx->in_unitsize = unitsize;
+
+	/*
+	 * The selected channels keep their original order, so the bits
+	 * of an input byte end up in consecutive output bits.
+	 */
+	out_bit = 0;
+	for (byte = 0; byte < unitsize; byte++) {
+		mask = 0;
+		for (i = 0; i < ctx->selected->len; i++) {
+			index = g_array_index(ctx->selected, int, i);
+			if ((size_t)index / 8 == byte)
+				mask |= 1 << (index % 8);
+		}
+		if (!mask)
+			continue;
+
+		map = &ctx->maps[ctx->map_count++];
+		map->in_byte = byte;
+		map->out_byte = out_bit / 8;
+		map->shift = out_bit % 8;
+		for (value = 0; value < 256; value++) {
+			width = 0;
+			for (bit = 0; bit < 8; bit++) {
+				if (!(mask & (1 << bit)))
+					continue;
+				if (value & (1 << bit))
+					map->table[value] |= 1 << width;
+				width++;
+			}
+		}
+		map->width = width;
+		out_bit += width;
+	}
+}
+
+/*
+ * Compact the samples one input byte at a time, so that the loops only
+ * do a table lookup and a store per sample.
+ */
+static void compact(const struct context *ctx, const uint8_t *in,
+		uint8_t *out, uint64_t count)
+{
+	const struct byte_map *map;
+	const uint8_t *src, *table;
+	uint8_t *dst;
+	size_t in_size, out_size, i;
+	unsigned int shift;
+	uint64_t n;
+
+	in_size = ctx->in_unitsize;
+	out_size = ctx->out_unitsize;
+
+	memset(out, 0, count * out_size);
+	for (i = 0; i < ctx->map_count; i++) {
+		map = &ctx->maps[i];
+		src = in + map->in_byte;
+		dst = out + map->out_byte;
+		table = map->table;
+		shift = map->shift;
+		if (shift + map->width <= 8) {
+			for (n = 0; n < count; n++)
+				dst[n * out_size] |= table[src[n * in_size]] << shift;
+		} else {
+			/* The bits straddle two output bytes. */
+			for (n = 0; n < count; n++) {
+				dst[n * out_size] |= table[src[n * in_size]] << shift;
+				dst[n * out_size + 1] |= table[src[n * in_size]] >> (8 - shift);
+			}
+		}
+	}
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	uint64_t count;
+	size_t size;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		select_channels(t, ctx);
+		break;
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!ctx->active || !logic->unitsize)
+			break;
+		if (ctx->passthrough && logic->unitsize == ctx->out_unitsize)
+			break;
+		if (logic->unitsize != ctx->in_unitsize)
+			make_plan(ctx, logic->unitsize);
+
+		count = logic->length / logic->unitsize;
+		size = count * ctx->out_unitsize;
+		if (size > ctx->buf_size) {
+			ctx->buf = g_realloc(ctx->buf, size);
+			ctx->buf_size = size;
+		}
+		compact(ctx, logic->data, ctx->buf, count);
+
+		ctx->logic.length = size;
+		ctx->logic.unitsize = ctx->out_unitsize;
+		ctx->logic.data = ctx->buf;
+		ctx->packet.type = SR_DF_LOGIC;
+		ctx->packet.payload = &ctx->logic;
+		*packet_out = size ? &ctx->packet : NULL;
+		break;
+	case SR_DF_END:
+		ctx->active = FALSE;
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Output modules ask before the header packet passes, when they set up.
+ * Take the selection early then, the header takes it again from the
+ * same channel states.
+ */
+static int logic_bit(const struct sr_transform *t, int bit)
+{
+	struct context *ctx;
+	size_t i;
+
+	if (!t || !t->sdi || !(ctx = t->priv))
+		return -1;
+
+	if (!ctx->active)
+		select_channels(t, ctx);
+	for (i = 0; i < ctx->selected->len; i++) {
+		if (g_array_index(ctx->selected, int, i) == bit)
+			return i;
+	}
+
+	return -1;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	g_strfreev(ctx->names);
+	g_array_free(ctx->selected, TRUE);
+	g_free(ctx->maps);
+	g_free(ctx->buf);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated names of the logic channels to keep (empty = all enabled)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_repack = {
+	.id = "repack",
+	.name = "Repack",
+	.desc = "Compact logic channels into the smallest unit size",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+	.logic_bit = logic_bit,
+};
@@ -0,0 +1,530 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Convert analog channels to logic channels.
+ *
+ * Every selected analog channel gets a logic channel added to the
+ * device, which is named after the analog channel with an "_L" suffix.
+ * The logic channels get the indices which follow the device's own
+ * channels, and the logic samples carry each channel's state in the
+ * bit of its index. Analog packets of the selected channels get
+ * replaced by logic packets, other packets pass through unmodified.
+ *
+ * Devices typically send the analog channels' data in separate packets.
+ * The channels' logic states get buffered as bitmaps until all selected
+ * channels have data for a sample, and then get transposed into logic
+ * samples eight samples at a time.
+ *
+ * Devices which have logic channels of their own keep them. Their logic
+ * samples get buffered as well, and get sent with the converted states
+ * in the bits after the device's channels, in a larger unit size when
+ * necessary.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/threshold"
+
+struct a2l_channel {
+	struct sr_channel *analog;
+	struct sr_channel *logic;
+	uint8_t state;
+	/* Logic states which were not sent yet, as a bitmap. */
+	uint8_t *bits;
+	uint64_t pending;
+	size_t bits_size;
+};
+
+struct context {
+	float lo_thr, hi_thr;
+	gboolean schmitt;
+	size_t count;
+	struct a2l_channel *channels;
+	/* Index of the first logic channel, and bit position in samples. */
+	size_t base;
+	size_t unitsize;
+	gboolean warned;
+
+	/* The device's logic samples not sent yet, at the output unit size. */
+	gboolean merge;
+	uint8_t *dev_mask;
+	uint8_t *dev_buf;
+	size_t dev_buf_size;
+	uint64_t dev_pending;
+
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t *logic_buf;
+	size_t logic_buf_size;
+	float *floats;
+	size_t floats_size;
+	uint8_t *scratch;
+	size_t scratch_size;
+};
+
+static gboolean name_selected(char **names, const char *name)
+{
+	size_t i;
+
+	if (!names || !names[0])
+		return TRUE;
+	for (i = 0; names[i]; i++) {
+		if (!strcmp(g_strstrip(names[i]), name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void remove_logic_channels(struct sr_dev_inst *sdi,
+		struct context *ctx)
+{
+	size_t i;
+
+	for (i = 0; i < ctx->count; i++) {
+		if (!ctx->channels[i].logic)
+			continue;
+		sdi->channels = g_slist_remove(sdi->channels,
+			ctx->channels[i].logic);
+		sr_channel_free(ctx->channels[i].logic);
+		ctx->channels[i].logic = NULL;
+	}
+}
+
+static void free_context(struct sr_dev_inst *sdi, struct context *ctx)
+{
+	size_t i;
+
+	remove_logic_channels(sdi, ctx);
+	for (i = 0; i < ctx->count; i++)
+		g_free(ctx->channels[i].bits);
+	g_free(ctx->channels);
+	g_free(ctx->dev_mask);
+	g_free(ctx->dev_buf);
+	g_free(ctx->logic_buf);
+	g_free(ctx->floats);
+	g_free(ctx->scratch);
+	g_free(ctx);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	GSList *l, *selected;
+	char **names, *name;
+	double threshold, hysteresis;
+	gboolean merge;
+	size_t i, base;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+	sdi = (struct sr_dev_inst *)t->sdi;
+
+	threshold = g_variant_get_double(g_hash_table_lookup(options, "threshold"));
+	hysteresis = g_variant_get_double(g_hash_table_lookup(options, "hysteresis"));
+	if (hysteresis < 0) {
+		sr_err("Hysteresis must not be negative.");
+		return SR_ERR_ARG;
+	}
+
+	selected = NULL;
+	merge = FALSE;
+	base = 0;
+	names = g_strsplit(g_variant_get_string(g_hash_table_lookup(options,
+		"channels"), NULL), ",", 0);
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC && ch->enabled)
+			merge = TRUE;
+		if ((size_t)ch->index >= base)
+			base = ch->index + 1;
+		if (ch->type == SR_CHANNEL_ANALOG && ch->enabled &&
+				name_selected(names, ch->name))
+			selected = g_slist_append(selected, ch);
+	}
+	g_strfreev(names);
+	if (!selected) {
+		sr_err("No analog channels to convert.");
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->lo_thr = threshold - hysteresis / 2;
+	ctx->hi_thr = threshold + hysteresis / 2;
+	ctx->schmitt = hysteresis > 0;
+	ctx->count = g_slist_length(selected);
+	ctx->base = base;
+	ctx->unitsize = (base + ctx->count + 7) / 8;
+	if ((ctx->merge = merge)) {
+		/* Only keep the bits of the device's logic channels. */
+		ctx->dev_mask = g_malloc0(ctx->unitsize);
+		for (l = sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (ch->type == SR_CHANNEL_LOGIC)
+				ctx->dev_mask[ch->index / 8] |= 1 << (ch->index % 8);
+		}
+	}
+	ctx->channels = g_malloc0(ctx->count * sizeof(*ctx->channels));
+	for (i = 0, l = selected; l; i++, l = l->next) {
+		ch = l->data;
+		ctx->channels[i].analog = ch;
+		name = g_strdup_printf("%s_L", ch->name);
+		ctx->channels[i].logic = sr_channel_new(sdi, base + i,
+			SR_CHANNEL_LOGIC, TRUE, name);
+		g_free(name);
+	}
+	g_slist_free(selected);
+
+	return SR_OK;
+}
+
+static struct a2l_channel *find_channel(struct context *ctx,
+		const struct sr_channel *ch)
+{
+	size_t i;
+
+	for (i = 0; i < ctx->count; i++) {
+		if (ctx->channels[i].analog == ch)
+			return &ctx->channels[i];
+	}
+
+	return NULL;
+}
+
+/* Append count bits to a channel's bitmap of pending states. */
+static void append_bits(struct a2l_channel *ch, const uint8_t *src,
+		uint64_t count)
+{
+	uint8_t *dst;
+	size_t size, nbytes, i;
+	unsigned int shift;
+
+	/* Keep a spare byte, shifting writes into the next byte. */
+	size = (ch->pending + count + 7) / 8 + 1;
+	if (size > ch->bits_size) {
+		ch->bits = g_realloc(ch->bits, size);
+		memset(ch->bits + ch->bits_size, 0, size - ch->bits_size);
+		ch->bits_size = size;
+	}
+
+	dst = ch->bits + ch->pending / 8;
+	shift = ch->pending % 8;
+	nbytes = (count + 7) / 8;
+	if (!shift) {
+		memcpy(dst, src, nbytes);
+	} else {
+		for (i = 0; i < nbytes; i++) {
+			dst[i] |= src[i] << shift;
+			dst[i + 1] = src[i] >> (8 - shift);
+		}
+	}
+	ch->pending += count;
+}
+
+/* Drop the first count bits from a channel's bitmap of pending states. */
+static void consume_bits(struct a2l_channel *ch, uint64_t count)
+{
+	uint64_t remain;
+	size_t skip, nbytes, i;
+	unsigned int shift;
+
+	remain = ch->pending - count;
+	skip = count / 8;
+	shift = count % 8;
+	nbytes = (remain + 7) / 8;
+	if (!shift) {
+		memmove(ch->bits, ch->bits + skip, nbytes);
+	} else {
+		for (i = 0; i < nbytes; i++) {
+			ch->bits[i] = (ch->bits[skip + i] >> shift) |
+				(ch->bits[skip + i + 1] << (8 - shift));
+		}
+	}
+	/* Keep the bits after the pending states cleared. */
+	memset(ch->bits + nbytes, 0, ch->bits_size - nbytes);
+	if (remain % 8)
+		ch->bits[nbytes - 1] &= (1 << (remain % 8)) - 1;
+	ch->pending = remain;
+}
+
+/*
+ * Transpose an 8x8 bit matrix: bit c of byte r becomes bit r of byte c.
+ * This turns the states of eight channels for eight samples into eight
+ * samples of eight channels.
+ */
+static inline uint64_t transpose8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+/* Interleave the pending states of all channels into logic samples. */
+static void pack_samples(struct context *ctx, uint64_t count)
+{
+	uint8_t *out;
+	struct a2l_channel *ch;
+	uint64_t group, groups, matrix;
+	size_t byte, pos, first, end, i, n;
+
+	out = ctx->logic_buf;
+	end = ctx->base + ctx->count;
+	groups = (count + 7) / 8;
+	for (group = 0; group < groups; group++) {
+		n = count - group * 8 < 8 ? count - group * 8 : 8;
+		for (byte = 0; byte < ctx->unitsize; byte++) {
+			/* Bytes below the first channel's bit stay zero. */
+			first = byte * 8;
+			matrix = 0;
+			pos = MAX(first, ctx->base);
+			for (; pos < first + 8 && pos < end; pos++) {
+				ch = &ctx->channels[pos - ctx->base];
+				matrix |= (uint64_t)ch->bits[group]
+					<< ((pos - first) * 8);
+			}
+			matrix = transpose8(matrix);
+			for (i = 0; i < n; i++)
+				out[i * ctx->unitsize + byte] = matrix >> (i * 8);
+		}
+		out += n * ctx->unitsize;
+	}
+}
+
+/* Buffer the device's logic samples until converted states are ready. */
+static void append_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *src;
+	uint8_t *dst;
+	uint64_t count, i;
+	size_t size, n, b;
+
+	if (!logic->unitsize)
+		return;
+	count = logic->length / logic->unitsize;
+	size = (ctx->dev_pending + count) * ctx->unitsize;
+	if (size > ctx->dev_buf_size) {
+		ctx->dev_buf = g_realloc(ctx->dev_buf, size);
+		ctx->dev_buf_size = size;
+	}
+
+	src = logic->data;
+	dst = ctx->dev_buf + ctx->dev_pending * ctx->unitsize;
+	n = MIN(logic->unitsize, ctx->unitsize);
+	memset(dst, 0, count * ctx->unitsize);
+	for (i = 0; i < count; i++) {
+		for (b = 0; b < n; b++)
+			dst[b] = src[b] & ctx->dev_mask[b];
+		src += logic->unitsize;
+		dst += ctx->unitsize;
+	}
+	ctx->dev_pending += count;
+}
+
+/* Send the samples which all channels have states for. */
+static int send_ready(struct context *ctx,
+		struct sr_datafeed_packet **packet_out)
+{
+	uint64_t ready;
+	size_t size, i;
+
+	ready = ctx->channels[0].pending;
+	for (i = 1; i < ctx->count; i++) {
+		if (ctx->channels[i].pending < ready)
+			ready = ctx->channels[i].pending;
+	}
+	if (ctx->merge && ctx->dev_pending < ready)
+		ready = ctx->dev_pending;
+	if (!ready)
+		return SR_OK;
+
+	size = ready * ctx->unitsize;
+	if (size > ctx->logic_buf_size) {
+		ctx->logic_buf = g_realloc(ctx->logic_buf, size);
+		ctx->logic_buf_size = size;
+	}
+	pack_samples(ctx, ready);
+	for (i = 0; i < ctx->count; i++)
+		consume_bits(&ctx->channels[i], ready);
+	if (ctx->merge) {
+		for (i = 0; i < size; i++)
+			ctx->logic_buf[i] |= ctx->dev_buf[i];
+		ctx->dev_pending -= ready;
+		memmove(ctx->dev_buf, ctx->dev_buf + size,
+			ctx->dev_pending * ctx->unitsize);
+	}
+
+	ctx->logic.length = size;
+	ctx->logic.unitsize = ctx->unitsize;
+	ctx->logic.data = ctx->logic_buf;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int convert(struct context *ctx,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct a2l_channel *ch;
+	uint64_t count;
+	size_t size;
+	int ret;
+
+	count = analog->num_samples;
+	ch = find_channel(ctx, analog->meaning->channels->data);
+
+	if (count > ctx->floats_size) {
+		ctx->floats = g_realloc(ctx->floats, count * sizeof(float));
+		ctx->floats_size = count;
+	}
+	ret = sr_analog_to_float(analog, ctx->floats);
+	if (ret != SR_OK)
+		return ret;
+
+	size = (count + 7) / 8;
+	if (size > ctx->scratch_size) {
+		ctx->scratch = g_realloc(ctx->scratch, size);
+		ctx->scratch_size = size;
+	}
+	if (ctx->schmitt)
+		sr_a2l_schmitt_trigger_packed(ctx->floats, count,
+			ctx->lo_thr, ctx->hi_thr, &ch->state, ctx->scratch);
+	else
+		sr_a2l_threshold_packed(ctx->floats, count,
+			ctx->lo_thr, ctx->scratch);
+	append_bits(ch, ctx->scratch, count);
+
+	return send_ready(ctx, packet_out);
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_analog *analog;
+	size_t i;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_ANALOG:
+		analog = packet_in->payload;
+		if (!analog->meaning || !analog->meaning->channels)
+			break;
+		if (!find_channel(ctx, analog->meaning->channels->data))
+			break;
+		if (analog->meaning->channels->next) {
+			if (!ctx->warned)
+				sr_warn("Not converting multi-channel packets.");
+			ctx->warned = TRUE;
+			break;
+		}
+		*packet_out = NULL;
+		return convert(ctx, analog, packet_out);
+	case SR_DF_LOGIC:
+		if (!ctx->merge)
+			break;
+		*packet_out = NULL;
+		append_logic(ctx, packet_in->payload);
+		return send_ready(ctx, packet_out);
+	case SR_DF_END:
+		/*
+		 * Drop the states of incomplete samples. The next acquisition
+		 * starts over with low Schmitt trigger states.
+		 */
+		ctx->dev_pending = 0;
+		for (i = 0; i < ctx->count; i++) {
+			ctx->channels[i].state = 0;
+			ctx->channels[i].pending = 0;
+			if (ctx->channels[i].bits)
+				memset(ctx->channels[i].bits, 0,
+					ctx->channels[i].bits_size);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+	if (!ctx)
+		return SR_OK;
+
+	free_context((struct sr_dev_inst *)t->sdi, ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated names of the analog channels to convert (empty = all)", NULL, NULL },
+	{ "threshold", "Threshold", "Value at which the logic state changes", NULL, NULL },
+	{ "hysteresis", "Hysteresis", "Width of the band around the threshold which keeps the state (0 = none)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+		options[1].def = g_variant_ref_sink(g_variant_new_double(1.5));
+		options[2].def = g_variant_ref_sink(g_variant_new_double(0.0));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_threshold = {
+	.id = "threshold",
+	.name = "Threshold",
+	.desc = "Convert analog channels to logic channels",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
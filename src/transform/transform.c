@@ -45,12 +45,18 @@
 extern SR_PRIV struct sr_transform_module transform_nop;
 extern SR_PRIV struct sr_transform_module transform_scale;
 extern SR_PRIV struct sr_transform_module transform_invert;
+extern SR_PRIV struct sr_transform_module transform_decimate;
+extern SR_PRIV struct sr_transform_module transform_threshold;
+extern SR_PRIV struct sr_transform_module transform_repack;
 /** @endcond */
 
 static const struct sr_transform_module *transform_module_list[] = {
 	&transform_nop,
 	&transform_scale,
 	&transform_invert,
+	&transform_decimate,
+	&transform_threshold,
+	&transform_repack,
 	NULL,
 };
 
@@ -276,6 +282,11 @@ SR_API int sr_transform_free(const struct sr_transform *t)
 	if (!t)
 		return SR_ERR_ARG;
 
+	/* Output modules look up the session's transforms, too. */
+	if (t->sdi && t->sdi->session)
+		t->sdi->session->transforms = g_slist_remove(
+			t->sdi->session->transforms, t);
+
 	ret = SR_OK;
 	if (t->module->cleanup)
 		ret = t->module->cleanup((struct sr_transform *)t);
@@ -284,4 +295,41 @@ SR_API int sr_transform_free(const struct sr_transform *t)
 	return ret;
 }
 
+/**
+ * Get the bit position of a logic channel in the samples which leave
+ * the session's transforms.
+ *
+ * Transforms may move or drop logic channels' bits. Output modules use
+ * this instead of the channel's index, to find the channel's data.
+ *
+ * @param sdi The device the samples come from.
+ * @param ch The logic channel.
+ *
+ * @return The bit position, or -1 when the channel's bit got dropped.
+ *
+ * @private
+ */
+SR_PRIV int sr_transform_logic_bit(const struct sr_dev_inst *sdi,
+		const struct sr_channel *ch)
+{
+	const struct sr_transform *t;
+	GSList *l;
+	int bit;
+
+	if (!sdi || !ch)
+		return -1;
+
+	bit = ch->index;
+	if (!sdi->session)
+		return bit;
+	for (l = sdi->session->transforms; l && bit >= 0; l = l->next) {
+		t = l->data;
+		if (t->sdi != sdi || !t->module->logic_bit)
+			continue;
+		bit = t->module->logic_bit(t, bit);
+	}
+
+	return bit;
+}
+
 /** @} */
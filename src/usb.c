@@ -120,6 +120,7 @@ static gboolean usb_source_dispatch(GSource *source,
 	GPollFD *pollfd;
 	unsigned int revents;
 	unsigned int i;
+	int64_t ready_us;
 	gboolean keep;
 
 	usource = (struct usb_source *)source;
@@ -138,6 +139,11 @@ static gboolean usb_source_dispatch(GSource *source,
 		sr_err("Callback not set, cannot dispatch event.");
 		return G_SOURCE_REMOVE;
 	}
+	if (sr_session_instr_get(usource->session)) {
+		ready_us = revents ? g_source_get_time(source) : usource->due_us;
+		sr_session_stats_lag(usource->session, SR_SESSION_SOURCE_USB,
+			g_get_monotonic_time() - ready_us);
+	}
 	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, revents, user_data);
 
 	if (G_LIKELY(keep) && G_LIKELY(!g_source_is_destroyed(source))) {
@@ -165,8 +171,10 @@ static void usb_source_finalize(GSource *source)
 	g_ptr_array_unref(usource->pollfds);
 	usource->pollfds = NULL;
 
-	sr_session_source_destroyed(usource->session,
-			usource->usb_ctx, source);
+	/* Not set when the source never got registered. */
+	if (usource->session)
+		sr_session_source_destroyed(usource->session,
+				usource->usb_ctx, source);
 }
 
 /** Callback invoked when a new libusb FD should be added to the poll set.
@@ -506,6 +514,8 @@ SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
 
 	ret = sr_session_source_add_internal(session, ctx->libusb_ctx, source);
+	if (ret != SR_OK)
+		((struct usb_source *)source)->session = NULL;
 	g_source_unref(source);
 
 	return ret;
@@ -268,6 +268,134 @@ START_TEST(test_endian_write_inc)
 }
 END_TEST
 
+/* Two bytes per sample, channel 9 toggles every third sample. */
+static const uint8_t logic16[] = {
+	0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x02,
+	0x04, 0x02, 0x05, 0x02, 0x06, 0x00, 0x07, 0x00,
+	0x08, 0x00, 0x09, 0x02, 0x0a, 0x02, 0x0b, 0x02,
+};
+
+START_TEST(test_logic_unpack)
+{
+	uint8_t bits[2];
+	int ret;
+
+	/* Channel 0 of 8-bit samples, a full group of eight and a tail. */
+	memset(bits, 0xff, sizeof(bits));
+	ret = sr_logic_channel_unpack(buff1234large, 1, 11, 0, bits);
+	fail_unless(ret == SR_OK);
+	fail_unless(bits[0] == 0x55, "Unexpected bits 0x%02x.", bits[0]);
+	fail_unless(bits[1] == 0x05, "Unexpected bits 0x%02x.", bits[1]);
+
+	/* Channel 9 of 16-bit samples. */
+	memset(bits, 0xff, sizeof(bits));
+	ret = sr_logic_channel_unpack(logic16, 2, 12, 9, bits);
+	fail_unless(ret == SR_OK);
+	fail_unless(bits[0] == 0x38, "Unexpected bits 0x%02x.", bits[0]);
+	fail_unless(bits[1] == 0x0e, "Unexpected bits 0x%02x.", bits[1]);
+
+	ret = sr_logic_channel_unpack(logic16, 2, 12, 16, bits);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
+START_TEST(test_logic_next_edge)
+{
+	uint64_t pos;
+
+	pos = sr_logic_channel_next_edge(logic16, 2, 12, 9, 0);
+	fail_unless(pos == 3, "Unexpected edge %" PRIu64 ".", pos);
+	pos = sr_logic_channel_next_edge(logic16, 2, 12, 9, 4);
+	fail_unless(pos == 6, "Unexpected edge %" PRIu64 ".", pos);
+	pos = sr_logic_channel_next_edge(logic16, 2, 12, 9, 7);
+	fail_unless(pos == 9, "Unexpected edge %" PRIu64 ".", pos);
+	pos = sr_logic_channel_next_edge(logic16, 2, 12, 9, 10);
+	fail_unless(pos == 12, "Unexpected edge %" PRIu64 ".", pos);
+
+	/* Bit 3 of the incrementing bytes changes every eighth sample. */
+	pos = sr_logic_channel_next_edge(buff1234large, 1, 64, 3, 0);
+	fail_unless(pos == 7, "Unexpected edge %" PRIu64 ".", pos);
+	pos = sr_logic_channel_next_edge(buff1234large, 1, 64, 3, 8);
+	fail_unless(pos == 15, "Unexpected edge %" PRIu64 ".", pos);
+
+	pos = sr_logic_channel_next_edge(buff1234large, 1, 64, 8, 0);
+	fail_unless(pos == 64);
+}
+END_TEST
+
+START_TEST(test_a2l_packed)
+{
+	const float input[] = {
+		0.0, 2.0, 0.9, 1.1, 1.6, 1.4, 0.4, 2.0,
+		2.0, 0.0, 3.0,
+	};
+	uint8_t bits[2], state;
+	int ret;
+
+	memset(bits, 0xff, sizeof(bits));
+	ret = sr_a2l_threshold_packed(input, 11, 1.0, bits);
+	fail_unless(ret == SR_OK);
+	fail_unless(bits[0] == 0xba, "Unexpected bits 0x%02x.", bits[0]);
+	fail_unless(bits[1] == 0x05, "Unexpected bits 0x%02x.", bits[1]);
+
+	state = 0;
+	memset(bits, 0xff, sizeof(bits));
+	ret = sr_a2l_schmitt_trigger_packed(input, 11, 0.5, 1.5, &state, bits);
+	fail_unless(ret == SR_OK);
+	fail_unless(bits[0] == 0xbe, "Unexpected bits 0x%02x.", bits[0]);
+	fail_unless(bits[1] == 0x05, "Unexpected bits 0x%02x.", bits[1]);
+	fail_unless(state == 1);
+}
+END_TEST
+
+/*
+ * Compare the packed conversions against the byte per sample ones, for
+ * enough samples to take the 64 sample block path, plus a tail.
+ */
+START_TEST(test_a2l_packed_blocks)
+{
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	float input[203];
+	uint8_t flags[203], bits[(203 + 7) / 8];
+	uint8_t state, packed_state;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(input); i++)
+		input[i] = ((i * 37 + 11) % 97) / 32.0;
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	analog.data = input;
+	analog.num_samples = ARRAY_SIZE(input);
+
+	ret = sr_a2l_threshold(&analog, 1.5, flags, ARRAY_SIZE(input));
+	fail_unless(ret == SR_OK);
+	memset(bits, 0xff, sizeof(bits));
+	ret = sr_a2l_threshold_packed(input, ARRAY_SIZE(input), 1.5, bits);
+	fail_unless(ret == SR_OK);
+	for (i = 0; i < ARRAY_SIZE(input); i++)
+		fail_unless(((bits[i / 8] >> (i % 8)) & 1) == flags[i],
+			"Threshold mismatch at sample %zu.", i);
+	fail_unless(bits[sizeof(bits) - 1] >> (ARRAY_SIZE(input) % 8) == 0,
+		"Unused bits not cleared.");
+
+	state = packed_state = 1;
+	ret = sr_a2l_schmitt_trigger(&analog, 1.0, 2.0, &state, flags,
+		ARRAY_SIZE(input));
+	fail_unless(ret == SR_OK);
+	memset(bits, 0xff, sizeof(bits));
+	ret = sr_a2l_schmitt_trigger_packed(input, ARRAY_SIZE(input), 1.0, 2.0,
+		&packed_state, bits);
+	fail_unless(ret == SR_OK);
+	for (i = 0; i < ARRAY_SIZE(input); i++)
+		fail_unless(((bits[i / 8] >> (i % 8)) & 1) == flags[i],
+			"Schmitt trigger mismatch at sample %zu.", i);
+	fail_unless(packed_state == state, "Unexpected final state.");
+}
+END_TEST
+
 Suite *suite_conv(void)
 {
 	Suite *s;
@@ -284,5 +412,12 @@ Suite *suite_conv(void)
 	tcase_add_test(tc, test_endian_write_inc);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("logic");
+	tcase_add_test(tc, test_logic_unpack);
+	tcase_add_test(tc, test_logic_next_edge);
+	tcase_add_test(tc, test_a2l_packed);
+	tcase_add_test(tc, test_a2l_packed_blocks);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
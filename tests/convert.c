@@ -0,0 +1,331 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+/* Small enough for one slice after the header slice. */
+#define SMALL_SIZE (100 * 1000 + 3)
+/* Several of the 16 MiB slices the jobs send at a time. */
+#define LARGE_SIZE (3 * 16 * 1024 * 1024 + 5)
+
+struct progress_state {
+	unsigned int reports;
+	unsigned int finished;
+	uint64_t last_done;
+	struct sr_convert_job *cancel;
+};
+
+static uint8_t pattern_byte(size_t i)
+{
+	return (uint8_t)(i * 7 + (i >> 8));
+}
+
+/* Write a file with a known pattern, return its name. */
+static char *input_file_new(size_t size)
+{
+	GError *error;
+	uint8_t *buf;
+	char *filename;
+	size_t i;
+	int fd;
+
+	error = NULL;
+	fd = g_file_open_tmp("sr-convert-XXXXXX", &filename, &error);
+	fail_unless(fd >= 0, "Failed to create a temporary file.");
+	close(fd);
+
+	buf = g_malloc(size);
+	for (i = 0; i < size; i++)
+		buf[i] = pattern_byte(i);
+	fail_unless(g_file_set_contents(filename, (const char *)buf, size,
+		&error), "Failed to write the input file.");
+	g_free(buf);
+
+	return filename;
+}
+
+static struct sr_convert_job *job_new(const char *input_file,
+		const char *output_format, const char *suffix)
+{
+	struct sr_convert_job *job;
+	char *output_file;
+
+	output_file = g_strconcat(input_file, suffix, NULL);
+	g_unlink(output_file);
+	job = sr_convert_job_new(input_file, "binary", NULL,
+		output_format, NULL, output_file);
+	fail_unless(job != NULL, "Failed to create a job.");
+	g_free(output_file);
+
+	return job;
+}
+
+static void job_free(struct sr_convert_job *job)
+{
+	g_unlink(sr_convert_job_output_file_get(job));
+	sr_convert_job_free(job);
+}
+
+/* Check that the output is the input pattern, optionally inverted. */
+static void check_output(const struct sr_convert_job *job, size_t size,
+		uint8_t xor)
+{
+	const char *filename;
+	char *contents;
+	gsize len;
+	size_t i;
+
+	filename = sr_convert_job_output_file_get(job);
+	fail_unless(g_file_get_contents(filename, &contents, &len, NULL),
+		"Failed to read %s.", filename);
+	fail_unless(len == size, "Output has %zu bytes, expected %zu.",
+		(size_t)len, size);
+	for (i = 0; i < size; i++) {
+		if ((uint8_t)contents[i] != (pattern_byte(i) ^ xor))
+			break;
+	}
+	fail_unless(i == size, "Output differs at byte %zu.", i);
+	g_free(contents);
+}
+
+static void progress_cb(const struct sr_convert_job *job, uint64_t bytes_done,
+		uint64_t bytes_total, gboolean finished, void *cb_data)
+{
+	struct progress_state *state;
+
+	(void)job;
+
+	state = cb_data;
+	state->reports++;
+	fail_unless(bytes_done <= bytes_total,
+		"Progress %" PRIu64 " beyond %" PRIu64 ".",
+		bytes_done, bytes_total);
+	if (finished) {
+		state->finished++;
+		return;
+	}
+	state->last_done = bytes_done;
+	if (state->cancel)
+		sr_convert_job_cancel(state->cancel);
+}
+
+/* Convert two files at the same time, one through a transform. */
+START_TEST(test_convert_binary)
+{
+	struct sr_convert_job *plain, *inverted;
+	struct progress_state state;
+	GSList *jobs;
+	char *input_file;
+	int ret;
+
+	input_file = input_file_new(SMALL_SIZE);
+	plain = job_new(input_file, "binary", ".plain");
+	inverted = job_new(input_file, "binary", ".inverted");
+	ret = sr_convert_job_transform_add(inverted, "invert", NULL);
+	fail_unless(ret == SR_OK);
+	fail_unless(sr_convert_job_result_get(plain) == SR_ERR_NA);
+
+	memset(&state, 0, sizeof(state));
+	jobs = g_slist_append(NULL, plain);
+	jobs = g_slist_append(jobs, inverted);
+	ret = sr_convert_run(srtest_ctx, jobs, 2, progress_cb, &state);
+	fail_unless(ret == SR_OK, "sr_convert_run() failed: %d.", ret);
+
+	fail_unless(state.finished == 2);
+	fail_unless(state.last_done == SMALL_SIZE);
+	fail_unless(sr_convert_job_result_get(plain) == SR_OK);
+	fail_unless(sr_convert_job_result_get(inverted) == SR_OK);
+	check_output(plain, SMALL_SIZE, 0x00);
+	check_output(inverted, SMALL_SIZE, 0xff);
+
+	/* The input file is mapped privately, transforms don't touch it. */
+	job_free(inverted);
+	inverted = job_new(input_file, "binary", ".again");
+	g_slist_free(jobs);
+	jobs = g_slist_append(NULL, inverted);
+	ret = sr_convert_run(srtest_ctx, jobs, 0, NULL, NULL);
+	fail_unless(ret == SR_OK);
+	check_output(inverted, SMALL_SIZE, 0x00);
+
+	g_slist_free(jobs);
+	job_free(plain);
+	job_free(inverted);
+	g_unlink(input_file);
+	g_free(input_file);
+}
+END_TEST
+
+/* Jobs which get cancelled before they start don't run. */
+START_TEST(test_convert_cancel_pending)
+{
+	struct sr_convert_job *kept, *cancelled;
+	struct progress_state state;
+	GSList *jobs;
+	char *input_file;
+	int ret;
+
+	fail_unless(sr_convert_job_cancel(NULL) == SR_ERR_ARG);
+
+	input_file = input_file_new(SMALL_SIZE);
+	kept = job_new(input_file, "binary", ".kept");
+	cancelled = job_new(input_file, "binary", ".cancelled");
+	ret = sr_convert_job_cancel(cancelled);
+	fail_unless(ret == SR_OK);
+
+	memset(&state, 0, sizeof(state));
+	jobs = g_slist_append(NULL, kept);
+	jobs = g_slist_append(jobs, cancelled);
+	ret = sr_convert_run(srtest_ctx, jobs, 1, progress_cb, &state);
+	fail_unless(ret == SR_ERR, "Cancelled job not reported: %d.", ret);
+
+	fail_unless(state.finished == 2);
+	fail_unless(sr_convert_job_result_get(kept) == SR_OK);
+	fail_unless(sr_convert_job_result_get(cancelled) == SR_ERR_NA);
+	check_output(kept, SMALL_SIZE, 0x00);
+	fail_unless(!g_file_test(sr_convert_job_output_file_get(cancelled),
+		G_FILE_TEST_EXISTS), "Cancelled job wrote output.");
+
+	/* Cancelling sticks across runs. */
+	ret = sr_convert_run(srtest_ctx, jobs, 1, NULL, NULL);
+	fail_unless(ret == SR_ERR);
+	fail_unless(sr_convert_job_result_get(cancelled) == SR_ERR_NA);
+
+	g_slist_free(jobs);
+	job_free(kept);
+	job_free(cancelled);
+	g_unlink(input_file);
+	g_free(input_file);
+}
+END_TEST
+
+/*
+ * Cancel a job from its first progress report. Depending on how far
+ * the worker got, the job either completed or removed its output.
+ */
+START_TEST(test_convert_cancel_running)
+{
+	struct sr_convert_job *job;
+	struct progress_state state;
+	GSList *jobs;
+	char *input_file;
+	gboolean exists;
+	int ret, result;
+
+	input_file = input_file_new(LARGE_SIZE);
+	job = job_new(input_file, "binary", ".out");
+
+	memset(&state, 0, sizeof(state));
+	state.cancel = job;
+	jobs = g_slist_append(NULL, job);
+	ret = sr_convert_run(srtest_ctx, jobs, 1, progress_cb, &state);
+
+	fail_unless(state.finished == 1);
+	fail_unless(state.reports >= 2);
+	result = sr_convert_job_result_get(job);
+	exists = g_file_test(sr_convert_job_output_file_get(job),
+		G_FILE_TEST_EXISTS);
+	if (result == SR_OK) {
+		fail_unless(ret == SR_OK);
+		check_output(job, LARGE_SIZE, 0x00);
+	} else {
+		fail_unless(result == SR_ERR_NA, "Unexpected result %d.", result);
+		fail_unless(ret == SR_ERR);
+		fail_unless(state.last_done < LARGE_SIZE);
+		fail_unless(!exists, "Cancelled job left its output.");
+	}
+
+	g_slist_free(jobs);
+	job_free(job);
+	g_unlink(input_file);
+	g_free(input_file);
+}
+END_TEST
+
+/* Jobs failing at any stage get torn down, and can be run again. */
+START_TEST(test_convert_teardown)
+{
+	struct sr_convert_job *missing, *bad_output, *bad_transform, *good;
+	struct progress_state state;
+	GSList *jobs;
+	char *input_file, *missing_file;
+	int ret;
+
+	input_file = input_file_new(SMALL_SIZE);
+	missing_file = g_strconcat(input_file, ".missing", NULL);
+	missing = job_new(missing_file, "binary", ".out");
+	bad_output = job_new(input_file, "no-such-format", ".bad-output");
+	bad_transform = job_new(input_file, "binary", ".bad-transform");
+	sr_convert_job_transform_add(bad_transform, "no-such-transform", NULL);
+	good = job_new(input_file, "binary", ".good");
+
+	memset(&state, 0, sizeof(state));
+	jobs = g_slist_append(NULL, missing);
+	jobs = g_slist_append(jobs, bad_output);
+	jobs = g_slist_append(jobs, bad_transform);
+	jobs = g_slist_append(jobs, good);
+	ret = sr_convert_run(srtest_ctx, jobs, 2, progress_cb, &state);
+	fail_unless(ret == SR_ERR);
+	fail_unless(state.finished == 4);
+	fail_unless(sr_convert_job_result_get(missing) == SR_ERR_IO);
+	fail_unless(sr_convert_job_result_get(bad_output) == SR_ERR_ARG);
+	fail_unless(sr_convert_job_result_get(bad_transform) == SR_ERR_ARG);
+	fail_unless(sr_convert_job_result_get(good) == SR_OK);
+	check_output(good, SMALL_SIZE, 0x00);
+
+	/* Run the same jobs again, nothing of the first run remains. */
+	g_unlink(sr_convert_job_output_file_get(good));
+	memset(&state, 0, sizeof(state));
+	ret = sr_convert_run(srtest_ctx, jobs, 4, progress_cb, &state);
+	fail_unless(ret == SR_ERR);
+	fail_unless(state.finished == 4);
+	fail_unless(sr_convert_job_result_get(bad_output) == SR_ERR_ARG);
+	fail_unless(sr_convert_job_result_get(good) == SR_OK);
+	check_output(good, SMALL_SIZE, 0x00);
+
+	g_slist_free_full(jobs, (GDestroyNotify)job_free);
+	g_unlink(input_file);
+	g_free(input_file);
+	g_free(missing_file);
+}
+END_TEST
+
+Suite *suite_convert(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("convert");
+
+	tc = tcase_create("jobs");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_set_timeout(tc, 30);
+	tcase_add_test(tc, test_convert_binary);
+	tcase_add_test(tc, test_convert_cancel_pending);
+	tcase_add_test(tc, test_convert_cancel_running);
+	tcase_add_test(tc, test_convert_teardown);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,163 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define POLY_MODBUS	0xA001
+#define POLY_MCRF4XX	0x8408
+
+/* Lengths to check, several 8 byte steps with every possible tail. */
+#define MAX_LEN		41
+
+struct crc_vector {
+	const char *data;
+	uint16_t modbus;
+	uint16_t mcrf4xx;
+};
+
+static const struct crc_vector vectors[] = {
+	{ "", 0xffff, 0xffff, },
+	{ "123456789", 0x4b37, 0x6f91, },
+	{ "The quick brown fox jumps over the lazy dog", 0xa89c, 0x6ca7, },
+};
+
+/* Bitwise reference implementation of reflected CRC16 flavors. */
+static uint16_t crc16_bitwise(uint16_t poly, uint16_t crc,
+	const uint8_t *buffer, size_t len)
+{
+	size_t i;
+
+	while (len--) {
+		crc ^= *buffer++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+	}
+
+	return crc;
+}
+
+static void fill_pattern(uint8_t *buffer, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buffer[i] = (uint8_t)(i * 151 + 17);
+}
+
+/* Check both flavors against their published check values. */
+START_TEST(test_crc16_vectors)
+{
+	const struct crc_vector *v;
+	const uint8_t *data;
+	size_t i, len;
+	uint16_t crc;
+
+	for (i = 0; i < ARRAY_SIZE(vectors); i++) {
+		v = &vectors[i];
+		data = (const uint8_t *)v->data;
+		len = strlen(v->data);
+		crc = sr_crc16(SR_CRC16_DEFAULT_INIT, data, len);
+		fail_unless(crc == v->modbus,
+			"CRC16-MODBUS of '%s' is 0x%04x, expected 0x%04x.",
+			v->data, crc, v->modbus);
+		crc = sr_crc16_mcrf4xx(SR_CRC16_DEFAULT_INIT, data, len);
+		fail_unless(crc == v->mcrf4xx,
+			"CRC16-MCRF4XX of '%s' is 0x%04x, expected 0x%04x.",
+			v->data, crc, v->mcrf4xx);
+	}
+}
+END_TEST
+
+/*
+ * Check the table driven calculation against the bitwise reference, for
+ * inputs which take several 8 byte steps, with all sizes of tails, and
+ * when the input gets passed in two parts.
+ */
+START_TEST(test_crc16_lengths)
+{
+	uint8_t buffer[MAX_LEN];
+	size_t len, split;
+	uint16_t expected, crc;
+
+	fill_pattern(buffer, sizeof(buffer));
+	for (len = 0; len <= sizeof(buffer); len++) {
+		expected = crc16_bitwise(POLY_MODBUS, SR_CRC16_DEFAULT_INIT,
+			buffer, len);
+		crc = sr_crc16(SR_CRC16_DEFAULT_INIT, buffer, len);
+		fail_unless(crc == expected,
+			"CRC16-MODBUS of %zu bytes is 0x%04x, expected 0x%04x.",
+			len, crc, expected);
+		for (split = 0; split <= len; split++) {
+			crc = sr_crc16(SR_CRC16_DEFAULT_INIT, buffer, split);
+			crc = sr_crc16(crc, &buffer[split], len - split);
+			fail_unless(crc == expected,
+				"CRC16-MODBUS of %zu bytes split at %zu differs.",
+				len, split);
+		}
+
+		expected = crc16_bitwise(POLY_MCRF4XX, SR_CRC16_DEFAULT_INIT,
+			buffer, len);
+		crc = sr_crc16_mcrf4xx(SR_CRC16_DEFAULT_INIT, buffer, len);
+		fail_unless(crc == expected,
+			"CRC16-MCRF4XX of %zu bytes is 0x%04x, expected 0x%04x.",
+			len, crc, expected);
+		for (split = 0; split <= len; split++) {
+			crc = sr_crc16_mcrf4xx(SR_CRC16_DEFAULT_INIT,
+				buffer, split);
+			crc = sr_crc16_mcrf4xx(crc, &buffer[split], len - split);
+			fail_unless(crc == expected,
+				"CRC16-MCRF4XX of %zu bytes split at %zu differs.",
+				len, split);
+		}
+	}
+}
+END_TEST
+
+/* Invalid arguments leave the CRC unchanged. */
+START_TEST(test_crc16_invalid)
+{
+	uint8_t buffer[4];
+
+	fill_pattern(buffer, sizeof(buffer));
+	fail_unless(sr_crc16(0x1234, NULL, 4) == 0x1234);
+	fail_unless(sr_crc16(0x1234, buffer, -1) == 0x1234);
+	fail_unless(sr_crc16_mcrf4xx(0x1234, NULL, 4) == 0x1234);
+}
+END_TEST
+
+Suite *suite_crc(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("crc");
+
+	tc = tcase_create("crc16");
+	tcase_add_test(tc, test_crc16_vectors);
+	tcase_add_test(tc, test_crc16_lengths);
+	tcase_add_test(tc, test_crc16_invalid);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,6 +19,8 @@
 
 #include <config.h>
 #include <check.h>
+#include <string.h>
+#include <unistd.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -308,6 +310,189 @@ START_TEST(test_input_binary_hello_world)
 }
 END_TEST
 
+static void datafeed_collect(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	fail_unless(logic->unitsize == 2);
+	fail_unless(logic->length % logic->unitsize == 0,
+		    "Partial sample in SR_DF_LOGIC packet.");
+	g_string_append_len(cb_data, logic->data, logic->length);
+}
+
+START_TEST(test_input_binary_mapped)
+{
+	char text[] = "Hello world, lent to the input module in odd pieces.";
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *options;
+	GString *collected;
+	size_t len, pos, n, piece;
+	int ret;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("numchannels"),
+			g_variant_ref_sink(g_variant_new_int32(16)));
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	collected = g_string_new(NULL);
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_collect, collected);
+
+	/* The first call gets the device instance ready. */
+	len = strlen(text);
+	ret = sr_input_send_mapped(in, text, 3);
+	fail_unless(ret == SR_OK, "sr_input_send_mapped() error: %d", ret);
+	sdi = sr_input_dev_inst_get(in);
+	fail_unless(sdi != NULL, "Device instance not ready.");
+	sr_session_dev_add(session, sdi);
+
+	/* Samples span the pieces, tails must get joined. */
+	pos = 3;
+	for (piece = 1; pos < len; piece += 2) {
+		n = MIN(piece, len - pos);
+		ret = sr_input_send_mapped(in, text + pos, n);
+		fail_unless(ret == SR_OK, "sr_input_send_mapped() error: %d", ret);
+		pos += n;
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+
+	fail_unless(collected->len == len / 2 * 2,
+		    "Expected %zu bytes, got %zu.", len / 2 * 2, collected->len);
+	fail_unless(!memcmp(collected->str, text, collected->len),
+		    "Sample data differs from the input.");
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_string_free(collected, TRUE);
+	g_hash_table_destroy(options);
+}
+END_TEST
+
+static void datafeed_collect_bytes(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	g_string_append_len(cb_data, logic->data, logic->length);
+}
+
+/*
+ * Send a file through an in-place transform. The data which the module
+ * passes on is the mapped file, its content must not change.
+ */
+START_TEST(test_input_binary_file)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	const struct sr_transform *t;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GHashTable *options;
+	GString *collected;
+	GError *error;
+	uint64_t offset;
+	char *filename, *contents, *buf;
+	gsize size, len;
+	size_t i;
+	int fd, ret;
+
+	/* Larger than the first slice, which gets copied. */
+	size = 200 * 1000 + 3;
+	buf = g_malloc(size);
+	for (i = 0; i < size; i++)
+		buf[i] = (char)(i * 7 + (i >> 8));
+	error = NULL;
+	fd = g_file_open_tmp("sr-input-XXXXXX", &filename, &error);
+	fail_unless(fd >= 0, "Failed to create a temporary file.");
+	close(fd);
+	fail_unless(g_file_set_contents(filename, buf, size, &error),
+		    "Failed to write the input file.");
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("numchannels"),
+			g_variant_ref_sink(g_variant_new_int32(8)));
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	collected = g_string_new(NULL);
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_collect_bytes,
+			collected);
+
+	/* The call returns when the device instance becomes ready. */
+	offset = 0;
+	ret = sr_input_send_file(in, filename, &offset);
+	fail_unless(ret == SR_OK, "sr_input_send_file() error: %d", ret);
+	fail_unless(offset > 0 && offset < size,
+		    "Unexpected offset %" PRIu64 ".", offset);
+	sdi = sr_input_dev_inst_get(in);
+	fail_unless(sdi != NULL, "Device instance not ready.");
+	sr_session_dev_add(session, sdi);
+	t = sr_transform_new(sr_transform_find("invert"), NULL, sdi);
+	fail_unless(t != NULL, "Cannot create transform.");
+
+	ret = sr_input_send_file(in, filename, &offset);
+	fail_unless(ret == SR_OK, "sr_input_send_file() error: %d", ret);
+	fail_unless(offset == size, "Offset %" PRIu64 " is not at the end.",
+		    offset);
+
+	/* Calls at the end of the file do nothing. */
+	len = collected->len;
+	ret = sr_input_send_file(in, filename, &offset);
+	fail_unless(ret == SR_OK, "sr_input_send_file() error: %d", ret);
+	fail_unless(offset == size && collected->len == len,
+		    "Call at the end of the file sent data.");
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+
+	fail_unless(collected->len == size, "Expected %zu bytes, got %zu.",
+		    (size_t)size, collected->len);
+	for (i = 0; i < size; i++) {
+		if ((collected->str[i] ^ buf[i]) != (char)0xff)
+			break;
+	}
+	fail_unless(i == size, "Sample data differs at byte %zu.", i);
+
+	fail_unless(g_file_get_contents(filename, &contents, &len, NULL),
+		    "Failed to read the input file.");
+	fail_unless(len == size && !memcmp(contents, buf, size),
+		    "The input file was modified.");
+	g_free(contents);
+
+	sr_transform_free(t);
+	sr_session_destroy(session);
+	sr_input_free(in);
+	g_unlink(filename);
+	g_free(filename);
+	g_free(buf);
+	g_string_free(collected, TRUE);
+	g_hash_table_destroy(options);
+}
+END_TEST
+
 Suite *suite_input_binary(void)
 {
 	Suite *s;
@@ -321,6 +506,8 @@ Suite *suite_input_binary(void)
 	tcase_add_test(tc, test_input_binary_all_high);
 	tcase_add_loop_test(tc, test_input_binary_all_high_loop, 1, 10);
 	tcase_add_test(tc, test_input_binary_hello_world);
+	tcase_add_test(tc, test_input_binary_mapped);
+	tcase_add_test(tc, test_input_binary_file);
 	suite_add_tcase(s, tc);
 
 	return s;
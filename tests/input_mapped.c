@@ -0,0 +1,223 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define WAV_HEADER_SIZE		44
+#define WAV_SAMPLES		101
+
+#define SALEAE_HEADER_SIZE	0x30
+#define SALEAE_WORDS		77
+
+/* Samples which the modules sent, and the data that got sent to them. */
+struct mapped_state {
+	GString *logic;
+	GArray *analog;
+	uint8_t *data;
+	size_t len;
+};
+
+static void datafeed_collect(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	struct mapped_state *state;
+	float *values;
+	int ret;
+
+	(void)sdi;
+
+	state = cb_data;
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		g_string_append_len(state->logic, logic->data, logic->length);
+	} else if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		values = g_malloc(analog->num_samples * sizeof(float));
+		ret = sr_analog_to_float(analog, values);
+		fail_unless(ret == SR_OK, "sr_analog_to_float() error: %d", ret);
+		g_array_append_vals(state->analog, values, analog->num_samples);
+		g_free(values);
+	}
+}
+
+/*
+ * Lend the data to the input instance, with just enough of it to get
+ * the device instance ready first. Then lend the rest in odd pieces,
+ * so that items span the pieces, and tails must get joined.
+ */
+static void send_mapped(const struct sr_input_module *imod,
+	GHashTable *options, size_t header_len, struct mapped_state *state)
+{
+	const struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	size_t pos, n, piece;
+	int ret;
+
+	in = sr_input_new(imod, options);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_collect, state);
+
+	ret = sr_input_send_mapped(in, state->data, header_len);
+	fail_unless(ret == SR_OK, "sr_input_send_mapped() error: %d", ret);
+	sdi = sr_input_dev_inst_get(in);
+	fail_unless(sdi != NULL, "Device instance not ready.");
+	sr_session_dev_add(session, sdi);
+
+	pos = header_len;
+	for (piece = 1; pos < state->len; piece += 2) {
+		n = MIN(piece, state->len - pos);
+		ret = sr_input_send_mapped(in, state->data + pos, n);
+		fail_unless(ret == SR_OK, "sr_input_send_mapped() error: %d", ret);
+		pos += n;
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+
+	sr_session_destroy(session);
+	sr_input_free(in);
+}
+
+static void state_init(struct mapped_state *state, size_t len)
+{
+	state->logic = g_string_new(NULL);
+	state->analog = g_array_new(FALSE, FALSE, sizeof(float));
+	state->data = g_malloc0(len);
+	state->len = len;
+}
+
+static void state_free(struct mapped_state *state)
+{
+	g_string_free(state->logic, TRUE);
+	g_array_free(state->analog, TRUE);
+	g_free(state->data);
+}
+
+static float wav_value(size_t i)
+{
+	return (float)i / 8 - 3;
+}
+
+/* Check WAV files with 32-bit float samples. */
+START_TEST(test_input_wav_mapped)
+{
+	struct mapped_state state;
+	uint8_t *p;
+	float value;
+	size_t i;
+
+	state_init(&state, WAV_HEADER_SIZE + WAV_SAMPLES * sizeof(float));
+	p = state.data;
+	memcpy(p, "RIFF", 4);
+	WL32(p + 4, state.len - 8);
+	memcpy(p + 8, "WAVEfmt ", 8);
+	WL32(p + 16, 16);
+	WL16(p + 20, 3);	/* IEEE float */
+	WL16(p + 22, 1);	/* Channels */
+	WL32(p + 24, 1000);	/* Samplerate */
+	WL32(p + 28, 1000 * sizeof(float));
+	WL16(p + 32, sizeof(float));
+	WL16(p + 34, 32);
+	memcpy(p + 36, "data", 4);
+	WL32(p + 40, WAV_SAMPLES * sizeof(float));
+	for (i = 0; i < WAV_SAMPLES; i++)
+		write_fltle(p + WAV_HEADER_SIZE + i * sizeof(float), wav_value(i));
+
+	/* The module needs one more byte than the header. */
+	send_mapped(sr_input_find("wav"), NULL, WAV_HEADER_SIZE + 1, &state);
+
+	fail_unless(state.analog->len == WAV_SAMPLES,
+		    "Expected %d samples, got %u.", WAV_SAMPLES,
+		    state.analog->len);
+	for (i = 0; i < WAV_SAMPLES; i++) {
+		value = g_array_index(state.analog, float, i);
+		fail_unless(value == wav_value(i),
+			    "Sample %zu is %f, expected %f.",
+			    i, value, wav_value(i));
+	}
+
+	state_free(&state);
+}
+END_TEST
+
+/* Check Logic 1 digital exports of 16-bit words, one per sample. */
+START_TEST(test_input_saleae_mapped)
+{
+	struct mapped_state state;
+	GHashTable *options;
+	const uint8_t *sample;
+	size_t i, unitsize;
+
+	/* Odd length, the final partial word does not get used. */
+	state_init(&state, SALEAE_WORDS * sizeof(uint16_t) + 1);
+	for (i = 0; i < state.len; i++)
+		state.data[i] = (uint8_t)(i * 7 + 3);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("format"),
+			g_variant_ref_sink(g_variant_new_string("logic1-digital")));
+	g_hash_table_insert(options, g_strdup("wordsize"),
+			g_variant_ref_sink(g_variant_new_uint32(16)));
+	g_hash_table_insert(options, g_strdup("samplerate"),
+			g_variant_ref_sink(g_variant_new_uint64(SR_KHZ(1))));
+
+	send_mapped(sr_input_find("saleae"), options, SALEAE_HEADER_SIZE,
+		&state);
+
+	/* The module sends samples in 32-bit units. */
+	unitsize = sizeof(uint32_t);
+	fail_unless(state.logic->len == SALEAE_WORDS * unitsize,
+		    "Expected %d samples, got %zu bytes.", SALEAE_WORDS,
+		    state.logic->len);
+	for (i = 0; i < SALEAE_WORDS; i++) {
+		sample = (const uint8_t *)state.logic->str + i * unitsize;
+		if (RL32(sample) != RL16(state.data + i * sizeof(uint16_t)))
+			break;
+	}
+	fail_unless(i == SALEAE_WORDS, "Sample %zu differs.", i);
+
+	g_hash_table_destroy(options);
+	state_free(&state);
+}
+END_TEST
+
+Suite *suite_input_mapped(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-mapped");
+
+	tc = tcase_create("modules");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_input_wav_mapped);
+	tcase_add_test(tc, test_input_saleae_mapped);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
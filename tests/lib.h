@@ -45,6 +45,7 @@ Suite *suite_core(void);
 Suite *suite_driver_all(void);
 Suite *suite_input_all(void);
 Suite *suite_input_binary(void);
+Suite *suite_input_mapped(void);
 Suite *suite_output_all(void);
 Suite *suite_transform_all(void);
 Suite *suite_session(void);
@@ -54,5 +55,11 @@ Suite *suite_device(void);
 Suite *suite_trigger(void);
 Suite *suite_analog(void);
 Suite *suite_conv(void);
+Suite *suite_log(void);
+Suite *suite_convert(void);
+Suite *suite_poll(void);
+Suite *suite_crc(void);
+Suite *suite_resource(void);
+Suite *suite_modbus(void);
 
 #endif
@@ -0,0 +1,189 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdarg.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define LOG_PREFIX "test"
+
+static GMutex log_mutex;
+static GString *log_text;
+
+static int log_capture(void *cb_data, int loglevel, const char *format,
+		va_list args)
+{
+	(void)cb_data;
+	(void)loglevel;
+
+	g_mutex_lock(&log_mutex);
+	g_string_append_vprintf(log_text, format, args);
+	g_string_append_c(log_text, '\n');
+	g_mutex_unlock(&log_mutex);
+
+	return SR_OK;
+}
+
+static void *log_from_thread(void *data)
+{
+	(void)data;
+
+	sr_info("from helper thread");
+
+	return NULL;
+}
+
+/* A callback which waits for another thread that logs, too. */
+static int log_capture_and_wait(void *cb_data, int loglevel,
+		const char *format, va_list args)
+{
+	static gboolean spawned;
+	GThread *thread;
+
+	log_capture(cb_data, loglevel, format, args);
+	if (spawned)
+		return SR_OK;
+	spawned = TRUE;
+
+	thread = g_thread_new("log-test", log_from_thread, NULL);
+	g_thread_join(thread);
+
+	return SR_OK;
+}
+
+static void setup(void)
+{
+	log_text = g_string_new(NULL);
+	sr_log_loglevel_set(SR_LOG_SPEW);
+}
+
+static void teardown(void)
+{
+	sr_log_async_stop();
+	sr_log_callback_set_default();
+	sr_log_loglevel_set(SR_LOG_WARN);
+	g_string_free(log_text, TRUE);
+	log_text = NULL;
+}
+
+/*
+ * Check that messages which get logged while the asynchronous backend
+ * is active are expanded correctly, and are all delivered to the log
+ * callback when the backend gets stopped.
+ */
+START_TEST(test_async_delivery)
+{
+	int ret;
+
+	sr_log_loglevel_set(SR_LOG_NONE);
+	sr_log_callback_set(log_capture, NULL);
+	ret = sr_log_async_start(0, SR_LOG_ASYNC_LOSSLESS);
+	fail_unless(ret == SR_OK, "sr_log_async_start() failed: %d.", ret);
+	ret = sr_log_async_start(0, 0);
+	fail_unless(ret != SR_OK, "Second sr_log_async_start() should fail.");
+	sr_log_loglevel_set(SR_LOG_DBG);
+	ret = sr_log_async_stop();
+	fail_unless(ret == SR_OK, "sr_log_async_stop() failed: %d.", ret);
+
+	fail_unless(strstr(log_text->str,
+		"log: libsigrok loglevel set to 4.\n") != NULL,
+		"Asynchronous message got lost: '%s'.", log_text->str);
+}
+END_TEST
+
+/* Check that sr_log_async_start() rejects invalid ring sizes. */
+START_TEST(test_async_ring_size)
+{
+	int ret;
+
+	ret = sr_log_async_start(1, 0);
+	fail_unless(ret == SR_ERR_ARG, "Tiny ring size should be rejected.");
+	ret = sr_log_async_stop();
+	fail_unless(ret == SR_OK, "sr_log_async_stop() failed: %d.", ret);
+}
+END_TEST
+
+/*
+ * Check that string precisions bound the data which gets copied,
+ * drivers log receive buffers which are not NUL terminated.
+ */
+START_TEST(test_async_string_precision)
+{
+	char *buf;
+	int ret;
+
+	buf = g_malloc(6);
+	memcpy(buf, "abcdef", 6);
+
+	sr_log_callback_set(log_capture, NULL);
+	ret = sr_log_async_start(0, SR_LOG_ASYNC_LOSSLESS);
+	fail_unless(ret == SR_OK);
+	sr_info("[%.4s]", buf);
+	sr_info("[%.*s]", 2, buf);
+	sr_info("[%.*s]", -1, "neg");
+	sr_info("[%.6s|%5.1s]", buf, "xyz");
+	ret = sr_log_async_stop();
+	fail_unless(ret == SR_OK);
+
+	fail_unless(!strcmp(log_text->str,
+		"test: [abcd]\ntest: [ab]\ntest: [neg]\ntest: [abcdef|    x]\n"),
+		"Unexpected log text: '%s'.", log_text->str);
+	g_free(buf);
+}
+END_TEST
+
+/* Check that callbacks which make other threads log don't deadlock. */
+START_TEST(test_async_callback_unlocked)
+{
+	int ret;
+
+	sr_log_callback_set(log_capture_and_wait, NULL);
+	ret = sr_log_async_start(0, SR_LOG_ASYNC_LOSSLESS);
+	fail_unless(ret == SR_OK);
+	sr_info("first");
+	ret = sr_log_async_stop();
+	fail_unless(ret == SR_OK);
+
+	fail_unless(!strcmp(log_text->str,
+		"test: first\ntest: from helper thread\n"),
+		"Unexpected log text: '%s'.", log_text->str);
+}
+END_TEST
+
+Suite *suite_log(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("log");
+
+	tc = tcase_create("async");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_async_delivery);
+	tcase_add_test(tc, test_async_ring_size);
+	tcase_add_test(tc, test_async_string_precision);
+	tcase_add_test(tc, test_async_callback_unlocked);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
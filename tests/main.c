@@ -37,6 +37,7 @@ int main(void)
 	srunner_add_suite(srunner, suite_driver_all());
 	srunner_add_suite(srunner, suite_input_all());
 	srunner_add_suite(srunner, suite_input_binary());
+	srunner_add_suite(srunner, suite_input_mapped());
 	srunner_add_suite(srunner, suite_output_all());
 	srunner_add_suite(srunner, suite_transform_all());
 	srunner_add_suite(srunner, suite_session());
@@ -46,6 +47,12 @@ int main(void)
 	srunner_add_suite(srunner, suite_trigger());
 	srunner_add_suite(srunner, suite_analog());
 	srunner_add_suite(srunner, suite_conv());
+	srunner_add_suite(srunner, suite_log());
+	srunner_add_suite(srunner, suite_convert());
+	srunner_add_suite(srunner, suite_poll());
+	srunner_add_suite(srunner, suite_crc());
+	srunner_add_suite(srunner, suite_resource());
+	srunner_add_suite(srunner, suite_modbus());
 
 	srunner_run_all(srunner, CK_VERBOSE);
 	ret = srunner_ntests_failed(srunner);
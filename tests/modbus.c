@@ -0,0 +1,582 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <unistd.h>
+#if !defined _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define MBAP_HEADER_SIZE	7
+#define REQUEST_SIZE		(MBAP_HEADER_SIZE + 5)
+
+/* Short, so that the test is quick, and well below the default. */
+#define TEST_TIMEOUT_MS		100
+
+/* A read holding registers request, as the server received it. */
+struct test_request {
+	uint16_t tid;
+	int address;
+	int nb_registers;
+};
+
+/* Register values which the device replies with. */
+static uint16_t register_value(int address)
+{
+	return (uint16_t)(address * 3 + 1);
+}
+
+static void check_registers(const uint16_t *registers, int address,
+		int nb_registers)
+{
+	int i;
+
+	for (i = 0; i < nb_registers; i++) {
+		fail_unless(RB16(&registers[i]) == register_value(address + i),
+			"Register 0x%04x has the wrong value.", address + i);
+	}
+}
+
+#if !defined _WIN32
+
+/* A Modbus TCP server on the loopback interface, which runs a script. */
+struct test_server {
+	int listen_fd;
+	int fd;
+	char *resource;
+	GThread *thread;
+	void (*script)(struct test_server *srv);
+	gboolean failed;
+};
+
+static gboolean server_read(struct test_server *srv, uint8_t *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = recv(srv->fd, buf, len, 0);
+		if (ret <= 0)
+			return FALSE;
+		buf += ret;
+		len -= ret;
+	}
+
+	return TRUE;
+}
+
+static void server_read_request(struct test_server *srv,
+		struct test_request *req)
+{
+	uint8_t buf[REQUEST_SIZE];
+
+	if (!server_read(srv, buf, sizeof(buf))
+	    || RB16(buf + 4) != 6 || R8(buf + 7) != 0x03) {
+		srv->failed = TRUE;
+		return;
+	}
+	req->tid = RB16(buf + 0);
+	req->address = RB16(buf + 8);
+	req->nb_registers = RB16(buf + 10);
+}
+
+static void server_reply(struct test_server *srv,
+		const struct test_request *req)
+{
+	uint8_t buf[MBAP_HEADER_SIZE + 2 + 2 * 125];
+	size_t len;
+	int i;
+
+	len = 2 + 2 * req->nb_registers;
+	WB16(buf + 0, req->tid);
+	WB16(buf + 2, 0);
+	WB16(buf + 4, 1 + len);
+	W8(buf + 6, 1);
+	W8(buf + 7, 0x03);
+	W8(buf + 8, 2 * req->nb_registers);
+	for (i = 0; i < req->nb_registers; i++)
+		WB16(buf + 9 + 2 * i, register_value(req->address + i));
+	len += MBAP_HEADER_SIZE;
+	if (send(srv->fd, buf, len, 0) != (ssize_t)len)
+		srv->failed = TRUE;
+}
+
+static gpointer server_thread(gpointer data)
+{
+	struct test_server *srv;
+
+	srv = data;
+	srv->fd = accept(srv->listen_fd, NULL, NULL);
+	if (srv->fd < 0) {
+		srv->failed = TRUE;
+		return NULL;
+	}
+	srv->script(srv);
+	close(srv->fd);
+
+	return NULL;
+}
+
+static void server_start(struct test_server *srv,
+		void (*script)(struct test_server *srv))
+{
+	struct sockaddr_in addr;
+	socklen_t addr_len;
+	int ret;
+
+	memset(srv, 0, sizeof(*srv));
+	srv->script = script;
+	srv->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	fail_unless(srv->listen_fd >= 0, "Cannot create socket.");
+
+	/* Let the system pick a free port. */
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	ret = bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+	fail_unless(ret == 0, "Cannot bind socket.");
+	ret = listen(srv->listen_fd, 1);
+	fail_unless(ret == 0, "Cannot listen on socket.");
+	addr_len = sizeof(addr);
+	ret = getsockname(srv->listen_fd, (struct sockaddr *)&addr, &addr_len);
+	fail_unless(ret == 0, "Cannot get the socket's port.");
+
+	srv->resource = g_strdup_printf("tcp/127.0.0.1/%u",
+		ntohs(addr.sin_port));
+	srv->thread = g_thread_new("modbus-server", server_thread, srv);
+}
+
+static void server_stop(struct test_server *srv)
+{
+	g_thread_join(srv->thread);
+	close(srv->listen_fd);
+	g_free(srv->resource);
+	fail_unless(!srv->failed, "The server got unexpected data.");
+}
+
+static struct sr_modbus_dev_inst *client_open(struct test_server *srv)
+{
+	struct sr_modbus_dev_inst *modbus;
+	int ret;
+
+	modbus = modbus_dev_inst_new(srv->resource, NULL, 1);
+	fail_unless(modbus != NULL, "Cannot create Modbus instance.");
+	ret = sr_modbus_open(modbus);
+	fail_unless(ret == SR_OK, "Cannot connect to the server: %d.", ret);
+
+	return modbus;
+}
+
+static void client_close(struct sr_modbus_dev_inst *modbus)
+{
+	sr_modbus_close(modbus);
+	sr_modbus_free(modbus);
+}
+
+#define PIPELINED	4
+
+/* Reply in reverse order, after a reply to an unknown transaction. */
+static void script_out_of_order(struct test_server *srv)
+{
+	struct test_request reqs[PIPELINED], stale;
+	int i;
+
+	for (i = 0; i < PIPELINED; i++)
+		server_read_request(srv, &reqs[i]);
+	stale = reqs[0];
+	stale.tid += 100;
+	server_reply(srv, &stale);
+	for (i = PIPELINED - 1; i >= 0; i--)
+		server_reply(srv, &reqs[i]);
+}
+
+/* Check that pipelined replies get matched to their requests. */
+START_TEST(test_modbus_tcp_out_of_order)
+{
+	struct test_server srv;
+	struct sr_modbus_dev_inst *modbus;
+	struct sr_modbus_register_range ranges[PIPELINED];
+	uint16_t registers[PIPELINED][PIPELINED];
+	int i, ret;
+
+	server_start(&srv, script_out_of_order);
+	modbus = client_open(&srv);
+
+	for (i = 0; i < PIPELINED; i++) {
+		ranges[i].address = 0x100 * (i + 1);
+		ranges[i].nb_registers = i + 1;
+		ranges[i].registers = registers[i];
+	}
+	ret = sr_modbus_read_holding_registers_multi(modbus, ranges, PIPELINED);
+	fail_unless(ret == SR_OK, "Pipelined reads failed: %d.", ret);
+	for (i = 0; i < PIPELINED; i++) {
+		fail_unless(ranges[i].result == SR_OK);
+		check_registers(registers[i], ranges[i].address,
+			ranges[i].nb_registers);
+	}
+
+	client_close(modbus);
+	server_stop(&srv);
+}
+END_TEST
+
+/*
+ * Leave requests unanswered until the client timed out, and send their
+ * replies ahead of the next request's reply.
+ */
+static void script_timeout(struct test_server *srv)
+{
+	struct test_request a, b, c, d, e;
+
+	/* Single transaction. */
+	server_read_request(srv, &a);
+	server_read_request(srv, &b);
+	server_reply(srv, &a);
+	server_reply(srv, &b);
+
+	/* Pipelined transactions, the second one times out. */
+	server_read_request(srv, &c);
+	server_read_request(srv, &d);
+	server_reply(srv, &c);
+	server_read_request(srv, &e);
+	server_reply(srv, &d);
+	server_reply(srv, &e);
+}
+
+/* Check that the configured timeout applies, and late replies get dropped. */
+START_TEST(test_modbus_tcp_timeout)
+{
+	struct test_server srv;
+	struct sr_modbus_dev_inst *modbus;
+	struct sr_modbus_register_range ranges[2];
+	uint16_t registers[2][2];
+	int64_t start, elapsed_ms;
+	int ret;
+
+	server_start(&srv, script_timeout);
+	modbus = client_open(&srv);
+	modbus->read_timeout_ms = TEST_TIMEOUT_MS;
+
+	start = g_get_monotonic_time();
+	ret = sr_modbus_read_holding_registers(modbus, 0x10, 1, registers[0]);
+	elapsed_ms = (g_get_monotonic_time() - start) / 1000;
+	fail_unless(ret == SR_ERR_TIMEOUT, "Expected a timeout, got %d.", ret);
+	fail_unless(elapsed_ms >= TEST_TIMEOUT_MS / 2
+		&& elapsed_ms < 5 * TEST_TIMEOUT_MS,
+		"Timed out after %" PRId64 " ms.", elapsed_ms);
+	ret = sr_modbus_read_holding_registers(modbus, 0x20, 2, registers[1]);
+	fail_unless(ret == SR_OK, "Read after a timeout failed: %d.", ret);
+	check_registers(registers[1], 0x20, 2);
+
+	ranges[0].address = 0x30;
+	ranges[0].nb_registers = 2;
+	ranges[0].registers = registers[0];
+	ranges[1].address = 0x40;
+	ranges[1].nb_registers = 1;
+	ranges[1].registers = registers[1];
+	start = g_get_monotonic_time();
+	ret = sr_modbus_read_holding_registers_multi(modbus, ranges, 2);
+	elapsed_ms = (g_get_monotonic_time() - start) / 1000;
+	fail_unless(ret == SR_ERR_TIMEOUT, "Expected a timeout, got %d.", ret);
+	fail_unless(elapsed_ms < 5 * TEST_TIMEOUT_MS,
+		"Timed out after %" PRId64 " ms.", elapsed_ms);
+	fail_unless(ranges[0].result == SR_OK);
+	check_registers(registers[0], 0x30, 2);
+	fail_unless(ranges[1].result == SR_ERR_TIMEOUT);
+
+	ret = sr_modbus_read_holding_registers(modbus, 0x50, 2, registers[1]);
+	fail_unless(ret == SR_OK, "Read after a timeout failed: %d.", ret);
+	check_registers(registers[1], 0x50, 2);
+
+	client_close(modbus);
+	server_stop(&srv);
+}
+END_TEST
+
+#endif
+
+/*
+ * A Modbus backend which answers read holding registers requests right
+ * away, and records the reads.
+ */
+#define MAX_FAKE_READS	8
+
+static struct {
+	struct test_request reads[MAX_FAKE_READS];
+	size_t num_reads;
+	uint8_t reply[2 + 2 * 125];
+	size_t reply_len;
+	size_t reply_pos;
+} fake;
+
+static int fake_send(void *priv, const uint8_t *buffer, int buffer_size)
+{
+	struct test_request *req;
+	int i;
+
+	(void)priv;
+
+	if (buffer_size != 5 || R8(buffer) != 0x03
+	    || fake.num_reads == MAX_FAKE_READS)
+		return SR_ERR;
+	req = &fake.reads[fake.num_reads++];
+	req->address = RB16(buffer + 1);
+	req->nb_registers = RB16(buffer + 3);
+
+	W8(fake.reply + 0, 0x03);
+	W8(fake.reply + 1, 2 * req->nb_registers);
+	for (i = 0; i < req->nb_registers; i++)
+		WB16(fake.reply + 2 + 2 * i, register_value(req->address + i));
+	fake.reply_len = 2 + 2 * req->nb_registers;
+
+	return SR_OK;
+}
+
+static int fake_read_begin(void *priv, uint8_t *function_code,
+		unsigned int timeout_ms)
+{
+	(void)priv;
+	(void)timeout_ms;
+
+	*function_code = fake.reply[0];
+	fake.reply_pos = 1;
+
+	return SR_OK;
+}
+
+static int fake_read_data(void *priv, uint8_t *buf, int maxlen)
+{
+	size_t len;
+
+	(void)priv;
+
+	len = MIN(fake.reply_len - fake.reply_pos, (size_t)maxlen);
+	memcpy(buf, fake.reply + fake.reply_pos, len);
+	fake.reply_pos += len;
+
+	return len;
+}
+
+static int fake_read_end(void *priv)
+{
+	(void)priv;
+
+	return SR_OK;
+}
+
+static struct sr_modbus_dev_inst fake_modbus = {
+	.name            = "fake",
+	.send            = fake_send,
+	.read_begin      = fake_read_begin,
+	.read_data       = fake_read_data,
+	.read_end        = fake_read_end,
+	.read_timeout_ms = 1000,
+};
+
+/* A read which a plan is expected to issue. */
+struct test_read {
+	int address;
+	int nb_registers;
+};
+
+/*
+ * Plan the reads of a register map, run the plan, and check the reads
+ * it issued, and the registers which got scattered back to the blocks.
+ */
+static void check_plan(const struct sr_modbus_regmap_entry *entries,
+		size_t count, int max_gap, const struct test_read *reads,
+		size_t num_reads)
+{
+	struct sr_modbus_read_plan *plan;
+	uint16_t **registers;
+	size_t i;
+	int ret;
+
+	plan = sr_modbus_read_plan_new(entries, count, max_gap);
+	fail_unless(plan != NULL, "Cannot plan the reads.");
+	registers = g_malloc(count * sizeof(*registers));
+	for (i = 0; i < count; i++)
+		registers[i] = g_malloc0(entries[i].nb_registers
+			* sizeof(*registers[i]));
+
+	memset(&fake, 0, sizeof(fake));
+	ret = sr_modbus_read_plan_run(&fake_modbus, plan, registers);
+	fail_unless(ret == SR_OK, "Cannot run the plan: %d.", ret);
+
+	fail_unless(fake.num_reads == num_reads,
+		"Plan has %zu reads, expected %zu.", fake.num_reads, num_reads);
+	for (i = 0; i < num_reads; i++) {
+		fail_unless(fake.reads[i].address == reads[i].address
+			&& fake.reads[i].nb_registers == reads[i].nb_registers,
+			"Read %zu is %d+%d, expected %d+%d.", i,
+			fake.reads[i].address, fake.reads[i].nb_registers,
+			reads[i].address, reads[i].nb_registers);
+	}
+	for (i = 0; i < count; i++) {
+		check_registers(registers[i], entries[i].address,
+			entries[i].nb_registers);
+		g_free(registers[i]);
+	}
+
+	g_free(registers);
+	sr_modbus_read_plan_free(plan);
+}
+
+/* Check that adjacent blocks share a read. */
+START_TEST(test_modbus_plan_adjacent)
+{
+	static const struct sr_modbus_regmap_entry entries[] = {
+		{ 0, 2, }, { 2, 3, }, { 5, 1, }, { 7, 1, },
+	};
+	static const struct test_read reads[] = {
+		{ 0, 6, }, { 7, 1, },
+	};
+
+	check_plan(entries, ARRAY_SIZE(entries), 0, reads, ARRAY_SIZE(reads));
+}
+END_TEST
+
+/* Check that reads span gaps up to the permitted size. */
+START_TEST(test_modbus_plan_gap)
+{
+	static const struct sr_modbus_regmap_entry entries[] = {
+		{ 0, 2, }, { 5, 2, }, { 20, 1, },
+	};
+	static const struct test_read reads_2[] = {
+		{ 0, 2, }, { 5, 2, }, { 20, 1, },
+	};
+	static const struct test_read reads_3[] = {
+		{ 0, 7, }, { 20, 1, },
+	};
+	static const struct test_read reads_13[] = {
+		{ 0, 21, },
+	};
+
+	check_plan(entries, ARRAY_SIZE(entries), 2,
+		reads_2, ARRAY_SIZE(reads_2));
+	check_plan(entries, ARRAY_SIZE(entries), 3,
+		reads_3, ARRAY_SIZE(reads_3));
+	check_plan(entries, ARRAY_SIZE(entries), 13,
+		reads_13, ARRAY_SIZE(reads_13));
+}
+END_TEST
+
+/* Check that reads don't exceed the protocol's 125 registers. */
+START_TEST(test_modbus_plan_split)
+{
+	static const struct sr_modbus_regmap_entry adjacent[] = {
+		{ 0, 125, }, { 125, 1, },
+	};
+	static const struct test_read adjacent_reads[] = {
+		{ 0, 125, }, { 125, 1, },
+	};
+	static const struct sr_modbus_regmap_entry gap[] = {
+		{ 0, 60, }, { 62, 63, }, { 130, 60, },
+	};
+	static const struct test_read gap_reads[] = {
+		{ 0, 125, }, { 130, 60, },
+	};
+
+	check_plan(adjacent, ARRAY_SIZE(adjacent), 0,
+		adjacent_reads, ARRAY_SIZE(adjacent_reads));
+	check_plan(gap, ARRAY_SIZE(gap), 5, gap_reads, ARRAY_SIZE(gap_reads));
+}
+END_TEST
+
+/* Check that overlapping blocks share a read, and each get their part. */
+START_TEST(test_modbus_plan_overlap)
+{
+	static const struct sr_modbus_regmap_entry entries[] = {
+		{ 10, 5, }, { 12, 5, }, { 11, 1, }, { 10, 2, },
+	};
+	static const struct test_read reads[] = {
+		{ 10, 7, },
+	};
+
+	check_plan(entries, ARRAY_SIZE(entries), 0, reads, ARRAY_SIZE(reads));
+}
+END_TEST
+
+/* Check that reads go by address, and registers get back in map order. */
+START_TEST(test_modbus_plan_unsorted)
+{
+	static const struct sr_modbus_regmap_entry entries[] = {
+		{ 50, 2, }, { 0, 2, }, { 20, 2, }, { 2, 1, },
+	};
+	static const struct test_read reads[] = {
+		{ 0, 3, }, { 20, 2, }, { 50, 2, },
+	};
+
+	check_plan(entries, ARRAY_SIZE(entries), 0, reads, ARRAY_SIZE(reads));
+}
+END_TEST
+
+/* Check that invalid register maps don't get planned. */
+START_TEST(test_modbus_plan_invalid)
+{
+	static const struct sr_modbus_regmap_entry valid[] = {
+		{ 0, 1, },
+	};
+	static const struct sr_modbus_regmap_entry too_long[] = {
+		{ 0, 126, },
+	};
+	static const struct sr_modbus_regmap_entry beyond[] = {
+		{ 0xfff0, 0x11, },
+	};
+
+	fail_unless(!sr_modbus_read_plan_new(NULL, 1, 0));
+	fail_unless(!sr_modbus_read_plan_new(valid, 0, 0));
+	fail_unless(!sr_modbus_read_plan_new(valid, 1, -1));
+	fail_unless(!sr_modbus_read_plan_new(too_long, 1, 0));
+	fail_unless(!sr_modbus_read_plan_new(beyond, 1, 0));
+}
+END_TEST
+
+Suite *suite_modbus(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("modbus");
+
+#if !defined _WIN32
+	tc = tcase_create("tcp");
+	tcase_add_test(tc, test_modbus_tcp_out_of_order);
+	tcase_add_test(tc, test_modbus_tcp_timeout);
+	suite_add_tcase(s, tc);
+#endif
+
+	tc = tcase_create("plan");
+	tcase_add_test(tc, test_modbus_plan_adjacent);
+	tcase_add_test(tc, test_modbus_plan_gap);
+	tcase_add_test(tc, test_modbus_plan_split);
+	tcase_add_test(tc, test_modbus_plan_overlap);
+	tcase_add_test(tc, test_modbus_plan_unsorted);
+	tcase_add_test(tc, test_modbus_plan_invalid);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,8 +19,12 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <check.h>
+#include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
 #include "lib.h"
 
 /* Check whether at least one output module is available. */
@@ -96,6 +100,675 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+/* Check whether output can be sent to a memory buffer sink. */
+START_TEST(test_output_sink_buffer)
+{
+	const struct sr_output *o;
+	struct sr_output_sink *sink;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t data[] = { 0x01, 0x02, 0x03, 0x04 };
+	GString *buf;
+	int ret;
+
+	o = sr_output_new(sr_output_find("binary"), NULL, NULL, NULL);
+	fail_unless(o != NULL, "Failed to create 'binary' output.");
+	ret = sr_output_sink_new_buffer(&sink);
+	fail_unless(ret == SR_OK, "Failed to create sink.");
+
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	ret = sr_output_send_to_sink(o, &packet, sink);
+	fail_unless(ret == SR_OK, "Failed to send packet.");
+	ret = sr_output_send_to_sink(o, &packet, sink);
+	fail_unless(ret == SR_OK, "Failed to send packet.");
+
+	buf = sr_output_sink_buffer(sink);
+	fail_unless(buf != NULL, "No sink buffer.");
+	fail_unless(buf->len == 2 * sizeof(data), "Wrong output length.");
+	fail_unless(!memcmp(buf->str + sizeof(data), data, sizeof(data)),
+		"Wrong output data.");
+
+	sr_output_sink_free(sink);
+	sr_output_free(o);
+}
+END_TEST
+
+/*
+ * Feed a byte pattern through the 'binary' output module into a sink.
+ * The total size spans several of the fd sink's chunks, the packet size
+ * is odd so that packets straddle chunk boundaries.
+ */
+#define SINK_TEST_SIZE		(3 * 1024 * 1024 + 123)
+#define SINK_TEST_PACKET	4093
+
+static uint8_t *sink_test_pattern(void)
+{
+	uint8_t *data;
+	size_t i;
+
+	data = g_malloc(SINK_TEST_SIZE);
+	for (i = 0; i < SINK_TEST_SIZE; i++)
+		data[i] = (i * 7) ^ (i >> 11);
+
+	return data;
+}
+
+static void sink_test_send(struct sr_output_sink *sink, const uint8_t *data)
+{
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	size_t pos;
+	int ret;
+
+	o = sr_output_new(sr_output_find("binary"), NULL, NULL, NULL);
+	fail_unless(o != NULL, "Failed to create 'binary' output.");
+
+	logic.unitsize = 1;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	for (pos = 0; pos < SINK_TEST_SIZE; pos += logic.length) {
+		logic.length = MIN(SINK_TEST_PACKET, SINK_TEST_SIZE - pos);
+		logic.data = (void *)&data[pos];
+		ret = sr_output_send_to_sink(o, &packet, sink);
+		fail_unless(ret == SR_OK, "Failed to send packet.");
+	}
+
+	sr_output_free(o);
+}
+
+static void sink_test_check_file(const char *filename, const uint8_t *data)
+{
+	gchar *contents;
+	gsize len;
+
+	fail_unless(g_file_get_contents(filename, &contents, &len, NULL),
+		"Cannot read back '%s'.", filename);
+	fail_unless(len == SINK_TEST_SIZE, "Wrong output size %zu.",
+		(size_t)len);
+	fail_unless(!memcmp(contents, data, len), "Wrong output data.");
+	g_free(contents);
+}
+
+/* Check whether output written through an fd sink reads back intact. */
+START_TEST(test_output_sink_fd)
+{
+	struct sr_output_sink *sink;
+	uint8_t *data;
+	gchar *filename;
+	int fd, ret;
+
+	data = sink_test_pattern();
+	fd = g_file_open_tmp("sr-sink-XXXXXX", &filename, NULL);
+	fail_unless(fd >= 0, "Cannot create temporary file.");
+
+	ret = sr_output_sink_new_fd(fd, &sink);
+	fail_unless(ret == SR_OK, "Failed to create sink.");
+	sink_test_send(sink, data);
+	ret = sr_output_sink_flush(sink);
+	fail_unless(ret == SR_OK, "Failed to flush sink.");
+	ret = sr_output_sink_free(sink);
+	fail_unless(ret == SR_OK, "Failed to free sink.");
+	close(fd);
+
+	sink_test_check_file(filename, data);
+	g_unlink(filename);
+	g_free(filename);
+	g_free(data);
+}
+END_TEST
+
+/* Check whether output written through a file sink reads back intact. */
+START_TEST(test_output_sink_file)
+{
+	struct sr_output_sink *sink;
+	uint8_t *data;
+	gchar *filename;
+	int fd, ret;
+
+	data = sink_test_pattern();
+	fd = g_file_open_tmp("sr-sink-XXXXXX", &filename, NULL);
+	fail_unless(fd >= 0, "Cannot create temporary file.");
+	close(fd);
+
+	ret = sr_output_sink_new_file(filename, &sink);
+	if (ret == SR_ERR_NA) {
+		/* No memory mapped files on this platform. */
+		g_unlink(filename);
+		g_free(filename);
+		g_free(data);
+		return;
+	}
+	fail_unless(ret == SR_OK, "Failed to create sink.");
+	sink_test_send(sink, data);
+	/* Freeing the sink truncates the file to the output's size. */
+	ret = sr_output_sink_free(sink);
+	fail_unless(ret == SR_OK, "Failed to free sink.");
+
+	sink_test_check_file(filename, data);
+	g_unlink(filename);
+	g_free(filename);
+	g_free(data);
+}
+END_TEST
+
+static void vcd_send_logic(const struct sr_output *o, GString *out,
+		const uint8_t *data, size_t count, size_t unitsize)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GString *text;
+	int ret;
+
+	logic.length = count * unitsize;
+	logic.unitsize = unitsize;
+	logic.data = (void *)data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	text = NULL;
+	ret = sr_output_send(o, &packet, &text);
+	fail_unless(ret == SR_OK, "Failed to send logic packet.");
+	if (text) {
+		g_string_append_len(out, text->str, text->len);
+		g_string_free(text, TRUE);
+	}
+}
+
+static void vcd_send_analog(const struct sr_output *o, GString *out,
+		struct sr_channel *ch, float *data, size_t count)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	GString *text;
+	int ret;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	meaning.channels = g_slist_append(NULL, ch);
+	meaning.mq = SR_MQ_VOLTAGE;
+	meaning.unit = SR_UNIT_VOLT;
+	analog.num_samples = count;
+	analog.data = data;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	text = NULL;
+	ret = sr_output_send(o, &packet, &text);
+	fail_unless(ret == SR_OK, "Failed to send analog packet.");
+	if (text) {
+		g_string_append_len(out, text->str, text->len);
+		g_string_free(text, TRUE);
+	}
+	g_slist_free(meaning.channels);
+}
+
+/*
+ * Check VCD output of interleaved logic and analog data. The logic
+ * channels span two 64bit words, and a disabled channel toggles without
+ * showing up. Value changes get queued until all channels have caught
+ * up with a sample number.
+ */
+START_TEST(test_output_vcd)
+{
+	static const char *expected =
+		"$timescale 1 ms $end\n"
+		"$scope module libsigrok $end\n"
+		"$var wire 1 ! D0 $end\n"
+		"$var wire 1 \" D1 $end\n"
+		"$var wire 1 # D65 $end\n"
+		"$var real 64 $ A0 $end\n"
+		"$upscope $end\n"
+		"$enddefinitions $end\n"
+		"\n#0 1! 0\" 0# r1.5 $"
+		"\n#1 1\""
+		"\n#2 r2 $"
+		"\n#3 1#"
+		"\n#4 0! r2.5 $"
+		"\n#6\n";
+	/* D0, D1, D2 (disabled) in byte 0, D65 in byte 8. */
+	static const uint8_t logic1[4][9] = {
+		{ 0x05, 0, 0, 0, 0, 0, 0, 0, 0x00 },
+		{ 0x03, 0, 0, 0, 0, 0, 0, 0, 0x00 },
+		{ 0x07, 0, 0, 0, 0, 0, 0, 0, 0x00 },
+		{ 0x07, 0, 0, 0, 0, 0, 0, 0, 0x02 },
+	};
+	static const uint8_t logic2[2][9] = {
+		{ 0x06, 0, 0, 0, 0, 0, 0, 0, 0x02 },
+		{ 0x02, 0, 0, 0, 0, 0, 0, 0, 0x02 },
+	};
+	float analog1[] = { 1.5, 1.5, 2.0 };
+	float analog2[] = { 2.0, 2.5, 2.5 };
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch_a0;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_config *src;
+	GString *out, *text;
+	const char *body;
+	GSList *l;
+	int ret;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	sr_dev_inst_channel_add(sdi, 1, SR_CHANNEL_LOGIC, "D1");
+	sr_dev_inst_channel_add(sdi, 2, SR_CHANNEL_LOGIC, "D2");
+	sr_dev_inst_channel_add(sdi, 65, SR_CHANNEL_LOGIC, "D65");
+	sr_dev_inst_channel_add(sdi, 66, SR_CHANNEL_ANALOG, "A0");
+	for (l = sdi->channels; l; l = l->next) {
+		if (!strcmp(((struct sr_channel *)l->data)->name, "D2"))
+			sr_dev_channel_enable(l->data, FALSE);
+	}
+	ch_a0 = g_slist_last(sdi->channels)->data;
+
+	o = sr_output_new(sr_output_find("vcd"), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create 'vcd' output.");
+	out = g_string_new(NULL);
+
+	src = sr_config_new(SR_CONF_SAMPLERATE, g_variant_new_uint64(1000));
+	meta.config = g_slist_append(NULL, src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	text = NULL;
+	ret = sr_output_send(o, &packet, &text);
+	fail_unless(ret == SR_OK, "Failed to send meta packet.");
+	if (text)
+		g_string_free(text, TRUE);
+	g_slist_free_full(meta.config, (GDestroyNotify)sr_config_free);
+
+	vcd_send_logic(o, out, &logic1[0][0], 4, 9);
+	vcd_send_analog(o, out, ch_a0, analog1, 3);
+	vcd_send_logic(o, out, &logic2[0][0], 2, 9);
+	vcd_send_analog(o, out, ch_a0, analog2, 3);
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	text = NULL;
+	ret = sr_output_send(o, &packet, &text);
+	fail_unless(ret == SR_OK, "Failed to send end packet.");
+	if (text) {
+		g_string_append_len(out, text->str, text->len);
+		g_string_free(text, TRUE);
+	}
+
+	/* Skip the header's date, version, and comment. */
+	body = strstr(out->str, "$timescale");
+	fail_unless(body != NULL, "No VCD header.");
+	fail_unless(!strcmp(body, expected),
+		"Unexpected VCD output:\n%s", body);
+
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+static void text_send(const struct sr_output *o, GString *out,
+		int type, const void *payload)
+{
+	struct sr_datafeed_packet packet;
+	GString *text;
+	int ret;
+
+	packet.type = type;
+	packet.payload = payload;
+	text = NULL;
+	ret = sr_output_send(o, &packet, &text);
+	fail_unless(ret == SR_OK, "Failed to send packet type %d.", type);
+	if (text) {
+		g_string_append_len(out, text->str, text->len);
+		g_string_free(text, TRUE);
+	}
+}
+
+/*
+ * Run a text output module on logic data, and return its output after
+ * the header lines. The device has unitsize * 8 channels D0, D1, ...,
+ * of which the ones in the enabled mask are enabled. The data is sent
+ * in two packets, with a trigger between them.
+ */
+static char *text_output_run(char *id, uint32_t width,
+		size_t unitsize, uint32_t enabled, size_t count, size_t split)
+{
+	struct sr_dev_inst *sdi;
+	const struct sr_output *o;
+	struct sr_datafeed_logic logic;
+	GHashTable *options;
+	GString *out;
+	GSList *l;
+	uint8_t *data;
+	const char *body;
+	char *name, *ret;
+	size_t i;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < unitsize * 8; i++) {
+		name = g_strdup_printf("D%zu", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+		g_free(name);
+	}
+	for (l = sdi->channels; l; l = l->next) {
+		i = ((struct sr_channel *)l->data)->index;
+		sr_dev_channel_enable(l->data, (enabled >> i) & 1);
+	}
+	data = g_malloc(count * unitsize);
+	for (i = 0; i < count * unitsize; i++)
+		data[i] = (i * 151 + 17) ^ (i / 3);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("width"),
+		g_variant_ref_sink(g_variant_new_uint32(width)));
+	o = sr_output_new(sr_output_find(id), options, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create '%s' output.", id);
+	g_hash_table_destroy(options);
+	out = g_string_new(NULL);
+
+	logic.unitsize = unitsize;
+	logic.data = data;
+	logic.length = split * unitsize;
+	text_send(o, out, SR_DF_LOGIC, &logic);
+	text_send(o, out, SR_DF_TRIGGER, NULL);
+	logic.data = data + split * unitsize;
+	logic.length = (count - split) * unitsize;
+	text_send(o, out, SR_DF_LOGIC, &logic);
+	text_send(o, out, SR_DF_END, NULL);
+
+	/* Skip the version and the acquisition summary. */
+	body = strstr(out->str, "Acquisition with");
+	fail_unless(body != NULL, "No '%s' header.", id);
+	body = strchr(body, '\n');
+	fail_unless(body != NULL, "No '%s' header.", id);
+	ret = g_strdup(body + 1);
+
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+	sr_dev_inst_free(sdi);
+	g_free(data);
+
+	return ret;
+}
+
+static void text_output_check(char *id, uint32_t width,
+		size_t unitsize, uint32_t enabled, const char *expected)
+{
+	char *body;
+
+	body = text_output_run(id, width, unitsize, enabled, 37, 13);
+	fail_unless(!strcmp(body, expected),
+		"Unexpected '%s' output (width %u, unitsize %zu):\n%s",
+		id, width, unitsize, body);
+	g_free(body);
+}
+
+/*
+ * Check hex output against known good text. Lines wrap at the width,
+ * and a partial byte at the end shows its samples in the upper bits.
+ */
+START_TEST(test_output_hex)
+{
+	text_output_check("hex", 16, 1, 0x0009,
+		"D0:b6 db \n"
+		"D3:6a 95 \n"
+		"T:    ^ 13\n"
+		"D0:6d b6 \n"
+		"D3:6a 6a \n"
+		"D0:d8 \n"
+		"D3:90 \n");
+	text_output_check("hex", 24, 2, 0x1002,
+		"D1:49 24 92 \n"
+		"D12:52 ad 52 \n"
+		"T:    ^ 13\n"
+		"D1:49 20 \n"
+		"D12:52 a8 \n");
+}
+END_TEST
+
+/*
+ * Check bits output against known good text, for a width which wraps
+ * lines within a byte, and for one which wraps at byte boundaries.
+ */
+START_TEST(test_output_bits)
+{
+	text_output_check("bits", 12, 1, 0x0009,
+		"D0:10110110 1101\n"
+		"D3:01101010 1001\n"
+		"D0:10110110 1101\n"
+		"D3:01010110 1010\n"
+		"T: ^ 1\n"
+		"D0:10110110 1101\n"
+		"D3:01101010 1001\n"
+		"D0:1\n"
+		"D3:0\n");
+	text_output_check("bits", 16, 2, 0x1002,
+		"D1:01001001 00100100\n"
+		"D12:01010010 10101101\n"
+		"T:              ^ 13\n"
+		"D1:10010010 01001001\n"
+		"D12:01010010 01010010\n"
+		"D1:00100\n"
+		"D12:10101\n");
+}
+END_TEST
+
+/*
+ * Check ascii output against known good text. Names get aligned, and
+ * the first sample of a line never shows an edge.
+ */
+START_TEST(test_output_ascii)
+{
+	text_output_check("ascii", 12, 1, 0x0009,
+		"D0:\"\\/\"\\/\"\\/\"\\/\n"
+		"D3:./\"\\/\\/\\/\\./\n"
+		"D0:\"\\/\"\\/\"\\/\"\\/\n"
+		"D3:./\\/\\/\"\\/\\/\\\n"
+		" T: ^ 1\n"
+		"D0:\"\\/\"\\/\"\\/\"\\/\n"
+		"D3:./\"\\/\\/\\/\\./\n"
+		"D0:\"\n"
+		"D3:.\n");
+	text_output_check("ascii", 20, 3, 0x20004,
+		" D2:./\\../\\../\\../\\../\\.\n"
+		"D17:\"\\/\\/\\/\\/\\/\\/\\/\\/\\/\\\n"
+		"  T:             ^ 13\n"
+		" D2:./\\../\\../\\../\\..\n"
+		"D17:\"\\/\\/\\/\\/\\/\\/\\/\\/\n");
+}
+END_TEST
+
+static void csv_send_analog(const struct sr_output *o, GString *out,
+		struct sr_channel *ch, float *data, size_t count,
+		enum sr_mq mq, enum sr_unit unit)
+{
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	meaning.channels = g_slist_append(NULL, ch);
+	meaning.mq = mq;
+	meaning.unit = unit;
+	analog.num_samples = count;
+	analog.data = data;
+	text_send(o, out, SR_DF_ANALOG, &analog);
+	g_slist_free(meaning.channels);
+}
+
+/*
+ * Run the CSV output module on two frames of mixed signal data, from
+ * two logic and two analog channels. Return the output, without the
+ * header's version and date lines.
+ */
+static char *csv_output_run(gboolean header, gboolean time,
+		const char *label, uint64_t samplerate)
+{
+	static const uint8_t logic_data[] = { 0x01, 0x02, 0x03, 0x00 };
+	float volts[] = { 1.5, -0.25, 3, 1000000 };
+	float amps[] = { 0.001, 2, 2, 0 };
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch_a0, *ch_a1;
+	const struct sr_output *o;
+	struct sr_datafeed_header hdr;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_config *src;
+	GHashTable *options;
+	GString *out;
+	const char *body;
+	char *ret;
+	int frame;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	sr_dev_inst_channel_add(sdi, 1, SR_CHANNEL_LOGIC, "D1");
+	sr_dev_inst_channel_add(sdi, 2, SR_CHANNEL_ANALOG, "A0");
+	sr_dev_inst_channel_add(sdi, 3, SR_CHANNEL_ANALOG, "A1");
+	ch_a0 = g_slist_nth_data(sdi->channels, 2);
+	ch_a1 = g_slist_nth_data(sdi->channels, 3);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("header"),
+		g_variant_ref_sink(g_variant_new_boolean(header)));
+	g_hash_table_insert(options, g_strdup("time"),
+		g_variant_ref_sink(g_variant_new_boolean(time)));
+	g_hash_table_insert(options, g_strdup("label"),
+		g_variant_ref_sink(g_variant_new_string(label)));
+	o = sr_output_new(sr_output_find("csv"), options, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create 'csv' output.");
+	g_hash_table_destroy(options);
+	out = g_string_new(NULL);
+
+	if (samplerate) {
+		src = sr_config_new(SR_CONF_SAMPLERATE,
+			g_variant_new_uint64(samplerate));
+		meta.config = g_slist_append(NULL, src);
+		text_send(o, out, SR_DF_META, &meta);
+		g_slist_free_full(meta.config, (GDestroyNotify)sr_config_free);
+	}
+	hdr.feed_version = 1;
+	hdr.starttime.tv_sec = 0;
+	hdr.starttime.tv_usec = 0;
+	text_send(o, out, SR_DF_HEADER, &hdr);
+
+	for (frame = 0; frame < 2; frame++) {
+		text_send(o, out, SR_DF_FRAME_BEGIN, NULL);
+		logic.unitsize = 1;
+		logic.data = (void *)logic_data;
+		logic.length = sizeof(logic_data);
+		text_send(o, out, SR_DF_LOGIC, &logic);
+		csv_send_analog(o, out, ch_a0, volts, 4,
+			SR_MQ_VOLTAGE, SR_UNIT_VOLT);
+		csv_send_analog(o, out, ch_a1, amps, 4,
+			SR_MQ_CURRENT, SR_UNIT_AMPERE);
+		text_send(o, out, SR_DF_FRAME_END, NULL);
+	}
+	text_send(o, out, SR_DF_END, NULL);
+
+	/* Skip the header's version and date. */
+	body = out->str;
+	if (header) {
+		body = strstr(body, "; Channels");
+		fail_unless(body != NULL, "No CSV header.");
+	}
+	ret = g_strdup(body);
+
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+	sr_dev_inst_free(sdi);
+
+	return ret;
+}
+
+static void csv_output_check(gboolean header, gboolean time,
+		const char *label, uint64_t samplerate, const char *expected)
+{
+	char *body;
+
+	body = csv_output_run(header, time, label, samplerate);
+	fail_unless(!strcmp(body, expected),
+		"Unexpected CSV output (label %s, rate %" PRIu64 "):\n%s",
+		label, samplerate, body);
+	g_free(body);
+}
+
+/*
+ * Check CSV output of mixed signal data against known good text. The
+ * header lists the channels and the samplerate, unit labels name the
+ * analog quantities, and timestamps continue across frames.
+ */
+START_TEST(test_output_csv_header)
+{
+	csv_output_check(TRUE, TRUE, "units", 3000,
+		"; Channels (4/4): D0, D1, A0, A1\n"
+		"; Samplerate: 3 kHz\n"
+		"\n"
+		"microseconds,logic,logic,V,A\n"
+		"0,1,0,1.5,0.001\n"
+		"333,0,1,-0.25,2\n"
+		"666,1,1,3,2\n"
+		"1000,0,0,1000000,0\n"
+		"\n"
+		"1333,1,0,1.5,0.001\n"
+		"1666,0,1,-0.25,2\n"
+		"2000,1,1,3,2\n"
+		"2333,0,0,1000000,0\n");
+}
+END_TEST
+
+/* Check the time column's unit, and labels which name the channels. */
+START_TEST(test_output_csv_time)
+{
+	csv_output_check(FALSE, TRUE, "units", 1000000,
+		"\n"
+		"microseconds,logic,logic,V,A\n"
+		"0,1,0,1.5,0.001\n"
+		"1,0,1,-0.25,2\n"
+		"2,1,1,3,2\n"
+		"3,0,0,1000000,0\n"
+		"\n"
+		"4,1,0,1.5,0.001\n"
+		"5,0,1,-0.25,2\n"
+		"6,1,1,3,2\n"
+		"7,0,0,1000000,0\n");
+	csv_output_check(FALSE, TRUE, "channel", 3000,
+		"\n"
+		"Time,D0,D1,A0,A1\n"
+		"0,1,0,1.5,0.001\n"
+		"333,0,1,-0.25,2\n"
+		"666,1,1,3,2\n"
+		"1000,0,0,1000000,0\n"
+		"\n"
+		"1333,1,0,1.5,0.001\n"
+		"1666,0,1,-0.25,2\n"
+		"2000,1,1,3,2\n"
+		"2333,0,0,1000000,0\n");
+}
+END_TEST
+
+/* Check CSV output without time column and labels. */
+START_TEST(test_output_csv_plain)
+{
+	csv_output_check(FALSE, FALSE, "off", 0,
+		"\n"
+		"1,0,1.5,0.001\n"
+		"0,1,-0.25,2\n"
+		"1,1,3,2\n"
+		"0,0,1000000,0\n"
+		"\n"
+		"1,0,1.5,0.001\n"
+		"0,1,-0.25,2\n"
+		"1,1,3,2\n"
+		"0,0,1000000,0\n");
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -112,5 +785,27 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_options);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("sink");
+	tcase_add_test(tc, test_output_sink_buffer);
+	tcase_add_test(tc, test_output_sink_fd);
+	tcase_add_test(tc, test_output_sink_file);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("vcd");
+	tcase_add_test(tc, test_output_vcd);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("text");
+	tcase_add_test(tc, test_output_hex);
+	tcase_add_test(tc, test_output_bits);
+	tcase_add_test(tc, test_output_ascii);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("csv");
+	tcase_add_test(tc, test_output_csv_header);
+	tcase_add_test(tc, test_output_csv_time);
+	tcase_add_test(tc, test_output_csv_plain);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -0,0 +1,395 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <stdarg.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define POLL_INTERVAL_MS 10
+/* Results each shared poll gets before it gets removed. */
+#define POLL_RESULTS 5
+/* Times the test locks a bus which gets polled continuously. */
+#define POLL_LOCKS 20
+/* The longest a bus lock may take, in us. Requests take 1 ms. */
+#define POLL_MAX_LOCK_WAIT_US (500 * 1000)
+
+/* A driver's poll, and what it has seen. */
+struct test_poll {
+	struct sr_poll *poll;
+	unsigned int results;
+	uint8_t last;
+	gboolean ordered;
+};
+
+static struct {
+	GThread *session_thread;
+	struct test_poll polls[2];
+	gint runs;
+	gint in_run;
+	gint locked;
+	gint lock_done;
+	gboolean overlap;
+	gboolean wrong_thread;
+	int64_t max_wait_us;
+} poll_state;
+
+/* Sets up the polls when the test device's acquisition starts. */
+static int (*poll_start)(const struct sr_dev_inst *sdi);
+
+static int poll_dev_open(struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_OK;
+}
+
+static int poll_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	return poll_start(sdi);
+}
+
+static int poll_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_OK;
+}
+
+static struct sr_dev_driver poll_driver = {
+	.name = "test-poll",
+	.longname = "Poll scheduler test device",
+	.dev_open = poll_dev_open,
+	.dev_acquisition_start = poll_acquisition_start,
+	.dev_acquisition_stop = poll_acquisition_stop,
+};
+
+/* Start a session with a test device, which sets up its polls. */
+static struct sr_session *poll_session_start(struct sr_dev_inst **sdi)
+{
+	struct sr_session *sess;
+	int ret;
+
+	*sdi = g_malloc0(sizeof(**sdi));
+	(*sdi)->driver = &poll_driver;
+	(*sdi)->status = SR_ST_ACTIVE;
+	/* All polls of the test device share one bus. */
+	(*sdi)->conn = &poll_driver;
+	sr_channel_new(*sdi, 0, SR_CHANNEL_ANALOG, TRUE, "A0");
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_dev_add(sess, *sdi);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+
+	return sess;
+}
+
+/* Run a session with a test device, until all polls are removed. */
+static void poll_run(void)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	int ret;
+
+	sess = poll_session_start(&sdi);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+
+	sr_session_destroy(sess);
+	sr_dev_inst_free(sdi);
+}
+
+/* Reply with the number of the request. */
+static int poll_run_count(void *cb_data, GByteArray *reply)
+{
+	uint8_t count;
+
+	(void)cb_data;
+
+	if (g_atomic_int_add(&poll_state.in_run, 1))
+		poll_state.overlap = TRUE;
+	if (g_atomic_int_get(&poll_state.locked))
+		poll_state.overlap = TRUE;
+	count = (uint8_t)g_atomic_int_add(&poll_state.runs, 1);
+	g_byte_array_append(reply, &count, 1);
+	g_atomic_int_add(&poll_state.in_run, -1);
+
+	return SR_OK;
+}
+
+static void poll_done_shared(int result, const uint8_t *reply, size_t len,
+		void *cb_data)
+{
+	struct test_poll *tp;
+
+	tp = cb_data;
+	if (g_thread_self() != poll_state.session_thread)
+		poll_state.wrong_thread = TRUE;
+	if (result != SR_OK || len != 1)
+		tp->ordered = FALSE;
+	else if (tp->results && reply[0] <= tp->last)
+		tp->ordered = FALSE;
+	else
+		tp->last = reply[0];
+
+	if (++tp->results == POLL_RESULTS) {
+		sr_poll_remove(tp->poll);
+		tp->poll = NULL;
+	}
+}
+
+static int poll_start_shared(const struct sr_dev_inst *sdi)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(poll_state.polls); i++) {
+		poll_state.polls[i].ordered = TRUE;
+		poll_state.polls[i].poll = sr_poll_add(sdi->session, sdi->conn,
+			"count", POLL_INTERVAL_MS, poll_run_count,
+			poll_done_shared, &poll_state.polls[i]);
+		if (!poll_state.polls[i].poll)
+			return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Check that polls with the same key share one request, and that the
+ * results reach the driver in the session thread, in order.
+ */
+START_TEST(test_poll_shared)
+{
+	unsigned int i;
+
+	memset(&poll_state, 0, sizeof(poll_state));
+	poll_state.session_thread = g_thread_self();
+	poll_start = poll_start_shared;
+	poll_run();
+
+	fail_unless(!poll_state.wrong_thread,
+		"Results passed outside the session thread.");
+	fail_unless(!poll_state.overlap, "Requests on a bus overlapped.");
+	for (i = 0; i < ARRAY_SIZE(poll_state.polls); i++) {
+		fail_unless(poll_state.polls[i].results == POLL_RESULTS);
+		fail_unless(poll_state.polls[i].ordered,
+			"Poll %u got results out of order.", i);
+	}
+	/* Separate requests would have taken twice as many. */
+	fail_unless(g_atomic_int_get(&poll_state.runs) < 2 * POLL_RESULTS,
+		"%d requests for %d results.",
+		g_atomic_int_get(&poll_state.runs), POLL_RESULTS);
+}
+END_TEST
+
+/* Take a while, check that the bus doesn't get locked meanwhile. */
+static int poll_run_slow(void *cb_data, GByteArray *reply)
+{
+	(void)cb_data;
+	(void)reply;
+
+	g_atomic_int_add(&poll_state.in_run, 1);
+	if (g_atomic_int_get(&poll_state.locked))
+		poll_state.overlap = TRUE;
+	g_usleep(1000);
+	if (g_atomic_int_get(&poll_state.locked))
+		poll_state.overlap = TRUE;
+	g_atomic_int_add(&poll_state.in_run, -1);
+
+	return SR_OK;
+}
+
+static void poll_done_slow(int result, const uint8_t *reply, size_t len,
+		void *cb_data)
+{
+	struct test_poll *tp;
+
+	(void)result;
+	(void)reply;
+	(void)len;
+
+	tp = cb_data;
+	tp->results++;
+	if (tp->poll && g_atomic_int_get(&poll_state.lock_done)) {
+		sr_poll_remove(tp->poll);
+		tp->poll = NULL;
+	}
+}
+
+/* Lock the bus repeatedly, like a driver changing settings. */
+static void *poll_lock_thread(void *data)
+{
+	struct sr_poll *poll;
+	int64_t start_us, wait_us;
+	unsigned int i;
+
+	poll = data;
+	for (i = 0; i < POLL_LOCKS; i++) {
+		start_us = g_get_monotonic_time();
+		sr_poll_bus_lock(poll);
+		wait_us = g_get_monotonic_time() - start_us;
+		poll_state.max_wait_us = MAX(poll_state.max_wait_us, wait_us);
+		g_atomic_int_set(&poll_state.locked, 1);
+		if (g_atomic_int_get(&poll_state.in_run))
+			poll_state.overlap = TRUE;
+		g_usleep(500);
+		g_atomic_int_set(&poll_state.locked, 0);
+		sr_poll_bus_unlock(poll);
+		g_usleep(500);
+	}
+	g_atomic_int_set(&poll_state.lock_done, 1);
+
+	return NULL;
+}
+
+static int poll_start_continuous(const struct sr_dev_inst *sdi)
+{
+	struct test_poll *tp;
+
+	tp = &poll_state.polls[0];
+	tp->poll = sr_poll_add(sdi->session, sdi->conn, NULL, 0,
+		poll_run_slow, poll_done_slow, tp);
+
+	return tp->poll ? SR_OK : SR_ERR;
+}
+
+/*
+ * Check that a driver gets the lock of a bus which gets polled as fast
+ * as possible, and that no request runs while the bus is locked.
+ */
+START_TEST(test_poll_bus_lock)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	GThread *thread;
+	int ret;
+
+	memset(&poll_state, 0, sizeof(poll_state));
+	poll_state.session_thread = g_thread_self();
+	poll_start = poll_start_continuous;
+	sess = poll_session_start(&sdi);
+
+	thread = g_thread_new("poll-lock", poll_lock_thread,
+		poll_state.polls[0].poll);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+	g_thread_join(thread);
+
+	fail_unless(!poll_state.overlap, "A request ran while locked.");
+	fail_unless(poll_state.max_wait_us < POLL_MAX_LOCK_WAIT_US,
+		"Locking the bus took %" PRId64 " us.", poll_state.max_wait_us);
+	fail_unless(poll_state.polls[0].results > 0);
+
+	sr_session_destroy(sess);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+static GString *poll_log;
+
+static int poll_log_capture(void *cb_data, int loglevel, const char *format,
+		va_list args)
+{
+	(void)cb_data;
+	(void)loglevel;
+
+	g_string_append_vprintf(poll_log, format, args);
+	g_string_append_c(poll_log, '\n');
+
+	return SR_OK;
+}
+
+static int poll_run_never(void *cb_data, GByteArray *reply)
+{
+	(void)cb_data;
+	(void)reply;
+
+	fail("Request of a poll which failed to register.");
+
+	return SR_ERR;
+}
+
+static void poll_done_never(int result, const uint8_t *reply, size_t len,
+		void *cb_data)
+{
+	(void)result;
+	(void)reply;
+	(void)len;
+	(void)cb_data;
+
+	fail("Result of a poll which failed to register.");
+}
+
+/*
+ * Check that a poll which cannot get registered (the session doesn't
+ * run) cleans up without unregistering a source the session never had.
+ */
+START_TEST(test_poll_add_failure)
+{
+	struct sr_session *sess;
+	struct sr_poll *poll;
+	int dummy;
+
+	fail_unless(sr_poll_add(NULL, &dummy, NULL, 0, poll_run_never,
+		poll_done_never, NULL) == NULL);
+
+	sr_session_new(srtest_ctx, &sess);
+	fail_unless(sr_poll_add(sess, NULL, NULL, 0, poll_run_never,
+		poll_done_never, NULL) == NULL);
+
+	poll_log = g_string_new(NULL);
+	sr_log_callback_set(poll_log_capture, NULL);
+	poll = sr_poll_add(sess, &dummy, "key", 0, poll_run_never,
+		poll_done_never, NULL);
+	sr_log_callback_set_default();
+
+	fail_unless(poll == NULL);
+	fail_unless(g_hash_table_size(sess->event_sources) == 0,
+		"Failed poll left an event source.");
+	fail_unless(strstr(poll_log->str, "without main context") != NULL,
+		"Unexpected log: '%s'.", poll_log->str);
+	fail_unless(strstr(poll_log->str, "No event source") == NULL,
+		"Failed poll unregistered itself: '%s'.", poll_log->str);
+
+	g_string_free(poll_log, TRUE);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+Suite *suite_poll(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("poll");
+
+	tc = tcase_create("scheduler");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_poll_shared);
+	tcase_add_test(tc, test_poll_bus_lock);
+	tcase_add_test(tc, test_poll_add_failure);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,267 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 The sigrok project
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define IMAGE_A		"test-a.fw"
+#define IMAGE_B		"test-b.fw"
+
+/* Image content which the resource hooks serve, and access counts. */
+static const char *image_a, *image_b;
+static int open_count, upload_count;
+
+struct test_handle {
+	const char *data;
+	size_t pos;
+};
+
+static int test_open(struct sr_resource *res, const char *name,
+		void *cb_data)
+{
+	struct test_handle *h;
+	const char *data;
+
+	(void)cb_data;
+
+	if (!strcmp(name, IMAGE_A))
+		data = image_a;
+	else if (!strcmp(name, IMAGE_B))
+		data = image_b;
+	else
+		return SR_ERR;
+
+	open_count++;
+	h = g_malloc0(sizeof(*h));
+	h->data = data;
+	res->handle = h;
+	res->size = strlen(data);
+
+	return SR_OK;
+}
+
+static int test_close(struct sr_resource *res, void *cb_data)
+{
+	(void)cb_data;
+
+	g_free(res->handle);
+	res->handle = NULL;
+
+	return SR_OK;
+}
+
+static gssize test_read(const struct sr_resource *res, void *buf,
+		size_t count, void *cb_data)
+{
+	struct test_handle *h;
+	size_t len;
+
+	(void)cb_data;
+
+	h = res->handle;
+	len = MIN(count, strlen(h->data) - h->pos);
+	memcpy(buf, h->data + h->pos, len);
+	h->pos += len;
+
+	return len;
+}
+
+static struct sr_dev_inst *test_device_new(const char *serial_num)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sdi->serial_num = g_strdup(serial_num);
+
+	return sdi;
+}
+
+/* Upload an image the way drivers do, and count actual uploads. */
+static void test_upload(const struct sr_dev_inst *sdi, const char *name)
+{
+	void *buf;
+	size_t size;
+
+	if (sr_resource_image_current(sdi, srtest_ctx,
+			SR_RESOURCE_FIRMWARE, name))
+		return;
+
+	buf = sr_resource_load(srtest_ctx, SR_RESOURCE_FIRMWARE,
+		name, &size, 1024);
+	fail_unless(buf != NULL, "Cannot load '%s'.", name);
+	g_free(buf);
+	sr_resource_image_uploaded(sdi, srtest_ctx, SR_RESOURCE_FIRMWARE, NULL);
+	upload_count++;
+	sr_resource_image_uploaded(sdi, srtest_ctx, SR_RESOURCE_FIRMWARE, name);
+}
+
+static void resource_setup(void)
+{
+	int ret;
+
+	srtest_setup();
+	image_a = "image A, version 1";
+	image_b = "image B";
+	open_count = upload_count = 0;
+	ret = sr_resource_set_hooks(srtest_ctx,
+		test_open, test_close, test_read, NULL);
+	fail_unless(ret == SR_OK, "Cannot set resource hooks: %d.", ret);
+}
+
+static void resource_teardown(void)
+{
+	srtest_teardown();
+}
+
+/* Check that loads read a resource once, until the cache gets cleared. */
+START_TEST(test_resource_cache)
+{
+	char *buf;
+	size_t size;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		buf = sr_resource_load(srtest_ctx, SR_RESOURCE_FIRMWARE,
+			IMAGE_A, &size, 1024);
+		fail_unless(buf != NULL, "Cannot load resource.");
+		fail_unless(size == strlen(image_a) &&
+			!memcmp(buf, image_a, size), "Unexpected content.");
+		g_free(buf);
+	}
+	fail_unless(open_count == 1, "Resource opened %d times.", open_count);
+
+	/* The size limit still applies to cached content. */
+	buf = sr_resource_load(srtest_ctx, SR_RESOURCE_FIRMWARE,
+		IMAGE_A, &size, 4);
+	fail_unless(buf == NULL, "Size limit not applied.");
+
+	image_a = "image A, version 2";
+	sr_resource_cache_clear(srtest_ctx);
+	buf = sr_resource_load(srtest_ctx, SR_RESOURCE_FIRMWARE,
+		IMAGE_A, &size, 1024);
+	fail_unless(buf != NULL, "Cannot load resource.");
+	fail_unless(!memcmp(buf, image_a, size), "Stale content.");
+	g_free(buf);
+	fail_unless(open_count == 2, "Resource opened %d times.", open_count);
+}
+END_TEST
+
+/* Check that the same image does not get uploaded to a device again. */
+START_TEST(test_resource_image_hit)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = test_device_new("0001");
+	fail_unless(!sr_resource_image_current(sdi, srtest_ctx,
+		SR_RESOURCE_FIRMWARE, IMAGE_A), "Unknown device is current.");
+	fail_unless(!sr_resource_image_differs(sdi, srtest_ctx,
+		SR_RESOURCE_FIRMWARE, IMAGE_A), "Unknown device differs.");
+
+	test_upload(sdi, IMAGE_A);
+	test_upload(sdi, IMAGE_A);
+	test_upload(sdi, IMAGE_A);
+	fail_unless(upload_count == 1, "Uploaded %d times.", upload_count);
+	fail_unless(open_count == 1, "Resource opened %d times.", open_count);
+	fail_unless(!sr_resource_image_differs(sdi, srtest_ctx,
+		SR_RESOURCE_FIRMWARE, IMAGE_A), "Same image differs.");
+
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/*
+ * Check that images get uploaded to devices which have not seen them,
+ * and to devices which got another image, or after a failed upload.
+ */
+START_TEST(test_resource_image_miss)
+{
+	struct sr_dev_inst *sdi1, *sdi2;
+
+	sdi1 = test_device_new("0001");
+	sdi2 = test_device_new("0002");
+
+	test_upload(sdi1, IMAGE_A);
+	test_upload(sdi2, IMAGE_A);
+	fail_unless(upload_count == 2, "Uploaded %d times.", upload_count);
+	fail_unless(open_count == 1, "Resource opened %d times.", open_count);
+
+	test_upload(sdi1, IMAGE_B);
+	fail_unless(upload_count == 3, "Uploaded %d times.", upload_count);
+	fail_unless(sr_resource_image_differs(sdi1, srtest_ctx,
+		SR_RESOURCE_FIRMWARE, IMAGE_A), "Other image does not differ.");
+	test_upload(sdi1, IMAGE_A);
+	fail_unless(upload_count == 4, "Uploaded %d times.", upload_count);
+
+	/* The state of the device is unknown after a failed upload. */
+	sr_resource_image_uploaded(sdi2, srtest_ctx,
+		SR_RESOURCE_FIRMWARE, NULL);
+	fail_unless(!sr_resource_image_differs(sdi2, srtest_ctx,
+		SR_RESOURCE_FIRMWARE, IMAGE_A), "Unknown device differs.");
+	test_upload(sdi2, IMAGE_A);
+	fail_unless(upload_count == 5, "Uploaded %d times.", upload_count);
+
+	sr_dev_inst_free(sdi1);
+	sr_dev_inst_free(sdi2);
+}
+END_TEST
+
+/* Check that a changed image file gets uploaded again. */
+START_TEST(test_resource_image_changed)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = test_device_new("0001");
+	test_upload(sdi, IMAGE_A);
+	test_upload(sdi, IMAGE_A);
+	fail_unless(upload_count == 1, "Uploaded %d times.", upload_count);
+
+	image_a = "image A, version 2";
+	sr_resource_cache_clear(srtest_ctx);
+	fail_unless(sr_resource_image_differs(sdi, srtest_ctx,
+		SR_RESOURCE_FIRMWARE, IMAGE_A), "Changed image does not differ.");
+	test_upload(sdi, IMAGE_A);
+	test_upload(sdi, IMAGE_A);
+	fail_unless(upload_count == 2, "Uploaded %d times.", upload_count);
+	fail_unless(open_count == 2, "Resource opened %d times.", open_count);
+
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+Suite *suite_resource(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("resource");
+
+	tc = tcase_create("cache");
+	tcase_add_checked_fixture(tc, resource_setup, resource_teardown);
+	tcase_add_test(tc, test_resource_cache);
+	tcase_add_test(tc, test_resource_image_hit);
+	tcase_add_test(tc, test_resource_image_miss);
+	tcase_add_test(tc, test_resource_image_changed);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -19,10 +19,38 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
 #include "lib.h"
 
+#define THREADS_SAMPLERATE SR_MHZ(10)
+#define THREADS_SAMPLES (1000 * 1000)
+/* Logic packets after which the continuous acquisition gets stopped. */
+#define THREADS_STOP_PACKETS 5
+
+#define COALESCE_MAX_SAMPLES 4
+#define COALESCE_MAX_MS 20
+#define COALESCE_TICK_MS 5
+/* Ticks the meter waits for the timer to pass on its readings. */
+#define COALESCE_MAX_TICKS 200
+/* Readings the test meter sends to a session with statistics enabled. */
+#define STATS_READINGS 3
+
+struct feed_state {
+	struct sr_session *session;
+	GThread *thread;
+	unsigned int headers, ends, logic_packets, others;
+	uint64_t samples;
+	uint8_t next;
+	gboolean ordered;
+	gboolean wrong_thread;
+	unsigned int stopped;
+};
+
+static struct feed_state feed_state;
+
 /*
  * Check whether sr_session_new() works.
  * If it returns != SR_OK (or segfaults) this test will fail.
@@ -185,6 +213,736 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+/*
+ * Check whether datafeed statistics can be enabled, queried, and reset
+ * on a session which did not see any packets yet.
+ */
+START_TEST(test_session_stats)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_stats *stats;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	/* Statistics were never enabled, there is nothing to get. */
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_ERR_NA);
+	fail_unless(stats == NULL);
+
+	ret = sr_session_stats_enable(sess, TRUE);
+	fail_unless(ret == SR_OK, "sr_session_stats_enable() failed: %d.", ret);
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK, "sr_session_stats_get() failed: %d.", ret);
+	fail_unless(stats != NULL);
+	fail_unless(stats->devices == NULL);
+	fail_unless(stats->send.count == 0);
+	sr_session_stats_free(stats);
+
+	ret = sr_session_stats_reset(sess);
+	fail_unless(ret == SR_OK, "sr_session_stats_reset() failed: %d.", ret);
+	ret = sr_session_stats_enable(sess, FALSE);
+	fail_unless(ret == SR_OK, "sr_session_stats_enable() failed: %d.", ret);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check whether the statistics API rejects bogus parameters. */
+START_TEST(test_session_stats_bogus)
+{
+	int ret;
+	struct sr_session_stats *stats;
+
+	ret = sr_session_stats_enable(NULL, TRUE);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_stats_reset(NULL);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_session_stats_get(NULL, &stats);
+	fail_unless(ret == SR_ERR_ARG);
+
+	/* NULL snapshot, must not segfault. */
+	sr_session_stats_free(NULL);
+}
+END_TEST
+
+/* Check whether analog coalescing can be enabled and disabled. */
+START_TEST(test_session_analog_coalesce)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_datafeed_analog analog;
+	const int64_t *timestamps;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_analog_coalesce_set(sess, 64, 100);
+	fail_unless(ret == SR_OK, "sr_session_analog_coalesce_set() failed: %d.", ret);
+	ret = sr_session_analog_coalesce_set(sess, 16, 0);
+	fail_unless(ret == SR_OK, "sr_session_analog_coalesce_set() failed: %d.", ret);
+	ret = sr_session_analog_coalesce_set(sess, 0, 0);
+	fail_unless(ret == SR_OK, "sr_session_analog_coalesce_set() failed: %d.", ret);
+
+	/* Not within a datafeed callback, there are no timestamps. */
+	memset(&analog, 0, sizeof(analog));
+	ret = sr_analog_timestamps_get(&analog, &timestamps);
+	fail_unless(ret == SR_ERR_NA);
+	fail_unless(timestamps == NULL);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check whether the coalescing API rejects bogus parameters. */
+START_TEST(test_session_analog_coalesce_bogus)
+{
+	int ret;
+	struct sr_datafeed_analog analog;
+	const int64_t *timestamps;
+
+	ret = sr_session_analog_coalesce_set(NULL, 64, 100);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_timestamps_get(NULL, &timestamps);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_timestamps_get(&analog, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
+/* An analog packet which the coalescing passed on. */
+struct coalesce_batch {
+	const struct sr_channel *ch;
+	unsigned int num_samples;
+	float values[COALESCE_MAX_SAMPLES];
+	int64_t timestamps[COALESCE_MAX_SAMPLES];
+	/* Time when the packet reached the datafeed callback. */
+	int64_t delivered_us;
+	/* Whether the meter had sent more readings by then. */
+	unsigned int readings_sent;
+};
+
+static struct {
+	GArray *batches;
+	unsigned int readings_sent;
+	unsigned int ticks;
+	gboolean ended;
+	gboolean late;
+	int64_t start_us;
+} coalesce_state;
+
+/* The test meter's acquisition routine, called every tick. */
+static sr_receive_data_callback meter_tick;
+
+static int meter_dev_open(struct sr_dev_inst *sdi)
+{
+	(void)sdi;
+
+	return SR_OK;
+}
+
+static int meter_acquisition_start(const struct sr_dev_inst *sdi)
+{
+	std_session_send_df_header(sdi);
+
+	return sr_session_source_add(sdi->session, -1, 0, COALESCE_TICK_MS,
+		meter_tick, (void *)sdi);
+}
+
+static int meter_acquisition_stop(struct sr_dev_inst *sdi)
+{
+	sr_session_source_remove(sdi->session, -1);
+
+	return std_session_send_df_end(sdi);
+}
+
+static struct sr_dev_driver meter_driver = {
+	.name = "test-meter",
+	.longname = "Coalescing test meter",
+	.dev_open = meter_dev_open,
+	.dev_acquisition_start = meter_acquisition_start,
+	.dev_acquisition_stop = meter_acquisition_stop,
+};
+
+/* Send one reading, the way meter drivers do. */
+static void meter_send(const struct sr_dev_inst *sdi, int channel, float value)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	meaning.mq = SR_MQ_VOLTAGE;
+	meaning.unit = SR_UNIT_VOLT;
+	meaning.mqflags = SR_MQFLAG_DC;
+	meaning.channels = g_slist_append(NULL,
+		g_slist_nth_data(sdi->channels, channel));
+	analog.data = &value;
+	analog.num_samples = 1;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(meaning.channels);
+
+	coalesce_state.readings_sent++;
+}
+
+/*
+ * Send ten readings of A0 and three of A1 at once, then stop. A0's
+ * readings fill two packets, the rest gets passed on at the end.
+ */
+static int meter_tick_burst(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	int i;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	for (i = 0; i < 10; i++) {
+		meter_send(sdi, 0, i);
+		if (i < 3)
+			meter_send(sdi, 1, 100 + i);
+	}
+	sr_dev_acquisition_stop(sdi);
+
+	return TRUE;
+}
+
+/*
+ * Send three readings, wait until the session's timer has passed them
+ * on, then send two more and stop.
+ */
+static int meter_tick_pause(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	int i;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	if (!coalesce_state.ticks++) {
+		for (i = 0; i < 3; i++)
+			meter_send(sdi, 0, i);
+		return TRUE;
+	}
+	if (!coalesce_state.batches->len
+			&& coalesce_state.ticks < COALESCE_MAX_TICKS)
+		return TRUE;
+
+	for (i = 3; i < 5; i++)
+		meter_send(sdi, 0, i);
+	sr_dev_acquisition_stop(sdi);
+
+	return TRUE;
+}
+
+/* Send a few readings, then stop. */
+static int meter_tick_stats(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	int i;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	for (i = 0; i < STATS_READINGS; i++)
+		meter_send(sdi, 0, i);
+	sr_dev_acquisition_stop(sdi);
+
+	return TRUE;
+}
+
+static void coalesce_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_analog *analog;
+	const int64_t *timestamps;
+	struct coalesce_batch batch;
+	int ret;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (coalesce_state.ended)
+		coalesce_state.late = TRUE;
+	if (packet->type == SR_DF_END)
+		coalesce_state.ended = TRUE;
+	if (packet->type != SR_DF_ANALOG)
+		return;
+
+	analog = packet->payload;
+	fail_unless(analog->num_samples <= COALESCE_MAX_SAMPLES,
+		"Packet of %u samples.", analog->num_samples);
+	fail_unless(g_slist_length(analog->meaning->channels) == 1);
+	fail_unless(analog->meaning->mq == SR_MQ_VOLTAGE);
+	fail_unless(analog->meaning->unit == SR_UNIT_VOLT);
+	fail_unless(analog->meaning->mqflags == SR_MQFLAG_DC);
+
+	memset(&batch, 0, sizeof(batch));
+	batch.ch = analog->meaning->channels->data;
+	batch.num_samples = analog->num_samples;
+	ret = sr_analog_to_float(analog, batch.values);
+	fail_unless(ret == SR_OK);
+	ret = sr_analog_timestamps_get(analog, &timestamps);
+	fail_unless(ret == SR_OK, "No timestamps: %d.", ret);
+	memcpy(batch.timestamps, timestamps,
+		analog->num_samples * sizeof(*timestamps));
+	batch.delivered_us = g_get_real_time();
+	batch.readings_sent = coalesce_state.readings_sent;
+	g_array_append_val(coalesce_state.batches, batch);
+}
+
+static struct sr_dev_inst *meter_dev_new(void)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = g_malloc0(sizeof(*sdi));
+	sdi->driver = &meter_driver;
+	sdi->status = SR_ST_ACTIVE;
+	sr_channel_new(sdi, 0, SR_CHANNEL_ANALOG, TRUE, "A0");
+	sr_channel_new(sdi, 1, SR_CHANNEL_ANALOG, TRUE, "A1");
+
+	return sdi;
+}
+
+/* Run a session with the test meter, with coalescing enabled. */
+static void coalesce_run(struct sr_dev_inst *sdi, unsigned int max_ms,
+		sr_receive_data_callback tick)
+{
+	struct sr_session *sess;
+	int ret;
+
+	memset(&coalesce_state, 0, sizeof(coalesce_state));
+	coalesce_state.batches = g_array_new(FALSE, FALSE,
+		sizeof(struct coalesce_batch));
+	coalesce_state.start_us = g_get_real_time();
+	meter_tick = tick;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_dev_add(sess, sdi);
+	fail_unless(ret == SR_OK);
+	sr_session_datafeed_callback_add(sess, coalesce_datafeed, NULL);
+	ret = sr_session_analog_coalesce_set(sess, COALESCE_MAX_SAMPLES, max_ms);
+	fail_unless(ret == SR_OK);
+
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+	fail_unless(coalesce_state.ended, "No end of acquisition.");
+	fail_unless(!coalesce_state.late, "Packets after the end.");
+
+	sr_session_destroy(sess);
+}
+
+/* Check a passed on packet's channel, values and timestamps. */
+static void coalesce_check(unsigned int idx, const struct sr_channel *ch,
+		unsigned int num_samples, float first)
+{
+	const struct coalesce_batch *batch;
+	unsigned int i;
+
+	fail_unless(idx < coalesce_state.batches->len,
+		"Only %u packets.", coalesce_state.batches->len);
+	batch = &g_array_index(coalesce_state.batches,
+		struct coalesce_batch, idx);
+	fail_unless(batch->ch == ch, "Packet %u for channel %s.",
+		idx, batch->ch->name);
+	fail_unless(batch->num_samples == num_samples,
+		"Packet %u has %u samples, expected %u.",
+		idx, batch->num_samples, num_samples);
+	for (i = 0; i < num_samples; i++) {
+		fail_unless(batch->values[i] == first + i,
+			"Packet %u sample %u is %f.", idx, i, batch->values[i]);
+		fail_unless(batch->timestamps[i] >= coalesce_state.start_us);
+		fail_unless(batch->timestamps[i] <= batch->delivered_us);
+		if (i)
+			fail_unless(batch->timestamps[i] >= batch->timestamps[i - 1]);
+	}
+}
+
+/*
+ * Check that full packets get passed on as soon as they are complete,
+ * and the rest of each channel at the end of the acquisition.
+ */
+START_TEST(test_session_analog_coalesce_batches)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_channel *a0, *a1;
+	const struct coalesce_batch *batch;
+
+	sdi = meter_dev_new();
+	a0 = g_slist_nth_data(sdi->channels, 0);
+	a1 = g_slist_nth_data(sdi->channels, 1);
+	coalesce_run(sdi, 0, meter_tick_burst);
+
+	fail_unless(coalesce_state.batches->len == 4,
+		"Got %u packets.", coalesce_state.batches->len);
+	coalesce_check(0, a0, 4, 0);
+	coalesce_check(1, a0, 4, 4);
+	coalesce_check(2, a0, 2, 8);
+	coalesce_check(3, a1, 3, 100);
+
+	/* A0's full packets went out while the meter was still sending. */
+	batch = &g_array_index(coalesce_state.batches, struct coalesce_batch, 0);
+	fail_unless(batch->readings_sent == 6);
+	batch = &g_array_index(coalesce_state.batches, struct coalesce_batch, 1);
+	fail_unless(batch->readings_sent == 10);
+	batch = &g_array_index(coalesce_state.batches, struct coalesce_batch, 3);
+	fail_unless(batch->readings_sent == 13);
+
+	g_array_free(coalesce_state.batches, TRUE);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/*
+ * Check that readings get passed on once they are due, although no
+ * more readings arrive, and the packet isn't full.
+ */
+START_TEST(test_session_analog_coalesce_timeout)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_channel *a0;
+	const struct coalesce_batch *batch;
+
+	sdi = meter_dev_new();
+	a0 = g_slist_nth_data(sdi->channels, 0);
+	coalesce_run(sdi, COALESCE_MAX_MS, meter_tick_pause);
+
+	fail_unless(coalesce_state.batches->len == 2,
+		"Got %u packets.", coalesce_state.batches->len);
+	coalesce_check(0, a0, 3, 0);
+	coalesce_check(1, a0, 2, 3);
+
+	batch = &g_array_index(coalesce_state.batches, struct coalesce_batch, 0);
+	fail_unless(batch->readings_sent == 3,
+		"The timer did not pass on the readings.");
+	fail_unless(batch->delivered_us - batch->timestamps[0]
+		>= COALESCE_MAX_MS * 1000, "Readings passed on too early.");
+
+	g_array_free(coalesce_state.batches, TRUE);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+static unsigned int stats_packets;
+
+static void stats_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+	(void)cb_data;
+
+	stats_packets++;
+}
+
+static void stats_check_histogram(const struct sr_latency_histogram *hist,
+		uint64_t count)
+{
+	uint64_t sum;
+	size_t i;
+
+	fail_unless(hist->count == count, "Histogram has %" PRIu64
+		" entries, expected %" PRIu64 ".", hist->count, count);
+	sum = 0;
+	for (i = 0; i < SR_LATENCY_HIST_BUCKETS; i++)
+		sum += hist->buckets[i];
+	fail_unless(sum == count, "Buckets hold %" PRIu64 " entries.", sum);
+	fail_unless(hist->max_us <= hist->total_us);
+}
+
+/*
+ * Check that packets which pass through a transform to a datafeed
+ * callback get counted per device, and that each stage's latency and
+ * the timer's dispatch lag get accounted.
+ */
+START_TEST(test_session_stats_packets)
+{
+	struct sr_session *sess;
+	struct sr_dev_inst *sdi;
+	const struct sr_transform *t;
+	struct sr_session_stats *stats;
+	const struct sr_session_dev_stats *dev;
+	const struct sr_session_stage_stats *stage;
+	int ret;
+
+	memset(&coalesce_state, 0, sizeof(coalesce_state));
+	stats_packets = 0;
+	meter_tick = meter_tick_stats;
+	sdi = meter_dev_new();
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_dev_add(sess, sdi);
+	fail_unless(ret == SR_OK);
+	t = sr_transform_new(sr_transform_find("nop"), NULL, sdi);
+	fail_unless(t != NULL);
+	sr_session_datafeed_callback_add(sess, stats_datafeed, NULL);
+	ret = sr_session_stats_enable(sess, TRUE);
+	fail_unless(ret == SR_OK);
+
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	/* Header, readings, end. */
+	fail_unless(stats_packets == STATS_READINGS + 2,
+		"Callback got %u packets.", stats_packets);
+
+	fail_unless(g_slist_length(stats->devices) == 1);
+	dev = stats->devices->data;
+	fail_unless(dev->sdi == sdi);
+	fail_unless(dev->packets[SR_DF_HEADER - SR_DF_HEADER] == 1);
+	fail_unless(dev->packets[SR_DF_END - SR_DF_HEADER] == 1);
+	fail_unless(dev->packets[SR_DF_ANALOG - SR_DF_HEADER] == STATS_READINGS);
+	fail_unless(dev->packets[SR_DF_LOGIC - SR_DF_HEADER] == 0);
+	fail_unless(dev->bytes[SR_DF_ANALOG - SR_DF_HEADER]
+		== STATS_READINGS * sizeof(float));
+	fail_unless(dev->analog_samples == STATS_READINGS);
+	fail_unless(dev->logic_samples == 0);
+
+	fail_unless(g_slist_length(stats->transforms) == 1);
+	stage = stats->transforms->data;
+	fail_unless(!strcmp(stage->name, "nop"));
+	stats_check_histogram(&stage->latency, stats_packets);
+	fail_unless(g_slist_length(stats->callbacks) == 1);
+	stage = stats->callbacks->data;
+	fail_unless(stage->name == NULL);
+	stats_check_histogram(&stage->latency, stats_packets);
+	stats_check_histogram(&stats->send, stats_packets);
+
+	/* The meter's timer got dispatched at least once. */
+	fail_unless(stats->fd_lag.count >= 1);
+	stats_check_histogram(&stats->fd_lag, stats->fd_lag.count);
+	fail_unless(stats->usb_lag.count == 0);
+	sr_session_stats_free(stats);
+
+	/* Resetting keeps the stages, with zero counts. */
+	ret = sr_session_stats_reset(sess);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_stats_get(sess, &stats);
+	fail_unless(ret == SR_OK);
+	fail_unless(stats->devices == NULL);
+	fail_unless(g_slist_length(stats->transforms) == 1);
+	stage = stats->transforms->data;
+	stats_check_histogram(&stage->latency, 0);
+	stats_check_histogram(&stats->send, 0);
+	stats_check_histogram(&stats->fd_lag, 0);
+	sr_session_stats_free(stats);
+
+	sr_session_destroy(sess);
+	sr_transform_free(t);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
+/* Get an open demo device with 8 logic channels running "incremental". */
+static struct sr_dev_inst *demo_dev_open(void)
+{
+	struct sr_dev_driver *driver;
+	struct sr_config nl, na;
+	struct sr_channel_group *cg;
+	struct sr_dev_inst *sdi;
+	GSList *options, *devices;
+	int ret;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+
+	nl.key = SR_CONF_NUM_LOGIC_CHANNELS;
+	nl.data = g_variant_new_int32(8);
+	na.key = SR_CONF_NUM_ANALOG_CHANNELS;
+	na.data = g_variant_new_int32(0);
+	options = g_slist_append(NULL, &nl);
+	options = g_slist_append(options, &na);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(g_variant_ref_sink(nl.data));
+	g_variant_unref(g_variant_ref_sink(na.data));
+	fail_unless(g_slist_length(devices) == 1, "No demo device found.");
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	ret = sr_dev_open(sdi);
+	fail_unless(ret == SR_OK, "sr_dev_open() failed: %d.", ret);
+	ret = sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(THREADS_SAMPLERATE));
+	fail_unless(ret == SR_OK);
+	cg = sr_dev_inst_channel_groups_get(sdi)->data;
+	ret = sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+		g_variant_new_string("incremental"));
+	fail_unless(ret == SR_OK);
+
+	return sdi;
+}
+
+/*
+ * Record the packets of a threaded session. The demo device's
+ * "incremental" pattern has every sample one above the previous one,
+ * so a packet which got lost or reordered breaks the sequence.
+ */
+static void threads_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *data;
+	uint64_t i;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (g_thread_self() != feed_state.thread)
+		feed_state.wrong_thread = TRUE;
+	if (feed_state.ends)
+		feed_state.ordered = FALSE;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		if (feed_state.headers++ || feed_state.samples)
+			feed_state.ordered = FALSE;
+		break;
+	case SR_DF_END:
+		feed_state.ends++;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!feed_state.headers || logic->unitsize != 1)
+			feed_state.ordered = FALSE;
+		data = logic->data;
+		for (i = 0; i < logic->length; i++) {
+			if (feed_state.samples + i && data[i] != feed_state.next)
+				feed_state.ordered = FALSE;
+			feed_state.next = data[i] + 1;
+		}
+		feed_state.samples += logic->length;
+		if (++feed_state.logic_packets == THREADS_STOP_PACKETS
+				&& feed_state.session)
+			sr_session_stop(feed_state.session);
+		break;
+	default:
+		feed_state.others++;
+		break;
+	}
+}
+
+static void threads_stopped(void *cb_data)
+{
+	(void)cb_data;
+
+	if (g_thread_self() != feed_state.thread)
+		feed_state.wrong_thread = TRUE;
+	feed_state.stopped++;
+}
+
+static struct sr_session *threads_session_new(struct sr_dev_inst *sdi)
+{
+	struct sr_session *sess;
+	int ret;
+
+	memset(&feed_state, 0, sizeof(feed_state));
+	feed_state.thread = g_thread_self();
+	feed_state.ordered = TRUE;
+
+	sr_session_new(srtest_ctx, &sess);
+	ret = sr_session_dev_add(sess, sdi);
+	fail_unless(ret == SR_OK);
+	sr_session_datafeed_callback_add(sess, threads_datafeed, NULL);
+	sr_session_stopped_callback_set(sess, threads_stopped, NULL);
+	ret = sr_session_dev_threads_set(sess, TRUE);
+	fail_unless(ret == SR_OK);
+
+	return sess;
+}
+
+/* Check how a threaded session with the demo driver ended. */
+static void threads_check(struct sr_session *sess)
+{
+	fail_unless(!feed_state.wrong_thread,
+		"Callback ran outside the session thread.");
+	fail_unless(feed_state.ordered, "Packets out of order near sample "
+		"%" PRIu64 ".", feed_state.samples);
+	fail_unless(feed_state.headers == 1);
+	fail_unless(feed_state.ends == 1, "Got %u ends.", feed_state.ends);
+	fail_unless(feed_state.stopped == 1);
+	fail_unless(feed_state.logic_packets > 0);
+	fail_unless(!sr_session_is_running(sess));
+	fail_unless(sess->threads == NULL, "Device threads were not joined.");
+}
+
+/*
+ * Check that with device threads, packets reach the datafeed callback
+ * in the session's thread and in order, and that the acquisition ends
+ * when the device reaches its sample limit.
+ */
+START_TEST(test_session_dev_threads)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_session *sess;
+	int ret;
+
+	sdi = demo_dev_open();
+	ret = sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(THREADS_SAMPLES));
+	fail_unless(ret == SR_OK);
+	sess = threads_session_new(sdi);
+
+	ret = sr_session_start(sess);
+	fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+	ret = sr_session_run(sess);
+	fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+
+	threads_check(sess);
+	fail_unless(feed_state.samples == THREADS_SAMPLES,
+		"Got %" PRIu64 " samples.", feed_state.samples);
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/*
+ * Check that stopping a continuous acquisition from the datafeed
+ * callback terminates the device thread, and that the session can be
+ * run again afterwards.
+ */
+START_TEST(test_session_dev_threads_stop)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_session *sess;
+	int ret, run;
+
+	sdi = demo_dev_open();
+	sess = threads_session_new(sdi);
+
+	for (run = 0; run < 2; run++) {
+		memset(&feed_state, 0, sizeof(feed_state));
+		feed_state.session = sess;
+		feed_state.thread = g_thread_self();
+		feed_state.ordered = TRUE;
+
+		ret = sr_session_start(sess);
+		fail_unless(ret == SR_OK, "sr_session_start() failed: %d.", ret);
+		ret = sr_session_run(sess);
+		fail_unless(ret == SR_OK, "sr_session_run() failed: %d.", ret);
+
+		threads_check(sess);
+		fail_unless(feed_state.logic_packets >= THREADS_STOP_PACKETS);
+	}
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +967,26 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("stats");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_stats);
+	tcase_add_test(tc, test_session_stats_bogus);
+	tcase_add_test(tc, test_session_stats_packets);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("analog_coalesce");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_analog_coalesce);
+	tcase_add_test(tc, test_session_analog_coalesce_bogus);
+	tcase_add_test(tc, test_session_analog_coalesce_batches);
+	tcase_add_test(tc, test_session_analog_coalesce_timeout);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("dev_threads");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_dev_threads);
+	tcase_add_test(tc, test_session_dev_threads_stop);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -21,6 +21,8 @@
 #include <check.h>
 #include <errno.h>
 #include <locale.h>
+#include <stdlib.h>
+#include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
 
@@ -608,6 +610,57 @@ START_TEST(test_calc_power_of_two)
 }
 END_TEST
 
+struct float_case_t {
+	float value;
+	const char *want;
+};
+
+static const struct float_case_t float_cases[] = {
+	{ 0.0f, "0", },
+	{ -1.0f, "-1", },
+	{ 0.1f, "0.1", },
+	{ 2.5f, "2.5", },
+	{ 3.14159265f, "3.1415927", },
+	{ 1234567.0f, "1234567", },
+	{ 123456789.0f, "123456790", },
+	{ 1e9f, "1e+09", },
+	{ 0.0001f, "0.0001", },
+	{ 1e-5f, "1e-05", },
+	{ -7.2e-12f, "-7.2e-12", },
+	{ 3.4028235e38f, "3.4028235e+38", },
+	{ 1.4e-45f, "1e-45", },
+};
+
+START_TEST(test_float_to_string)
+{
+	size_t case_idx;
+	const struct float_case_t *tcase;
+	char buf[SR_FLOAT_STRING_SIZE];
+	uint32_t bits;
+	float value;
+	int ret;
+
+	for (case_idx = 0; case_idx < ARRAY_SIZE(float_cases); case_idx++) {
+		tcase = &float_cases[case_idx];
+		ret = sr_float_to_string(tcase->value, buf, sizeof(buf));
+		fail_unless(ret == (int)strlen(tcase->want),
+			"Wrong length for %s.", tcase->want);
+		fail_unless(!strcmp(buf, tcase->want),
+			"Expected '%s', got '%s'.", tcase->want, buf);
+	}
+
+	/* Text for a spread of finite values must read back exactly. */
+	for (bits = 1; bits < 0x7f800000; bits += 0x1003) {
+		memcpy(&value, &bits, sizeof(value));
+		ret = sr_float_to_string(value, buf, sizeof(buf));
+		fail_unless(ret > 0 && ret < SR_FLOAT_STRING_SIZE,
+			"Bad length for %a.", value);
+		fail_unless(strtof(buf, NULL) == value,
+			"'%s' does not read back as %a.", buf, value);
+	}
+}
+END_TEST
+
 Suite *suite_strutil(void)
 {
 	Suite *s;
@@ -639,5 +692,9 @@ Suite *suite_strutil(void)
 	tcase_add_test(tc, test_calc_power_of_two);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("float");
+	tcase_add_test(tc, test_float_to_string);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
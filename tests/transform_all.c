@@ -18,9 +18,12 @@
  */
 
 #include <config.h>
+#include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
 #include "lib.h"
 
 /* Check whether at least one transform module is available. */
@@ -96,6 +99,587 @@ START_TEST(test_transform_options)
 }
 END_TEST
 
+/* Check whether the 'decimate' module lists its options. */
+START_TEST(test_transform_decimate_options)
+{
+	const struct sr_option **opt;
+
+	opt = sr_transform_options_get(sr_transform_find("decimate"));
+	fail_unless(opt != NULL, "Transform module 'decimate' has no options.");
+	fail_unless(!strcmp(opt[0]->id, "factor"), "Unexpected first option.");
+	fail_unless(opt[0]->def != NULL, "No default for 'factor'.");
+	sr_transform_options_free(opt);
+}
+END_TEST
+
+/* Transforms work on the channels of a device in a session. */
+static struct sr_session *test_session;
+static struct sr_dev_inst *test_sdi;
+
+static void transform_setup(void)
+{
+	int ret;
+
+	srtest_setup();
+	ret = sr_session_new(srtest_ctx, &test_session);
+	fail_unless(ret == SR_OK, "sr_session_new() failed: %d.", ret);
+	test_sdi = NULL;
+}
+
+static void transform_teardown(void)
+{
+	sr_session_destroy(test_session);
+	sr_dev_inst_free(test_sdi);
+	srtest_teardown();
+}
+
+/*
+ * Provide a virtual device with logic channels D0, D1, ..., followed by
+ * analog channels A0, A1, ..., indices are counted up across both.
+ */
+static void test_device_new(int num_logic, int num_analog)
+{
+	char name[8];
+	int i, ret;
+
+	test_sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < num_logic; i++) {
+		g_snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(test_sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	for (i = 0; i < num_analog; i++) {
+		g_snprintf(name, sizeof(name), "A%d", i);
+		sr_dev_inst_channel_add(test_sdi, num_logic + i,
+			SR_CHANNEL_ANALOG, name);
+	}
+	ret = sr_session_dev_add(test_session, test_sdi);
+	fail_unless(ret == SR_OK, "sr_session_dev_add() failed: %d.", ret);
+}
+
+static struct sr_channel *test_channel(const char *name)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = test_sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!strcmp(ch->name, name))
+			return ch;
+	}
+	fail_unless(FALSE, "No channel '%s'.", name);
+
+	return NULL;
+}
+
+/* Create a transform, options are NULL terminated (id, GVariant) pairs. */
+static const struct sr_transform *test_transform_new(const char *id, ...)
+{
+	const struct sr_transform *t;
+	GHashTable *options;
+	const char *key;
+	va_list args;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	va_start(args, id);
+	while ((key = va_arg(args, const char *)))
+		g_hash_table_insert(options, (void *)key,
+			g_variant_ref_sink(va_arg(args, GVariant *)));
+	va_end(args);
+
+	t = sr_transform_new(sr_transform_find(id), options, test_sdi);
+	g_hash_table_destroy(options);
+	fail_unless(t != NULL, "Cannot create '%s' transform.", id);
+
+	return t;
+}
+
+static struct sr_datafeed_packet *test_feed(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet *out;
+	int ret;
+
+	out = NULL;
+	ret = t->module->receive(t, packet, &out);
+	fail_unless(ret == SR_OK, "Transform failed: %d.", ret);
+
+	return out;
+}
+
+static struct sr_datafeed_packet *test_feed_logic(const struct sr_transform *t,
+		const uint8_t *data, size_t count, size_t unitsize)
+{
+	static struct sr_datafeed_packet packet;
+	static struct sr_datafeed_logic logic;
+
+	logic.length = count * unitsize;
+	logic.unitsize = unitsize;
+	logic.data = (void *)data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	return test_feed(t, &packet);
+}
+
+/* Feed single channel float samples. */
+static struct sr_datafeed_packet *test_feed_analog(const struct sr_transform *t,
+		struct sr_channel *ch, const float *data, size_t count)
+{
+	static struct sr_datafeed_packet packet;
+	static struct sr_datafeed_analog analog;
+	static struct sr_analog_encoding encoding;
+	static struct sr_analog_meaning meaning;
+	static struct sr_analog_spec spec;
+
+	/* The previous packet's channel list is no longer referenced. */
+	g_slist_free(meaning.channels);
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	meaning.channels = g_slist_append(NULL, ch);
+	meaning.mq = SR_MQ_VOLTAGE;
+	meaning.unit = SR_UNIT_VOLT;
+	analog.num_samples = count;
+	analog.data = (void *)data;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+
+	return test_feed(t, &packet);
+}
+
+static void test_check_logic(const struct sr_datafeed_packet *out,
+		const uint8_t *expected, size_t count, size_t unitsize)
+{
+	const struct sr_datafeed_logic *logic;
+
+	if (!count) {
+		fail_unless(out == NULL, "Unexpected output packet.");
+		return;
+	}
+	fail_unless(out != NULL, "Missing output packet.");
+	fail_unless(out->type == SR_DF_LOGIC, "Not a logic packet.");
+	logic = out->payload;
+	fail_unless(logic->unitsize == unitsize, "Unit size %u, expected %zu.",
+		logic->unitsize, unitsize);
+	fail_unless(logic->length == count * unitsize,
+		"Got %" PRIu64 " bytes, expected %zu.", logic->length,
+		count * unitsize);
+	fail_unless(!memcmp(logic->data, expected, count * unitsize),
+		"Unexpected logic data.");
+}
+
+static void test_check_analog(const struct sr_datafeed_packet *out,
+		const float *expected, size_t count)
+{
+	const struct sr_datafeed_analog *analog;
+	float *values;
+	size_t i;
+
+	if (!count) {
+		fail_unless(out == NULL, "Unexpected output packet.");
+		return;
+	}
+	fail_unless(out != NULL, "Missing output packet.");
+	fail_unless(out->type == SR_DF_ANALOG, "Not an analog packet.");
+	analog = out->payload;
+	fail_unless(analog->num_samples == count, "Got %u samples, expected %zu.",
+		analog->num_samples, count);
+	values = g_malloc(count * sizeof(*values));
+	fail_unless(sr_analog_to_float(analog, values) == SR_OK);
+	for (i = 0; i < count; i++)
+		fail_unless(values[i] == expected[i], "Sample %zu is %f, not %f.",
+			i, values[i], expected[i]);
+	g_free(values);
+}
+
+/*
+ * Check logic decimation by 4, in both modes. Packets of 3, 4 and 3
+ * samples make intervals span packets. The trailing partial interval
+ * gets dropped.
+ */
+START_TEST(test_transform_decimate_logic)
+{
+	static const uint8_t data[] = {
+		0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+	};
+	static const uint8_t glitch[] = {
+		0x00, 0x00, 0x80, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+	};
+	const struct sr_transform *t;
+	uint8_t expected;
+
+	test_device_new(8, 0);
+	t = test_transform_new("decimate",
+		"factor", g_variant_new_uint64(4),
+		"logic", g_variant_new_string("sample"), NULL);
+	test_check_logic(test_feed_logic(t, &data[0], 3, 1), NULL, 0, 1);
+	expected = 0x01;
+	test_check_logic(test_feed_logic(t, &data[3], 4, 1), &expected, 1, 1);
+	expected = 0x05;
+	test_check_logic(test_feed_logic(t, &data[7], 3, 1), &expected, 1, 1);
+	sr_transform_free(t);
+
+	/*
+	 * The pulse on D7 in the first interval shows up, even though it
+	 * ends in the next packet. D0 follows the input.
+	 */
+	t = test_transform_new("decimate",
+		"factor", g_variant_new_uint64(4),
+		"logic", g_variant_new_string("transitions"), NULL);
+	test_check_logic(test_feed_logic(t, &glitch[0], 3, 1), NULL, 0, 1);
+	expected = 0x80;
+	test_check_logic(test_feed_logic(t, &glitch[3], 4, 1), &expected, 1, 1);
+	expected = 0x01;
+	test_check_logic(test_feed_logic(t, &glitch[7], 3, 1), &expected, 1, 1);
+	sr_transform_free(t);
+}
+END_TEST
+
+/* Check analog decimation by 4, in mean and min/max envelope mode. */
+START_TEST(test_transform_decimate_analog)
+{
+	static const float ramp[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+	static const float peaks[] = { 0, 5, -3, 1, 0, 0, 0, 0, 2, -1, 0 };
+	const struct sr_transform *t;
+	struct sr_channel *ch;
+	float expected[2];
+
+	test_device_new(0, 1);
+	ch = test_channel("A0");
+
+	t = test_transform_new("decimate",
+		"factor", g_variant_new_uint64(4), NULL);
+	test_check_analog(test_feed_analog(t, ch, &ramp[0], 3), NULL, 0);
+	expected[0] = 2.5;
+	test_check_analog(test_feed_analog(t, ch, &ramp[3], 4), expected, 1);
+	expected[0] = 6.5;
+	test_check_analog(test_feed_analog(t, ch, &ramp[7], 3), expected, 1);
+	sr_transform_free(t);
+
+	/*
+	 * Intervals span two output samples, so eight input samples.
+	 * The maximum precedes the minimum in the first interval.
+	 */
+	t = test_transform_new("decimate",
+		"factor", g_variant_new_uint64(4),
+		"analog", g_variant_new_string("minmax"), NULL);
+	test_check_analog(test_feed_analog(t, ch, &peaks[0], 5), NULL, 0);
+	expected[0] = 5;
+	expected[1] = -3;
+	test_check_analog(test_feed_analog(t, ch, &peaks[5], 6), expected, 2);
+	sr_transform_free(t);
+}
+END_TEST
+
+static uint8_t threshold_sample(const float *a0, const float *a1, size_t i)
+{
+	/* A0_L and A1_L follow A0 and A1, at indices 2 and 3. */
+	return (a0[i] >= 1.5) << 2 | (a1[i] >= 1.5) << 3;
+}
+
+/*
+ * Check that analog channels get converted to logic channels, with
+ * samples sent as soon as both channels have data for them, no matter
+ * how the channels' packets are interleaved.
+ */
+START_TEST(test_transform_threshold)
+{
+	float a0[20], a1[20];
+	uint8_t expected[20];
+	const struct sr_transform *t;
+	struct sr_channel *ch;
+	size_t i;
+
+	test_device_new(0, 2);
+	for (i = 0; i < 20; i++) {
+		a0[i] = i % 3 ? 0.0 : 3.0;
+		a1[i] = i & 4 ? 3.0 : 0.0;
+		expected[i] = threshold_sample(a0, a1, i);
+	}
+
+	t = test_transform_new("threshold", NULL);
+	ch = test_channel("A0_L");
+	fail_unless(ch->type == SR_CHANNEL_LOGIC && ch->index == 2,
+		"Unexpected logic channel for A0.");
+	ch = test_channel("A1_L");
+	fail_unless(ch->type == SR_CHANNEL_LOGIC && ch->index == 3,
+		"Unexpected logic channel for A1.");
+
+	/* Pending states get appended and consumed at odd bit offsets. */
+	test_check_logic(test_feed_analog(t, test_channel("A0"), &a0[0], 13),
+		NULL, 0, 1);
+	test_check_logic(test_feed_analog(t, test_channel("A1"), &a1[0], 7),
+		&expected[0], 7, 1);
+	test_check_logic(test_feed_analog(t, test_channel("A1"), &a1[7], 13),
+		&expected[7], 6, 1);
+	test_check_logic(test_feed_analog(t, test_channel("A0"), &a0[13], 7),
+		&expected[13], 7, 1);
+
+	sr_transform_free(t);
+	fail_unless(g_slist_length(test_sdi->channels) == 2,
+		"Logic channels were not removed.");
+}
+END_TEST
+
+/*
+ * Check that a device's own logic channels get merged with converted
+ * channels. D0 to D8 are followed by A0 and A1, A0_L and A1_L at indices
+ * 11 and 12 take the upper bits of 16 bit samples. Bits of the device's
+ * samples which are not its logic channels' get dropped.
+ */
+START_TEST(test_transform_threshold_mixed)
+{
+	float a0[20], a1[20];
+	uint8_t data[40], expected[40];
+	const struct sr_transform *t;
+	struct sr_channel *ch;
+	unsigned int sample;
+	size_t i;
+
+	test_device_new(9, 2);
+	for (i = 0; i < 20; i++) {
+		a0[i] = i % 3 ? 0.0 : 3.0;
+		a1[i] = i & 4 ? 3.0 : 0.0;
+		data[2 * i] = i * 37 + 5;
+		data[2 * i + 1] = 0xfe | (i & 1);
+		sample = (data[2 * i] | data[2 * i + 1] << 8) & 0x1ff;
+		sample |= (a0[i] >= 1.5) << 11 | (a1[i] >= 1.5) << 12;
+		expected[2 * i] = sample & 0xff;
+		expected[2 * i + 1] = sample >> 8;
+	}
+
+	t = test_transform_new("threshold", NULL);
+	ch = test_channel("A0_L");
+	fail_unless(ch->type == SR_CHANNEL_LOGIC && ch->index == 11,
+		"Unexpected logic channel for A0.");
+	ch = test_channel("A1_L");
+	fail_unless(ch->type == SR_CHANNEL_LOGIC && ch->index == 12,
+		"Unexpected logic channel for A1.");
+
+	/* Samples get sent when the device's and both channels' are in. */
+	test_check_logic(test_feed_logic(t, &data[0], 5, 2), NULL, 0, 2);
+	test_check_logic(test_feed_analog(t, test_channel("A0"), &a0[0], 13),
+		NULL, 0, 2);
+	test_check_logic(test_feed_analog(t, test_channel("A1"), &a1[0], 7),
+		&expected[0], 5, 2);
+	test_check_logic(test_feed_logic(t, &data[10], 15, 2),
+		&expected[10], 2, 2);
+	test_check_logic(test_feed_analog(t, test_channel("A1"), &a1[7], 13),
+		&expected[14], 6, 2);
+	test_check_logic(test_feed_analog(t, test_channel("A0"), &a0[13], 7),
+		&expected[26], 7, 2);
+
+	sr_transform_free(t);
+	fail_unless(g_slist_length(test_sdi->channels) == 11,
+		"Logic channels were not removed.");
+}
+END_TEST
+
+/* Check that Schmitt trigger states don't leak into the next acquisition. */
+START_TEST(test_transform_threshold_schmitt)
+{
+	static const float high[] = { 3.0 };
+	static const float band[] = { 1.5 };
+	struct sr_datafeed_packet end;
+	const struct sr_transform *t;
+	struct sr_channel *ch;
+	uint8_t expected;
+
+	test_device_new(0, 2);
+	t = test_transform_new("threshold",
+		"channels", g_variant_new_string("A0"),
+		"hysteresis", g_variant_new_double(1.0), NULL);
+	ch = test_channel("A0");
+
+	expected = 1 << 2;
+	test_check_logic(test_feed_analog(t, ch, high, 1), &expected, 1, 1);
+	test_check_logic(test_feed_analog(t, ch, band, 1), &expected, 1, 1);
+
+	end.type = SR_DF_END;
+	end.payload = NULL;
+	fail_unless(test_feed(t, &end) == &end);
+
+	expected = 0;
+	test_check_logic(test_feed_analog(t, ch, band, 1), &expected, 1, 1);
+	sr_transform_free(t);
+}
+END_TEST
+
+static void test_feed_header(const struct sr_transform *t)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+
+	memset(&header, 0, sizeof(header));
+	header.feed_version = 1;
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	fail_unless(test_feed(t, &packet) == &packet);
+}
+
+/*
+ * Check that selected channels get compacted into consecutive bits in
+ * the order of their indices, into a smaller unit size, and that the
+ * device's channels are left alone.
+ */
+START_TEST(test_transform_repack_select)
+{
+	static const uint8_t data[] = {
+		0x0a, 0x02, /* D1, D3, D9 */
+		0x08, 0x00, /* D3 */
+		0xf5, 0xfd, /* all others */
+		0x02, 0x02, /* D1, D9 */
+	};
+	static const uint8_t expected[] = { 0x07, 0x02, 0x00, 0x05 };
+	const struct sr_transform *t;
+	struct sr_channel *ch;
+	GSList *l;
+	int index;
+
+	test_device_new(16, 0);
+	t = test_transform_new("repack",
+		"channels", g_variant_new_string("D9, D1,D3"), NULL);
+	test_feed_header(t);
+	test_check_logic(test_feed_logic(t, data, 4, 2), expected, 4, 1);
+
+	index = 0;
+	for (l = test_sdi->channels; l; l = l->next, index++) {
+		ch = l->data;
+		fail_unless(ch->index == index && ch->enabled,
+			"Channel %s was modified.", ch->name);
+	}
+	sr_transform_free(t);
+}
+END_TEST
+
+/* Check that disabled channels are not kept, with the default selection. */
+START_TEST(test_transform_repack_enabled)
+{
+	static const uint8_t data[] = { 0xff, 0xff, 0x01, 0x80, 0x10, 0x01 };
+	static const uint8_t expected[] = { 0x07, 0x04, 0x03 };
+	const struct sr_transform *t;
+	struct sr_channel *ch;
+	GSList *l;
+
+	/* Leave D4, D8 and D15 enabled. */
+	test_device_new(16, 0);
+	for (l = test_sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->index != 4 && ch->index != 8 && ch->index != 15)
+			sr_dev_channel_enable(ch, FALSE);
+	}
+
+	t = test_transform_new("repack", NULL);
+	test_feed_header(t);
+	test_check_logic(test_feed_logic(t, data, 3, 2), expected, 3, 1);
+	sr_transform_free(t);
+}
+END_TEST
+
+/*
+ * Check that data passes unmodified when no channel moves, and that
+ * deselected channels' bits get masked when they would pass otherwise.
+ */
+START_TEST(test_transform_repack_passthrough)
+{
+	static const uint8_t data[] = { 0xff, 0x5a };
+	static const uint8_t expected[] = { 0x03, 0x02 };
+	struct sr_datafeed_packet *out;
+	const struct sr_transform *t;
+
+	test_device_new(8, 0);
+	t = test_transform_new("repack", NULL);
+	test_feed_header(t);
+	out = test_feed_logic(t, data, 2, 1);
+	fail_unless(out && ((struct sr_datafeed_logic *)out->payload)->data
+		== (void *)data, "Data was not passed through.");
+	sr_transform_free(t);
+
+	t = test_transform_new("repack",
+		"channels", g_variant_new_string("D0,D1"), NULL);
+	test_feed_header(t);
+	test_check_logic(test_feed_logic(t, data, 2, 1), expected, 2, 1);
+	sr_transform_free(t);
+}
+END_TEST
+
+static void test_output_send(const struct sr_output *o, GString *text,
+		const struct sr_datafeed_packet *packet)
+{
+	GString *out;
+	int ret;
+
+	if (!packet)
+		return;
+	out = NULL;
+	ret = sr_output_send(o, packet, &out);
+	fail_unless(ret == SR_OK, "Output failed: %d.", ret);
+	if (out) {
+		g_string_append_len(text, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+}
+
+/*
+ * Check that output modules find the channels' data at their compacted
+ * positions, and leave out deselected channels.
+ */
+START_TEST(test_transform_repack_output)
+{
+	static const uint8_t expected[] = { 0, 1, 2, 3, 0, 1, 2, 3 };
+	struct sr_datafeed_packet packet, *out;
+	struct sr_datafeed_header header;
+	const struct sr_transform *t;
+	const struct sr_output *o;
+	GHashTable *options;
+	GString *text;
+	uint8_t data[8];
+	size_t i;
+
+	/* D0 is always high, D2 and D5 count up. */
+	for (i = 0; i < ARRAY_SIZE(data); i++)
+		data[i] = 0x01 | (i & 1) << 2 | ((i >> 1) & 1) << 5;
+
+	test_device_new(8, 0);
+	t = test_transform_new("repack",
+		"channels", g_variant_new_string("D5,D2"), NULL);
+	fail_unless(sr_transform_logic_bit(test_sdi, test_channel("D2")) == 0);
+	fail_unless(sr_transform_logic_bit(test_sdi, test_channel("D5")) == 1);
+	fail_unless(sr_transform_logic_bit(test_sdi, test_channel("D0")) < 0);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, g_strdup("width"),
+		g_variant_ref_sink(g_variant_new_uint32(8)));
+	o = sr_output_new(sr_output_find("bits"), options, test_sdi, NULL);
+	g_hash_table_destroy(options);
+	fail_unless(o != NULL, "Cannot create 'bits' output.");
+	text = g_string_new(NULL);
+
+	memset(&header, 0, sizeof(header));
+	header.feed_version = 1;
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	test_output_send(o, text, test_feed(t, &packet));
+	out = test_feed_logic(t, data, ARRAY_SIZE(data), 1);
+	test_check_logic(out, expected, ARRAY_SIZE(data), 1);
+	test_output_send(o, text, out);
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	test_output_send(o, text, test_feed(t, &packet));
+
+	fail_unless(strstr(text->str, "D2:01010101\n") != NULL,
+		"Unexpected D2 data:\n%s", text->str);
+	fail_unless(strstr(text->str, "D5:00110011\n") != NULL,
+		"Unexpected D5 data:\n%s", text->str);
+	fail_unless(strstr(text->str, "D0:") == NULL,
+		"Deselected channel in output:\n%s", text->str);
+
+	g_string_free(text, TRUE);
+	sr_output_free(o);
+	sr_transform_free(t);
+}
+END_TEST
+
 Suite *suite_transform_all(void)
 {
 	Suite *s;
@@ -110,6 +694,28 @@ Suite *suite_transform_all(void)
 	tcase_add_test(tc, test_transform_desc);
 	tcase_add_test(tc, test_transform_find);
 	tcase_add_test(tc, test_transform_options);
+	tcase_add_test(tc, test_transform_decimate_options);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("decimate");
+	tcase_add_checked_fixture(tc, transform_setup, transform_teardown);
+	tcase_add_test(tc, test_transform_decimate_logic);
+	tcase_add_test(tc, test_transform_decimate_analog);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("threshold");
+	tcase_add_checked_fixture(tc, transform_setup, transform_teardown);
+	tcase_add_test(tc, test_transform_threshold);
+	tcase_add_test(tc, test_transform_threshold_mixed);
+	tcase_add_test(tc, test_transform_threshold_schmitt);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("repack");
+	tcase_add_checked_fixture(tc, transform_setup, transform_teardown);
+	tcase_add_test(tc, test_transform_repack_select);
+	tcase_add_test(tc, test_transform_repack_enabled);
+	tcase_add_test(tc, test_transform_repack_passthrough);
+	tcase_add_test(tc, test_transform_repack_output);
 	suite_add_tcase(s, tc);
 
 	return s;